@@ -0,0 +1,523 @@
+/*
+ * capture.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <zlib.h>
+#include "GL/glfw.h"
+#include "capture.h"
+
+/* states of a queue slot */
+enum {
+	CAPTURE_FREE,
+	CAPTURE_READING,
+	CAPTURE_QUEUED,
+	CAPTURE_ENCODING
+};
+
+/* names of capture_format_t values, also the file extensions */
+static const char *g_capture_format_names[CAPTURE_FORMAT_COUNT] = {
+	"png", "y4m"
+};
+
+/* locals */
+static double capture_now(void);
+static int capture_grow(uint8_t **buffer, size_t *size, size_t wanted);
+static void capture_be32(uint8_t *out, uint32_t v);
+static void capture_chunk(FILE *fp, const char *type, const uint8_t *data,
+		uint32_t length);
+static long capture_png(capture_t *c, capture_frame_t *f);
+static void capture_yuv(capture_frame_t *f);
+static long capture_y4m(capture_t *c, capture_frame_t *f);
+static capture_frame_t *capture_oldest(capture_t *c);
+static void *capture_thread(void *user);
+
+/*
+@returns monotonic time in seconds
+*/
+static double capture_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return(ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+/*
+Grow a buffer to at least wanted bytes.
+
+@returns 0 on success, -1 on allocation failure
+*/
+static int capture_grow(uint8_t **buffer, size_t *size, size_t wanted) {
+	uint8_t *grown;
+
+	if(wanted <= *size) {
+		return(0);
+	}
+	if((grown = (uint8_t*)realloc(*buffer, wanted)) == NULL) {
+		perror("capture_grow");
+		return(-1);
+	}
+	*buffer = grown;
+	*size = wanted;
+	return(0);
+}
+
+static void capture_be32(uint8_t *out, uint32_t v) {
+	out[0] = (uint8_t)(v >> 24);
+	out[1] = (uint8_t)(v >> 16);
+	out[2] = (uint8_t)(v >> 8);
+	out[3] = (uint8_t)v;
+}
+
+/*
+Write a PNG chunk: length, type, data and the CRC of type and data.
+*/
+static void capture_chunk(FILE *fp, const char *type, const uint8_t *data,
+		uint32_t length) {
+	uLong crc = crc32(0L, (const Bytef*)type, 4);
+	uint8_t word[4];
+
+	if(length > 0) {
+		crc = crc32(crc, data, length);
+	}
+	capture_be32(word, length);
+	fwrite(word, 4, 1, fp);
+	fwrite(type, 4, 1, fp);
+	if(length > 0) {
+		fwrite(data, length, 1, fp);
+	}
+	capture_be32(word, (uint32_t)crc);
+	fwrite(word, 4, 1, fp);
+}
+
+/*
+Write a frame to its numbered PNG file, RGB, each row filtered against the
+one above it.
+
+@returns bytes written, -1 on error
+*/
+static long capture_png(capture_t *c, capture_frame_t *f) {
+	static const uint8_t signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+	char name[FILENAME_MAX + 16];
+	size_t row = (size_t)f->width * 3;
+	size_t filtered = (row + 1) * f->height;
+	uint8_t header[13];
+	uLongf length;
+	FILE *fp;
+	size_t i;
+	int y;
+
+	if(capture_grow(&f->scratch, &f->scratch_size, filtered) ||
+			capture_grow(&f->encoded, &f->encoded_size,
+			compressBound(filtered))) {
+		return(-1);
+	}
+	/* top row first, GL reads them bottom up */
+	for(y = 0; y < f->height; y++) {
+		const uint8_t *in = &f->pixels[row * (f->height - 1 - y)];
+		uint8_t *out = &f->scratch[(row + 1) * y];
+		out[0] = y > 0 ? 2 : 0;
+		if(y == 0) {
+			memcpy(out + 1, in, row);
+			continue;
+		}
+		for(i = 0; i < row; i++) {
+			out[1 + i] = (uint8_t)(in[i] - in[i + row]);
+		}
+	}
+	length = (uLongf)f->encoded_size;
+	if(compress2(f->encoded, &length, f->scratch, (uLong)filtered,
+			Z_BEST_SPEED) != Z_OK) {
+		fprintf(stderr, "capture_png: compress2 failed\n");
+		return(-1);
+	}
+
+	snprintf(name, sizeof(name), "%s%06u.%s", c->path, f->number,
+		g_capture_format_names[CAPTURE_PNG]);
+	if((fp = fopen(name, "wb")) == NULL) {
+		perror(name);
+		return(-1);
+	}
+	capture_be32(&header[0], (uint32_t)f->width);
+	capture_be32(&header[4], (uint32_t)f->height);
+	/* 8 bit RGB, deflate, adaptive filtering, not interlaced */
+	header[8] = 8;
+	header[9] = 2;
+	header[10] = header[11] = header[12] = 0;
+	fwrite(signature, sizeof(signature), 1, fp);
+	capture_chunk(fp, "IHDR", header, sizeof(header));
+	capture_chunk(fp, "IDAT", f->encoded, (uint32_t)length);
+	capture_chunk(fp, "IEND", NULL, 0);
+	if(ferror(fp)) {
+		perror(name);
+		fclose(fp);
+		return(-1);
+	}
+	if(fclose(fp)) {
+		perror(name);
+		return(-1);
+	}
+	return((long)(sizeof(signature) + 3 * 12 + sizeof(header) + length));
+}
+
+/*
+Convert a frame to full range BT.601 Y, Cb and Cr planes, top row first,
+chroma averaged over each 2x2 block.
+*/
+static void capture_yuv(capture_frame_t *f) {
+	int w = f->width;
+	int h = f->height;
+	int cw = (w + 1) / 2;
+	int ch = (h + 1) / 2;
+	uint8_t *luma = f->encoded;
+	uint8_t *cb = luma + (size_t)w * h;
+	uint8_t *cr = cb + (size_t)cw * ch;
+	int x, y;
+
+	for(y = 0; y < h; y++) {
+		const uint8_t *in = &f->pixels[(size_t)w * 3 * (h - 1 - y)];
+		uint8_t *out = &luma[(size_t)w * y];
+		for(x = 0; x < w; x++, in += 3) {
+			out[x] = (uint8_t)((77 * in[0] + 150 * in[1] + 29 * in[2] + 128) >> 8);
+		}
+	}
+	for(y = 0; y < ch; y++) {
+		int y0 = h - 1 - 2 * y;
+		int y1 = y0 > 0 ? y0 - 1 : y0;
+		const uint8_t *row0 = &f->pixels[(size_t)w * 3 * y0];
+		const uint8_t *row1 = &f->pixels[(size_t)w * 3 * y1];
+		for(x = 0; x < cw; x++) {
+			int x0 = 2 * x * 3;
+			int x1 = 2 * x + 1 < w ? x0 + 3 : x0;
+			int r = row0[x0] + row0[x1] + row1[x0] + row1[x1];
+			int g = row0[x0 + 1] + row0[x1 + 1] + row1[x0 + 1] + row1[x1 + 1];
+			int b = row0[x0 + 2] + row0[x1 + 2] + row1[x0 + 2] + row1[x1 + 2];
+			/* sums of four, offset so the shift sees no negative value */
+			int u = (-43 * r - 85 * g + 128 * b + 4 * 32896) >> 10;
+			int v = (128 * r - 107 * g - 21 * b + 4 * 32896) >> 10;
+			cb[(size_t)cw * y + x] = (uint8_t)(u > 255 ? 255 : u);
+			cr[(size_t)cw * y + x] = (uint8_t)(v > 255 ? 255 : v);
+		}
+	}
+}
+
+/*
+Append a frame to the Y4M stream, after every frame numbered before it.
+
+@returns bytes written, -1 on error
+*/
+static long capture_y4m(capture_t *c, capture_frame_t *f) {
+	size_t planes = (size_t)f->width * f->height +
+		2 * (size_t)((f->width + 1) / 2) * ((f->height + 1) / 2);
+	int ready = capture_grow(&f->encoded, &f->encoded_size, planes) == 0;
+	long bytes = -1;
+
+	if(ready) {
+		capture_yuv(f);
+	}
+
+	/* wait for this frame's turn, the number is taken even on error */
+	pthread_mutex_lock(&c->lock);
+	while(c->streamed != f->number) {
+		pthread_cond_wait(&c->written, &c->lock);
+	}
+	pthread_mutex_unlock(&c->lock);
+	if(ready) {
+		if(ftell(c->stream) == 0) {
+			fprintf(c->stream, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n",
+				f->width, f->height, c->fps);
+		}
+		fputs("FRAME\n", c->stream);
+		fwrite(f->encoded, planes, 1, c->stream);
+		if(fflush(c->stream) || ferror(c->stream)) {
+			perror("capture_y4m");
+			clearerr(c->stream);
+		} else {
+			bytes = (long)(6 + planes);
+		}
+	}
+	pthread_mutex_lock(&c->lock);
+	c->streamed++;
+	pthread_cond_broadcast(&c->written);
+	pthread_mutex_unlock(&c->lock);
+	return(bytes);
+}
+
+/*
+@returns the queued frame numbered first, NULL if none.  Called with the
+lock held.
+*/
+static capture_frame_t *capture_oldest(capture_t *c) {
+	capture_frame_t *oldest = NULL;
+	int i;
+
+	for(i = 0; i < c->slots; i++) {
+		capture_frame_t *f = &c->frames[i];
+		if(f->state == CAPTURE_QUEUED &&
+				(oldest == NULL || f->number < oldest->number)) {
+			oldest = f;
+		}
+	}
+	return(oldest);
+}
+
+/*
+Encoding thread: encode queued frames oldest first until stopped with
+none left.
+*/
+static void *capture_thread(void *user) {
+	capture_t *c = (capture_t*)user;
+	capture_frame_t *f;
+	double start;
+	long bytes;
+
+	pthread_mutex_lock(&c->lock);
+	for(;;) {
+		if((f = capture_oldest(c)) == NULL) {
+			if(c->stopping) {
+				break;
+			}
+			pthread_cond_wait(&c->queued, &c->lock);
+			continue;
+		}
+		f->state = CAPTURE_ENCODING;
+		pthread_mutex_unlock(&c->lock);
+
+		start = capture_now();
+		bytes = c->format == CAPTURE_Y4M ? capture_y4m(c, f) :
+			capture_png(c, f);
+
+		pthread_mutex_lock(&c->lock);
+		if(bytes < 0) {
+			c->errors++;
+		} else {
+			c->encoded++;
+			c->bytes += (unsigned long long)bytes;
+		}
+		c->encode_seconds += capture_now() - start;
+		f->state = CAPTURE_FREE;
+		pthread_cond_signal(&c->freed);
+	}
+	pthread_mutex_unlock(&c->lock);
+	return(NULL);
+}
+
+/*
+@returns capture_format_t for name, -1 if unknown
+*/
+int capture_format_code(const char *name) {
+	int i;
+	for(i = 0; i < CAPTURE_FORMAT_COUNT; i++) {
+		if(!strcmp(name, g_capture_format_names[i])) {
+			return(i);
+		}
+	}
+	return(-1);
+}
+
+/*
+@returns name of a capture_format_t
+*/
+const char *capture_format_name(int format) {
+	return(format >= 0 && format < CAPTURE_FORMAT_COUNT ?
+		g_capture_format_names[format] : "unknown");
+}
+
+/*
+Start capturing, unless path is empty.  PNG frames are written to path
+followed by a six digit frame number, a Y4M stream to path.y4m.
+
+@param	c	capture state
+@param	path	file name prefix, empty to capture nothing
+@param	format	capture_format_t
+@param	interval	simulation seconds between frames, 0 for every timestep
+@param	fps	frames per second a Y4M stream plays at
+@param	threads	encoding threads
+@param	slots	frames read back and waiting to be encoded, at most
+
+@returns 0 on success, -1 on error
+*/
+int capture_init(capture_t *c, const char *path, int format, double interval,
+		int fps, int threads, int slots) {
+	char name[FILENAME_MAX + 16];
+	int err;
+
+	memset(c, 0, sizeof(capture_t));
+	pthread_mutex_init(&c->lock, NULL);
+	pthread_cond_init(&c->queued, NULL);
+	pthread_cond_init(&c->written, NULL);
+	pthread_cond_init(&c->freed, NULL);
+	if(path == NULL || path[0] == '\0') {
+		return(0);
+	}
+	strncpy(c->path, path, sizeof(c->path) - 1);
+	c->format = format;
+	c->interval = interval > 0.0 ? interval : 0.0;
+	c->fps = fps > 0 ? fps : 30;
+	threads = threads < 1 ? 1 : (threads > CAPTURE_THREADS_MAX ?
+		CAPTURE_THREADS_MAX : threads);
+	c->slots = slots < 1 ? 1 : slots;
+	if(format == CAPTURE_Y4M) {
+		snprintf(name, sizeof(name), "%s.%s", path,
+			g_capture_format_names[CAPTURE_Y4M]);
+		if((c->stream = fopen(name, "wb")) == NULL) {
+			perror(name);
+			return(-1);
+		}
+	}
+	if((c->frames = (capture_frame_t*)calloc(c->slots,
+			sizeof(capture_frame_t))) == NULL) {
+		perror("capture_init");
+		capture_free(c);
+		return(-1);
+	}
+	for(c->thread_count = 0; c->thread_count < threads; c->thread_count++) {
+		if((err = pthread_create(&c->threads[c->thread_count], NULL,
+				capture_thread, c))) {
+			fprintf(stderr, "capture_init: pthread_create: %s\n",
+				strerror(err));
+			capture_free(c);
+			return(-1);
+		}
+	}
+	c->enabled = 1;
+	return(0);
+}
+
+/*
+Encode the frames still queued, stop the threads and close the stream.
+*/
+void capture_free(capture_t *c) {
+	int i;
+
+	pthread_mutex_lock(&c->lock);
+	c->stopping = 1;
+	pthread_cond_broadcast(&c->queued);
+	pthread_mutex_unlock(&c->lock);
+	for(i = 0; i < c->thread_count; i++) {
+		pthread_join(c->threads[i], NULL);
+	}
+	if(c->stream != NULL) {
+		fclose(c->stream);
+	}
+	for(i = 0; c->frames != NULL && i < c->slots; i++) {
+		free(c->frames[i].pixels);
+		free(c->frames[i].encoded);
+		free(c->frames[i].scratch);
+	}
+	free(c->frames);
+	pthread_cond_destroy(&c->freed);
+	pthread_cond_destroy(&c->written);
+	pthread_cond_destroy(&c->queued);
+	pthread_mutex_destroy(&c->lock);
+	memset(c, 0, sizeof(capture_t));
+}
+
+/*
+Read the frame just drawn back for encoding, if a frame is due at its
+simulation time: once per interval, or for every new time if the interval
+is 0, and again whenever time goes back.  Render thread, before the buffers
+are swapped.  With every slot busy the frame is dropped, unless waiting for
+a slot, and the cadence is left for the next frame drawn to try again; so
+is it with a size the stream was not started with.  A frame due is counted
+dropped once however often it is tried.
+
+@param	c	capture state
+@param	t	simulation time of the frame
+@param	width	framebuffer size in pixels
+@param	height
+
+@returns 1 if captured, 0 if not due or dropped, -1 on error
+*/
+int capture_frame(capture_t *c, double t, int width, int height) {
+	double start = capture_now();
+	double due;
+	capture_frame_t *f = NULL;
+	int i;
+
+	if(!c->enabled || width <= 0 || height <= 0) {
+		return(0);
+	}
+	if(c->started && t >= c->last_t && (t == c->last_t || t < c->next)) {
+		return(0);
+	}
+	due = c->interval > 0.0 ? floor(t / c->interval) : t;
+
+	pthread_mutex_lock(&c->lock);
+	if(c->format == CAPTURE_Y4M && c->stream_width == 0) {
+		c->stream_width = width;
+		c->stream_height = height;
+	}
+	if(c->format != CAPTURE_Y4M ||
+			(width == c->stream_width && height == c->stream_height)) {
+		for(;;) {
+			for(i = 0; i < c->slots && f == NULL; i++) {
+				if(c->frames[i].state == CAPTURE_FREE) {
+					f = &c->frames[i];
+				}
+			}
+			if(f != NULL || !c->wait) {
+				break;
+			}
+			pthread_cond_wait(&c->freed, &c->lock);
+		}
+	}
+	if(f == NULL) {
+		if(!c->missing || c->missed != due) {
+			c->dropped++;
+		}
+		c->missing = 1;
+		c->missed = due;
+		pthread_mutex_unlock(&c->lock);
+		return(0);
+	}
+	c->missing = 0;
+	c->started = 1;
+	c->last_t = t;
+	c->next = c->interval > 0.0 ? (due + 1.0) * c->interval : t;
+	f->state = CAPTURE_READING;
+	pthread_mutex_unlock(&c->lock);
+
+	if(capture_grow(&f->pixels, &f->pixels_size,
+			(size_t)width * height * 3)) {
+		pthread_mutex_lock(&c->lock);
+		f->state = CAPTURE_FREE;
+		c->errors++;
+		pthread_mutex_unlock(&c->lock);
+		return(-1);
+	}
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, f->pixels);
+	f->width = width;
+	f->height = height;
+	f->t = t;
+
+	pthread_mutex_lock(&c->lock);
+	f->number = c->numbered++;
+	f->state = CAPTURE_QUEUED;
+	c->captured++;
+	pthread_cond_signal(&c->queued);
+	pthread_mutex_unlock(&c->lock);
+	c->last_read_seconds = capture_now() - start;
+	return(1);
+}
+
+/*
+@returns frames read back and not yet encoded
+*/
+unsigned int capture_pending(capture_t *c) {
+	unsigned int pending = 0;
+	int i;
+
+	pthread_mutex_lock(&c->lock);
+	for(i = 0; i < c->slots; i++) {
+		pending += c->frames[i].state != CAPTURE_FREE;
+	}
+	pthread_mutex_unlock(&c->lock);
+	return(pending);
+}
@@ -0,0 +1,112 @@
+/*
+ * capture.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Image sequences of the drawn frames.  At a cadence of simulation time the
+ * render thread reads the finished frame back into a free slot of a small
+ * queue and goes on drawing; encoding threads turn queued frames into
+ * numbered PNG files, or append them in order to one YUV4MPEG2 (Y4M)
+ * stream that video encoders read directly.  When every slot is waiting to
+ * be encoded the frame is dropped rather than the renderer held up, and
+ * taken instead if a slot frees while it is still due; drawing offscreen,
+ * where no one watches the frame rate, the renderer waits for a slot.
+ */
+
+#ifndef CAPTURE_H_
+#define CAPTURE_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+
+/* encoding threads at most */
+#define CAPTURE_THREADS_MAX 16
+
+/* file formats */
+typedef enum {
+	CAPTURE_PNG,
+	CAPTURE_Y4M,
+	CAPTURE_FORMAT_COUNT
+} capture_format_t;
+
+/*
+A queue slot: one frame's pixels and its encoding scratch.
+*/
+typedef struct {
+	/* RGB rows, bottom row first as read back, and their size */
+	uint8_t *pixels;
+	size_t pixels_size;
+	/* filtered and compressed PNG data, or YUV planes */
+	uint8_t *encoded;
+	size_t encoded_size;
+	uint8_t *scratch;
+	size_t scratch_size;
+	int width;
+	int height;
+	/* frame number in the sequence and its simulation time */
+	unsigned int number;
+	double t;
+	/* capture_state of the slot */
+	int state;
+} capture_frame_t;
+
+/*
+Cadence, queue, encoding threads and the stream they write.
+*/
+typedef struct {
+	/* non-zero if frames are captured */
+	int enabled;
+	/* capture_format_t, and the file name prefix */
+	int format;
+	char path[FILENAME_MAX];
+	/* simulation seconds between frames, 0 for every new timestep, and
+	frames per second a Y4M stream plays at */
+	double interval;
+	int fps;
+	/* non-zero to wait for a free slot rather than drop the frame */
+	int wait;
+	/* simulation time of the last frame taken and the next one due */
+	int started;
+	double last_t;
+	double next;
+	/* non-zero while a dropped frame is retried, and its interval */
+	int missing;
+	double missed;
+	/* guards the slots' states, numbers and the counters below */
+	pthread_mutex_t lock;
+	/* a frame was queued, a stream frame was written, or a slot freed */
+	pthread_cond_t queued;
+	pthread_cond_t written;
+	pthread_cond_t freed;
+	capture_frame_t *frames;
+	int slots;
+	pthread_t threads[CAPTURE_THREADS_MAX];
+	int thread_count;
+	int stopping;
+	/* frames numbered so far, and stream frames written in order */
+	unsigned int numbered;
+	unsigned int streamed;
+	/* Y4M stream and its frame size, fixed by the first frame */
+	FILE *stream;
+	int stream_width;
+	int stream_height;
+	/* statistics */
+	unsigned long long captured;
+	unsigned long long encoded;
+	unsigned long long dropped;
+	unsigned long long errors;
+	unsigned long long bytes;
+	double encode_seconds;
+	double last_read_seconds;
+} capture_t;
+
+int capture_format_code(const char *name);
+const char *capture_format_name(int format);
+int capture_init(capture_t *c, const char *path, int format, double interval,
+		int fps, int threads, int slots);
+void capture_free(capture_t *c);
+int capture_frame(capture_t *c, double t, int width, int height);
+unsigned int capture_pending(capture_t *c);
+
+#endif /* CAPTURE_H_ */
@@ -0,0 +1,344 @@
+/*
+ * completeness.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include "completeness.h"
+
+/* locals */
+static void completeness_slot_clear(completeness_t *c, completeness_slot_t *slot);
+static int completeness_slot_full(const completeness_slot_t *slot);
+static void completeness_slot_retire(completeness_t *c, completeness_slot_t *slot);
+static uint32_t completeness_wire_id(completeness_t *c,
+		const completeness_slot_t *slot, unsigned int index);
+static completeness_slot_t *completeness_slot_for(completeness_t *c, float t);
+static int completeness_slot_wants_nack(completeness_t *c, int i);
+
+/*
+Clear a slot bitmap.  Bits past the last index are set so that they never
+look missing.
+*/
+static void completeness_slot_clear(completeness_t *c, completeness_slot_t *slot) {
+	unsigned int tail = c->capacity % 64;
+	memset(slot->received, 0, c->words * sizeof(uint64_t));
+	if(tail) {
+		slot->received[c->words - 1] = ~((((uint64_t)1) << tail) - 1);
+	}
+	slot->particles = 0;
+	slot->unmapped = 0;
+	slot->keyframe = 0;
+	slot->nacks_sent = 0;
+	slot->used = 0;
+}
+
+/*
+@returns non-zero if every particle of the model arrived in a slot
+*/
+static int completeness_slot_full(const completeness_slot_t *slot) {
+	return(slot->particles + slot->unmapped >= slot->total_particle_count);
+}
+
+/*
+Account for a timestep leaving the tracking window.  A full keyframe
+carried every particle of the model: ids it lacks have left the model and
+give their index back.
+*/
+static void completeness_slot_retire(completeness_t *c, completeness_slot_t *slot) {
+	unsigned int w;
+	int complete;
+	if(!slot->used) {
+		return;
+	}
+	complete = completeness_slot_full(slot);
+	c->frames_seen++;
+	c->frames_complete += complete;
+	if(slot->keyframe) {
+		c->keyframes_seen++;
+		c->keyframes_complete += complete;
+	}
+	if(!slot->keyframe || !complete || c->ids == NULL) {
+		return;
+	}
+	for(w = 0; w < c->words; w++) {
+		uint64_t missing = ~slot->received[w];
+		while(missing) {
+			unsigned int index = w * 64 + (unsigned int)__builtin_ctzll(missing);
+			uint32_t id = idmap_id(c->ids, index);
+			if(id != IDMAP_NONE) {
+				idmap_remove(c->ids, id);
+			}
+			missing &= missing - 1;
+		}
+	}
+}
+
+/*
+@returns wire id of a store index, IDMAP_NONE if it has none or is past the
+model at the slot's timestep
+*/
+static uint32_t completeness_wire_id(completeness_t *c,
+		const completeness_slot_t *slot, unsigned int index) {
+	/* ids never seen are still known while they are their own index */
+	if(c->ids == NULL || c->ids->identity_size > 0) {
+		return(index < slot->total_particle_count ? index : IDMAP_NONE);
+	}
+	return(idmap_id(c->ids, index));
+}
+
+/*
+Find the slot tracking timestep t, recycling the oldest slot if t is newer
+than it.
+
+@returns slot or NULL if t is older than everything being tracked
+*/
+static completeness_slot_t *completeness_slot_for(completeness_t *c, float t) {
+	completeness_slot_t *oldest = NULL;
+	int i;
+	for(i = 0; i < COMPLETENESS_SLOTS; i++) {
+		completeness_slot_t *slot = &c->slots[i];
+		if(slot->used && slot->t == t) {
+			return(slot);
+		}
+		if(oldest == NULL || !slot->used ||
+				(oldest->used && slot->t < oldest->t)) {
+			oldest = slot;
+		}
+	}
+	if(oldest->used && oldest->t > t) {
+		return(NULL);
+	}
+	completeness_slot_retire(c, oldest);
+	completeness_slot_clear(c, oldest);
+	oldest->used = 1;
+	oldest->t = t;
+	oldest->total_particle_count = c->total_particle_count;
+	return(oldest);
+}
+
+/*
+Is slot i a closed, incomplete keyframe we should still ask for?
+*/
+static int completeness_slot_wants_nack(completeness_t *c, int i) {
+	completeness_slot_t *slot = &c->slots[i];
+	return(slot->used && slot->t < c->newest_t && slot->keyframe &&
+		!completeness_slot_full(slot) &&
+		slot->nacks_sent < COMPLETENESS_MAX_NACKS);
+}
+
+/*
+Initialize tracking for a model.
+
+@param	c	completeness structure
+@param	total_particle_count	number of particles in the model
+@param	ids	id map assigning the indices packets carry, NULL if they
+carry wire ids
+
+@returns 0 on success, -1 on allocation failure
+*/
+int completeness_init(completeness_t *c, unsigned int total_particle_count,
+		idmap_t *ids) {
+	int i;
+	memset(c, 0, sizeof(completeness_t));
+	c->total_particle_count = total_particle_count;
+	c->newest_t = -FLT_MAX;
+	c->ids = ids;
+	c->capacity = ids != NULL ? ids->capacity : total_particle_count;
+	c->words = (c->capacity + 63) / 64;
+	if(c->words == 0) {
+		c->words = 1;
+	}
+	for(i = 0; i < COMPLETENESS_SLOTS; i++) {
+		c->slots[i].received = (uint64_t*)malloc(c->words * sizeof(uint64_t));
+		if(c->slots[i].received == NULL) {
+			perror("completeness_init");
+			completeness_free(c);
+			return(-1);
+		}
+		completeness_slot_clear(c, &c->slots[i]);
+	}
+	return(0);
+}
+
+/*
+Release memory held by tracking.
+*/
+void completeness_free(completeness_t *c) {
+	int i;
+	for(i = 0; i < COMPLETENESS_SLOTS; i++) {
+		free(c->slots[i].received);
+		c->slots[i].received = NULL;
+	}
+}
+
+/*
+Follow a model whose particle count changed.  Bitmaps grow with the id
+map, keeping what the tracked timesteps received; the new indices are
+missing from them.
+
+@param	c	completeness structure
+@param	total_particle_count	number of particles in the model
+
+@returns 0 on success, -1 on allocation failure
+*/
+int completeness_resize(completeness_t *c, unsigned int total_particle_count) {
+	unsigned int capacity = c->ids != NULL ? c->ids->capacity :
+		total_particle_count;
+	unsigned int words = (capacity + 63) / 64;
+	unsigned int tail = c->capacity % 64;
+	int i;
+
+	c->total_particle_count = total_particle_count;
+	if(capacity <= c->capacity) {
+		return(0);
+	}
+	for(i = 0; i < COMPLETENESS_SLOTS; i++) {
+		completeness_slot_t *slot = &c->slots[i];
+		uint64_t *received = (uint64_t*)realloc(slot->received,
+			words * sizeof(uint64_t));
+		if(received == NULL) {
+			perror("completeness_resize");
+			return(-1);
+		}
+		slot->received = received;
+	}
+	for(i = 0; i < COMPLETENESS_SLOTS; i++) {
+		completeness_slot_t *slot = &c->slots[i];
+		/* the old tail bits are indices now */
+		if(tail) {
+			slot->received[c->words - 1] &= (((uint64_t)1) << tail) - 1;
+		}
+		memset(slot->received + c->words, 0,
+			(words - c->words) * sizeof(uint64_t));
+		if(capacity % 64) {
+			slot->received[words - 1] |= ~((((uint64_t)1) << (capacity % 64)) - 1);
+		}
+	}
+	c->capacity = capacity;
+	c->words = words;
+	return(0);
+}
+
+/*
+Record the particles carried by a packet.
+
+@param	c	completeness structure
+@param	packet	received packet
+*/
+void completeness_add(completeness_t *c, const ptp_packet_t *packet) {
+	completeness_slot_t *slot;
+	unsigned int i;
+
+	if(c->slots[0].received == NULL) {
+		return;
+	}
+	if(packet->flags & PTP_FLAG_RETRANSMIT) {
+		c->retransmits_received++;
+	}
+	/* any newer packet closes the timesteps before it */
+	if(packet->t > c->newest_t) {
+		c->newest_t = packet->t;
+	}
+	if(packet->flags & PTP_FLAG_SUBSET) {
+		/* tracked subset steps are never expected to be complete */
+		c->subset_packets++;
+		return;
+	}
+	if((slot = completeness_slot_for(c, packet->t)) == NULL) {
+		/* too old to matter */
+		return;
+	}
+	if(packet->flags & PTP_FLAG_KEYFRAME) {
+		slot->keyframe = 1;
+	}
+	for(i = 0; i < packet->particle_count && i < PTP_PARTICLES_PER_PACKET; i++) {
+		unsigned int id = packet->data[i].id;
+		uint64_t bit;
+		if(id >= c->capacity) {
+			slot->unmapped += c->ids != NULL;
+			continue;
+		}
+		bit = ((uint64_t)1) << (id % 64);
+		if(!(slot->received[id / 64] & bit)) {
+			slot->received[id / 64] |= bit;
+			slot->particles++;
+		}
+	}
+}
+
+/*
+@returns non-zero if some closed keyframe is missing particles
+*/
+int completeness_nack_pending(completeness_t *c) {
+	int i;
+	for(i = 0; i < COMPLETENESS_SLOTS; i++) {
+		if(completeness_slot_wants_nack(c, i)) {
+			return(1);
+		}
+	}
+	return(0);
+}
+
+/*
+Fill the NACK part of a heartbeat with the missing id ranges of the most
+recent closed, incomplete keyframe.  Ranges beyond PTP_NACK_MAX_RANGES are
+left for a later heartbeat.  Once ids are out of identity only those
+seen before can be asked for, and ranges follow the wire ids.
+
+@param	c	completeness structure
+@param	hb	heartbeat packet, nack_t, nack_count and nack[] are set
+
+@returns number of ranges
+*/
+unsigned short completeness_build_nack(completeness_t *c,
+		ptp_heartbeat_packet_t *hb) {
+	completeness_slot_t *slot = NULL;
+	unsigned short n = 0;
+	unsigned int w;
+	int full = 0;
+	int i;
+
+	hb->nack_count = 0;
+	for(i = 0; i < COMPLETENESS_SLOTS; i++) {
+		if(completeness_slot_wants_nack(c, i) &&
+				(slot == NULL || c->slots[i].t > slot->t)) {
+			slot = &c->slots[i];
+		}
+	}
+	if(slot == NULL) {
+		return(0);
+	}
+
+	/* walk the bitmap, coalescing runs of missing ids, until a range past
+	the last would be needed */
+	for(w = 0; w < c->words && !full; w++) {
+		uint64_t missing = ~slot->received[w];
+		while(missing) {
+			unsigned int bit = (unsigned int)__builtin_ctzll(missing);
+			uint32_t id = completeness_wire_id(c, slot, w * 64 + bit);
+			missing &= missing - 1;
+			if(id == IDMAP_NONE) {
+				continue;
+			}
+			if(n > 0 && hb->nack[n - 1].first_id + hb->nack[n - 1].count == id) {
+				hb->nack[n - 1].count++;
+			} else if(n < PTP_NACK_MAX_RANGES) {
+				hb->nack[n].first_id = id;
+				hb->nack[n].count = 1;
+				n++;
+			} else {
+				full = 1;
+				break;
+			}
+		}
+	}
+	hb->nack_t = slot->t;
+	hb->nack_count = n;
+	slot->nacks_sent++;
+	c->nacks_sent++;
+	return(n);
+}
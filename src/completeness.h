@@ -0,0 +1,88 @@
+/*
+ * completeness.h
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#ifndef COMPLETENESS_H_
+#define COMPLETENESS_H_
+
+#include <sys/types.h>
+#include <stdint.h>
+#include "ptp.h"
+#include "idmap.h"
+
+/* number of most recent timesteps tracked at once */
+#define COMPLETENESS_SLOTS 4
+
+/* give up asking for a timestep after this many NACKs */
+#define COMPLETENESS_MAX_NACKS 4
+
+/*
+Per-timestep reception state.
+*/
+typedef struct {
+	/* timestamp of this timestep */
+	float t;
+	/* non-zero if slot is in use */
+	int used;
+	/* non-zero if any packet of this timestep was a keyframe packet */
+	int keyframe;
+	/* particles in the model at this timestep */
+	unsigned int total_particle_count;
+	/* number of distinct particles received */
+	unsigned int particles;
+	/* particles received without a store index, never asked for again */
+	unsigned int unmapped;
+	/* NACKs sent for this timestep */
+	int nacks_sent;
+	/* one bit per store index, set when received */
+	uint64_t *received;
+} completeness_slot_t;
+
+/*
+Tracks which particles of the most recent timesteps have been received.
+Packets carry store indices of ids, as idmap_index() assigned them, so
+bitmaps follow the id map's capacity however sparse the wire ids are.
+NACKs name wire ids again.
+*/
+typedef struct {
+	/* number of particles in the model */
+	unsigned int total_particle_count;
+	/* ids of the indices, NULL if packets carry wire ids below
+	total_particle_count */
+	idmap_t *ids;
+	/* number of bits and of 64 bit words in each slot bitmap */
+	unsigned int capacity;
+	unsigned int words;
+	/* newest timestamp of any tracked packet, subset packets included;
+	slots older than it are closed */
+	float newest_t;
+	/* tracked timesteps */
+	completeness_slot_t slots[COMPLETENESS_SLOTS];
+	/* timesteps retired from tracking */
+	int frames_seen;
+	/* timesteps retired with every particle received */
+	int frames_complete;
+	/* keyframe timesteps retired from tracking */
+	int keyframes_seen;
+	/* keyframe timesteps retired with every particle received */
+	int keyframes_complete;
+	/* tracked subset packets received */
+	int subset_packets;
+	/* retransmitted packets received */
+	int retransmits_received;
+	/* NACK heartbeats built */
+	int nacks_sent;
+} completeness_t;
+
+int completeness_init(completeness_t *c, unsigned int total_particle_count,
+		idmap_t *ids);
+void completeness_free(completeness_t *c);
+int completeness_resize(completeness_t *c, unsigned int total_particle_count);
+void completeness_add(completeness_t *c, const ptp_packet_t *packet);
+int completeness_nack_pending(completeness_t *c);
+unsigned short completeness_build_nack(completeness_t *c,
+		ptp_heartbeat_packet_t *hb);
+
+#endif /* COMPLETENESS_H_ */
@@ -0,0 +1,368 @@
+/*
+ * cull.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include <time.h>
+#include "cull.h"
+
+/* parallel pass arguments */
+typedef struct {
+	cull_t *cull;
+	/* bounds: vertices and their count */
+	const store_vertex_t *vertex;
+	unsigned int count;
+	/* frustum: inward planes a, b, c, d and box padding */
+	float planes[6][4];
+	float margin;
+	/* visible chunks and their particles, per worker */
+	unsigned int visible[PARALLEL_MAX_THREADS];
+	unsigned int submitted[PARALLEL_MAX_THREADS];
+} cull_job_t;
+
+/* locals */
+static double cull_now(void);
+static int cull_reserve(float **box, unsigned int *capacity,
+		unsigned int chunks);
+static void cull_bounds_pass(void *user, unsigned int begin, unsigned int end,
+		int worker);
+static void cull_frustum_pass(void *user, unsigned int begin, unsigned int end,
+		int worker);
+
+/*
+@returns monotonic time in seconds
+*/
+static double cull_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return(ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+/*
+Grow a box array to hold chunks boxes.
+
+@returns 0 on success, -1 on allocation failure
+*/
+static int cull_reserve(float **box, unsigned int *capacity,
+		unsigned int chunks) {
+	float *grown;
+
+	if(chunks <= *capacity) {
+		return(0);
+	}
+	if((grown = (float*)realloc(*box, chunks * 6 * sizeof(float))) == NULL) {
+		perror("cull_reserve");
+		return(-1);
+	}
+	*box = grown;
+	*capacity = chunks;
+	return(0);
+}
+
+/*
+Bound this worker's chunks into the spare boxes.
+*/
+static void cull_bounds_pass(void *user, unsigned int begin, unsigned int end,
+		int worker) {
+	cull_job_t *job = (cull_job_t*)user;
+	unsigned int chunk;
+	(void)worker;
+
+	for(chunk = begin; chunk < end; chunk++) {
+		float *b = &job->cull->spare[chunk * 6];
+		unsigned int slot = chunk * CULL_CHUNK;
+		unsigned int last = slot + CULL_CHUNK;
+		if(last > job->count) {
+			last = job->count;
+		}
+		b[0] = b[1] = b[2] = FLT_MAX;
+		b[3] = b[4] = b[5] = -FLT_MAX;
+		for(; slot < last; slot++) {
+			const float *p = job->vertex[slot].pos;
+			b[0] = p[0] < b[0] ? p[0] : b[0];
+			b[1] = p[1] < b[1] ? p[1] : b[1];
+			b[2] = p[2] < b[2] ? p[2] : b[2];
+			b[3] = p[0] > b[3] ? p[0] : b[3];
+			b[4] = p[1] > b[4] ? p[1] : b[4];
+			b[5] = p[2] > b[5] ? p[2] : b[5];
+		}
+	}
+}
+
+/*
+Test this worker's chunks against the frustum.
+*/
+static void cull_frustum_pass(void *user, unsigned int begin, unsigned int end,
+		int worker) {
+	cull_job_t *job = (cull_job_t*)user;
+	cull_t *c = job->cull;
+	unsigned int visible = 0;
+	unsigned int submitted = 0;
+	unsigned int chunk;
+
+	for(chunk = begin; chunk < end; chunk++) {
+		int inside = cull_box(job->planes, &c->box[chunk * 6], job->margin);
+		c->visible[chunk] = (uint8_t)inside;
+		if(inside) {
+			unsigned int last = (chunk + 1) * CULL_CHUNK;
+			if(last > c->count) {
+				last = c->count;
+			}
+			visible++;
+			submitted += last - chunk * CULL_CHUNK;
+		}
+	}
+	job->visible[worker] += visible;
+	job->submitted[worker] += submitted;
+}
+
+/*
+Inward frustum planes of the current transforms, normalized so distances
+are in world units.
+
+@param	modelview	as glGetDoublev()
+@param	projection
+@param	planes	a, b, c, d of each plane
+*/
+void cull_planes(const double modelview[16],
+		const double projection[16], float planes[6][4]) {
+	double clip[16];
+	int row, col, k, i;
+
+	/* clip = projection * modelview, column major */
+	for(col = 0; col < 4; col++) {
+		for(row = 0; row < 4; row++) {
+			clip[col * 4 + row] = 0.0;
+			for(k = 0; k < 4; k++) {
+				clip[col * 4 + row] += projection[k * 4 + row] *
+					modelview[col * 4 + k];
+			}
+		}
+	}
+	/* w + x, w - x, w + y, w - y, w + z, w - z */
+	for(i = 0; i < 6; i++) {
+		double sign = (i & 1) ? -1.0 : 1.0;
+		double length;
+		double p[4];
+		for(col = 0; col < 4; col++) {
+			p[col] = clip[col * 4 + 3] + sign * clip[col * 4 + i / 2];
+		}
+		length = sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+		for(col = 0; col < 4; col++) {
+			planes[i][col] = (float)(length > 0.0 ? p[col] / length : p[col]);
+		}
+	}
+}
+
+/*
+Test a box against frustum planes.  A box is outside if its corner furthest
+along some plane's normal is behind that plane.
+
+@param	planes	from cull_planes()
+@param	b	min x, y, z then max x, y, z, empty if min x > max x
+@param	margin	distance a box may lie outside and still count
+
+@returns non-zero if the box may be inside
+*/
+int cull_box(float planes[6][4], const float b[6], float margin) {
+	int i;
+
+	if(b[0] > b[3]) {
+		return(0);
+	}
+	for(i = 0; i < 6; i++) {
+		const float *p = planes[i];
+		float x = p[0] >= 0.0f ? b[3] : b[0];
+		float y = p[1] >= 0.0f ? b[4] : b[1];
+		float z = p[2] >= 0.0f ? b[5] : b[2];
+		if(p[0] * x + p[1] * y + p[2] * z + p[3] < -margin) {
+			return(0);
+		}
+	}
+	return(1);
+}
+
+/*
+Initialize, arrays are sized by the first cull_bounds().
+
+@param	c	culling state
+@param	enabled	non-zero to compute boxes
+*/
+void cull_init(cull_t *c, int enabled) {
+	memset(c, 0, sizeof(cull_t));
+	pthread_mutex_init(&c->lock, NULL);
+	c->enabled = enabled;
+}
+
+/*
+Free the arrays.
+*/
+void cull_free(cull_t *c) {
+	free(c->box);
+	free(c->spare);
+	free(c->visible);
+	free(c->first);
+	free(c->length);
+	pthread_mutex_destroy(&c->lock);
+	memset(c, 0, sizeof(cull_t));
+}
+
+/*
+Bound each chunk of the store's vertices and publish the boxes.  Data
+thread, as each timestep is published, after the slots are ordered.
+
+@param	c	culling state
+@param	s	store
+@param	pool	threads for the pass
+
+@returns 0 on success, -1 on allocation failure
+*/
+int cull_bounds(cull_t *c, const store_t *s, parallel_t *pool) {
+	double start = cull_now();
+	unsigned int chunks = (s->count + CULL_CHUNK - 1) / CULL_CHUNK;
+	unsigned int capacity;
+	cull_job_t job;
+	float *box;
+
+	if(!c->enabled) {
+		return(0);
+	}
+	if(cull_reserve(&c->spare, &c->spare_capacity, chunks)) {
+		return(-1);
+	}
+	job.cull = c;
+	job.vertex = s->vertex;
+	job.count = s->count;
+	parallel_for(pool, chunks, cull_bounds_pass, &job);
+
+	/* swap the finished boxes in */
+	pthread_mutex_lock(&c->lock);
+	box = c->box;
+	capacity = c->box_capacity;
+	c->box = c->spare;
+	c->box_capacity = c->spare_capacity;
+	c->spare = box;
+	c->spare_capacity = capacity;
+	c->chunks = chunks;
+	c->count = s->count;
+	c->store = s;
+	pthread_mutex_unlock(&c->lock);
+
+	c->last_bound_seconds = cull_now() - start;
+	c->bound_seconds += c->last_bound_seconds;
+	c->bounds++;
+	return(0);
+}
+
+/*
+Find the chunks of a store inside the view frustum, for cull_ranges().
+Render thread.
+
+@param	c	culling state
+@param	s	store to be drawn
+@param	pool	threads, used only for very many chunks
+@param	modelview	transforms the store is drawn with, as glGetDoublev()
+@param	projection
+@param	margin	world units particles reach past their centers
+
+@returns 0 on success, -1 if there are no boxes for the store
+*/
+int cull_frustum(cull_t *c, const store_t *s, parallel_t *pool,
+		const double modelview[16], const double projection[16],
+		float margin) {
+	double start = cull_now();
+	cull_job_t job;
+	int i;
+
+	pthread_mutex_lock(&c->lock);
+	if(c->store != s || c->count != s->count || c->chunks == 0) {
+		pthread_mutex_unlock(&c->lock);
+		return(-1);
+	}
+	if(c->chunks > c->visible_capacity) {
+		uint8_t *visible = (uint8_t*)realloc(c->visible, c->chunks);
+		GLint *first = (GLint*)realloc(c->first,
+			(c->chunks + 1) * sizeof(GLint));
+		GLsizei *length = (GLsizei*)realloc(c->length,
+			(c->chunks + 1) * sizeof(GLsizei));
+		if(visible != NULL) {
+			c->visible = visible;
+		}
+		if(first != NULL) {
+			c->first = first;
+		}
+		if(length != NULL) {
+			c->length = length;
+		}
+		if(visible == NULL || first == NULL || length == NULL) {
+			perror("cull_frustum");
+			pthread_mutex_unlock(&c->lock);
+			return(-1);
+		}
+		c->visible_capacity = c->chunks;
+	}
+	job.cull = c;
+	job.margin = margin;
+	cull_planes(modelview, projection, job.planes);
+	memset(job.visible, 0, sizeof(job.visible));
+	memset(job.submitted, 0, sizeof(job.submitted));
+	if(c->chunks >= CULL_PARALLEL_CHUNKS) {
+		parallel_for(pool, c->chunks, cull_frustum_pass, &job);
+	} else {
+		cull_frustum_pass(&job, 0, c->chunks, 0);
+	}
+	c->visible_chunks = c->chunks;
+	pthread_mutex_unlock(&c->lock);
+
+	c->last_visible = 0;
+	c->last_submitted = 0;
+	for(i = 0; i < PARALLEL_MAX_THREADS; i++) {
+		c->last_visible += job.visible[i];
+		c->last_submitted += job.submitted[i];
+	}
+	c->last_cull_seconds = cull_now() - start;
+	return(0);
+}
+
+/*
+Visible runs of slots begin to end, into first and length, adjacent runs
+merged.  Slots past the chunks last tested count as visible.  Render thread,
+after cull_frustum().
+
+@param	c	culling state
+@param	begin	first slot
+@param	end	one past the last slot
+
+@returns runs
+*/
+GLsizei cull_ranges(cull_t *c, unsigned int begin, unsigned int end) {
+	GLsizei runs = 0;
+	unsigned int slot = begin;
+
+	while(slot < end) {
+		unsigned int chunk = slot / CULL_CHUNK;
+		unsigned int next = chunk < c->visible_chunks ?
+			(chunk + 1) * CULL_CHUNK : end;
+		if(next > end) {
+			next = end;
+		}
+		if(chunk >= c->visible_chunks || c->visible[chunk]) {
+			if(runs > 0 && (unsigned int)(c->first[runs - 1] +
+					c->length[runs - 1]) == slot) {
+				c->length[runs - 1] += (GLsizei)(next - slot);
+			} else {
+				c->first[runs] = (GLint)slot;
+				c->length[runs] = (GLsizei)(next - slot);
+				runs++;
+			}
+		}
+		slot = next;
+	}
+	return(runs);
+}
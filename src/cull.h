@@ -0,0 +1,74 @@
+/*
+ * cull.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Frustum culling of particles by chunk.  The store's slots are cut into
+ * runs of CULL_CHUNK; with slots in Morton order (morton.h) each run is a
+ * compact region of space.  As each timestep is published the publish thread
+ * computes every run's bounding box in parallel, and each frame the
+ * renderer tests the boxes against the view frustum and draws the visible
+ * runs of each type with one glMultiDrawArrays.  Finished boxes are swapped
+ * in under a lock of their own, so neither thread waits on the other's
+ * pass.  Boxes belong to the live store; replayed frames are drawn whole.
+ */
+
+#ifndef CULL_H_
+#define CULL_H_
+
+#include <pthread.h>
+#include "GL/glfw.h"
+#include "store.h"
+#include "parallel.h"
+
+/* slots per bounding box */
+#define CULL_CHUNK 1024
+/* boxes a frame tests before it shares the test out to the pool */
+#define CULL_PARALLEL_CHUNKS 16384
+
+/*
+Chunk boxes, their visibility and the draw ranges built from it.
+*/
+typedef struct {
+	/* non-zero to compute boxes */
+	int enabled;
+	/* guards the published boxes: store, count, box, chunks */
+	pthread_mutex_t lock;
+	/* store and particle count the boxes were computed for */
+	const store_t *store;
+	unsigned int count;
+	/* GL-order min x, y, z then max x, y, z of each chunk */
+	float *box;
+	unsigned int chunks;
+	unsigned int box_capacity;
+	/* boxes being computed, publish thread only, swapped with box */
+	float *spare;
+	unsigned int spare_capacity;
+	/* visibility of each chunk in the last frame tested, render thread */
+	uint8_t *visible;
+	unsigned int visible_chunks;
+	unsigned int visible_capacity;
+	/* ranges of one type, visible_capacity + 1 long, render thread */
+	GLint *first;
+	GLsizei *length;
+	/* statistics of boxes, publish thread */
+	unsigned long long bounds;
+	double bound_seconds;
+	double last_bound_seconds;
+	/* statistics of the last frame tested, render thread */
+	unsigned int last_visible;
+	unsigned int last_submitted;
+	double last_cull_seconds;
+} cull_t;
+
+void cull_init(cull_t *c, int enabled);
+void cull_free(cull_t *c);
+int cull_bounds(cull_t *c, const store_t *s, parallel_t *pool);
+int cull_frustum(cull_t *c, const store_t *s, parallel_t *pool,
+		const double modelview[16], const double projection[16], float margin);
+GLsizei cull_ranges(cull_t *c, unsigned int begin, unsigned int end);
+void cull_planes(const double modelview[16], const double projection[16],
+		float planes[6][4]);
+int cull_box(float planes[6][4], const float b[6], float margin);
+
+#endif /* CULL_H_ */
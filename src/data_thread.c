@@ -19,6 +19,7 @@
 #include <netdb.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <getopt.h>
 #include <assert.h>
 #include "util.h"
@@ -26,6 +27,282 @@
 #include "seewaves.h"
 #include "ptp.h"
 
+/* locals */
+static void data_thread_load(seewaves_t *sw, const ptp_packet_t *packet);
+static void data_thread_grow(seewaves_t *sw, const ptp_packet_t *packet);
+static void data_thread_retire(seewaves_t *sw);
+static void data_thread_apply(seewaves_t *sw, const ptp_packet_t *packet);
+static void data_thread_show(seewaves_t *sw);
+static void data_thread_publish(seewaves_t *sw, float t);
+
+/*
+Allocate the store for a new model, freeing the last one.  Publish thread,
+with publish_lock held.
+
+@param  sw  seewaves pointer
+@param  packet  first packet of the model
+*/
+static void data_thread_load(seewaves_t *sw, const ptp_packet_t *packet) {
+    pthread_mutex_lock(&sw->store_lock);
+    if (sw->store.t != NULL) {
+        /* not first time, but different count, so free */
+        stream_detach(&sw->stream, &sw->store);
+        store_free(&sw->store);
+    }
+    if (store_init(&sw->store, packet->total_particle_count, &sw->palette)) {
+        exit(EXIT_FAILURE);
+    }
+    sw->ids_cleared = 0;
+    memcpy(sw->world_origin, packet->world_origin, sizeof(packet->world_origin));
+    memcpy(sw->world_size, packet->world_size, sizeof(packet->world_size));
+    sw->rotation_center[0] = sw->world_origin[0] + sw->world_size[0] / 2.0;
+    sw->rotation_center[1] = sw->world_origin[2] + sw->world_size[2] / 2.0;
+    sw->rotation_center[2] = sw->world_origin[1] + sw->world_size[1] / 2.0;
+    pthread_mutex_unlock(&sw->store_lock);
+
+    if(sw->history.max_frames || sw->history.max_bytes) {
+        history_reset(&sw->history, packet->total_particle_count,
+            sw->world_origin, sw->world_size);
+    }
+}
+
+/*
+Make room for particles added to the model, keeping the ones stored.
+History frames hold the old count, so history restarts.  Publish thread,
+with publish_lock held.
+
+@param  sw  seewaves pointer
+@param  packet  packet counting more particles than the store holds
+*/
+static void data_thread_grow(seewaves_t *sw, const ptp_packet_t *packet) {
+    pthread_mutex_lock(&sw->store_lock);
+    stream_detach(&sw->stream, &sw->store);
+    if (store_resize(&sw->store, packet->total_particle_count)) {
+        exit(EXIT_FAILURE);
+    }
+    pthread_mutex_unlock(&sw->store_lock);
+
+    if(sw->history.max_frames || sw->history.max_bytes) {
+        history_reset(&sw->history, packet->total_particle_count,
+            sw->world_origin, sw->world_size);
+    }
+}
+
+/*
+Clear the particles whose ids left the model since the last call, once the
+id map has given their index back.  Publish thread, with publish_lock held.
+
+@param  sw  seewaves pointer
+*/
+static void data_thread_retire(seewaves_t *sw) {
+    unsigned int id;
+
+    pthread_mutex_lock(&sw->store_lock);
+    pthread_mutex_lock(&sw->lock);
+    if (sw->ids.removed != sw->ids_cleared) {
+        for (id = 0; id < sw->store.count; id++) {
+            if (sw->store.t[id] != STORE_T_NONE &&
+                    idmap_id(&sw->ids, id) == IDMAP_NONE) {
+                store_clear(&sw->store, id);
+            }
+        }
+        sw->ids_cleared = sw->ids.removed;
+    }
+    pthread_mutex_unlock(&sw->lock);
+    pthread_mutex_unlock(&sw->store_lock);
+}
+
+/*
+Write the particles of a packet to the store.  Publish thread, with
+publish_lock and store_lock held.
+
+@param  sw  seewaves pointer
+@param  packet  packet of the store's model, carrying store indices
+*/
+static void data_thread_apply(seewaves_t *sw, const ptp_packet_t *packet) {
+    unsigned int particle;
+
+    for(particle = 0; particle < packet->particle_count &&
+            particle < PTP_PARTICLES_PER_PACKET; particle++) {
+        /* the data thread mapped the particle id, none once the store is
+         * full of other ids */
+        unsigned int id = packet->data[particle].id;
+        if(id >= sw->store.count) {
+            continue;
+        }
+        /* retransmits may be older than what we already have */
+        if(packet->t < sw->store.t[id]) {
+            continue;
+        }
+        /* convert once, here, to the store layout */
+        store_set(&sw->store, id, packet->t,
+            packet->data[particle].position[0],
+            packet->data[particle].position[1],
+            packet->data[particle].position[2],
+            store_type_code(packet->data[particle].particle_type));
+    }
+}
+
+/*
+Hand the store's vertices to the renderer and ask for a frame.  Publish
+thread, with publish_lock held.
+
+@param  sw  seewaves pointer
+*/
+static void data_thread_show(seewaves_t *sw) {
+    /* hand the vertices to the renderer if streaming */
+    pthread_mutex_lock(&sw->store_lock);
+    stream_publish(&sw->stream, &sw->store);
+    pthread_mutex_unlock(&sw->store_lock);
+
+    /* there is something new to draw */
+    redraw_post(&sw->redraw, REDRAW_DATA);
+}
+
+/*
+Publish the timestep held in the store.  Publish thread, with publish_lock
+held, once the timestep is as complete as it will get: the first packet of
+a newer timestep came off the queue, every particle carries it, or no
+packet came for DATA_THREAD_IDLE_MS.  The passes read the store without
+store_lock: only this thread writes it, and publish_lock keeps the renderer
+from attaching it to the stream ring meanwhile.  What the renderer draws is
+replaced under store_lock, or swapped in under the cull and lod locks.
+
+@param  sw  seewaves pointer
+@param  t   timestamp of the timestep
+*/
+static void data_thread_publish(seewaves_t *sw, float t) {
+    /* particles that left the model are not drawn any more */
+    data_thread_retire(sw);
+
+    /* keep it for replay, a no-op if history is disabled */
+    (void)history_add(&sw->history, &sw->store, t);
+
+    /* keep slots in spatial order, then re-index for spatial queries */
+    (void)morton_order(&sw->order, &sw->store, &sw->pool, sw->world_origin,
+        sw->world_size, &sw->store_lock);
+    (void)grid_build(&sw->grid, &sw->store, &sw->pool, sw->world_origin,
+        sw->world_size);
+
+    /* chunk boxes and octree of the new order, for culling and detail */
+    (void)cull_bounds(&sw->cull, &sw->store, &sw->pool);
+    (void)lod_build(&sw->lod, &sw->store, &sw->order, &sw->pool);
+
+    /* velocity from this sample and the last, recolors fluid if enabled */
+    (void)motion_update(&sw->motion, &sw->store, &sw->pool, &sw->store_lock);
+
+    data_thread_show(sw);
+}
+
+/*
+Publish thread loop.  Takes the packets the data thread queued, in batches,
+applies them to the store and publishes each timestep once it is complete,
+see data_thread_publish().  Packets applied to a timestep already published,
+late or retransmitted, are shown without running the passes again.
+
+@param  user_data   seewaves_t ptr cast to void ptr.
+
+@returns NULL
+*/
+void *data_thread_publish_main(void *user_data) {
+    /* cast to our global data structure pointer */
+    seewaves_t *sw = (seewaves_t*)user_data;
+
+    /* packets taken off the queue at once */
+    ptp_packet_t *batch;
+    int count;
+
+    /* model in the store, newest timestamp applied and timesteps seen */
+    pid_t model = 0;
+    float newest = -FLT_MAX;
+    int timesteps = 0;
+
+    /* newest timestep published, packets applied since */
+    int published = 0;
+    int late = 0;
+
+    if ((batch = (ptp_packet_t*)malloc(DATA_THREAD_BATCH *
+            sizeof(ptp_packet_t))) == NULL) {
+        perror("data_thread_publish_main");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Loop until the queue is closed */
+    while ((count = packet_queue_take(&sw->queue, batch, DATA_THREAD_BATCH,
+            DATA_THREAD_IDLE_MS)) >= 0) {
+        int i = 0;
+
+        pthread_mutex_lock(&sw->publish_lock);
+
+        /* nothing came for a while, the simulation paused or ended */
+        if (count == 0 && timesteps > 0 && !published) {
+            data_thread_publish(sw, newest);
+            published = 1;
+        }
+
+        while (i < count) {
+            int end;
+            int full;
+
+            /* allocate memory if first time or new model */
+            if (sw->store.t == NULL || batch[i].model_id != model) {
+                data_thread_load(sw, &batch[i]);
+                model = batch[i].model_id;
+                /* timestamps restart with the model */
+                newest = -FLT_MAX;
+                timesteps = 0;
+            } else if (batch[i].total_particle_count > sw->store.count) {
+                data_thread_grow(sw, &batch[i]);
+            }
+
+            /* KAG - fix me, should be list, they can be out-of-order
+             * keep most recent timestamp */
+            if (batch[i].t > newest) {
+                /* the previous timestep is as complete as it will get */
+                if (timesteps > 0 && !published) {
+                    data_thread_publish(sw, newest);
+                }
+                newest = batch[i].t;
+                timesteps++;
+                published = 0;
+            }
+
+            /* apply packets up to the next timestep or model at once */
+            for (end = i + 1; end < count && batch[end].model_id == model &&
+                    !(batch[end].t > newest); end++) {
+            }
+            pthread_mutex_lock(&sw->store_lock);
+            for (; i < end; i++) {
+                data_thread_apply(sw, &batch[i]);
+            }
+            full = sw->store.current_t == newest &&
+                sw->store.current_count >= sw->store.count;
+            pthread_mutex_unlock(&sw->store_lock);
+
+            if (published) {
+                late = 1;
+            } else if (full) {
+                /* every particle arrived, no need to wait for the next */
+                data_thread_publish(sw, newest);
+                published = 1;
+            }
+        }
+
+        /* late packets changed what was published */
+        if (late) {
+            data_thread_show(sw);
+            late = 0;
+        }
+        pthread_mutex_unlock(&sw->publish_lock);
+    }
+    if(sw->verbosity) {
+        printf("Publish thread exiting\n");
+        fflush(stdout);
+    }
+    free(batch);
+    return(NULL);
+}
+
 /*
 Data thread loop.  This function is the main loop for the data thread.
 
@@ -33,8 +310,9 @@ Data thread loop.  This function is the main loop for the data thread.
 - Listens for incoming PTP UDP packets from server
 - Upon receipt of a packet:
     - Gets mutex lock
-    - Updates global data structures
+    - Updates reception tracking
     - Releases mutex lock
+    - Queues the packet for the publish thread
 
 @param  user_data   seewaves_t ptr cast to void ptr.
 
@@ -51,9 +329,15 @@ void *data_thread_main(void *user_data) {
     /* loop exit variable */
     int done = 0;
 
+    /* wait on the socket, waking to check for exit */
+    struct pollfd pfd;
+
     /* return values */
     int err;
 
+    /* particle in a packet */
+    unsigned int i;
+
     /* port as string */
     char port_as_string[32];
 
@@ -113,11 +397,10 @@ void *data_thread_main(void *user_data) {
     /* get actual UDP receive buffer size in use */
     sw->udp_buffer_size = util_get_udp_buffer_size(sw->data_socket_fd);
 
-    /* enable non-blocking */
-    fcntl(sw->data_socket_fd, F_SETFL, O_NONBLOCK);
-
     /* Loop until application asks us to exit */
-    while(!done) {
+    pfd.fd = sw->data_socket_fd;
+    pfd.events = POLLIN;
+    while(!done && !sw->flag_exit_main_loop) {
         struct sockaddr data_socket_remote_address;
         socklen_t data_socket_remote_address_len;
 
@@ -131,20 +414,42 @@ void *data_thread_main(void *user_data) {
         memset((char *) &data_socket_remote_address, 0,
                sizeof(data_socket_remote_address));
 
+        /* block until a packet arrives; on exit the main thread shuts the
+         * socket down, which wakes us to an empty read, or where it does
+         * not, the exit flag is seen at the next timeout */
+        err = poll(&pfd, 1, PTP_NACK_INTERVAL_MS);
+        if (err == -1) {
+            if (errno != EINTR) {
+                perror("data poll");
+                done = 1;
+            }
+            continue;
+        }
+        if (err == 0) {
+            /* timed out */
+            continue;
+        }
+        if (pfd.revents & POLLNVAL) {
+            /* the socket is gone, we own it so this is not expected */
+            done = 1;
+            continue;
+        }
+
         /* first byte has version number, are we compatible? */
         unsigned char buf;
+        data_socket_remote_address_len = sizeof(data_socket_remote_address);
         packet_length_bytes = recvfrom(sw->data_socket_fd, &buf,
-                                       1, MSG_PEEK, (struct sockaddr *)
+                                       1, MSG_PEEK | MSG_DONTWAIT, (struct sockaddr *)
                                        &data_socket_remote_address,
                                        &data_socket_remote_address_len);
         if (packet_length_bytes == 1) {
-			if(buf > PTP_VERSION) {
+			if(buf != PTP_VERSION) {
 				fprintf(stderr, "Unsupported version %i\n", buf);
 				exit(1);
 			}
 			packet_length_bytes = recvfrom(sw->data_socket_fd, &packet,
 									   sizeof(ptp_packet_t),
-									   0, (struct sockaddr *)
+									   MSG_DONTWAIT, (struct sockaddr *)
 									   &data_socket_remote_address,
 									   &data_socket_remote_address_len);
 			if ((size_t)packet_length_bytes < sizeof(ptp_packet_t)) {
@@ -154,97 +459,68 @@ void *data_thread_main(void *user_data) {
 				exit(1);
 			}
 			/* we have received a packet */
-			int locked = 0;
-			while(!locked) {
-				err = pthread_mutex_trylock(&sw->lock);
-				if(err) {
-					if(err == EBUSY) {
-						/* mutex was locked */
-						printf("!LOCK\n");
-						fflush(stdout);
-					} else if(err == EINVAL) {
-						fprintf(stderr, "Invalid mutex lock?");
-					} else {
-						fprintf(stderr, "Unhandled mutex lock error: %i", err);
-					}
-					continue;
-				}
+			if ((err = pthread_mutex_lock(&sw->lock))) {
+				fprintf(stderr, "Error locking mutex: %i\n", err);
+				done = 1;
+				continue;
+			}
 
-				/* got the lock */
-				unsigned int particle = 0;
-				/* exit loop flag */
-				locked++;
+			/* keep track of packet count received */
+			sw->packets_received++;
 
-				/* KAG - fix me, should be list, they can be out-of-order
-				 * keep most recent timestamp */
-				if(packet.t > sw->most_recent_timestamp) {
-					sw->most_recent_timestamp = packet.t;
-					sw->total_timesteps++;
+			/* ids and reception tracking restart with each model, and
+			 * grow with it */
+			if (sw->model_id != packet.model_id) {
+				completeness_free(&sw->completeness);
+				idmap_free(&sw->ids);
+				if (idmap_init(&sw->ids, packet.total_particle_count)) {
+					exit(EXIT_FAILURE);
 				}
-
-				/* keep track of packet count received */
-				sw->packets_received++;
-
-				/* allocate memory if first time or new model */
-				if (sw->model_id != packet.model_id) {
-
-					if (sw->x != NULL) {
-						/* not first time, but different count, so free */
-						free(sw->x);
-						free(sw->y);
-						free(sw->z);
-						free(sw->flag);
-						free(sw->t);
-					}
-					sw->x = (double*)calloc(packet.total_particle_count,
-						sizeof(double));
-					sw->y = (double*)calloc(packet.total_particle_count,
-						sizeof(double));
-					sw->z = (double*)calloc(packet.total_particle_count,
-						sizeof(double));
-					sw->particle_type = (short*)calloc(packet.total_particle_count,
-						sizeof(short));
-					sw->t = (float*)calloc(packet.total_particle_count,
-						sizeof(float));
-					for(particle = 0; particle < packet.total_particle_count;particle++) {
-						sw->x[particle] = UNDEFINED_PARTICLE;
-					}
-					sw->rotation_center[0] = UNDEFINED_PARTICLE;
-					memcpy(sw->world_origin, packet.world_origin, sizeof(packet.world_origin));
-					memcpy(sw->world_size, packet.world_size, sizeof(packet.world_size));
-					sw->model_id = packet.model_id;
+				completeness_init(&sw->completeness,
+					packet.total_particle_count, &sw->ids);
+				sw->model_id = packet.model_id;
+				/* timestamps restart with the model */
+				sw->most_recent_timestamp = -FLT_MAX;
+				sw->total_timesteps = 0;
+			} else if (packet.total_particle_count !=
+					sw->total_particle_count) {
+				if (idmap_resize(&sw->ids, packet.total_particle_count)) {
+					exit(EXIT_FAILURE);
 				}
+				completeness_resize(&sw->completeness,
+					packet.total_particle_count);
+			}
 
-				/* save total number of particles in model */
-				sw->total_particle_count = packet.total_particle_count;
-
-				/* loop through particles in this packet */
-				for(; particle < packet.particle_count; particle++) {
-					/* get particle id */
-					unsigned int id = packet.data[particle].id;
-					/* set x, y, z and w */
-					sw->t[id] = packet.t;
-					sw->x[id] = packet.data[particle].position[0];
-					sw->y[id] = packet.data[particle].position[1];
-					sw->z[id] = packet.data[particle].position[2];
-					sw->particle_type[id] = packet.data[particle].particle_type;
-					/*sw->w[id] = packet.data[particle].position[2];*/
-					/*sw->flag[id] = packet.data[particle].flag;*/
-				}
-				if(sw->rotation_center[0] == UNDEFINED_PARTICLE) {
-					sw->rotation_center[0] = sw->world_origin[0] + sw->world_size[0] / 2.0;
-					sw->rotation_center[1] = sw->world_origin[2] + sw->world_size[2] / 2.0;
-					sw->rotation_center[2] = sw->world_origin[1] + sw->world_size[1] / 2.0;
-				}
-				sw->udp_buffer_size = sw->total_particle_count * sizeof(ptp_packet_t);
+			/* the publish thread and reception tracking work on store
+			 * indices: carry them in place of the wire ids */
+			for (i = 0; i < packet.particle_count &&
+					i < PTP_PARTICLES_PER_PACKET; i++) {
+				packet.data[i].id = idmap_index(&sw->ids, packet.data[i].id);
+			}
 
-				/* Release the lock */
-				if ((err = pthread_mutex_unlock(&sw->lock))) {
-					fprintf(stderr, "Error unlocking mutex: %i\n", err);
-				}
-            }
+			/* keep most recent timestamp */
+			if(packet.t > sw->most_recent_timestamp) {
+				sw->most_recent_timestamp = packet.t;
+				sw->total_timesteps++;
+			}
+
+			/* track which particles of this timestep have arrived */
+			completeness_add(&sw->completeness, &packet);
+
+			/* save total number of particles in model */
+			sw->total_particle_count = packet.total_particle_count;
+			sw->udp_buffer_size = sw->total_particle_count * sizeof(ptp_packet_t);
+
+			/* Release the lock */
+			if ((err = pthread_mutex_unlock(&sw->lock))) {
+				fprintf(stderr, "Error unlocking mutex: %i\n", err);
+			}
+
+			/* the publish thread applies it, waits only if far behind;
+			 * fails once the queue is closed on exit */
+			(void)packet_queue_push(&sw->queue, &packet);
         } else if (packet_length_bytes == 0) {
-            /* socket closed on linux */
+            /* shut down for reading, the main thread is exiting */
             done = 1;
         } else {
             if(errno == EINTR) {
@@ -8,6 +8,13 @@
 #ifndef DATA_THREAD_H_
 #define DATA_THREAD_H_
 
+/* packets the publish thread takes off the queue and applies at once */
+#define DATA_THREAD_BATCH 64
+/* the newest timestep is published after this long without packets, two
+NACK intervals, so the last one shows when the simulation pauses or ends */
+#define DATA_THREAD_IDLE_MS 100
+
 void *data_thread_main(void *user_data);
+void *data_thread_publish_main(void *user_data);
 
 #endif /* DATA_THREAD_H_ */
@@ -0,0 +1,510 @@
+/*
+ * grid.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <time.h>
+#include "grid.h"
+
+/* parallel pass arguments */
+typedef struct {
+	grid_t *grid;
+	const store_t *store;
+	/* cursors are shared between workers and need atomic updates */
+	int shared;
+} grid_job_t;
+
+/* locals */
+static double grid_now(void);
+static int grid_axis_cell(const grid_t *g, int axis, float v);
+static void grid_count_pass(void *user, unsigned int begin, unsigned int end,
+		int worker);
+static void grid_scatter_pass(void *user, unsigned int begin, unsigned int end,
+		int worker);
+static void grid_ray_cells(const grid_t *g, const int c[3], int r,
+		const float origin[3], const float dir[3], float radius2,
+		int *best, float *best_t);
+static void grid_knn_insert(unsigned int id, float d2, unsigned int k,
+		unsigned int *n, unsigned int *ids, float *dist2);
+
+/*
+@returns monotonic time in seconds
+*/
+static double grid_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return(ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+/*
+@returns cell index of v along axis, clamped to the grid
+*/
+static int grid_axis_cell(const grid_t *g, int axis, float v) {
+	float f = (v - g->origin[axis]) * g->inv_cell;
+	int c;
+	if(!(f > 0.0f)) {
+		return(0);
+	}
+	c = (int)f;
+	return(c < g->dims[axis] ? c : g->dims[axis] - 1);
+}
+
+/* linear cell index */
+#define GRID_CELL(g, cx, cy, cz) \
+	((unsigned int)(((cz) * (g)->dims[1] + (cy)) * (g)->dims[0] + (cx)))
+
+/*
+Pass 1: find each slot's cell and count cell populations.  Slots are
+walked rather than ids so a spatially ordered store is read in order.
+*/
+static void grid_count_pass(void *user, unsigned int begin, unsigned int end,
+		int worker) {
+	grid_job_t *job = (grid_job_t*)user;
+	grid_t *g = job->grid;
+	const store_t *s = job->store;
+	unsigned int i;
+	(void)worker;
+	for(i = begin; i < end; i++) {
+		/* vertices are in GL order, x z y */
+		const float *p = s->vertex[i].pos;
+		unsigned int c = GRID_CELL(g, grid_axis_cell(g, 0, p[0]),
+			grid_axis_cell(g, 1, p[2]), grid_axis_cell(g, 2, p[1]));
+		g->cell_of[i] = c;
+		if(job->shared) {
+			__sync_fetch_and_add(&g->cursor[c], 1);
+		} else {
+			g->cursor[c]++;
+		}
+	}
+}
+
+/*
+Pass 2: scatter ids and positions to their cell's range.
+*/
+static void grid_scatter_pass(void *user, unsigned int begin, unsigned int end,
+		int worker) {
+	grid_job_t *job = (grid_job_t*)user;
+	grid_t *g = job->grid;
+	const store_t *s = job->store;
+	unsigned int i;
+	(void)worker;
+	for(i = begin; i < end; i++) {
+		const float *p = s->vertex[i].pos;
+		unsigned int c = g->cell_of[i];
+		unsigned int e = job->shared ? __sync_fetch_and_add(&g->cursor[c], 1) :
+			g->cursor[c]++;
+		g->ids[e] = store_id(s, i);
+		g->pos[3 * e] = p[0];
+		g->pos[3 * e + 1] = p[2];
+		g->pos[3 * e + 2] = p[1];
+	}
+}
+
+/*
+Initialize an empty grid.
+
+@param	g	grid
+@param	particles_per_cell	target average cell population, 0 disables the
+grid and grid_build() is then a no-op
+*/
+void grid_init(grid_t *g, unsigned int particles_per_cell) {
+	memset(g, 0, sizeof(grid_t));
+	g->particles_per_cell = particles_per_cell;
+}
+
+/*
+Release grid memory.
+*/
+void grid_free(grid_t *g) {
+	free(g->cell_start);
+	free(g->ids);
+	free(g->pos);
+	free(g->cell_of);
+	free(g->cursor);
+	grid_init(g, g->particles_per_cell);
+}
+
+/*
+Rebuild the grid from the store.
+
+@param	g	grid
+@param	s	store
+@param	pool	threads for the sort
+@param	origin	world origin
+@param	size	world size
+
+@returns 0 on success, -1 on allocation failure
+*/
+int grid_build(grid_t *g, const store_t *s, parallel_t *pool,
+		const float origin[3], const float size[3]) {
+	double start = grid_now();
+	double volume = 1.0;
+	grid_job_t job;
+	unsigned int c;
+	float cell;
+	int i;
+
+	if(g->particles_per_cell == 0) {
+		return(0);
+	}
+
+	/* cell size for the target population, bounded by GRID_MAX_DIM */
+	for(i = 0; i < 3; i++) {
+		volume *= size[i] > 0.0 ? size[i] : 1.0;
+	}
+	cell = (float)cbrt(volume * g->particles_per_cell / (s->count ? s->count : 1));
+	for(i = 0; i < 3; i++) {
+		float extent = size[i] > 0.0 ? size[i] : 1.0;
+		if(extent / cell > GRID_MAX_DIM) {
+			cell = extent / GRID_MAX_DIM;
+		}
+	}
+	g->cell = cell;
+	g->inv_cell = 1.0f / cell;
+	g->cells = 1;
+	for(i = 0; i < 3; i++) {
+		float extent = size[i] > 0.0 ? size[i] : 1.0;
+		g->origin[i] = origin[i];
+		g->dims[i] = (int)ceil(extent / cell);
+		if(g->dims[i] < 1) {
+			g->dims[i] = 1;
+		}
+		g->cells *= g->dims[i];
+	}
+
+	/* grow storage */
+	if(s->count > g->particle_capacity) {
+		free(g->ids);
+		free(g->pos);
+		free(g->cell_of);
+		g->ids = (unsigned int*)malloc(s->count * sizeof(unsigned int));
+		g->pos = (float*)malloc(3 * (size_t)s->count * sizeof(float));
+		g->cell_of = (unsigned int*)malloc(s->count * sizeof(unsigned int));
+		g->particle_capacity = s->count;
+	}
+	if(g->cells > g->cell_capacity) {
+		free(g->cell_start);
+		free(g->cursor);
+		g->cell_start = (unsigned int*)malloc((g->cells + 1) * sizeof(unsigned int));
+		g->cursor = (unsigned int*)malloc(g->cells * sizeof(unsigned int));
+		g->cell_capacity = g->cells;
+	}
+	if(!g->ids || !g->pos || !g->cell_of || !g->cell_start || !g->cursor) {
+		perror("grid_build");
+		grid_free(g);
+		return(-1);
+	}
+
+	/* counting sort by cell */
+	job.grid = g;
+	job.store = s;
+	job.shared = pool->threads > 1;
+	g->count = 0;
+	memset(g->cursor, 0, g->cells * sizeof(unsigned int));
+	parallel_for(pool, s->count, grid_count_pass, &job);
+	g->cell_start[0] = 0;
+	for(c = 0; c < g->cells; c++) {
+		g->cell_start[c + 1] = g->cell_start[c] + g->cursor[c];
+		g->cursor[c] = g->cell_start[c];
+	}
+	parallel_for(pool, s->count, grid_scatter_pass, &job);
+	g->count = s->count;
+
+	g->last_build_seconds = grid_now() - start;
+	g->build_seconds += g->last_build_seconds;
+	g->builds++;
+	return(0);
+}
+
+/*
+Find particles inside an axis-aligned box.
+
+@param	g	grid
+@param	min	box minimum corner
+@param	max	box maximum corner
+@param	ids	filled with up to max_ids particle ids, may be NULL
+@param	max_ids	length of ids
+
+@returns number of particles in the box, which may exceed max_ids
+*/
+unsigned int grid_range(const grid_t *g, const float min[3], const float max[3],
+		unsigned int *ids, unsigned int max_ids) {
+	unsigned int found = 0;
+	int lo[3];
+	int hi[3];
+	int x, y, z;
+	int i;
+
+	if(g->count == 0) {
+		return(0);
+	}
+	for(i = 0; i < 3; i++) {
+		lo[i] = grid_axis_cell(g, i, min[i]);
+		hi[i] = grid_axis_cell(g, i, max[i]);
+	}
+	for(z = lo[2]; z <= hi[2]; z++) {
+		for(y = lo[1]; y <= hi[1]; y++) {
+			for(x = lo[0]; x <= hi[0]; x++) {
+				unsigned int c = GRID_CELL(g, x, y, z);
+				unsigned int e;
+				for(e = g->cell_start[c]; e < g->cell_start[c + 1]; e++) {
+					const float *p = &g->pos[3 * e];
+					if(p[0] < min[0] || p[0] > max[0] || p[1] < min[1] ||
+							p[1] > max[1] || p[2] < min[2] || p[2] > max[2]) {
+						continue;
+					}
+					if(ids != NULL && found < max_ids) {
+						ids[found] = g->ids[e];
+					}
+					found++;
+				}
+			}
+		}
+	}
+	return(found);
+}
+
+/*
+Test the particles in the cells within r of cell c against a ray.
+*/
+static void grid_ray_cells(const grid_t *g, const int c[3], int r,
+		const float origin[3], const float dir[3], float radius2,
+		int *best, float *best_t) {
+	int x, y, z;
+	for(z = c[2] - r; z <= c[2] + r; z++) {
+		if(z < 0 || z >= g->dims[2]) {
+			continue;
+		}
+		for(y = c[1] - r; y <= c[1] + r; y++) {
+			if(y < 0 || y >= g->dims[1]) {
+				continue;
+			}
+			for(x = c[0] - r; x <= c[0] + r; x++) {
+				unsigned int cell;
+				unsigned int e;
+				if(x < 0 || x >= g->dims[0]) {
+					continue;
+				}
+				cell = GRID_CELL(g, x, y, z);
+				for(e = g->cell_start[cell]; e < g->cell_start[cell + 1]; e++) {
+					const float *p = &g->pos[3 * e];
+					float v[3];
+					float t;
+					v[0] = p[0] - origin[0];
+					v[1] = p[1] - origin[1];
+					v[2] = p[2] - origin[2];
+					t = v[0] * dir[0] + v[1] * dir[1] + v[2] * dir[2];
+					if(t < 0.0f || t >= *best_t) {
+						continue;
+					}
+					if(v[0] * v[0] + v[1] * v[1] + v[2] * v[2] - t * t <= radius2) {
+						*best = (int)g->ids[e];
+						*best_t = t;
+					}
+				}
+			}
+		}
+	}
+}
+
+/*
+Find the first particle along a ray, walking the cells it crosses.
+
+@param	g	grid
+@param	origin	ray origin
+@param	dir	ray direction, need not be normalized
+@param	radius	particles within this distance of the ray are hits
+@param	t_hit	set to the distance along the ray of the hit, may be NULL
+
+@returns particle id or -1 if nothing was hit
+*/
+int grid_ray(const grid_t *g, const float origin[3], const float dir[3],
+		float radius, float *t_hit) {
+	float d[3];
+	float len;
+	float t0 = 0.0f;
+	float t1 = FLT_MAX;
+	float t_max[3];
+	float t_delta[3];
+	int step[3];
+	int c[3];
+	int r;
+	int best = -1;
+	float best_t = FLT_MAX;
+	int i;
+
+	if(g->count == 0) {
+		return(-1);
+	}
+	len = sqrtf(dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2]);
+	if(len == 0.0f) {
+		return(-1);
+	}
+	for(i = 0; i < 3; i++) {
+		d[i] = dir[i] / len;
+	}
+
+	/* clip the ray to the grid box */
+	for(i = 0; i < 3; i++) {
+		float lo = g->origin[i];
+		float hi = g->origin[i] + g->dims[i] * g->cell;
+		if(d[i] == 0.0f) {
+			if(origin[i] < lo || origin[i] > hi) {
+				return(-1);
+			}
+		} else {
+			float a = (lo - origin[i]) / d[i];
+			float b = (hi - origin[i]) / d[i];
+			if(a > b) {
+				float tmp = a;
+				a = b;
+				b = tmp;
+			}
+			t0 = a > t0 ? a : t0;
+			t1 = b < t1 ? b : t1;
+		}
+	}
+	if(t0 > t1) {
+		return(-1);
+	}
+
+	/* 3D DDA from the entry point */
+	for(i = 0; i < 3; i++) {
+		float p = origin[i] + d[i] * t0;
+		c[i] = grid_axis_cell(g, i, p);
+		if(d[i] > 0.0f) {
+			step[i] = 1;
+			t_max[i] = (g->origin[i] + (c[i] + 1) * g->cell - origin[i]) / d[i];
+			t_delta[i] = g->cell / d[i];
+		} else if(d[i] < 0.0f) {
+			step[i] = -1;
+			t_max[i] = (g->origin[i] + c[i] * g->cell - origin[i]) / d[i];
+			t_delta[i] = -g->cell / d[i];
+		} else {
+			step[i] = 0;
+			t_max[i] = FLT_MAX;
+			t_delta[i] = FLT_MAX;
+		}
+	}
+	r = (int)ceilf(radius / g->cell);
+	for(;;) {
+		int axis;
+		/* nothing further along can beat the best hit */
+		if(best >= 0 && t0 > best_t + (r + 1) * g->cell * 1.7321f) {
+			break;
+		}
+		grid_ray_cells(g, c, r, origin, d, radius * radius, &best, &best_t);
+		axis = (t_max[0] < t_max[1]) ? (t_max[0] < t_max[2] ? 0 : 2) :
+			(t_max[1] < t_max[2] ? 1 : 2);
+		if(t_max[axis] > t1) {
+			break;
+		}
+		t0 = t_max[axis];
+		t_max[axis] += t_delta[axis];
+		c[axis] += step[axis];
+		if(c[axis] < 0 || c[axis] >= g->dims[axis]) {
+			break;
+		}
+	}
+	if(best >= 0 && t_hit != NULL) {
+		*t_hit = best_t;
+	}
+	return(best);
+}
+
+/*
+Insert into a sorted k-best list.
+*/
+static void grid_knn_insert(unsigned int id, float d2, unsigned int k,
+		unsigned int *n, unsigned int *ids, float *dist2) {
+	unsigned int i;
+	if(*n == k && d2 >= dist2[k - 1]) {
+		return;
+	}
+	i = (*n < k) ? (*n)++ : k - 1;
+	while(i > 0 && dist2[i - 1] > d2) {
+		dist2[i] = dist2[i - 1];
+		ids[i] = ids[i - 1];
+		i--;
+	}
+	dist2[i] = d2;
+	ids[i] = id;
+}
+
+/*
+Find the k particles nearest a point, searching shells of cells outward.
+
+@param	g	grid
+@param	p	query point
+@param	k	number of neighbors wanted
+@param	ids	k long, filled nearest first
+@param	dist2	k long, squared distances
+
+@returns number of neighbors found, less than k only if the grid holds
+fewer particles
+*/
+unsigned int grid_knn(const grid_t *g, const float p[3], unsigned int k,
+		unsigned int *ids, float *dist2) {
+	unsigned int n = 0;
+	int c[3];
+	int ring;
+	int max_ring = 0;
+	int i;
+
+	if(g->count == 0 || k == 0) {
+		return(0);
+	}
+	for(i = 0; i < 3; i++) {
+		c[i] = grid_axis_cell(g, i, p[i]);
+		if(g->dims[i] > max_ring) {
+			max_ring = g->dims[i];
+		}
+	}
+	for(ring = 0; ring <= max_ring; ring++) {
+		int x, y, z;
+		float bound;
+		for(z = c[2] - ring; z <= c[2] + ring; z++) {
+			if(z < 0 || z >= g->dims[2]) {
+				continue;
+			}
+			for(y = c[1] - ring; y <= c[1] + ring; y++) {
+				if(y < 0 || y >= g->dims[1]) {
+					continue;
+				}
+				for(x = c[0] - ring; x <= c[0] + ring; x++) {
+					unsigned int cell;
+					unsigned int e;
+					if(x < 0 || x >= g->dims[0]) {
+						continue;
+					}
+					/* only the shell, inner cells were done already */
+					if(abs(x - c[0]) != ring && abs(y - c[1]) != ring &&
+							abs(z - c[2]) != ring) {
+						continue;
+					}
+					cell = GRID_CELL(g, x, y, z);
+					for(e = g->cell_start[cell]; e < g->cell_start[cell + 1]; e++) {
+						const float *q = &g->pos[3 * e];
+						float dx = q[0] - p[0];
+						float dy = q[1] - p[1];
+						float dz = q[2] - p[2];
+						grid_knn_insert(g->ids[e], dx * dx + dy * dy + dz * dz,
+							k, &n, ids, dist2);
+					}
+				}
+			}
+		}
+		/* every cell beyond this shell is at least ring cells away */
+		bound = ring * g->cell;
+		if(n == k && bound * bound >= dist2[k - 1]) {
+			break;
+		}
+	}
+	return(n);
+}
@@ -0,0 +1,66 @@
+/*
+ * grid.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Uniform grid (cell list) over the world box, rebuilt from the store each
+ * time a timestep is published.  Particles are counting-sorted by cell in
+ * parallel and their positions copied next to their ids, so queries read
+ * one contiguous block per cell and see a consistent timestep while ingest
+ * moves on.  All coordinates are simulation x, y, z (not GL order).
+ */
+
+#ifndef GRID_H_
+#define GRID_H_
+
+#include "store.h"
+#include "parallel.h"
+
+/* default average particles per cell */
+#define GRID_PARTICLES_PER_CELL 8
+/* limit on cells along one axis */
+#define GRID_MAX_DIM 1024
+
+/*
+Cell list.
+*/
+typedef struct {
+	/* grid origin, cell edge length and cells along each axis */
+	float origin[3];
+	float cell;
+	float inv_cell;
+	int dims[3];
+	unsigned int cells;
+	/* particles in the grid */
+	unsigned int count;
+	/* first entry of each cell, cells + 1 long */
+	unsigned int *cell_start;
+	/* entries sorted by cell: particle id and position */
+	unsigned int *ids;
+	float *pos;
+	/* scratch: cell of each store slot and per-cell fill cursor */
+	unsigned int *cell_of;
+	unsigned int *cursor;
+	/* capacity of the per-particle and per-cell arrays */
+	unsigned int particle_capacity;
+	unsigned int cell_capacity;
+	/* target average particles per cell, 0 when disabled */
+	unsigned int particles_per_cell;
+	/* statistics */
+	unsigned long long builds;
+	double build_seconds;
+	double last_build_seconds;
+} grid_t;
+
+void grid_init(grid_t *g, unsigned int particles_per_cell);
+void grid_free(grid_t *g);
+int grid_build(grid_t *g, const store_t *s, parallel_t *pool,
+		const float origin[3], const float size[3]);
+unsigned int grid_range(const grid_t *g, const float min[3], const float max[3],
+		unsigned int *ids, unsigned int max_ids);
+int grid_ray(const grid_t *g, const float origin[3], const float dir[3],
+		float radius, float *t_hit);
+unsigned int grid_knn(const grid_t *g, const float p[3], unsigned int k,
+		unsigned int *ids, float *dist2);
+
+#endif /* GRID_H_ */
@@ -0,0 +1,288 @@
+/*
+ * grid_bench.c
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Spatial index benchmark.  Fills a store with random particles, rebuilds
+ * the grid repeatedly in id order, then again after sorting the store into
+ * Morton order, and reports build and query times against a frame budget.
+ * Cache misses are counted where the kernel exposes hardware counters.
+ * Exits non-zero if the average Morton-ordered build does not fit.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "store.h"
+#include "parallel.h"
+#include "grid.h"
+#include "morton.h"
+
+/* queries of each kind timed after the builds */
+#define BENCH_QUERIES 1000
+
+/* Local prototypes */
+static void bench_usage(void);
+static double bench_now(void);
+static double bench_random(unsigned long long *rng);
+static int bench_counter_open(void);
+static double bench_builds(grid_t *grid, const store_t *store, parallel_t *pool,
+		int iterations, int counter, const float origin[3], const float size[3],
+		const char *label);
+
+static void bench_usage(void) {
+	printf("usage: grid_bench [ options ]\n\n");
+	printf("Options:\n\n");
+	printf("--particles -n <count>   Particle count (10000000)\n");
+	printf("--threads -j <count>     Threads, 0 for one per CPU (0)\n");
+	printf("--iterations -i <count>  Builds to time (10)\n");
+	printf("--cell -c <count>        Particles per cell (%i)\n",
+		GRID_PARTICLES_PER_CELL);
+	printf("--budget -b <ms>         Frame budget for one build (16.7)\n");
+	printf("--seed -S <n>            Random seed (1)\n");
+}
+
+/*
+@returns monotonic time in seconds
+*/
+static double bench_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return(ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+/*
+@returns uniform random number in [0, 1), xorshift64*
+*/
+static double bench_random(unsigned long long *rng) {
+	*rng ^= *rng >> 12;
+	*rng ^= *rng << 25;
+	*rng ^= *rng >> 27;
+	return((double)((*rng * 2685821657736338717ULL) >> 11) / 9007199254740992.0);
+}
+
+/*
+Open a cache miss counter for this process, covering all its threads.
+
+@returns file descriptor or -1 if counters are unavailable
+*/
+static int bench_counter_open(void) {
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(attr);
+	attr.config = PERF_COUNT_HW_CACHE_MISSES;
+	attr.disabled = 1;
+	attr.inherit = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return((int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+/*
+Time grid builds and print a summary line.
+
+@returns average build time in milliseconds
+*/
+static double bench_builds(grid_t *grid, const store_t *store, parallel_t *pool,
+		int iterations, int counter, const float origin[3], const float size[3],
+		const char *label) {
+	char misses[64] = "n/a";
+	uint64_t count = 0;
+	double worst = 0.0;
+	double total = 0.0;
+	int i;
+
+	if(counter >= 0) {
+		ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+		ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+	}
+	for(i = 0; i < iterations; i++) {
+		if(grid_build(grid, store, pool, origin, size)) {
+			exit(EXIT_FAILURE);
+		}
+		total += grid->last_build_seconds;
+		if(grid->last_build_seconds > worst) {
+			worst = grid->last_build_seconds;
+		}
+	}
+	if(counter >= 0) {
+		ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+		if(read(counter, &count, sizeof(count)) == sizeof(count)) {
+			sprintf(misses, "%.2f", (double)count / iterations / store->count);
+		}
+	}
+	printf("build(%s): particles(%u) threads(%i) cells(%u = %ix%ix%i) "
+		"avg(%.2fms) max(%.2fms) misses/particle(%s)\n", label,
+		store->count, pool->threads, grid->cells, grid->dims[0],
+		grid->dims[1], grid->dims[2], total / iterations * 1000.0,
+		worst * 1000.0, misses);
+	return(total / iterations * 1000.0);
+}
+
+int main(int argc, char *argv[]) {
+	static struct option long_options[] = {
+		{ "particles", required_argument, 0, 'n' },
+		{ "threads", required_argument, 0, 'j' },
+		{ "iterations", required_argument, 0, 'i' },
+		{ "cell", required_argument, 0, 'c' },
+		{ "budget", required_argument, 0, 'b' },
+		{ "seed", required_argument, 0, 'S' },
+		{ "help", no_argument, 0, '?' },
+		{ 0, 0, 0, 0 }
+	};
+	unsigned int particles = 10000000;
+	int threads = 0;
+	int iterations = 10;
+	unsigned int per_cell = GRID_PARTICLES_PER_CELL;
+	double budget_ms = 16.7;
+	unsigned long long rng = 1;
+	float origin[3] = { 0.0f, 0.0f, 0.0f };
+	float size[3] = { 100.0f, 50.0f, 20.0f };
+	store_palette_t palette;
+	store_t store;
+	parallel_t pool;
+	grid_t grid;
+	morton_t order;
+	unsigned int ids[64];
+	float dist2[64];
+	double average;
+	double start;
+	int counter;
+	unsigned long long found = 0;
+	unsigned int i;
+	int c;
+
+	while((c = getopt_long(argc, argv, "n:j:i:c:b:S:?", long_options,
+			NULL)) != -1) {
+		switch(c) {
+		case 'n':
+			particles = (unsigned int)strtoul(optarg, NULL, 10);
+			break;
+		case 'j':
+			threads = atoi(optarg);
+			break;
+		case 'i':
+			iterations = atoi(optarg);
+			break;
+		case 'c':
+			per_cell = (unsigned int)strtoul(optarg, NULL, 10);
+			break;
+		case 'b':
+			budget_ms = atof(optarg);
+			break;
+		case 'S':
+			rng = strtoull(optarg, NULL, 10);
+			break;
+		default:
+			bench_usage();
+			return(EXIT_FAILURE);
+		}
+	}
+	if(particles == 0 || iterations <= 0) {
+		bench_usage();
+		return(EXIT_FAILURE);
+	}
+	if(rng == 0) {
+		rng = 1;
+	}
+
+	/* random particles over the world box */
+	memset(&palette, 0, sizeof(palette));
+	if(store_init(&store, particles, &palette)) {
+		return(EXIT_FAILURE);
+	}
+	for(i = 0; i < particles; i++) {
+		double x = origin[0] + bench_random(&rng) * size[0];
+		double y = origin[1] + bench_random(&rng) * size[1];
+		double z = origin[2] + bench_random(&rng) * size[2];
+		store_set(&store, i, 0.0f, x, y, z, STORE_TYPE_FLUID);
+	}
+	if(parallel_init(&pool, threads)) {
+		return(EXIT_FAILURE);
+	}
+	grid_init(&grid, per_cell);
+	morton_init(&order, 1);
+	counter = bench_counter_open();
+
+	/* builds before and after spatial ordering */
+	(void)bench_builds(&grid, &store, &pool, iterations, counter, origin, size,
+		"id order");
+	if(morton_order(&order, &store, &pool, origin, size, NULL)) {
+		return(EXIT_FAILURE);
+	}
+	printf("order: sort(%.2fms)", order.last_sort_seconds * 1000.0);
+	/* an unchanged timestep only costs the check */
+	start = bench_now();
+	if(morton_order(&order, &store, &pool, origin, size, NULL)) {
+		return(EXIT_FAILURE);
+	}
+	printf(" resort(%.2fms %s)\n", (bench_now() - start) * 1000.0,
+		order.skipped ? "skipped" : "sorted");
+	average = bench_builds(&grid, &store, &pool, iterations, counter, origin,
+		size, "morton");
+	printf("budget: %.2fms\n", budget_ms);
+
+	/* queries around random particles */
+	start = bench_now();
+	for(i = 0; i < BENCH_QUERIES; i++) {
+		unsigned int id = (unsigned int)(bench_random(&rng) * particles);
+		const float *p = store.vertex[store_slot(&store, id)].pos;
+		float min[3];
+		float max[3];
+		min[0] = p[0] - grid.cell;
+		min[1] = p[2] - grid.cell;
+		min[2] = p[1] - grid.cell;
+		max[0] = p[0] + grid.cell;
+		max[1] = p[2] + grid.cell;
+		max[2] = p[1] + grid.cell;
+		found += grid_range(&grid, min, max, NULL, 0);
+	}
+	printf("range: %.2fus/query %.1f particles/query\n",
+		(bench_now() - start) * 1e6 / BENCH_QUERIES,
+		(double)found / BENCH_QUERIES);
+
+	start = bench_now();
+	for(i = 0; i < BENCH_QUERIES; i++) {
+		float p[3];
+		p[0] = (float)(origin[0] + bench_random(&rng) * size[0]);
+		p[1] = (float)(origin[1] + bench_random(&rng) * size[1]);
+		p[2] = (float)(origin[2] + bench_random(&rng) * size[2]);
+		(void)grid_knn(&grid, p, 16, ids, dist2);
+	}
+	printf("knn16: %.2fus/query\n",
+		(bench_now() - start) * 1e6 / BENCH_QUERIES);
+
+	start = bench_now();
+	found = 0;
+	for(i = 0; i < BENCH_QUERIES; i++) {
+		float o[3];
+		float d[3];
+		o[0] = (float)(origin[0] + bench_random(&rng) * size[0]);
+		o[1] = origin[1] - 10.0f;
+		o[2] = (float)(origin[2] + bench_random(&rng) * size[2]);
+		d[0] = 0.0f;
+		d[1] = 1.0f;
+		d[2] = 0.0f;
+		found += grid_ray(&grid, o, d, grid.cell * 0.5f, NULL) >= 0;
+	}
+	printf("ray: %.2fus/query %.1f%% hit\n",
+		(bench_now() - start) * 1e6 / BENCH_QUERIES,
+		100.0 * found / BENCH_QUERIES);
+
+	if(counter >= 0) {
+		close(counter);
+	}
+	morton_free(&order);
+	grid_free(&grid);
+	parallel_free(&pool);
+	store_free(&store);
+	return(average <= budget_ms ? EXIT_SUCCESS : EXIT_FAILURE);
+}
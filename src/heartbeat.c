@@ -12,12 +12,53 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <netdb.h>
+#include <poll.h>
 #include <string.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <sys/time.h>
 #include "ptp.h"
 #include "heartbeat.h"
 
+/* locals */
+static long heartbeat_ms_since(struct timeval *then);
+static ssize_t heartbeat_send(seewaves_t *sw, ptp_heartbeat_packet_t *hb,
+    const struct sockaddr_in *to, socklen_t to_len);
+
+/*
+@returns milliseconds elapsed since then
+*/
+static long heartbeat_ms_since(struct timeval *then) {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return((now.tv_sec - then->tv_sec) * 1000 +
+        (now.tv_usec - then->tv_usec) / 1000);
+}
+
+/*
+Send a heartbeat, including only the NACK ranges in use.
+
+@returns bytes sent or -1 on error
+*/
+static ssize_t heartbeat_send(seewaves_t *sw, ptp_heartbeat_packet_t *hb,
+    const struct sockaddr_in *to, socklen_t to_len) {
+    size_t len = PTP_HEARTBEAT_HEADER_SIZE +
+        hb->nack_count * sizeof(ptp_nack_range_t);
+    ssize_t bytes_sent = sendto(sw->heartbeat_socket_fd, hb, len, 0,
+        (const struct sockaddr *)to, to_len);
+    if (bytes_sent == -1) {
+        /* failed.  If EBADF, we'll detect that in the caller  */
+        if (errno != EBADF) {
+            /* hmm, real failure of some sort */
+            perror("sendto()");
+        }
+    } else if (bytes_sent > 0) {
+        /* keep track of heartbeats sent */
+        sw->heartbeats_sent++;
+    }
+    return(bytes_sent);
+}
+
 /*
 Heartbeat thread loop.
 This function is the main loop for the heartbeat thread.  It sends heartbeat
@@ -55,6 +96,13 @@ void *heartbeat_thread_main(void *seewaves_data) {
     /* last time a heartbeat was sent to server */
     time_t last_heartbeat_sent;
 
+    /* last time we checked for missing keyframe particles */
+    struct timeval last_nack_check;
+
+    /* wait on the socket between NACK checks */
+    struct pollfd pfd;
+    long wait_ms;
+
     /* loop flag */
     int done = 0;
 
@@ -68,9 +116,6 @@ void *heartbeat_thread_main(void *seewaves_data) {
         pthread_exit(NULL);
     }
 
-    /* set non-blocking so we can use it to test for closure */
-    fcntl(sw->heartbeat_socket_fd, F_SETFL, O_NONBLOCK);
-
     /* resolve host name */
     memset(&address_hints, 0, sizeof address_hints); /* clear the struct */
     address_hints.ai_family = AF_UNSPEC;     /* IPv4 or IPv6 */
@@ -110,11 +155,19 @@ void *heartbeat_thread_main(void *seewaves_data) {
     /* clear heartbeat packet */
     memset(&hb, 0, sizeof(ptp_heartbeat_packet_t));
 
+    /* every heartbeat carries our subscription */
+    hb.tracked_types = sw->tracked_types;
+    hb.tracked_stride = sw->tracked_stride;
+    hb.full_stride = sw->full_stride;
+
     /* initialize timing */
     last_heartbeat_sent = 0;
+    gettimeofday(&last_nack_check, NULL);
 
     /* main thread loop */
-    while(!done) {
+    pfd.fd = sw->heartbeat_socket_fd;
+    pfd.events = POLLIN;
+    while(!done && !sw->flag_exit_main_loop) {
         /* buffer used to test for socket closure */
         unsigned char b[64];
 
@@ -123,34 +176,59 @@ void *heartbeat_thread_main(void *seewaves_data) {
         /* is it time to send a heartbeat? */
         if (difftime(now, last_heartbeat_sent) > PTP_HEARTBEAT_TTL_S) {
             /* yes, send a heartbeat */
-            ssize_t bytes_sent;
-            bytes_sent = sendto(sw->heartbeat_socket_fd, &hb,
-                sizeof(ptp_heartbeat_packet_t), 0,
-                (const struct sockaddr *)(&heartbeat_socket_remote_address),
-                heartbeat_socket_remote_address_len);
-            if (bytes_sent == -1) {
-                /* failed.  If EBADF, we'll detect that below  */
-                if (errno != EBADF) {
-                    /* hmm, real failure of some sort */
-                    perror("sendto()");
-                }
-            } else if(bytes_sent == 0) {
+            hb.nack_count = 0;
+            if (heartbeat_send(sw, &hb, &heartbeat_socket_remote_address,
+                heartbeat_socket_remote_address_len) == 0) {
                 done = 1;
-            } else {
-                /* keep track of heartbeats sent */
-                sw->heartbeats_sent++;
             }
             /* update timing */
             time(&last_heartbeat_sent);
         }
-        /* has main thread closed our socket? */
-        err = recvfrom(sw->heartbeat_socket_fd, &b, sizeof(b), 0, NULL, NULL);
+
+        /* did a keyframe arrive incomplete?  if so, ask for the rest */
+        if (heartbeat_ms_since(&last_nack_check) >= PTP_NACK_INTERVAL_MS) {
+            hb.nack_count = 0;
+            pthread_mutex_lock(&sw->lock);
+            if (completeness_nack_pending(&sw->completeness)) {
+                hb.model_id = sw->model_id;
+                completeness_build_nack(&sw->completeness, &hb);
+            }
+            pthread_mutex_unlock(&sw->lock);
+            if (hb.nack_count > 0 && heartbeat_send(sw, &hb,
+                &heartbeat_socket_remote_address,
+                heartbeat_socket_remote_address_len) == 0) {
+                done = 1;
+            }
+            gettimeofday(&last_nack_check, NULL);
+        }
+        /* sleep until the next NACK check, or until the socket is closed */
+        wait_ms = PTP_NACK_INTERVAL_MS - heartbeat_ms_since(&last_nack_check);
+        err = poll(&pfd, 1, wait_ms > 0 ? (int)wait_ms : 0);
+        if (err == -1) {
+            if (errno != EINTR) {
+                perror("heartbeat poll");
+                done = 1;
+            }
+            continue;
+        }
+        if (err == 0) {
+            /* timed out */
+            continue;
+        }
+        if (pfd.revents & POLLNVAL) {
+            /* Parent thread closed the socket, that's our signal that
+            we're done */
+            done = 1;
+            continue;
+        }
+        err = recvfrom(sw->heartbeat_socket_fd, &b, sizeof(b), MSG_DONTWAIT,
+            NULL, NULL);
         if (err == 0) {
             /* socket closed on linux */
             done = 1;
-        } else {
-            if(errno == EAGAIN) {
-                /* ignore, we're non-blocking and nothings ready */
+        } else if (err == -1) {
+            if(errno == EAGAIN || errno == EWOULDBLOCK) {
+                /* ignore, nothing was ready after all */
             } else if(errno == EINTR) {
                 /* ignore */
             } else if (errno == EBADF) {
@@ -164,8 +242,6 @@ void *heartbeat_thread_main(void *seewaves_data) {
                 done = 1;
             }
         }
-        /* give cpu a break */
-        //usleep(10);
     }
     if(sw->verbosity) {
         fprintf(stdout, "Heartbeat thread exiting\n");
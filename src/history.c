@@ -0,0 +1,411 @@
+/*
+ * history.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "history.h"
+
+#define HISTORY_QUANTA 65535.0
+
+/* locals */
+static double history_now(void);
+static history_frame_t *history_frame(const history_t *h, unsigned int index);
+static unsigned char *history_put(unsigned char *p, uint32_t v);
+static const unsigned char *history_get(const unsigned char *p, uint32_t *v);
+static uint16_t history_quantize(const history_t *h, int axis, double v);
+static void history_evict_group(history_t *h);
+static void history_apply(history_t *h, const history_frame_t *f);
+
+/*
+@returns monotonic time in seconds
+*/
+static double history_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return(ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+/*
+@returns frame at index, 0 being the oldest
+*/
+static history_frame_t *history_frame(const history_t *h, unsigned int index) {
+	return(&h->frames[(h->head + index) % h->capacity]);
+}
+
+/*
+Append an unsigned LEB128 varint.
+*/
+static unsigned char *history_put(unsigned char *p, uint32_t v) {
+	while(v >= 0x80) {
+		*p++ = (unsigned char)(v | 0x80);
+		v >>= 7;
+	}
+	*p++ = (unsigned char)v;
+	return(p);
+}
+
+/*
+Read an unsigned LEB128 varint.
+*/
+static const unsigned char *history_get(const unsigned char *p, uint32_t *v) {
+	uint32_t value = 0;
+	int shift = 0;
+	while(*p & 0x80) {
+		value |= (uint32_t)(*p++ & 0x7f) << shift;
+		shift += 7;
+	}
+	*v = value | ((uint32_t)*p++ << shift);
+	return(p);
+}
+
+/* zigzag mapping of signed deltas onto small unsigned values */
+#define HISTORY_ZIGZAG(d) (((uint32_t)(d) << 1) ^ (uint32_t)((d) >> 31))
+#define HISTORY_UNZIGZAG(u) ((int32_t)((u) >> 1) ^ -(int32_t)((u) & 1))
+
+/*
+@returns v quantized over the world box along axis
+*/
+static uint16_t history_quantize(const history_t *h, int axis, double v) {
+	double q = (v - h->origin[axis]) * h->scale[axis] + 0.5;
+	if(q <= 0.0) {
+		return(0);
+	}
+	if(q >= HISTORY_QUANTA) {
+		return((uint16_t)HISTORY_QUANTA);
+	}
+	return((uint16_t)q);
+}
+
+/*
+Drop the oldest keyframe and the delta frames that depend on it.
+*/
+static void history_evict_group(history_t *h) {
+	do {
+		history_frame_t *f = history_frame(h, 0);
+		h->bytes -= f->size;
+		free(f->data);
+		f->data = NULL;
+		h->head = (h->head + 1) % h->capacity;
+		h->length--;
+		h->first_frame++;
+		h->frames_evicted++;
+	} while(h->length > 0 && !history_frame(h, 0)->keyframe);
+}
+
+/*
+Apply one frame to the decoder state.
+*/
+static void history_apply(history_t *h, const history_frame_t *f) {
+	const unsigned char *p = f->data;
+	unsigned int i = 0;
+	uint32_t v;
+
+	if(f->keyframe) {
+		memset(h->dec_q, 0, 3 * h->count * sizeof(uint16_t));
+		memset(h->dec_type, 0, h->count);
+	}
+	/* positions: skip count, then three deltas for the next particle */
+	while(i < h->count) {
+		uint16_t *q;
+		p = history_get(p, &v);
+		i += v;
+		if(i >= h->count) {
+			break;
+		}
+		q = &h->dec_q[3 * i];
+		p = history_get(p, &v);
+		q[0] = (uint16_t)(q[0] + (HISTORY_UNZIGZAG(v)));
+		p = history_get(p, &v);
+		q[1] = (uint16_t)(q[1] + (HISTORY_UNZIGZAG(v)));
+		p = history_get(p, &v);
+		q[2] = (uint16_t)(q[2] + (HISTORY_UNZIGZAG(v)));
+		i++;
+	}
+	/* types: skip count, then the new type code */
+	i = 0;
+	while(i < h->count) {
+		p = history_get(p, &v);
+		i += v;
+		if(i >= h->count) {
+			break;
+		}
+		h->dec_type[i++] = *p++;
+	}
+}
+
+/*
+Initialize an empty history.
+
+@param	h	history
+@param	max_frames	most frames kept, 0 for no limit
+@param	max_bytes	most compressed bytes kept, 0 for no limit
+@param	keyframe_interval	frames between keyframes, 0 for the default;
+at most max_frames, so a whole group fits
+
+@returns 0
+*/
+int history_init(history_t *h, unsigned int max_frames, size_t max_bytes,
+		unsigned int keyframe_interval) {
+	memset(h, 0, sizeof(history_t));
+	h->max_frames = max_frames;
+	h->max_bytes = max_bytes;
+	h->keyframe_interval = keyframe_interval ? keyframe_interval :
+		HISTORY_KEYFRAME_INTERVAL;
+	if(max_frames && h->keyframe_interval > max_frames) {
+		h->keyframe_interval = max_frames;
+	}
+	return(0);
+}
+
+/*
+Release everything held by the history.
+*/
+void history_free(history_t *h) {
+	while(h->length > 0) {
+		history_evict_group(h);
+	}
+	free(h->frames);
+	free(h->enc_q);
+	free(h->enc_type);
+	free(h->dec_q);
+	free(h->dec_type);
+	free(h->scratch);
+	h->frames = NULL;
+	h->capacity = 0;
+	h->head = 0;
+	h->enc_q = h->dec_q = NULL;
+	h->enc_type = h->dec_type = NULL;
+	h->scratch = NULL;
+	h->count = 0;
+	h->dec_valid = 0;
+}
+
+/*
+Empty the history and prepare it for a model.
+
+@param	h	history
+@param	count	particles per frame
+@param	origin	world origin, the quantization box
+@param	size	world size
+*/
+void history_reset(history_t *h, unsigned int count, const float origin[3],
+		const float size[3]) {
+	int i;
+	history_free(h);
+	h->count = count;
+	for(i = 0; i < 3; i++) {
+		h->origin[i] = origin[i];
+		h->size[i] = size[i] > 0.0 ? size[i] : 1.0;
+		h->scale[i] = HISTORY_QUANTA / h->size[i];
+	}
+	h->enc_q = (uint16_t*)calloc(3 * (size_t)count, sizeof(uint16_t));
+	h->enc_type = (uint8_t*)calloc(count, sizeof(uint8_t));
+	h->dec_q = (uint16_t*)calloc(3 * (size_t)count, sizeof(uint16_t));
+	h->dec_type = (uint8_t*)calloc(count, sizeof(uint8_t));
+	/* worst case: 1 byte skip + 3 byte deltas, 1 byte skip + type */
+	h->scratch = (unsigned char*)malloc(12 * (size_t)count + 16);
+	if(!h->enc_q || !h->enc_type || !h->dec_q || !h->dec_type || !h->scratch) {
+		perror("history_reset");
+		history_free(h);
+	}
+}
+
+/*
+Compress the store into a new frame, evicting old frames as needed.
+
+@param	h	history
+@param	s	store holding the timestep
+@param	t	simulation time of the timestep
+
+@returns 0 on success, -1 if the history is not set up for this store
+*/
+int history_add(history_t *h, const store_t *s, float t) {
+	history_frame_t *f;
+	unsigned char *p;
+	unsigned int run;
+	unsigned int i;
+	double start = history_now();
+	int keyframe;
+
+	if(h->scratch == NULL || s->count != h->count) {
+		return(-1);
+	}
+	keyframe = (h->length == 0 || h->close_group ||
+		h->since_keyframe + 1 >= h->keyframe_interval);
+	if(keyframe) {
+		memset(h->enc_q, 0, 3 * h->count * sizeof(uint16_t));
+		memset(h->enc_type, 0, h->count);
+		h->since_keyframe = 0;
+		h->close_group = 0;
+	} else {
+		h->since_keyframe++;
+	}
+
+	p = h->scratch;
+	run = 0;
+	for(i = 0; i < h->count; i++) {
+		uint16_t *q = &h->enc_q[3 * i];
+		/* the vertex in the particle's slot, in GL order x, z, y */
+		const float *v = s->vertex[store_slot(s, i)].pos;
+		int32_t d0 = (int32_t)history_quantize(h, 0, v[0]) - q[0];
+		int32_t d1 = (int32_t)history_quantize(h, 1, v[2]) - q[1];
+		int32_t d2 = (int32_t)history_quantize(h, 2, v[1]) - q[2];
+		if(!(d0 | d1 | d2)) {
+			run++;
+			continue;
+		}
+		p = history_put(p, run);
+		p = history_put(p, HISTORY_ZIGZAG(d0));
+		p = history_put(p, HISTORY_ZIGZAG(d1));
+		p = history_put(p, HISTORY_ZIGZAG(d2));
+		q[0] = (uint16_t)(q[0] + d0);
+		q[1] = (uint16_t)(q[1] + d1);
+		q[2] = (uint16_t)(q[2] + d2);
+		run = 0;
+	}
+	if(run) {
+		p = history_put(p, run);
+	}
+	run = 0;
+	for(i = 0; i < h->count; i++) {
+		if(s->type[i] == h->enc_type[i]) {
+			run++;
+			continue;
+		}
+		p = history_put(p, run);
+		*p++ = s->type[i];
+		h->enc_type[i] = s->type[i];
+		run = 0;
+	}
+	if(run) {
+		p = history_put(p, run);
+	}
+
+	/* grow the ring if it is full */
+	if(h->length == h->capacity) {
+		unsigned int capacity = h->capacity ? 2 * h->capacity : 64;
+		history_frame_t *frames = (history_frame_t*)calloc(capacity,
+			sizeof(history_frame_t));
+		if(frames == NULL) {
+			perror("history_add");
+			return(-1);
+		}
+		for(i = 0; i < h->length; i++) {
+			frames[i] = *history_frame(h, i);
+		}
+		free(h->frames);
+		h->frames = frames;
+		h->capacity = capacity;
+		h->head = 0;
+	}
+	f = history_frame(h, h->length);
+	f->t = t;
+	f->keyframe = keyframe;
+	f->size = (size_t)(p - h->scratch);
+	if((f->data = (unsigned char*)malloc(f->size)) == NULL) {
+		perror("history_add");
+		return(-1);
+	}
+	memcpy(f->data, h->scratch, f->size);
+	h->length++;
+	h->bytes += f->size;
+	h->frames_added++;
+
+	/* the newest group, since_keyframe + 1 frames, stays: the frame just
+	added cannot be decoded without it */
+	while(h->length > h->since_keyframe + 1 &&
+			((h->max_frames && h->length > h->max_frames) ||
+			(h->max_bytes && h->bytes > h->max_bytes))) {
+		history_evict_group(h);
+	}
+	/* still over budget: start a group the next frame, this one can go then */
+	h->close_group = h->max_bytes && h->bytes > h->max_bytes;
+	h->encode_seconds += history_now() - start;
+	return(0);
+}
+
+/*
+@returns index of the newest frame at or before t, the oldest frame if t
+precedes them all, or -1 if the history is empty
+*/
+int history_find(const history_t *h, float t) {
+	unsigned int lo = 0;
+	unsigned int hi;
+	if(h->length == 0) {
+		return(-1);
+	}
+	hi = h->length - 1;
+	while(lo < hi) {
+		unsigned int mid = (lo + hi + 1) / 2;
+		if(history_frame(h, mid)->t <= t) {
+			lo = mid;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	return((int)lo);
+}
+
+/*
+@returns simulation time of frame index
+*/
+float history_time(const history_t *h, unsigned int index) {
+	return(history_frame(h, index)->t);
+}
+
+/*
+Decode a frame into a store.  Decoding continues from the last decoded
+frame when going forward, otherwise from the nearest earlier keyframe.
+
+@param	h	history
+@param	index	frame, 0 being the oldest
+@param	out	store, must hold h->count particles
+
+@returns 0 on success, -1 on error
+*/
+int history_decode(history_t *h, unsigned int index, store_t *out) {
+	unsigned long long target = h->first_frame + index;
+	unsigned long long from;
+	unsigned int k;
+	unsigned int i;
+	double start = history_now();
+	float t;
+
+	if(index >= h->length || out->count != h->count) {
+		return(-1);
+	}
+	/* nearest keyframe at or before the target */
+	k = index;
+	while(k > 0 && !history_frame(h, k)->keyframe) {
+		k--;
+	}
+	from = h->first_frame + k;
+	if(h->dec_valid && h->dec_frame >= from && h->dec_frame <= target) {
+		from = h->dec_frame + 1;
+	}
+	for(; from <= target; from++) {
+		history_apply(h, history_frame(h, (unsigned int)(from - h->first_frame)));
+	}
+	h->dec_frame = target;
+	h->dec_valid = 1;
+
+	t = history_frame(h, index)->t;
+	for(i = 0; i < h->count; i++) {
+		const uint16_t *q = &h->dec_q[3 * i];
+		store_set(out, i, t,
+			h->origin[0] + q[0] * (h->size[0] / HISTORY_QUANTA),
+			h->origin[1] + q[1] * (h->size[1] / HISTORY_QUANTA),
+			h->origin[2] + q[2] * (h->size[2] / HISTORY_QUANTA),
+			h->dec_type[i]);
+	}
+	out->current_t = t;
+	out->current_count = h->count;
+	h->decoded_particles += h->count;
+	h->decode_seconds += history_now() - start;
+	return(0);
+}
@@ -0,0 +1,96 @@
+/*
+ * history.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Ring of recently published timesteps.  Each frame is quantized to 16 bits
+ * per axis over the world box and stored as varint deltas against the
+ * previous frame, with runs of unchanged particles collapsed.  Every
+ * keyframe_interval frames is coded against zero so a frame can be decoded
+ * without walking the whole ring, and frames are evicted a keyframe group
+ * at a time when the frame count or byte budget is exceeded.  The group
+ * the newest frame belongs to is never evicted, so the ring is never
+ * emptied by its limits.
+ */
+
+#ifndef HISTORY_H_
+#define HISTORY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "store.h"
+
+/* default frames between keyframes */
+#define HISTORY_KEYFRAME_INTERVAL 16
+
+/*
+One compressed timestep.
+*/
+typedef struct {
+	/* simulation time */
+	float t;
+	/* non-zero if coded against zero rather than the previous frame */
+	int keyframe;
+	/* compressed size */
+	size_t size;
+	unsigned char *data;
+} history_frame_t;
+
+/*
+History ring.
+*/
+typedef struct {
+	/* limits, 0 means no limit */
+	unsigned int max_frames;
+	size_t max_bytes;
+	unsigned int keyframe_interval;
+	/* particles per frame */
+	unsigned int count;
+	/* quantization box */
+	float origin[3];
+	float size[3];
+	/* quanta per world unit */
+	double scale[3];
+	/* frames, oldest first starting at head */
+	history_frame_t *frames;
+	unsigned int capacity;
+	unsigned int head;
+	unsigned int length;
+	/* bytes held by frames */
+	size_t bytes;
+	/* frames since the last keyframe */
+	unsigned int since_keyframe;
+	/* non-zero to make the next frame a keyframe: the newest group alone
+	is over the byte budget */
+	int close_group;
+	/* encoder state: quantized previous frame, xyz interleaved, and types */
+	uint16_t *enc_q;
+	uint8_t *enc_type;
+	/* decoder state and the absolute index of the frame it holds */
+	uint16_t *dec_q;
+	uint8_t *dec_type;
+	unsigned long long dec_frame;
+	int dec_valid;
+	/* scratch encode buffer */
+	unsigned char *scratch;
+	/* absolute index of frames[head] */
+	unsigned long long first_frame;
+	/* statistics */
+	unsigned long long frames_added;
+	unsigned long long frames_evicted;
+	double encode_seconds;
+	unsigned long long decoded_particles;
+	double decode_seconds;
+} history_t;
+
+int history_init(history_t *h, unsigned int max_frames, size_t max_bytes,
+		unsigned int keyframe_interval);
+void history_free(history_t *h);
+void history_reset(history_t *h, unsigned int count, const float origin[3],
+		const float size[3]);
+int history_add(history_t *h, const store_t *s, float t);
+int history_find(const history_t *h, float t);
+float history_time(const history_t *h, unsigned int index);
+int history_decode(history_t *h, unsigned int index, store_t *out);
+
+#endif /* HISTORY_H_ */
@@ -0,0 +1,410 @@
+/*
+ * hud.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/* GL 1.5 buffer binding entry points */
+#define GL_GLEXT_PROTOTYPES 1
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hud.h"
+#ifdef SEEWAVES_GLUT
+#ifdef __APPLE__
+#include <GLUT/glut.h>
+#else
+#include <GL/glut.h>
+#endif
+#endif
+
+/* font cell in the atlas: 5x7 glyph, a column and a row of spacing */
+#define HUD_CELL_WIDTH 6
+#define HUD_CELL_HEIGHT 8
+/* atlas of 16x6 cells for characters ' ' through '~' */
+#define HUD_FIRST ' '
+#define HUD_LAST '~'
+#define HUD_ATLAS_COLUMNS 16
+#define HUD_ATLAS_WIDTH 128
+#define HUD_ATLAS_HEIGHT 64
+
+/* locals */
+#ifndef SEEWAVES_GLUT
+static GLuint hud_atlas(void);
+static unsigned int hud_quads(const hud_t *h, GLfloat x, GLfloat y,
+		const char *text, GLfloat *vertices);
+static void hud_batch(const hud_t *h, const GLfloat *vertices,
+		unsigned int quads);
+#else
+static void hud_glut(GLfloat x, GLfloat y, const char *text);
+#endif
+
+#ifndef SEEWAVES_GLUT
+/* 5x7 font, a byte per column, least significant bit at the top */
+static const unsigned char g_hud_font[HUD_LAST - HUD_FIRST + 1][5] = {
+	{ 0x00, 0x00, 0x00, 0x00, 0x00 },	/* space */
+	{ 0x00, 0x00, 0x5F, 0x00, 0x00 },	/* ! */
+	{ 0x00, 0x07, 0x00, 0x07, 0x00 },	/* " */
+	{ 0x14, 0x7F, 0x14, 0x7F, 0x14 },	/* # */
+	{ 0x24, 0x2A, 0x7F, 0x2A, 0x12 },	/* $ */
+	{ 0x23, 0x13, 0x08, 0x64, 0x62 },	/* % */
+	{ 0x36, 0x49, 0x55, 0x22, 0x50 },	/* & */
+	{ 0x00, 0x05, 0x03, 0x00, 0x00 },	/* quote */
+	{ 0x00, 0x1C, 0x22, 0x41, 0x00 },	/* ( */
+	{ 0x00, 0x41, 0x22, 0x1C, 0x00 },	/* ) */
+	{ 0x08, 0x2A, 0x1C, 0x2A, 0x08 },	/* * */
+	{ 0x08, 0x08, 0x3E, 0x08, 0x08 },	/* + */
+	{ 0x00, 0x50, 0x30, 0x00, 0x00 },	/* , */
+	{ 0x08, 0x08, 0x08, 0x08, 0x08 },	/* - */
+	{ 0x00, 0x60, 0x60, 0x00, 0x00 },	/* . */
+	{ 0x20, 0x10, 0x08, 0x04, 0x02 },	/* / */
+	{ 0x3E, 0x51, 0x49, 0x45, 0x3E },	/* 0 */
+	{ 0x00, 0x42, 0x7F, 0x40, 0x00 },	/* 1 */
+	{ 0x42, 0x61, 0x51, 0x49, 0x46 },	/* 2 */
+	{ 0x21, 0x41, 0x45, 0x4B, 0x31 },	/* 3 */
+	{ 0x18, 0x14, 0x12, 0x7F, 0x10 },	/* 4 */
+	{ 0x27, 0x45, 0x45, 0x45, 0x39 },	/* 5 */
+	{ 0x3C, 0x4A, 0x49, 0x49, 0x30 },	/* 6 */
+	{ 0x01, 0x71, 0x09, 0x05, 0x03 },	/* 7 */
+	{ 0x36, 0x49, 0x49, 0x49, 0x36 },	/* 8 */
+	{ 0x06, 0x49, 0x49, 0x29, 0x1E },	/* 9 */
+	{ 0x00, 0x36, 0x36, 0x00, 0x00 },	/* : */
+	{ 0x00, 0x56, 0x36, 0x00, 0x00 },	/* ; */
+	{ 0x08, 0x14, 0x22, 0x41, 0x00 },	/* < */
+	{ 0x14, 0x14, 0x14, 0x14, 0x14 },	/* = */
+	{ 0x00, 0x41, 0x22, 0x14, 0x08 },	/* > */
+	{ 0x02, 0x01, 0x51, 0x09, 0x06 },	/* ? */
+	{ 0x32, 0x49, 0x79, 0x41, 0x3E },	/* @ */
+	{ 0x7E, 0x11, 0x11, 0x11, 0x7E },	/* A */
+	{ 0x7F, 0x49, 0x49, 0x49, 0x36 },	/* B */
+	{ 0x3E, 0x41, 0x41, 0x41, 0x22 },	/* C */
+	{ 0x7F, 0x41, 0x41, 0x22, 0x1C },	/* D */
+	{ 0x7F, 0x49, 0x49, 0x49, 0x41 },	/* E */
+	{ 0x7F, 0x09, 0x09, 0x09, 0x01 },	/* F */
+	{ 0x3E, 0x41, 0x49, 0x49, 0x7A },	/* G */
+	{ 0x7F, 0x08, 0x08, 0x08, 0x7F },	/* H */
+	{ 0x00, 0x41, 0x7F, 0x41, 0x00 },	/* I */
+	{ 0x20, 0x40, 0x41, 0x3F, 0x01 },	/* J */
+	{ 0x7F, 0x08, 0x14, 0x22, 0x41 },	/* K */
+	{ 0x7F, 0x40, 0x40, 0x40, 0x40 },	/* L */
+	{ 0x7F, 0x02, 0x0C, 0x02, 0x7F },	/* M */
+	{ 0x7F, 0x04, 0x08, 0x10, 0x7F },	/* N */
+	{ 0x3E, 0x41, 0x41, 0x41, 0x3E },	/* O */
+	{ 0x7F, 0x09, 0x09, 0x09, 0x06 },	/* P */
+	{ 0x3E, 0x41, 0x51, 0x21, 0x5E },	/* Q */
+	{ 0x7F, 0x09, 0x19, 0x29, 0x46 },	/* R */
+	{ 0x46, 0x49, 0x49, 0x49, 0x31 },	/* S */
+	{ 0x01, 0x01, 0x7F, 0x01, 0x01 },	/* T */
+	{ 0x3F, 0x40, 0x40, 0x40, 0x3F },	/* U */
+	{ 0x1F, 0x20, 0x40, 0x20, 0x1F },	/* V */
+	{ 0x3F, 0x40, 0x38, 0x40, 0x3F },	/* W */
+	{ 0x63, 0x14, 0x08, 0x14, 0x63 },	/* X */
+	{ 0x07, 0x08, 0x70, 0x08, 0x07 },	/* Y */
+	{ 0x61, 0x51, 0x49, 0x45, 0x43 },	/* Z */
+	{ 0x00, 0x7F, 0x41, 0x41, 0x00 },	/* [ */
+	{ 0x02, 0x04, 0x08, 0x10, 0x20 },	/* backslash */
+	{ 0x00, 0x41, 0x41, 0x7F, 0x00 },	/* ] */
+	{ 0x04, 0x02, 0x01, 0x02, 0x04 },	/* ^ */
+	{ 0x40, 0x40, 0x40, 0x40, 0x40 },	/* _ */
+	{ 0x00, 0x01, 0x02, 0x04, 0x00 },	/* ` */
+	{ 0x20, 0x54, 0x54, 0x54, 0x78 },	/* a */
+	{ 0x7F, 0x48, 0x44, 0x44, 0x38 },	/* b */
+	{ 0x38, 0x44, 0x44, 0x44, 0x20 },	/* c */
+	{ 0x38, 0x44, 0x44, 0x48, 0x7F },	/* d */
+	{ 0x38, 0x54, 0x54, 0x54, 0x18 },	/* e */
+	{ 0x08, 0x7E, 0x09, 0x01, 0x02 },	/* f */
+	{ 0x0C, 0x52, 0x52, 0x52, 0x3E },	/* g */
+	{ 0x7F, 0x08, 0x04, 0x04, 0x78 },	/* h */
+	{ 0x00, 0x44, 0x7D, 0x40, 0x00 },	/* i */
+	{ 0x20, 0x40, 0x44, 0x3D, 0x00 },	/* j */
+	{ 0x7F, 0x10, 0x28, 0x44, 0x00 },	/* k */
+	{ 0x00, 0x41, 0x7F, 0x40, 0x00 },	/* l */
+	{ 0x7C, 0x04, 0x18, 0x04, 0x78 },	/* m */
+	{ 0x7C, 0x08, 0x04, 0x04, 0x78 },	/* n */
+	{ 0x38, 0x44, 0x44, 0x44, 0x38 },	/* o */
+	{ 0x7C, 0x14, 0x14, 0x14, 0x08 },	/* p */
+	{ 0x08, 0x14, 0x14, 0x18, 0x7C },	/* q */
+	{ 0x7C, 0x08, 0x04, 0x04, 0x08 },	/* r */
+	{ 0x48, 0x54, 0x54, 0x54, 0x20 },	/* s */
+	{ 0x04, 0x3F, 0x44, 0x40, 0x20 },	/* t */
+	{ 0x3C, 0x40, 0x40, 0x20, 0x7C },	/* u */
+	{ 0x1C, 0x20, 0x40, 0x20, 0x1C },	/* v */
+	{ 0x3C, 0x40, 0x30, 0x40, 0x3C },	/* w */
+	{ 0x44, 0x28, 0x10, 0x28, 0x44 },	/* x */
+	{ 0x0C, 0x50, 0x50, 0x50, 0x3C },	/* y */
+	{ 0x44, 0x64, 0x54, 0x4C, 0x44 },	/* z */
+	{ 0x00, 0x08, 0x36, 0x41, 0x00 },	/* { */
+	{ 0x00, 0x00, 0x7F, 0x00, 0x00 },	/* | */
+	{ 0x00, 0x41, 0x36, 0x08, 0x00 },	/* } */
+	{ 0x08, 0x04, 0x08, 0x10, 0x08 }	/* ~ */
+};
+
+/*
+Bake the font into an alpha texture.
+
+@returns texture name
+*/
+static GLuint hud_atlas(void) {
+	static GLubyte texels[HUD_ATLAS_HEIGHT][HUD_ATLAS_WIDTH];
+	GLuint atlas;
+	int c, column, row;
+
+	memset(texels, 0, sizeof(texels));
+	for(c = 0; c <= HUD_LAST - HUD_FIRST; c++) {
+		int left = (c % HUD_ATLAS_COLUMNS) * HUD_CELL_WIDTH;
+		int top = (c / HUD_ATLAS_COLUMNS) * HUD_CELL_HEIGHT;
+		for(column = 0; column < 5; column++) {
+			for(row = 0; row < 7; row++) {
+				if(g_hud_font[c][column] & (1 << row)) {
+					texels[top + row][left + column] = 255;
+				}
+			}
+		}
+	}
+	glGenTextures(1, &atlas);
+	glBindTexture(GL_TEXTURE_2D, atlas);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA8, HUD_ATLAS_WIDTH, HUD_ATLAS_HEIGHT,
+		0, GL_ALPHA, GL_UNSIGNED_BYTE, texels);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return(atlas);
+}
+
+/*
+Lay out a string as quads, one per visible character.
+
+@param	h	display
+@param	x	left edge, pixels
+@param	y	bottom edge, pixels
+@param	text	string, characters outside the font show as '?'
+@param	vertices	room for strlen(text) quads
+
+@returns quads written
+*/
+static unsigned int hud_quads(const hud_t *h, GLfloat x, GLfloat y,
+		const char *text, GLfloat *vertices) {
+	GLfloat width = (GLfloat)(HUD_CELL_WIDTH * h->scale);
+	GLfloat height = (GLfloat)(HUD_CELL_HEIGHT * h->scale);
+	unsigned int quads = 0;
+
+	for(; *text != '\0'; text++, x += width) {
+		int c = (unsigned char)*text;
+		GLfloat s0, t0, s1, t1;
+		GLfloat *v = vertices + quads * 16;
+		if(c == ' ') {
+			continue;
+		}
+		if(c < HUD_FIRST || c > HUD_LAST) {
+			c = '?';
+		}
+		c -= HUD_FIRST;
+		s0 = (GLfloat)((c % HUD_ATLAS_COLUMNS) * HUD_CELL_WIDTH) / HUD_ATLAS_WIDTH;
+		t0 = (GLfloat)((c / HUD_ATLAS_COLUMNS) * HUD_CELL_HEIGHT) /
+			HUD_ATLAS_HEIGHT;
+		s1 = s0 + (GLfloat)HUD_CELL_WIDTH / HUD_ATLAS_WIDTH;
+		t1 = t0 + (GLfloat)HUD_CELL_HEIGHT / HUD_ATLAS_HEIGHT;
+		/* atlas rows run top down, y runs up */
+		v[0] = s0; v[1] = t1; v[2] = x; v[3] = y;
+		v[4] = s1; v[5] = t1; v[6] = x + width; v[7] = y;
+		v[8] = s1; v[9] = t0; v[10] = x + width; v[11] = y + height;
+		v[12] = s0; v[13] = t0; v[14] = x; v[15] = y + height;
+		quads++;
+	}
+	return(quads);
+}
+
+/*
+Draw quads from the atlas in the current color, over the scene.
+*/
+static void hud_batch(const hud_t *h, const GLfloat *vertices,
+		unsigned int quads) {
+	if(quads == 0) {
+		return;
+	}
+	glPushAttrib(GL_ENABLE_BIT | GL_TEXTURE_BIT | GL_COLOR_BUFFER_BIT);
+	glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_LIGHTING);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glEnable(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, h->atlas);
+	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glTexCoordPointer(2, GL_FLOAT, 4 * sizeof(GLfloat), vertices);
+	glVertexPointer(2, GL_FLOAT, 4 * sizeof(GLfloat), vertices + 2);
+	glDrawArrays(GL_QUADS, 0, (GLsizei)(quads * 4));
+	glPopClientAttrib();
+	glPopAttrib();
+}
+#else
+/*
+Draw a string with GLUT's bitmap font, over the scene.
+*/
+static void hud_glut(GLfloat x, GLfloat y, const char *text) {
+	glPushAttrib(GL_ENABLE_BIT);
+	glDisable(GL_DEPTH_TEST);
+	glRasterPos2f(x, y);
+	for(; *text != '\0'; text++) {
+		glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, *text);
+	}
+	glPopAttrib();
+}
+#endif
+
+/*
+Build the atlas.  Needs a current GL context.
+
+@param	h	display
+@param	scale	pixels per font pixel, at least 1
+@param	hz	refreshes per second, 0 to refresh every frame
+
+@returns 0 on success, -1 on error
+*/
+int hud_init(hud_t *h, int scale, double hz) {
+	memset(h, 0, sizeof(hud_t));
+	h->scale = scale > 0 ? scale : 1;
+	h->interval = hz > 0.0 ? 1.0 / hz : 0.0;
+	h->vertices = (GLfloat*)malloc(HUD_LINES * HUD_LINE_CHARS * 16 *
+		sizeof(GLfloat));
+	if(h->vertices == NULL) {
+		perror("hud_init");
+		return(-1);
+	}
+#ifndef SEEWAVES_GLUT
+	h->atlas = hud_atlas();
+#endif
+	return(0);
+}
+
+/*
+Delete the atlas and cached lines.
+*/
+void hud_free(hud_t *h) {
+	if(h->atlas != 0) {
+		glDeleteTextures(1, &h->atlas);
+	}
+	free(h->vertices);
+	memset(h, 0, sizeof(hud_t));
+}
+
+/*
+Start a refresh if one is due.  Set the lines with hud_line() and finish
+with hud_end(); when none is due, the cached lines stand.
+
+@param	h	display
+@param	now	seconds, any monotonic clock
+
+@returns non-zero if the lines should be set
+*/
+int hud_begin(hud_t *h, double now) {
+	if(now < h->next) {
+		h->stale = 1;
+		return(0);
+	}
+	h->next = now + h->interval;
+	h->stale = 0;
+	h->setting = 0;
+	h->refreshes++;
+	return(1);
+}
+
+/*
+Set the next line of a refresh.  Its quads are rebuilt only if its text or
+position changed.
+
+@param	h	display
+@param	x	left edge, pixels
+@param	y	bottom edge, pixels
+@param	text	line, cut at HUD_LINE_CHARS - 1 characters
+*/
+void hud_line(hud_t *h, GLfloat x, GLfloat y, const char *text) {
+	unsigned int line = h->setting;
+
+	if(line >= HUD_LINES) {
+		return;
+	}
+	h->setting++;
+	if(line < h->lines && h->position[line][0] == x &&
+			h->position[line][1] == y &&
+			!strncmp(h->text[line], text, HUD_LINE_CHARS - 1)) {
+		return;
+	}
+	strncpy(h->text[line], text, HUD_LINE_CHARS - 1);
+	h->text[line][HUD_LINE_CHARS - 1] = '\0';
+	h->position[line][0] = x;
+	h->position[line][1] = y;
+	h->changed = 1;
+}
+
+/*
+Finish a refresh, dropping lines it did not set.
+*/
+void hud_end(hud_t *h) {
+	if(h->setting != h->lines) {
+		h->changed = 1;
+	}
+	h->lines = h->setting;
+	if(h->changed) {
+		h->rebuilds++;
+	}
+}
+
+/*
+Draw the cached lines in the current color, rebuilding their quads if a
+line changed.  Expects a pixel projection, see push_ortho().
+*/
+void hud_draw(hud_t *h) {
+	unsigned int line;
+
+#ifdef SEEWAVES_GLUT
+	for(line = 0; line < h->lines; line++) {
+		hud_glut(h->position[line][0], h->position[line][1], h->text[line]);
+	}
+#else
+	if(h->changed) {
+		h->quads = 0;
+		for(line = 0; line < h->lines; line++) {
+			h->quads += hud_quads(h, h->position[line][0],
+				h->position[line][1], h->text[line],
+				h->vertices + h->quads * 16);
+		}
+		h->changed = 0;
+	}
+	hud_batch(h, h->vertices, h->quads);
+#endif
+}
+
+/*
+Draw one string now, outside the cached lines.
+
+@param	h	display
+@param	x	left edge, pixels
+@param	y	bottom edge, pixels
+@param	text	string, cut at HUD_LINE_CHARS - 1 characters
+*/
+void hud_string(hud_t *h, GLfloat x, GLfloat y, const char *text) {
+	char line[HUD_LINE_CHARS];
+
+	strncpy(line, text, HUD_LINE_CHARS - 1);
+	line[HUD_LINE_CHARS - 1] = '\0';
+#ifdef SEEWAVES_GLUT
+	(void)h;
+	hud_glut(x, y, line);
+#else
+	{
+		GLfloat vertices[HUD_LINE_CHARS * 16];
+		hud_batch(h, vertices, hud_quads(h, x, y, line, vertices));
+	}
+#endif
+}
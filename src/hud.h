@@ -0,0 +1,59 @@
+/*
+ * hud.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Heads-up display text.  Glyphs of a built-in 5x7 font are baked once into
+ * an alpha texture atlas, and every HUD line is drawn from it as one batch
+ * of textured quads.  Lines are regenerated only at the refresh rate; a line
+ * whose text and position are unchanged keeps its cached quads, so a frame
+ * between refreshes draws the batch and formats nothing.  Built with
+ * SEEWAVES_GLUT, the cached lines are drawn with GLUT's bitmap font instead.
+ */
+
+#ifndef HUD_H_
+#define HUD_H_
+
+#include "GL/glfw.h"
+
+/* lines and characters per line the display caches */
+#define HUD_LINES 16
+#define HUD_LINE_CHARS 192
+
+/*
+Atlas, cached lines and their quads.
+*/
+typedef struct {
+	/* alpha texture of the font, 0 when drawing with GLUT */
+	GLuint atlas;
+	/* pixels per font pixel */
+	int scale;
+	/* seconds between refreshes, 0 for every frame, and the next one due */
+	double interval;
+	double next;
+	/* non-zero if a frame skipped a refresh since the last one */
+	int stale;
+	/* lines as last set, and lines set by the refresh under way */
+	char text[HUD_LINES][HUD_LINE_CHARS];
+	GLfloat position[HUD_LINES][2];
+	unsigned int lines;
+	unsigned int setting;
+	/* non-zero if the quads no longer match the lines */
+	int changed;
+	/* s, t, x, y of four vertices per quad, for every line */
+	GLfloat *vertices;
+	unsigned int quads;
+	/* refreshes, and those that changed a line */
+	unsigned long long refreshes;
+	unsigned long long rebuilds;
+} hud_t;
+
+int hud_init(hud_t *h, int scale, double hz);
+void hud_free(hud_t *h);
+int hud_begin(hud_t *h, double now);
+void hud_line(hud_t *h, GLfloat x, GLfloat y, const char *text);
+void hud_end(hud_t *h);
+void hud_draw(hud_t *h);
+void hud_string(hud_t *h, GLfloat x, GLfloat y, const char *text);
+
+#endif /* HUD_H_ */
@@ -0,0 +1,402 @@
+/*
+ * idmap.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "store.h"
+#include "idmap.h"
+
+/* first hash table size */
+#define IDMAP_HASH_MIN 1024
+
+/* locals */
+static unsigned int idmap_hash(const idmap_t *m, uint32_t id);
+static int idmap_grow(idmap_t *m);
+static int idmap_leave_identity(idmap_t *m);
+static unsigned int idmap_take(idmap_t *m, uint32_t id);
+static void idmap_unhash(idmap_t *m, unsigned int b);
+
+/*
+@returns home bucket of id.  Ids from senders are often strided, so every
+bit is mixed (the MurmurHash3 finalizer) before taking the low ones.
+*/
+static unsigned int idmap_hash(const idmap_t *m, uint32_t id) {
+	id ^= id >> 16;
+	id *= 0x85ebca6bU;
+	id ^= id >> 13;
+	id *= 0xc2b2ae35U;
+	id ^= id >> 16;
+	return(id & m->hash_mask);
+}
+
+/*
+Double the hash table, or create it, and reinsert every entry.
+
+@returns 0 on success, -1 on allocation failure
+*/
+static int idmap_grow(idmap_t *m) {
+	unsigned int size = m->keys ? 2 * (m->hash_mask + 1) : IDMAP_HASH_MIN;
+	uint32_t *keys = (uint32_t*)malloc(size * sizeof(uint32_t));
+	unsigned int *values = (unsigned int*)malloc(size * sizeof(unsigned int));
+	uint32_t *old_keys = m->keys;
+	unsigned int *old_values = m->values;
+	unsigned int old_size = m->keys ? m->hash_mask + 1 : 0;
+	unsigned int i;
+
+	if(keys == NULL || values == NULL) {
+		perror("idmap_grow");
+		free(keys);
+		free(values);
+		return(-1);
+	}
+	memset(keys, 0xff, size * sizeof(uint32_t));
+	m->keys = keys;
+	m->values = values;
+	m->hash_mask = size - 1;
+	for(i = 0; i < old_size; i++) {
+		unsigned int b;
+		if(old_keys[i] == IDMAP_NONE) {
+			continue;
+		}
+		for(b = idmap_hash(m, old_keys[i]); keys[b] != IDMAP_NONE;
+				b = (b + 1) & m->hash_mask) {
+		}
+		keys[b] = old_keys[i];
+		values[b] = old_values[i];
+	}
+	free(old_keys);
+	free(old_values);
+	return(0);
+}
+
+/*
+Switch from identity to tables.  Ids below the highest seen keep their
+index, the rest of the indices are freed.
+
+@returns 0 on success, -1 on allocation failure
+*/
+static int idmap_leave_identity(idmap_t *m) {
+	unsigned int i;
+
+	m->dense = (unsigned int*)store_column(m->capacity, sizeof(unsigned int));
+	m->id_of = (uint32_t*)store_column(m->capacity, sizeof(uint32_t));
+	m->free_list = (unsigned int*)store_column(m->capacity,
+		sizeof(unsigned int));
+	if(m->dense == NULL || m->id_of == NULL || m->free_list == NULL) {
+		perror("idmap_leave_identity");
+		store_column_free(m->dense, m->capacity, sizeof(unsigned int));
+		store_column_free(m->id_of, m->capacity, sizeof(uint32_t));
+		store_column_free(m->free_list, m->capacity, sizeof(unsigned int));
+		m->dense = NULL;
+		m->id_of = NULL;
+		m->free_list = NULL;
+		return(-1);
+	}
+	for(i = 0; i < m->capacity; i++) {
+		if(i < m->identity_seen) {
+			m->dense[i] = i;
+			m->id_of[i] = i;
+		} else {
+			m->dense[i] = IDMAP_NONE;
+			m->id_of[i] = IDMAP_NONE;
+			m->free_list[m->free_count++] = i;
+		}
+	}
+	m->dense_size = m->capacity;
+	m->identity_size = 0;
+	m->identity_seen = 0;
+	return(0);
+}
+
+/*
+@returns a free index for id, or IDMAP_NONE if there are none left
+*/
+static unsigned int idmap_take(idmap_t *m, uint32_t id) {
+	unsigned int index;
+	if(m->free_next == m->free_count) {
+		m->dropped++;
+		return(IDMAP_NONE);
+	}
+	index = m->free_list[m->free_next++];
+	m->id_of[index] = id;
+	return(index);
+}
+
+/*
+Empty hash bucket b, moving later entries of its probe run back so that
+none is left behind a hole.
+*/
+static void idmap_unhash(idmap_t *m, unsigned int b) {
+	unsigned int next = b;
+	for(;;) {
+		unsigned int home;
+		m->keys[b] = IDMAP_NONE;
+		do {
+			next = (next + 1) & m->hash_mask;
+			if(m->keys[next] == IDMAP_NONE) {
+				m->hashed--;
+				return;
+			}
+			home = idmap_hash(m, m->keys[next]);
+		/* entries whose home lies cyclically in (b, next] stay */
+		} while(b <= next ? (b < home && home <= next) :
+			(b < home || home <= next));
+		m->keys[b] = m->keys[next];
+		m->values[b] = m->values[next];
+		b = next;
+	}
+}
+
+/*
+Initialize for a model, every id its own index.
+
+@param	m	id map
+@param	capacity	particles in the model, the store's count
+
+@returns 0 on success, -1 if the model has more particles than indices
+*/
+int idmap_init(idmap_t *m, unsigned int capacity) {
+	memset(m, 0, sizeof(idmap_t));
+	if(capacity >= IDMAP_NONE) {
+		fprintf(stderr, "idmap_init: cannot map %u particles\n", capacity);
+		return(-1);
+	}
+	m->capacity = capacity;
+	m->identity_size = capacity;
+	return(0);
+}
+
+/*
+Release the tables.
+*/
+void idmap_free(idmap_t *m) {
+	store_column_free(m->dense, m->dense_size, sizeof(unsigned int));
+	store_column_free(m->id_of, m->capacity, sizeof(uint32_t));
+	store_column_free(m->free_list, m->capacity, sizeof(unsigned int));
+	free(m->keys);
+	free(m->values);
+	memset(m, 0, sizeof(idmap_t));
+}
+
+/*
+Make room for a model that grew.  Indices only grow: ids keep theirs, and
+the new ones are free, or the new ids' own while in identity.  The dense
+table keeps its size, ids past it are hashed.
+
+@param	m	id map
+@param	capacity	particles in the model, the store's count
+
+@returns 0 on success, -1 on allocation failure, the map is unchanged
+*/
+int idmap_resize(idmap_t *m, unsigned int capacity) {
+	uint32_t *id_of;
+	unsigned int *free_list;
+	unsigned int i, n;
+
+	if(capacity <= m->capacity) {
+		return(0);
+	}
+	if(capacity >= IDMAP_NONE) {
+		fprintf(stderr, "idmap_resize: cannot map %u particles\n", capacity);
+		return(-1);
+	}
+	if(m->identity_size > 0 || m->capacity == 0) {
+		m->capacity = capacity;
+		m->identity_size = capacity;
+		return(0);
+	}
+
+	id_of = (uint32_t*)store_column(capacity, sizeof(uint32_t));
+	free_list = (unsigned int*)store_column(capacity, sizeof(unsigned int));
+	if(id_of == NULL || free_list == NULL) {
+		perror("idmap_resize");
+		store_column_free(id_of, capacity, sizeof(uint32_t));
+		store_column_free(free_list, capacity, sizeof(unsigned int));
+		return(-1);
+	}
+	memcpy(id_of, m->id_of, m->capacity * sizeof(uint32_t));
+	/* indices still free first, then the new ones */
+	n = 0;
+	for(i = m->free_next; i < m->free_count; i++) {
+		free_list[n++] = m->free_list[i];
+	}
+	for(i = m->capacity; i < capacity; i++) {
+		id_of[i] = IDMAP_NONE;
+		free_list[n++] = i;
+	}
+	store_column_free(m->id_of, m->capacity, sizeof(uint32_t));
+	store_column_free(m->free_list, m->capacity, sizeof(unsigned int));
+	m->id_of = id_of;
+	m->free_list = free_list;
+	m->free_next = 0;
+	m->free_count = n;
+	m->capacity = capacity;
+	return(0);
+}
+
+/*
+Forget an id that left the model.  Its index is free for the next new id.
+Leaves identity, the unseen ids in it are not known to be free.
+
+@param	m	id map
+@param	id	wire particle id, a no-op if it has no index
+*/
+void idmap_remove(idmap_t *m, uint32_t id) {
+	unsigned int index;
+	unsigned int b;
+
+	if(m->identity_size > 0) {
+		if(id >= m->identity_seen || idmap_leave_identity(m)) {
+			return;
+		}
+	}
+	if(id < m->dense_size) {
+		if((index = m->dense[id]) == IDMAP_NONE) {
+			return;
+		}
+		m->dense[id] = IDMAP_NONE;
+	} else {
+		if(m->keys == NULL || id == IDMAP_NONE) {
+			return;
+		}
+		for(b = idmap_hash(m, id); m->keys[b] != id;
+				b = (b + 1) & m->hash_mask) {
+			if(m->keys[b] == IDMAP_NONE) {
+				return;
+			}
+		}
+		index = m->values[b];
+		idmap_unhash(m, b);
+	}
+	m->id_of[index] = IDMAP_NONE;
+	/* handed out next, in the slot the last take left */
+	if(m->free_next > 0) {
+		m->free_list[--m->free_next] = index;
+	} else {
+		m->free_list[m->free_count++] = index;
+	}
+	m->removed++;
+}
+
+/*
+Index of an id, assigning a free one if it is new.  The slow path of
+idmap_index().
+
+@param	m	id map
+@param	id	wire particle id
+
+@returns index below m->capacity, or IDMAP_NONE if the store is full
+*/
+unsigned int idmap_insert(idmap_t *m, uint32_t id) {
+	unsigned int b;
+	unsigned int index;
+
+	if(id < m->identity_size) {
+		if(id >= m->identity_seen) {
+			m->identity_seen = id + 1;
+		}
+		return(id);
+	}
+	if(m->identity_size > 0 && idmap_leave_identity(m)) {
+		m->dropped++;
+		return(IDMAP_NONE);
+	}
+	if(id < m->dense_size) {
+		if(m->dense[id] == IDMAP_NONE) {
+			m->dense[id] = idmap_take(m, id);
+		}
+		return(m->dense[id]);
+	}
+
+	/* the empty key cannot be stored */
+	if(id == IDMAP_NONE) {
+		m->dropped++;
+		return(IDMAP_NONE);
+	}
+	if(m->keys != NULL) {
+		m->lookups++;
+		for(b = idmap_hash(m, id); m->keys[b] != IDMAP_NONE;
+				b = (b + 1) & m->hash_mask) {
+			m->probes++;
+			if(m->keys[b] == id) {
+				return(m->values[b]);
+			}
+		}
+	}
+	if(m->keys == NULL || (m->hashed + 1) * 100ULL >
+			(m->hash_mask + 1) * (unsigned long long)IDMAP_LOAD) {
+		if(idmap_grow(m)) {
+			m->dropped++;
+			return(IDMAP_NONE);
+		}
+	}
+	if((index = idmap_take(m, id)) == IDMAP_NONE) {
+		return(IDMAP_NONE);
+	}
+	for(b = idmap_hash(m, id); m->keys[b] != IDMAP_NONE;
+			b = (b + 1) & m->hash_mask) {
+	}
+	m->keys[b] = id;
+	m->values[b] = index;
+	m->hashed++;
+	return(index);
+}
+
+/*
+Index of an id without assigning one.
+
+@returns index, or IDMAP_NONE if the id has not been seen
+*/
+unsigned int idmap_find(const idmap_t *m, uint32_t id) {
+	unsigned int b;
+
+	if(m->identity_size > 0) {
+		return(id < m->identity_size ? idmap_id(m, id) : IDMAP_NONE);
+	}
+	if(id < m->dense_size) {
+		return(m->dense[id]);
+	}
+	if(m->keys == NULL) {
+		return(IDMAP_NONE);
+	}
+	for(b = idmap_hash(m, id); m->keys[b] != IDMAP_NONE;
+			b = (b + 1) & m->hash_mask) {
+		if(m->keys[b] == id) {
+			return(m->values[b]);
+		}
+	}
+	return(IDMAP_NONE);
+}
+
+/*
+@returns wire id held at index, IDMAP_NONE if the index is unused
+*/
+uint32_t idmap_id(const idmap_t *m, unsigned int index) {
+	if(index >= m->capacity) {
+		return(IDMAP_NONE);
+	}
+	if(m->identity_size > 0) {
+		return(index < m->identity_seen ? index : IDMAP_NONE);
+	}
+	return(m->id_of[index]);
+}
+
+/*
+@returns bytes held by the tables
+*/
+size_t idmap_bytes(const idmap_t *m) {
+	size_t bytes = 0;
+	if(m->dense != NULL) {
+		bytes += (size_t)m->dense_size * sizeof(unsigned int) +
+			(size_t)m->capacity * (sizeof(unsigned int) + sizeof(uint32_t));
+	}
+	if(m->keys != NULL) {
+		bytes += (size_t)(m->hash_mask + 1) * (sizeof(uint32_t) +
+			sizeof(unsigned int));
+	}
+	return(bytes);
+}
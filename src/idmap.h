@@ -0,0 +1,97 @@
+/*
+ * idmap.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Wire particle id to store index.  The store has one index per particle
+ * of the model.  As long as every id is below the model's particle count,
+ * the usual dense case, an id is its own index and mapping costs one
+ * compare or two.  The first id outside that range switches the map
+ * over: ids up to the highest seen keep their index, the indices above go on a
+ * free list, and from then on dense ids go through a direct table and all
+ * others through an open-addressing hash with linear probing.  Sparse or
+ * growing id spaces (filtered streams, several sender ranks, inserted
+ * particles) thus cost memory for the particles present rather than for
+ * the largest id.  A model that grows gets more indices (idmap_resize()),
+ * and ids that leave it give theirs back (idmap_remove()).  Lookups never
+ * return an index outside the store.  The data thread maps ids as packets
+ * arrive, so reception tracking and the store share the indices.
+ */
+
+#ifndef IDMAP_H_
+#define IDMAP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* no index: unseen id, or no room left */
+#define IDMAP_NONE 0xffffffffU
+/* hash table load limit, in percent */
+#define IDMAP_LOAD 50
+
+/*
+Id map.
+*/
+typedef struct {
+	/* indices available, the store's count */
+	unsigned int capacity;
+	/* ids below this are their own index: capacity until the first id out
+	of range, then 0 */
+	unsigned int identity_size;
+	/* ids below this have been seen, while in identity */
+	unsigned int identity_seen;
+	/* index of each id below dense_size, IDMAP_NONE if unseen */
+	unsigned int *dense;
+	unsigned int dense_size;
+	/* ids at or above dense_size, IDMAP_NONE keys are empty; allocated on
+	first use, hash_mask + 1 entries */
+	uint32_t *keys;
+	unsigned int *values;
+	unsigned int hash_mask;
+	/* wire id of each index, once out of identity */
+	uint32_t *id_of;
+	/* unused indices, handed out from free_next on */
+	unsigned int *free_list;
+	unsigned int free_count;
+	unsigned int free_next;
+	/* statistics */
+	unsigned int hashed;
+	unsigned long long lookups;
+	unsigned long long probes;
+	unsigned long long dropped;
+	unsigned long long removed;
+} idmap_t;
+
+int idmap_init(idmap_t *m, unsigned int capacity);
+void idmap_free(idmap_t *m);
+int idmap_resize(idmap_t *m, unsigned int capacity);
+unsigned int idmap_insert(idmap_t *m, uint32_t id);
+void idmap_remove(idmap_t *m, uint32_t id);
+unsigned int idmap_find(const idmap_t *m, uint32_t id);
+uint32_t idmap_id(const idmap_t *m, unsigned int index);
+size_t idmap_bytes(const idmap_t *m);
+
+/*
+Index of an id, assigning a free one on first sight.  Dense ids cost a
+compare, or a table load once out of identity; everything else goes out of
+line.
+
+@param	m	id map
+@param	id	wire particle id
+
+@returns index below m->capacity, or IDMAP_NONE if the store is full
+*/
+static inline unsigned int idmap_index(idmap_t *m, uint32_t id) {
+	if(id < m->identity_size) {
+		if(id >= m->identity_seen) {
+			m->identity_seen = id + 1;
+		}
+		return(id);
+	}
+	if(id < m->dense_size && m->dense[id] != IDMAP_NONE) {
+		return(m->dense[id]);
+	}
+	return(idmap_insert(m, id));
+}
+
+#endif /* IDMAP_H_ */
@@ -0,0 +1,220 @@
+/*
+ * idmap_bench.c
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Particle id mapping benchmark.  Ingests timesteps into a store three
+ * ways: indexing it with the wire id directly (the old decode path), through
+ * the id map with dense ids, and through the id map with ids scattered over
+ * the whole 32-bit space, as from filtered or multi-rank senders.  Direct
+ * and dense timesteps alternate so both see the same machine, and the best
+ * of each is kept.  Exits non-zero if dense mapping is slower than direct
+ * indexing by more than the tolerance.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include "store.h"
+#include "idmap.h"
+
+/* keeps the lookup passes from being optimized away */
+static volatile unsigned long long g_bench_sink;
+
+/* Local prototypes */
+static void bench_usage(void);
+static double bench_now(void);
+static uint32_t bench_scatter(uint32_t i);
+static double bench_lookup(idmap_t *map, const uint32_t *ids,
+		unsigned int particles);
+static double bench_step(store_t *store, idmap_t *map, const uint32_t *ids,
+		unsigned int particles, int step);
+static void bench_report(const char *label, const idmap_t *map,
+		unsigned int particles, double lookup_s, double ingest_s);
+
+static void bench_usage(void) {
+	printf("usage: idmap_bench [ options ]\n\n");
+	printf("Options:\n\n");
+	printf("--particles -n <count>   Particle count (10000000)\n");
+	printf("--iterations -i <count>  Timesteps to time (5)\n");
+	printf("--tolerance -t <pct>     Allowed dense slowdown over direct (5)\n");
+}
+
+/*
+@returns monotonic time in seconds
+*/
+static double bench_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return(ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+/*
+@returns distinct, scattered 32-bit id for each i, never IDMAP_NONE
+*/
+static uint32_t bench_scatter(uint32_t i) {
+	/* odd multiplier, a bijection on 32 bits */
+	uint32_t id = i * 2246822519U + 374761393U;
+	return(id == IDMAP_NONE ? 0 : id);
+}
+
+/*
+Look up every particle.  A NULL map takes the wire id as the index.
+
+@returns seconds taken
+*/
+static double bench_lookup(idmap_t *map, const uint32_t *ids,
+		unsigned int particles) {
+	double start = bench_now();
+	unsigned long long sum = 0;
+	unsigned int i;
+	for(i = 0; i < particles; i++) {
+		sum += map ? idmap_index(map, ids[i]) : ids[i];
+	}
+	g_bench_sink = sum;
+	return(bench_now() - start);
+}
+
+/*
+Ingest one timestep of every particle in wire id order, bounds-checked as
+the data thread does.  A NULL map takes the wire id as the index.
+
+@returns seconds taken
+*/
+static double bench_step(store_t *store, idmap_t *map, const uint32_t *ids,
+		unsigned int particles, int step) {
+	double start = bench_now();
+	unsigned int i;
+	for(i = 0; i < particles; i++) {
+		unsigned int id = map ? idmap_index(map, ids[i]) : ids[i];
+		if(id >= store->count) {
+			continue;
+		}
+		store_set(store, id, (float)step, i + 0.001 * step, 0.0, 0.0,
+			STORE_TYPE_FLUID);
+	}
+	return(bench_now() - start);
+}
+
+/*
+Print one summary line.
+*/
+static void bench_report(const char *label, const idmap_t *map,
+		unsigned int particles, double lookup_s, double ingest_s) {
+	printf("%-8s lookup(%6.2fns %7.1fM/s) ingest(%7.2fms %6.1fM/s) "
+		"map(%6.1fMB hashed %u %.2f probes/lookup dropped %llu)\n", label,
+		lookup_s * 1e9 / particles, particles / lookup_s / 1e6,
+		ingest_s * 1000.0, particles / ingest_s / 1e6,
+		map ? idmap_bytes(map) / (1024.0 * 1024.0) : 0.0,
+		map ? map->hashed : 0, map && map->lookups ?
+		(double)map->probes / map->lookups : 0.0, map ? map->dropped : 0ULL);
+}
+
+int main(int argc, char *argv[]) {
+	static struct option long_options[] = {
+		{ "particles", required_argument, 0, 'n' },
+		{ "iterations", required_argument, 0, 'i' },
+		{ "tolerance", required_argument, 0, 't' },
+		{ "help", no_argument, 0, '?' },
+		{ 0, 0, 0, 0 }
+	};
+	unsigned int particles = 10000000;
+	int iterations = 5;
+	double tolerance = 5.0;
+	store_palette_t palette;
+	store_t direct, dense, sparse;
+	idmap_t dense_map, sparse_map;
+	uint32_t *ids;
+	uint32_t *scattered;
+	/* best lookup then ingest times: direct, dense, sparse */
+	double best[6] = { 1e9, 1e9, 1e9, 1e9, 1e9, 1e9 };
+	double s;
+	unsigned int i;
+	int step;
+	int c;
+
+	while((c = getopt_long(argc, argv, "n:i:t:?", long_options,
+			NULL)) != -1) {
+		switch(c) {
+		case 'n':
+			particles = (unsigned int)strtoul(optarg, NULL, 10);
+			break;
+		case 'i':
+			iterations = atoi(optarg);
+			break;
+		case 't':
+			tolerance = atof(optarg);
+			break;
+		default:
+			bench_usage();
+			return(EXIT_FAILURE);
+		}
+	}
+	if(particles == 0 || iterations <= 0) {
+		bench_usage();
+		return(EXIT_FAILURE);
+	}
+	ids = (uint32_t*)malloc(particles * sizeof(uint32_t));
+	scattered = (uint32_t*)malloc(particles * sizeof(uint32_t));
+	if(ids == NULL || scattered == NULL) {
+		perror("malloc");
+		return(EXIT_FAILURE);
+	}
+	for(i = 0; i < particles; i++) {
+		ids[i] = i;
+		scattered[i] = bench_scatter(i);
+	}
+	memset(&palette, 0, sizeof(palette));
+	if(store_init(&direct, particles, &palette) ||
+			store_init(&dense, particles, &palette) ||
+			store_init(&sparse, particles, &palette) ||
+			idmap_init(&dense_map, dense.count) ||
+			idmap_init(&sparse_map, sparse.count)) {
+		return(EXIT_FAILURE);
+	}
+	printf("particles(%u) iterations(%i)\n", particles, iterations);
+
+	/* first timestep faults pages in and assigns indices */
+	(void)bench_step(&direct, NULL, ids, particles, 0);
+	(void)bench_step(&dense, &dense_map, ids, particles, 0);
+	(void)bench_step(&sparse, &sparse_map, scattered, particles, 0);
+
+	for(step = 1; step <= iterations; step++) {
+		if((s = bench_lookup(NULL, ids, particles)) < best[0]) {
+			best[0] = s;
+		}
+		if((s = bench_lookup(&dense_map, ids, particles)) < best[1]) {
+			best[1] = s;
+		}
+		if((s = bench_lookup(&sparse_map, scattered, particles)) < best[2]) {
+			best[2] = s;
+		}
+		if((s = bench_step(&direct, NULL, ids, particles, step)) < best[3]) {
+			best[3] = s;
+		}
+		if((s = bench_step(&dense, &dense_map, ids, particles, step)) < best[4]) {
+			best[4] = s;
+		}
+		if((s = bench_step(&sparse, &sparse_map, scattered, particles,
+				step)) < best[5]) {
+			best[5] = s;
+		}
+	}
+	bench_report("direct", NULL, particles, best[0], best[3]);
+	bench_report("dense", &dense_map, particles, best[1], best[4]);
+	bench_report("sparse", &sparse_map, particles, best[2], best[5]);
+	printf("dense vs direct: %+.1f%% (tolerance %.1f%%)\n",
+		(best[4] / best[3] - 1.0) * 100.0, tolerance);
+
+	idmap_free(&dense_map);
+	idmap_free(&sparse_map);
+	store_free(&direct);
+	store_free(&dense);
+	store_free(&sparse);
+	free(ids);
+	free(scattered);
+	return(best[4] <= best[3] * (1.0 + tolerance / 100.0) ?
+		EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,594 @@
+/*
+ * lod.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include <time.h>
+#include "lod.h"
+#include "cull.h"
+
+/* selection state of a node */
+enum {
+	LOD_HIDDEN,
+	LOD_SAMPLED,
+	LOD_WHOLE,
+	LOD_OPENED
+};
+
+/* frames the budget doubles for at most, keeps the shift in range */
+#define LOD_STILL_MAX 24
+
+/* parallel pass arguments */
+typedef struct {
+	lod_t *lod;
+	const store_vertex_t *vertex;
+} lod_job_t;
+
+/* locals */
+static double lod_now(void);
+static unsigned int lod_add(lod_t *l, unsigned int begin, unsigned int end,
+		unsigned int shift, unsigned int type);
+static unsigned int lod_lower(const uint32_t *keys, unsigned int begin,
+		unsigned int end, uint32_t key);
+static int lod_split(lod_t *l, const uint32_t *keys, unsigned int node);
+static void lod_bounds_pass(void *user, unsigned int begin, unsigned int end,
+		int worker);
+static int lod_reserve(lod_t *l, unsigned int count);
+static float lod_pixels(const lod_node_t *n, const double modelview[16],
+		const double projection[16], int height);
+static void lod_push(lod_t *l, unsigned int *heap, unsigned int node);
+static unsigned int lod_pop(lod_t *l, unsigned int *heap);
+static void lod_emit(lod_t *l, unsigned int node, unsigned int *runs,
+		unsigned int *samples);
+
+/*
+@returns monotonic time in seconds
+*/
+static double lod_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return(ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+/*
+Append a node to the tree being built.
+
+@returns its index, LOD_NONE on allocation failure
+*/
+static unsigned int lod_add(lod_t *l, unsigned int begin, unsigned int end,
+		unsigned int shift, unsigned int type) {
+	lod_node_t *n;
+
+	if(l->spare_count == l->spare_capacity) {
+		unsigned int capacity = l->spare_capacity ? 2 * l->spare_capacity : 64;
+		lod_node_t *grown = (lod_node_t*)realloc(l->spare,
+			capacity * sizeof(lod_node_t));
+		if(grown == NULL) {
+			perror("lod_add");
+			return(LOD_NONE);
+		}
+		l->spare = grown;
+		l->spare_capacity = capacity;
+	}
+	n = &l->spare[l->spare_count];
+	memset(n, 0, sizeof(lod_node_t));
+	n->begin = begin;
+	n->end = end;
+	n->shift = (uint8_t)shift;
+	n->type = (uint8_t)type;
+	return(l->spare_count++);
+}
+
+/*
+@returns first of the sorted keys begin to end not below key, end if none
+*/
+static unsigned int lod_lower(const uint32_t *keys, unsigned int begin,
+		unsigned int end, uint32_t key) {
+	while(begin < end) {
+		unsigned int middle = begin + (end - begin) / 2;
+		if(keys[middle] < key) {
+			begin = middle + 1;
+		} else {
+			end = middle;
+		}
+	}
+	return(begin);
+}
+
+/*
+Split a node holding more than LOD_LEAF particles by the next three key
+bits, past any cell whose particles all fall in one child.
+
+@returns 0 on success, -1 on allocation failure
+*/
+static int lod_split(lod_t *l, const uint32_t *keys, unsigned int node) {
+	unsigned int begin = l->spare[node].begin;
+	unsigned int end = l->spare[node].end;
+	unsigned int shift = l->spare[node].shift;
+	unsigned int bound[9];
+	unsigned int first;
+	uint32_t base;
+	int children, d;
+
+	if(end - begin <= LOD_LEAF) {
+		return(0);
+	}
+	do {
+		if(shift == 0) {
+			/* one lattice cell, a leaf however full */
+			return(0);
+		}
+		shift -= 3;
+		base = keys[begin] & ~((8U << shift) - 1);
+		bound[0] = begin;
+		bound[8] = end;
+		children = 0;
+		for(d = 1; d < 8; d++) {
+			bound[d] = lod_lower(keys, bound[d - 1], end,
+				base | ((uint32_t)d << shift));
+			children += bound[d] > bound[d - 1];
+		}
+		children += end > bound[7];
+	} while(children < 2);
+
+	first = l->spare_count;
+	for(d = 0; d < 8; d++) {
+		if(bound[d + 1] > bound[d] && lod_add(l, bound[d], bound[d + 1],
+				shift, l->spare[node].type) == LOD_NONE) {
+			return(-1);
+		}
+	}
+	l->spare[node].shift = (uint8_t)(shift + 3);
+	l->spare[node].child = first;
+	l->spare[node].children = (unsigned int)children;
+	return(0);
+}
+
+/*
+Bound this worker's leaves, parents are merged from them afterwards.
+*/
+static void lod_bounds_pass(void *user, unsigned int begin, unsigned int end,
+		int worker) {
+	lod_job_t *job = (lod_job_t*)user;
+	unsigned int node, slot;
+	(void)worker;
+
+	for(node = begin; node < end; node++) {
+		lod_node_t *n = &job->lod->spare[node];
+		float *b = n->box;
+		if(n->children > 0) {
+			continue;
+		}
+		b[0] = b[1] = b[2] = FLT_MAX;
+		b[3] = b[4] = b[5] = -FLT_MAX;
+		for(slot = n->begin; slot < n->end; slot++) {
+			const float *p = job->vertex[slot].pos;
+			b[0] = p[0] < b[0] ? p[0] : b[0];
+			b[1] = p[1] < b[1] ? p[1] : b[1];
+			b[2] = p[2] < b[2] ? p[2] : b[2];
+			b[3] = p[0] > b[3] ? p[0] : b[3];
+			b[4] = p[1] > b[4] ? p[1] : b[4];
+			b[5] = p[2] > b[5] ? p[2] : b[5];
+		}
+	}
+}
+
+/*
+Grow the selection arrays to the published tree, and the subsample slots
+to the most its sampled nodes could need.  Called with the lock held.
+
+@returns 0 on success, -1 on allocation failure
+*/
+static int lod_reserve(lod_t *l, unsigned int count) {
+	unsigned long long points = (unsigned long long)l->node_count * LOD_SAMPLE;
+
+	if(points > count) {
+		points = count;
+	}
+	if(l->node_count > l->select_capacity) {
+		unsigned int n = l->node_count;
+		uint8_t *state = (uint8_t*)realloc(l->state, n);
+		unsigned int *heap = (unsigned int*)realloc(l->heap,
+			n * sizeof(unsigned int));
+		float *pixels = (float*)realloc(l->pixels, n * sizeof(float));
+		GLint *first = (GLint*)realloc(l->first, n * sizeof(GLint));
+		GLsizei *length = (GLsizei*)realloc(l->length, n * sizeof(GLsizei));
+		if(state != NULL) {
+			l->state = state;
+		}
+		if(heap != NULL) {
+			l->heap = heap;
+		}
+		if(pixels != NULL) {
+			l->pixels = pixels;
+		}
+		if(first != NULL) {
+			l->first = first;
+		}
+		if(length != NULL) {
+			l->length = length;
+		}
+		if(state == NULL || heap == NULL || pixels == NULL || first == NULL ||
+				length == NULL) {
+			perror("lod_reserve");
+			return(-1);
+		}
+		l->select_capacity = n;
+	}
+	if(points > l->index_capacity) {
+		GLuint *indices = (GLuint*)realloc(l->indices,
+			(size_t)points * sizeof(GLuint));
+		if(indices == NULL) {
+			perror("lod_reserve");
+			return(-1);
+		}
+		l->indices = indices;
+		l->index_capacity = (unsigned int)points;
+	}
+	return(0);
+}
+
+/*
+@returns height in pixels a node's bounding sphere projects to, FLT_MAX if
+it reaches the eye
+*/
+static float lod_pixels(const lod_node_t *n, const double modelview[16],
+		const double projection[16], int height) {
+	const float *b = n->box;
+	double x = 0.5 * (b[0] + b[3]);
+	double y = 0.5 * (b[1] + b[4]);
+	double z = 0.5 * (b[2] + b[5]);
+	double radius = 0.5 * sqrt((b[3] - b[0]) * (b[3] - b[0]) +
+		(b[4] - b[1]) * (b[4] - b[1]) + (b[5] - b[2]) * (b[5] - b[2]));
+	/* clip w of the center: its distance in perspective, 1 in ortho */
+	double w = projection[11] * (modelview[2] * x + modelview[6] * y +
+		modelview[10] * z + modelview[14]) + projection[15];
+
+	if(w <= radius && projection[11] != 0.0) {
+		return(FLT_MAX);
+	}
+	return((float)(radius * projection[5] * height / w));
+}
+
+/*
+Add a node to the heap of sampled nodes, largest on screen first.
+*/
+static void lod_push(lod_t *l, unsigned int *heap, unsigned int node) {
+	unsigned int i = (*heap)++;
+
+	while(i > 0) {
+		unsigned int parent = (i - 1) / 2;
+		if(l->pixels[l->heap[parent]] >= l->pixels[node]) {
+			break;
+		}
+		l->heap[i] = l->heap[parent];
+		i = parent;
+	}
+	l->heap[i] = node;
+}
+
+/*
+@returns the sampled node largest on screen, removed from the heap
+*/
+static unsigned int lod_pop(lod_t *l, unsigned int *heap) {
+	unsigned int top = l->heap[0];
+	unsigned int last = l->heap[--(*heap)];
+	unsigned int i = 0;
+
+	for(;;) {
+		unsigned int child = 2 * i + 1;
+		if(child >= *heap) {
+			break;
+		}
+		if(child + 1 < *heap &&
+				l->pixels[l->heap[child + 1]] > l->pixels[l->heap[child]]) {
+			child++;
+		}
+		if(l->pixels[last] >= l->pixels[l->heap[child]]) {
+			break;
+		}
+		l->heap[i] = l->heap[child];
+		i = child;
+	}
+	l->heap[i] = last;
+	return(top);
+}
+
+/*
+Append the runs and subsample slots of a selected subtree, in slot order.
+*/
+static void lod_emit(lod_t *l, unsigned int node, unsigned int *runs,
+		unsigned int *samples) {
+	const lod_node_t *n = &l->nodes[node];
+	unsigned int count = n->end - n->begin;
+	unsigned int i;
+
+	switch(l->state[node]) {
+	case LOD_OPENED:
+		for(i = 0; i < n->children; i++) {
+			lod_emit(l, n->child + i, runs, samples);
+		}
+		break;
+	case LOD_WHOLE:
+		if(*runs > l->run_start[n->type] && (unsigned int)(l->first[*runs - 1] +
+				l->length[*runs - 1]) == n->begin) {
+			l->length[*runs - 1] += (GLsizei)count;
+		} else {
+			l->first[*runs] = (GLint)n->begin;
+			l->length[*runs] = (GLsizei)count;
+			(*runs)++;
+		}
+		break;
+	case LOD_SAMPLED:
+		for(i = 0; i < LOD_SAMPLE; i++) {
+			l->indices[(*samples)++] = n->begin +
+				(GLuint)((unsigned long long)i * count / LOD_SAMPLE);
+		}
+		break;
+	}
+}
+
+/*
+Initialize, arrays are sized by the first lod_build() and lod_select().
+
+@param	l	level of detail state
+@param	enabled	non-zero to build trees
+@param	budget	points drawn with the camera moving, 0 for all
+@param	limit	points refinement stops at, 0 for all
+*/
+void lod_init(lod_t *l, int enabled, unsigned int budget, unsigned int limit) {
+	int i;
+
+	memset(l, 0, sizeof(lod_t));
+	pthread_mutex_init(&l->lock, NULL);
+	l->enabled = enabled;
+	l->budget = budget;
+	l->limit = limit;
+	for(i = 0; i < STORE_TYPE_COUNT; i++) {
+		l->root[i] = LOD_NONE;
+		l->spare_root[i] = LOD_NONE;
+	}
+}
+
+/*
+Free the arrays.
+*/
+void lod_free(lod_t *l) {
+	free(l->nodes);
+	free(l->spare);
+	free(l->state);
+	free(l->heap);
+	free(l->pixels);
+	free(l->first);
+	free(l->length);
+	free(l->indices);
+	pthread_mutex_destroy(&l->lock);
+	memset(l, 0, sizeof(lod_t));
+}
+
+/*
+Build the octrees of the store's types and publish them.  Publish thread, as
+each timestep is published, right after morton_order() so its keys match
+the slots.  Without Morton order an empty tree is published and frames are
+drawn whole.
+
+@param	l	level of detail state
+@param	s	store
+@param	order	Morton order of the store's slots
+@param	pool	threads for the bounding pass
+
+@returns 0 on success, -1 on allocation failure
+*/
+int lod_build(lod_t *l, const store_t *s, const morton_t *order,
+		parallel_t *pool) {
+	double start = lod_now();
+	lod_job_t job;
+	lod_node_t *nodes;
+	unsigned int capacity, node, i;
+	int t;
+
+	if(!l->enabled) {
+		return(0);
+	}
+	l->spare_count = 0;
+	for(t = 0; t < STORE_TYPE_COUNT; t++) {
+		l->spare_root[t] = LOD_NONE;
+	}
+	if(order->enabled && order->keys != NULL && order->capacity >= s->count &&
+			s->count >= 2) {
+		for(t = 0; t < STORE_TYPE_COUNT; t++) {
+			if(s->type_start[t + 1] > s->type_start[t] &&
+					(l->spare_root[t] = lod_add(l, s->type_start[t],
+					s->type_start[t + 1], 3 * MORTON_BITS, t)) == LOD_NONE) {
+				return(-1);
+			}
+		}
+		/* breadth first, children follow their parents */
+		for(node = 0; node < l->spare_count; node++) {
+			if(lod_split(l, order->keys, node)) {
+				return(-1);
+			}
+		}
+		job.lod = l;
+		job.vertex = s->vertex;
+		parallel_for(pool, l->spare_count, lod_bounds_pass, &job);
+		for(node = l->spare_count; node-- > 0;) {
+			lod_node_t *n = &l->spare[node];
+			if(n->children == 0) {
+				continue;
+			}
+			memcpy(n->box, l->spare[n->child].box, sizeof(n->box));
+			for(i = 1; i < n->children; i++) {
+				const float *b = l->spare[n->child + i].box;
+				n->box[0] = b[0] < n->box[0] ? b[0] : n->box[0];
+				n->box[1] = b[1] < n->box[1] ? b[1] : n->box[1];
+				n->box[2] = b[2] < n->box[2] ? b[2] : n->box[2];
+				n->box[3] = b[3] > n->box[3] ? b[3] : n->box[3];
+				n->box[4] = b[4] > n->box[4] ? b[4] : n->box[4];
+				n->box[5] = b[5] > n->box[5] ? b[5] : n->box[5];
+			}
+		}
+	}
+
+	/* swap the finished tree in */
+	pthread_mutex_lock(&l->lock);
+	nodes = l->nodes;
+	capacity = l->node_capacity;
+	l->nodes = l->spare;
+	l->node_capacity = l->spare_capacity;
+	l->node_count = l->spare_count;
+	l->spare = nodes;
+	l->spare_capacity = capacity;
+	memcpy(l->root, l->spare_root, sizeof(l->root));
+	l->count = s->count;
+	l->store = s;
+	pthread_mutex_unlock(&l->lock);
+
+	l->last_build_seconds = lod_now() - start;
+	l->build_seconds += l->last_build_seconds;
+	l->builds++;
+	return(0);
+}
+
+/*
+Choose the nodes a frame draws, for render_particles().  Render thread.
+
+@param	l	level of detail state
+@param	s	store to be drawn
+@param	modelview	transforms the store is drawn with, as glGetDoublev()
+@param	projection
+@param	height	viewport height in pixels
+@param	margin	world units particles reach past their centers
+@param	hidden_types	bit per store_type_t not drawn
+
+@returns 0 on success, -1 if there is no tree for the store
+*/
+int lod_select(lod_t *l, const store_t *s, const double modelview[16],
+		const double projection[16], int height, float margin,
+		unsigned int hidden_types) {
+	double start = lod_now();
+	float planes[6][4];
+	unsigned long long budget;
+	unsigned long long points = 0;
+	unsigned int heap = 0;
+	unsigned int runs = 0;
+	unsigned int samples = 0;
+	unsigned int nodes = 0;
+	unsigned int node, i;
+	int complete = 1;
+	int t;
+
+	pthread_mutex_lock(&l->lock);
+	if(l->store != s || l->count != s->count || l->node_count == 0 ||
+			lod_reserve(l, s->count)) {
+		pthread_mutex_unlock(&l->lock);
+		return(-1);
+	}
+
+	/* the budget doubles each frame the camera holds still */
+	if(height == l->height && !memcmp(modelview, l->modelview,
+			sizeof(l->modelview)) && !memcmp(projection, l->projection,
+			sizeof(l->projection))) {
+		l->still += l->still < LOD_STILL_MAX;
+	} else {
+		memcpy(l->modelview, modelview, sizeof(l->modelview));
+		memcpy(l->projection, projection, sizeof(l->projection));
+		l->height = height;
+		l->still = 0;
+	}
+	budget = l->budget ? (unsigned long long)l->budget << l->still : s->count;
+	if(l->limit && budget > l->limit) {
+		budget = l->limit;
+	}
+	if(budget > s->count) {
+		budget = s->count;
+	}
+
+	/* roots in view, then open the largest sampled node while it fits */
+	cull_planes(modelview, projection, planes);
+	memset(l->state, LOD_HIDDEN, l->node_count);
+	for(t = 0; t < STORE_TYPE_COUNT; t++) {
+		node = l->root[t];
+		if(node == LOD_NONE || (hidden_types & (1 << t)) ||
+				!cull_box(planes, l->nodes[node].box, margin)) {
+			continue;
+		}
+		if(l->nodes[node].end - l->nodes[node].begin <= LOD_SAMPLE) {
+			l->state[node] = LOD_WHOLE;
+			points += l->nodes[node].end - l->nodes[node].begin;
+		} else {
+			l->state[node] = LOD_SAMPLED;
+			l->pixels[node] = lod_pixels(&l->nodes[node], modelview,
+				projection, height);
+			lod_push(l, &heap, node);
+			points += LOD_SAMPLE;
+		}
+	}
+	while(heap > 0) {
+		unsigned long long opened = points - LOD_SAMPLE;
+		const lod_node_t *n;
+		node = lod_pop(l, &heap);
+		n = &l->nodes[node];
+		if(n->children == 0) {
+			/* a leaf opens to all of its particles */
+			if(opened + (n->end - n->begin) <= budget) {
+				l->state[node] = LOD_WHOLE;
+				points = opened + (n->end - n->begin);
+			} else {
+				complete = 0;
+			}
+			continue;
+		}
+		for(i = n->child; i < n->child + n->children; i++) {
+			unsigned int count = l->nodes[i].end - l->nodes[i].begin;
+			if(cull_box(planes, l->nodes[i].box, margin)) {
+				l->state[i] = count <= LOD_SAMPLE ? LOD_WHOLE : LOD_SAMPLED;
+				opened += count <= LOD_SAMPLE ? count : LOD_SAMPLE;
+			}
+		}
+		if(opened > budget) {
+			for(i = n->child; i < n->child + n->children; i++) {
+				l->state[i] = LOD_HIDDEN;
+			}
+			complete = 0;
+			continue;
+		}
+		l->state[node] = LOD_OPENED;
+		points = opened;
+		for(i = n->child; i < n->child + n->children; i++) {
+			if(l->state[i] == LOD_SAMPLED) {
+				l->pixels[i] = lod_pixels(&l->nodes[i], modelview, projection,
+					height);
+				lod_push(l, &heap, i);
+			}
+		}
+	}
+
+	/* runs and subsample slots of each type, in slot order */
+	for(t = 0; t < STORE_TYPE_COUNT; t++) {
+		l->run_start[t] = runs;
+		l->index_start[t] = samples;
+		if(l->root[t] != LOD_NONE) {
+			lod_emit(l, l->root[t], &runs, &samples);
+		}
+	}
+	l->run_start[STORE_TYPE_COUNT] = runs;
+	l->index_start[STORE_TYPE_COUNT] = samples;
+	for(node = 0; node < l->node_count; node++) {
+		nodes += l->state[node] == LOD_SAMPLED || l->state[node] == LOD_WHOLE;
+	}
+	pthread_mutex_unlock(&l->lock);
+
+	l->refining = !complete && budget < (l->limit ? l->limit : s->count);
+	l->last_nodes = nodes;
+	l->last_points = (unsigned int)points;
+	l->last_budget = budget;
+	l->last_select_seconds = lod_now() - start;
+	return(0);
+}
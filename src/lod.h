@@ -0,0 +1,117 @@
+/*
+ * lod.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Level of detail for very large fields.  As each timestep is published the
+ * publish thread builds an octree per particle type over the Morton keys of
+ * morton.h: with slots in key order every node is one run of slots, split
+ * by the next three key bits until it holds at most LOD_LEAF particles.
+ * Node boxes are bounded in parallel.  A node's representative subsample is
+ * LOD_SAMPLE of its slots taken at an even stride along the Z-order curve,
+ * and so evenly over its volume.
+ *
+ * Each frame the renderer starts from the roots inside the view and opens
+ * the node of largest projected size, drawing its children's subsamples in
+ * place of its own, for as long as the points drawn stay within the budget;
+ * a leaf opened is drawn whole.  While the camera holds still the budget
+ * doubles every frame until the whole field or the limit is drawn.  The
+ * finished tree is swapped in under a lock of its own, as cull.h does.
+ */
+
+#ifndef LOD_H_
+#define LOD_H_
+
+#include <pthread.h>
+#include "GL/glfw.h"
+#include "store.h"
+#include "parallel.h"
+#include "morton.h"
+
+/* particles in a node that is not split */
+#define LOD_LEAF 4096
+/* particles drawn for a node that is not opened */
+#define LOD_SAMPLE 512
+/* no node */
+#define LOD_NONE 0xffffffffU
+
+/*
+A node: one type's slots within an octree cell.
+*/
+typedef struct {
+	/* GL-order min x, y, z then max x, y, z of its particles */
+	float box[6];
+	/* run of slots */
+	unsigned int begin;
+	unsigned int end;
+	/* first child and children, consecutive, 0 children for a leaf */
+	unsigned int child;
+	unsigned int children;
+	/* key bits below the cell, and the particles' type */
+	uint8_t shift;
+	uint8_t type;
+} lod_node_t;
+
+/*
+Published tree, the tree being built and the last frame's selection.
+*/
+typedef struct {
+	/* non-zero to build trees */
+	int enabled;
+	/* points a frame draws with the camera moving, and at most, 0 for all */
+	unsigned int budget;
+	unsigned int limit;
+	/* guards the published tree: store, count, nodes, node_count, root */
+	pthread_mutex_t lock;
+	/* store and particle count the tree was built for */
+	const store_t *store;
+	unsigned int count;
+	/* nodes, parents before children, and each type's root or LOD_NONE */
+	lod_node_t *nodes;
+	unsigned int node_count;
+	unsigned int node_capacity;
+	unsigned int root[STORE_TYPE_COUNT];
+	/* tree being built, publish thread only, swapped with nodes */
+	lod_node_t *spare;
+	unsigned int spare_count;
+	unsigned int spare_capacity;
+	unsigned int spare_root[STORE_TYPE_COUNT];
+	/* per node selection state, open-node heap and projected sizes */
+	uint8_t *state;
+	unsigned int *heap;
+	float *pixels;
+	unsigned int select_capacity;
+	/* whole runs, and subsample slots, of each type in the last frame */
+	GLint *first;
+	GLsizei *length;
+	unsigned int run_start[STORE_TYPE_COUNT + 1];
+	GLuint *indices;
+	unsigned int index_capacity;
+	unsigned int index_start[STORE_TYPE_COUNT + 1];
+	/* transforms of the last frame, and frames since they changed */
+	double modelview[16];
+	double projection[16];
+	int height;
+	unsigned int still;
+	/* non-zero if a frame with the camera still would draw more */
+	int refining;
+	/* statistics of trees, publish thread */
+	unsigned long long builds;
+	double build_seconds;
+	double last_build_seconds;
+	/* statistics of the last frame, render thread */
+	unsigned int last_nodes;
+	unsigned int last_points;
+	unsigned long long last_budget;
+	double last_select_seconds;
+} lod_t;
+
+void lod_init(lod_t *l, int enabled, unsigned int budget, unsigned int limit);
+void lod_free(lod_t *l);
+int lod_build(lod_t *l, const store_t *s, const morton_t *order,
+		parallel_t *pool);
+int lod_select(lod_t *l, const store_t *s, const double modelview[16],
+		const double projection[16], int height, float margin,
+		unsigned int hidden_types);
+
+#endif /* LOD_H_ */
@@ -0,0 +1,428 @@
+/*
+ * loss_bench.c
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Keyframe completeness under packet loss.  A reference sender and a
+ * receiver run over loopback in one process.  The sender drops packets at
+ * each loss rate of a sweep, and the receiver tracks completeness the way
+ * seewaves does.  Each rate is run twice, once without NACK heartbeats and
+ * once with them, and the share of keyframes that arrived complete is
+ * reported for both.  Exits non-zero if NACKs ever leave fewer keyframes
+ * complete than doing without.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <poll.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "ptp.h"
+#include "ptp_sender.h"
+#include "completeness.h"
+
+/* loss rates swept unless given */
+#define BENCH_LOSSES "0,0.001,0.01,0.02,0.05,0.1"
+/* receive buffer asked for, loopback bursts must not overflow it */
+#define BENCH_RCVBUF (8 * 1024 * 1024)
+
+/*
+Receiver side of one run.
+*/
+typedef struct {
+	int fd;
+	struct sockaddr_in server;
+	/* non-zero if missing keyframe particles are asked for */
+	int nack;
+	completeness_t completeness;
+	unsigned long long packets;
+	volatile int stopping;
+} bench_receiver_t;
+
+/*
+Sender side impairment.
+*/
+typedef struct {
+	double loss;
+	unsigned long long rng;
+	unsigned long long packets;
+	unsigned long long dropped;
+} bench_loss_t;
+
+/* Local prototypes */
+static void bench_usage(void);
+static double bench_now(void);
+static double bench_random(unsigned long long *rng);
+static void bench_drop(void *user, ptp_packet_t *batch, unsigned int *count);
+static void bench_heartbeat(bench_receiver_t *r, ptp_heartbeat_packet_t *hb);
+static void *bench_receive(void *user);
+static int bench_run(double loss, int nack, unsigned int particles, int steps,
+		double step_rate, double packet_rate, unsigned int keyframe_steps,
+		unsigned short port, unsigned long long seed, completeness_t *result,
+		bench_loss_t *dropped);
+
+static void bench_usage(void) {
+	printf("usage: loss_bench [ options ]\n\n");
+	printf("Options:\n\n");
+	printf("--particles -n <count>   Particle count (20000)\n");
+	printf("--steps -N <count>       Timesteps per run (50)\n");
+	printf("--rate -s <steps/s>      Timestep rate (10)\n");
+	printf("--packet_rate -k <pkt/s> Packet rate (20000)\n");
+	printf("--keyframe -K <steps>    Flag every n-th step as a keyframe (1)\n");
+	printf("--losses -L <list>       Loss probabilities (%s)\n", BENCH_LOSSES);
+	printf("--port -p <port>         First of the loopback ports used (50020)\n");
+	printf("--seed -S <n>            Loss random seed (1)\n");
+}
+
+/*
+@returns monotonic time in seconds
+*/
+static double bench_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return(ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+/*
+@returns uniform random number in [0, 1), xorshift64*
+*/
+static double bench_random(unsigned long long *rng) {
+	*rng ^= *rng >> 12;
+	*rng ^= *rng << 25;
+	*rng ^= *rng >> 27;
+	return((double)((*rng * 2685821657736338717ULL) >> 11) / 9007199254740992.0);
+}
+
+/*
+Sender batch hook, drops each packet, retransmits included, with the loss
+probability.
+*/
+static void bench_drop(void *user, ptp_packet_t *batch, unsigned int *count) {
+	bench_loss_t *l = (bench_loss_t*)user;
+	unsigned int kept = 0;
+	unsigned int i;
+
+	for(i = 0; i < *count; i++) {
+		l->packets++;
+		if(l->loss > 0.0 && bench_random(&l->rng) < l->loss) {
+			l->dropped++;
+			continue;
+		}
+		if(kept != i) {
+			batch[kept] = batch[i];
+		}
+		kept++;
+	}
+	*count = kept;
+}
+
+/*
+Send a heartbeat with its NACK ranges, if any.
+*/
+static void bench_heartbeat(bench_receiver_t *r, ptp_heartbeat_packet_t *hb) {
+	size_t len = PTP_HEARTBEAT_HEADER_SIZE +
+		hb->nack_count * sizeof(ptp_nack_range_t);
+	if(sendto(r->fd, hb, len, 0, (struct sockaddr*)&r->server,
+			sizeof(r->server)) == -1) {
+		perror("heartbeat sendto");
+	}
+}
+
+/*
+Receiver thread.  Heartbeats every PTP_HEARTBEAT_TTL_S, and NACKs every
+PTP_NACK_INTERVAL_MS when enabled, go out of the data socket so the sender
+answers to it.
+
+@param	user	bench_receiver_t pointer
+
+@returns NULL
+*/
+static void *bench_receive(void *user) {
+	bench_receiver_t *r = (bench_receiver_t*)user;
+	ptp_heartbeat_packet_t hb;
+	ptp_packet_t packet;
+	double last_heartbeat = 0.0;
+	double last_nack = bench_now();
+	struct pollfd pfd;
+
+	memset(&hb, 0, sizeof(hb));
+	hb.full_stride = 1;
+	pfd.fd = r->fd;
+	pfd.events = POLLIN;
+	while(!r->stopping) {
+		double now = bench_now();
+		if(now - last_heartbeat >= PTP_HEARTBEAT_TTL_S) {
+			hb.nack_count = 0;
+			bench_heartbeat(r, &hb);
+			last_heartbeat = now;
+		}
+		if(r->nack && (now - last_nack) * 1000.0 >= PTP_NACK_INTERVAL_MS) {
+			if(completeness_nack_pending(&r->completeness) &&
+					completeness_build_nack(&r->completeness, &hb) > 0) {
+				bench_heartbeat(r, &hb);
+			}
+			last_nack = now;
+		}
+		if(poll(&pfd, 1, PTP_NACK_INTERVAL_MS / 5) <= 0) {
+			continue;
+		}
+		while(recv(r->fd, &packet, sizeof(packet), MSG_DONTWAIT) > 0) {
+			hb.model_id = packet.model_id;
+			completeness_add(&r->completeness, &packet);
+			r->packets++;
+		}
+	}
+	return(NULL);
+}
+
+/*
+Send steps through the loss and receive them.
+
+@param	loss	packet loss probability
+@param	nack	non-zero to ask for missing keyframe particles
+@param	result	completeness counters at the end of the run, its bitmaps
+		are freed
+@param	dropped	packets sent and dropped
+
+@returns 0 on success, -1 on error
+*/
+static int bench_run(double loss, int nack, unsigned int particles, int steps,
+		double step_rate, double packet_rate, unsigned int keyframe_steps,
+		unsigned short port, unsigned long long seed, completeness_t *result,
+		bench_loss_t *dropped) {
+	int rcvbuf = BENCH_RCVBUF;
+	struct sockaddr_in local;
+	bench_receiver_t r;
+	bench_loss_t l;
+	ptp_sender_t sender;
+	ptp_sender_frame_t frame;
+	pthread_t thread;
+	double *pos;
+	short *types;
+	double start;
+	int step;
+	unsigned int i;
+	int err;
+
+	pos = (double*)malloc(particles * 4 * sizeof(double));
+	types = (short*)calloc(particles, sizeof(short));
+	if(pos == NULL || types == NULL) {
+		perror("bench_run");
+		free(pos);
+		free(types);
+		return(-1);
+	}
+	for(i = 0; i < particles; i++) {
+		pos[i * 4 + 0] = (double)(i % 100);
+		pos[i * 4 + 1] = (double)(i / 100 % 100);
+		pos[i * 4 + 2] = (double)(i / 10000);
+		pos[i * 4 + 3] = 0.0;
+	}
+
+	/* sender on port, receiver on port + 1 */
+	if(ptp_sender_open(&sender, "127.0.0.1", port, (uint16_t)(port + 1))) {
+		free(pos);
+		free(types);
+		return(-1);
+	}
+	ptp_sender_set_rate(&sender, packet_rate * sizeof(ptp_packet_t), 0.0);
+	memset(&l, 0, sizeof(l));
+	l.loss = loss;
+	l.rng = seed ? seed : 1;
+	sender.batch_hook = bench_drop;
+	sender.batch_hook_user = &l;
+
+	memset(&r, 0, sizeof(r));
+	r.nack = nack;
+	r.server.sin_family = AF_INET;
+	r.server.sin_port = htons(port);
+	r.server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	memset(&local, 0, sizeof(local));
+	local.sin_family = AF_INET;
+	local.sin_port = htons((uint16_t)(port + 1));
+	local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if((r.fd = socket(AF_INET, SOCK_DGRAM, 0)) == -1 ||
+			bind(r.fd, (struct sockaddr*)&local, sizeof(local)) == -1) {
+		perror("receiver socket");
+		ptp_sender_close(&sender);
+		free(pos);
+		free(types);
+		return(-1);
+	}
+	(void)setsockopt(r.fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+	if(completeness_init(&r.completeness, particles, NULL)) {
+		close(r.fd);
+		ptp_sender_close(&sender);
+		free(pos);
+		free(types);
+		return(-1);
+	}
+	if((err = pthread_create(&thread, NULL, bench_receive, &r))) {
+		fprintf(stderr, "pthread_create: %s\n", strerror(err));
+		completeness_free(&r.completeness);
+		close(r.fd);
+		ptp_sender_close(&sender);
+		free(pos);
+		free(types);
+		return(-1);
+	}
+
+	/* wait for the first heartbeat to subscribe the receiver */
+	start = bench_now();
+	while(ptp_sender_client_count(&sender) == 0 && bench_now() - start < 2.0) {
+		(void)ptp_sender_poll(&sender);
+		usleep(1000);
+	}
+
+	memset(&frame, 0, sizeof(frame));
+	frame.model_id = getpid();
+	frame.world_size[0] = 100.0f;
+	frame.world_size[1] = 100.0f;
+	frame.world_size[2] = 100.0f;
+	frame.total_particle_count = particles;
+	frame.count = particles;
+	frame.pos = pos;
+	frame.types = types;
+	start = bench_now();
+
+	/* trailing plain steps retire the last keyframes from tracking */
+	for(step = 0; step < steps + COMPLETENESS_SLOTS; step++) {
+		double due = start + (step + 1) / step_rate;
+		frame.step = (unsigned int)step;
+		frame.t = (float)step * 0.01f;
+		frame.flags = (step < steps && step % keyframe_steps == 0) ?
+			PTP_FLAG_KEYFRAME : 0;
+		(void)ptp_sender_publish(&sender, &frame);
+
+		/* answer NACKs until the next step is due */
+		while(bench_now() < due) {
+			(void)ptp_sender_poll(&sender);
+			usleep(1000);
+		}
+	}
+
+	r.stopping = 1;
+	pthread_join(thread, NULL);
+	*result = r.completeness;
+	*dropped = l;
+	completeness_free(&r.completeness);
+	close(r.fd);
+	ptp_sender_close(&sender);
+	free(pos);
+	free(types);
+	return(0);
+}
+
+int main(int argc, char *argv[]) {
+	static struct option long_options[] = {
+		{ "particles", required_argument, 0, 'n' },
+		{ "steps", required_argument, 0, 'N' },
+		{ "rate", required_argument, 0, 's' },
+		{ "packet_rate", required_argument, 0, 'k' },
+		{ "keyframe", required_argument, 0, 'K' },
+		{ "losses", required_argument, 0, 'L' },
+		{ "port", required_argument, 0, 'p' },
+		{ "seed", required_argument, 0, 'S' },
+		{ "help", no_argument, 0, '?' },
+		{ 0, 0, 0, 0 }
+	};
+	unsigned int particles = 20000;
+	int steps = 50;
+	double step_rate = 10.0;
+	double packet_rate = 20000.0;
+	unsigned int keyframe_steps = 1;
+	const char *losses = BENCH_LOSSES;
+	unsigned short port = 50020;
+	unsigned long long seed = 1;
+	int worse = 0;
+	const char *p;
+	int c;
+
+	while((c = getopt_long(argc, argv, "n:N:s:k:K:L:p:S:?", long_options,
+			NULL)) != -1) {
+		switch(c) {
+		case 'n':
+			particles = (unsigned int)strtoul(optarg, NULL, 10);
+			break;
+		case 'N':
+			steps = atoi(optarg);
+			break;
+		case 's':
+			step_rate = atof(optarg);
+			break;
+		case 'k':
+			packet_rate = atof(optarg);
+			break;
+		case 'K':
+			keyframe_steps = (unsigned int)strtoul(optarg, NULL, 10);
+			break;
+		case 'L':
+			losses = optarg;
+			break;
+		case 'p':
+			port = (unsigned short)atoi(optarg);
+			break;
+		case 'S':
+			seed = strtoull(optarg, NULL, 10);
+			break;
+		default:
+			bench_usage();
+			return(EXIT_FAILURE);
+		}
+	}
+	if(particles == 0 || steps <= 0 || step_rate <= 0.0 ||
+			packet_rate <= 0.0 || keyframe_steps == 0) {
+		bench_usage();
+		return(EXIT_FAILURE);
+	}
+
+	printf("particles(%u) steps(%i) rate(%.1f steps/s %.0f pkt/s) "
+		"keyframe every %u\n", particles, steps, step_rate, packet_rate,
+		keyframe_steps);
+	printf("%-8s %-8s %-10s %-18s %-18s %-12s %s\n", "loss", "dropped",
+		"keyframes", "complete(no nack)", "complete(nack)", "retransmits",
+		"nacks");
+	for(p = losses; *p != '\0'; ) {
+		completeness_t plain;
+		completeness_t repaired;
+		bench_loss_t plain_loss;
+		bench_loss_t repaired_loss;
+		double loss = strtod(p, NULL);
+		double plain_rate;
+		double repaired_rate;
+
+		if(bench_run(loss, 0, particles, steps, step_rate, packet_rate,
+				keyframe_steps, port, seed, &plain, &plain_loss) ||
+				bench_run(loss, 1, particles, steps, step_rate, packet_rate,
+				keyframe_steps, (unsigned short)(port + 2), seed, &repaired,
+				&repaired_loss)) {
+			return(EXIT_FAILURE);
+		}
+		plain_rate = plain.keyframes_seen ?
+			100.0 * plain.keyframes_complete / plain.keyframes_seen : 0.0;
+		repaired_rate = repaired.keyframes_seen ?
+			100.0 * repaired.keyframes_complete / repaired.keyframes_seen : 0.0;
+		printf("%-8.3f %-8.3f %-10i %-18.1f %-18.1f %-12i %i\n", loss,
+			repaired_loss.packets ?
+			(double)repaired_loss.dropped / repaired_loss.packets : 0.0,
+			repaired.keyframes_seen, plain_rate, repaired_rate,
+			repaired.retransmits_received, repaired.nacks_sent);
+		fflush(stdout);
+		worse |= repaired_rate < plain_rate;
+
+		/* next comma-separated rate */
+		while(*p != '\0' && *p != ',') {
+			p++;
+		}
+		if(*p == ',') {
+			p++;
+		}
+	}
+	return(worse ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -0,0 +1,365 @@
+/*
+ * morton.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "morton.h"
+
+/* parallel pass arguments */
+typedef struct {
+	morton_t *morton;
+	store_t *store;
+	/* lattice origin and cells per world unit */
+	float origin[3];
+	float scale[3];
+	/* digit of the current radix pass */
+	int shift;
+} morton_job_t;
+
+/* locals */
+static double morton_now(void);
+static uint32_t morton_spread(uint32_t v);
+static unsigned int morton_cell(const morton_job_t *job, int axis, float v);
+static void morton_key_pass(void *user, unsigned int begin, unsigned int end,
+		int worker);
+static void morton_descent_pass(void *user, unsigned int begin, unsigned int end,
+		int worker);
+static void morton_histogram_pass(void *user, unsigned int begin,
+		unsigned int end, int worker);
+static void morton_scatter_pass(void *user, unsigned int begin, unsigned int end,
+		int worker);
+static void morton_apply_pass(void *user, unsigned int begin, unsigned int end,
+		int worker);
+static void morton_release(morton_t *m);
+static int morton_reserve(morton_t *m, unsigned int capacity, int workers);
+
+/*
+@returns monotonic time in seconds
+*/
+static double morton_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return(ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+/*
+@returns the low 10 bits of v spread to every third bit
+*/
+static uint32_t morton_spread(uint32_t v) {
+	v &= 0x3ff;
+	v = (v | (v << 16)) & 0x030000ff;
+	v = (v | (v << 8)) & 0x0300f00f;
+	v = (v | (v << 4)) & 0x030c30c3;
+	v = (v | (v << 2)) & 0x09249249;
+	return(v);
+}
+
+/*
+Interleave lattice coordinates, x in the lowest bit.
+
+@returns Morton code
+*/
+uint32_t morton_code(unsigned int x, unsigned int y, unsigned int z) {
+	return(morton_spread(x) | (morton_spread(y) << 1) | (morton_spread(z) << 2));
+}
+
+/*
+@returns lattice coordinate of v along axis, clamped
+*/
+static unsigned int morton_cell(const morton_job_t *job, int axis, float v) {
+	float f = (v - job->origin[axis]) * job->scale[axis];
+	if(!(f > 0.0f)) {
+		return(0);
+	}
+	return(f < (1 << MORTON_BITS) - 1 ? (unsigned int)f : (1 << MORTON_BITS) - 1);
+}
+
+/*
+Key every slot: type code above the Morton code of its vertex.
+*/
+static void morton_key_pass(void *user, unsigned int begin, unsigned int end,
+		int worker) {
+	morton_job_t *job = (morton_job_t*)user;
+	morton_t *m = job->morton;
+	const store_t *s = job->store;
+	uint32_t code = 0;
+	unsigned int slot;
+	(void)worker;
+	for(slot = begin; slot < end; slot++) {
+		/* vertices are in GL order, x z y */
+		const float *p = s->vertex[slot].pos;
+		while(s->type_start[code + 1] <= slot) {
+			code++;
+		}
+		m->keys[slot] = (code << (3 * MORTON_BITS)) |
+			morton_code(morton_cell(job, 0, p[0]), morton_cell(job, 1, p[2]),
+				morton_cell(job, 2, p[1]));
+		m->slots[slot] = slot;
+	}
+}
+
+/*
+Count neighbors out of order.
+*/
+static void morton_descent_pass(void *user, unsigned int begin, unsigned int end,
+		int worker) {
+	morton_t *m = ((morton_job_t*)user)->morton;
+	unsigned int descents = 0;
+	unsigned int slot;
+	for(slot = begin ? begin : 1; slot < end; slot++) {
+		descents += m->keys[slot - 1] > m->keys[slot];
+	}
+	m->descents[worker] = descents;
+}
+
+/*
+Count the current digit over this worker's keys.
+*/
+static void morton_histogram_pass(void *user, unsigned int begin,
+		unsigned int end, int worker) {
+	morton_job_t *job = (morton_job_t*)user;
+	morton_t *m = job->morton;
+	unsigned int *h = &m->histogram[worker * MORTON_RADIX];
+	unsigned int i;
+	for(i = begin; i < end; i++) {
+		h[(m->keys[i] >> job->shift) & (MORTON_RADIX - 1)]++;
+	}
+}
+
+/*
+Move this worker's keys to their place for the current digit.  Workers
+own consecutive key ranges and offsets, so the pass is stable.
+*/
+static void morton_scatter_pass(void *user, unsigned int begin, unsigned int end,
+		int worker) {
+	morton_job_t *job = (morton_job_t*)user;
+	morton_t *m = job->morton;
+	unsigned int *h = &m->histogram[worker * MORTON_RADIX];
+	unsigned int i;
+	for(i = begin; i < end; i++) {
+		unsigned int dst = h[(m->keys[i] >> job->shift) & (MORTON_RADIX - 1)]++;
+		m->keys_tmp[dst] = m->keys[i];
+		m->slots_tmp[dst] = m->slots[i];
+	}
+}
+
+/*
+Gather vertices and ids into sorted order, point ids at their new slots and
+flag the chunks that changed.
+*/
+static void morton_apply_pass(void *user, unsigned int begin, unsigned int end,
+		int worker) {
+	morton_job_t *job = (morton_job_t*)user;
+	morton_t *m = job->morton;
+	store_t *s = job->store;
+	unsigned int chunk = begin / STORE_CHUNK;
+	int moved = 0;
+	unsigned int slot;
+	(void)worker;
+	for(slot = begin; slot < end; slot++) {
+		unsigned int from = m->slots[slot];
+		unsigned int id = s->id_of[from];
+		m->vertex[slot] = s->vertex[from];
+		m->id_of[slot] = id;
+		s->slot_of[id] = slot;
+		/* chunks with no moves are identical in both copies */
+		if(slot / STORE_CHUNK != chunk) {
+			if(moved) {
+				store_dirty_chunk(s, chunk);
+			}
+			chunk = slot / STORE_CHUNK;
+			moved = 0;
+		}
+		moved |= from != slot;
+	}
+	if(moved) {
+		store_dirty_chunk(s, chunk);
+	}
+}
+
+/*
+Release the per-slot arrays.
+*/
+static void morton_release(morton_t *m) {
+	store_column_free(m->keys, m->capacity, sizeof(uint32_t));
+	store_column_free(m->keys_tmp, m->capacity, sizeof(uint32_t));
+	store_column_free(m->slots, m->capacity, sizeof(unsigned int));
+	store_column_free(m->slots_tmp, m->capacity, sizeof(unsigned int));
+	store_column_free(m->vertex, m->capacity, sizeof(store_vertex_t));
+	store_column_free(m->id_of, m->capacity, sizeof(unsigned int));
+	m->capacity = 0;
+}
+
+/*
+Make room for capacity slots and workers histograms.
+
+@returns 0 on success, -1 on allocation failure
+*/
+static int morton_reserve(morton_t *m, unsigned int capacity, int workers) {
+	/* exact, the swapped columns must match the store's length */
+	if(capacity != m->capacity) {
+		morton_release(m);
+		m->keys = (uint32_t*)store_column(capacity, sizeof(uint32_t));
+		m->keys_tmp = (uint32_t*)store_column(capacity, sizeof(uint32_t));
+		m->slots = (unsigned int*)store_column(capacity, sizeof(unsigned int));
+		m->slots_tmp = (unsigned int*)store_column(capacity, sizeof(unsigned int));
+		m->vertex = (store_vertex_t*)store_column(capacity, sizeof(store_vertex_t));
+		m->id_of = (unsigned int*)store_column(capacity, sizeof(unsigned int));
+		m->capacity = capacity;
+	}
+	if(workers > m->workers) {
+		free(m->histogram);
+		free(m->descents);
+		m->histogram = (unsigned int*)malloc(workers * MORTON_RADIX *
+			sizeof(unsigned int));
+		m->descents = (unsigned int*)malloc(workers * sizeof(unsigned int));
+		m->workers = workers;
+	}
+	if(!m->keys || !m->keys_tmp || !m->slots || !m->slots_tmp || !m->vertex ||
+			!m->id_of || !m->histogram || !m->descents) {
+		perror("morton_reserve");
+		morton_free(m);
+		return(-1);
+	}
+	return(0);
+}
+
+/*
+Initialize.
+
+@param	m	sort state
+@param	enabled	non-zero to order the store, otherwise morton_order() is a
+no-op
+*/
+void morton_init(morton_t *m, int enabled) {
+	memset(m, 0, sizeof(morton_t));
+	m->enabled = enabled;
+}
+
+/*
+Release scratch memory.
+*/
+void morton_free(morton_t *m) {
+	morton_release(m);
+	free(m->histogram);
+	free(m->descents);
+	morton_init(m, m->enabled);
+}
+
+/*
+Sort the store's slots into Morton order within each type range.
+
+@param	m	sort state
+@param	s	store, its vertex and id_of columns are replaced
+@param	pool	threads for the sort
+@param	origin	world origin
+@param	size	world size
+@param	lock	held while the store's vertices are permuted, NULL for none;
+the sort itself only reads the store
+
+@returns 0 on success, -1 on allocation failure
+*/
+int morton_order(morton_t *m, store_t *s, parallel_t *pool,
+		const float origin[3], const float size[3], pthread_mutex_t *lock) {
+	double start = morton_now();
+	morton_job_t job;
+	unsigned int descents = 0;
+	void *swap;
+	int i;
+
+	if(!m->enabled || s->count < 2) {
+		return(0);
+	}
+	if(morton_reserve(m, s->capacity, pool->threads)) {
+		return(-1);
+	}
+	job.morton = m;
+	job.store = s;
+	for(i = 0; i < 3; i++) {
+		job.origin[i] = origin[i];
+		job.scale[i] = (1 << MORTON_BITS) / (size[i] > 0.0f ? size[i] : 1.0f);
+	}
+
+	/* nothing to do if slots are still in order */
+	parallel_for(pool, s->count, morton_key_pass, &job);
+	memset(m->descents, 0, m->workers * sizeof(unsigned int));
+	parallel_for(pool, s->count, morton_descent_pass, &job);
+	for(i = 0; i < m->workers; i++) {
+		descents += m->descents[i];
+	}
+	m->last_descents = descents;
+	if(descents == 0) {
+		m->skipped++;
+		return(0);
+	}
+
+	/* LSD radix sort of the keys, carrying their slots */
+	for(job.shift = 0; job.shift < 3 * MORTON_BITS + 4;
+			job.shift += MORTON_RADIX_BITS) {
+		unsigned int running = 0;
+		int skip = 0;
+		int d, w;
+		memset(m->histogram, 0, m->workers * MORTON_RADIX * sizeof(unsigned int));
+		parallel_for(pool, s->count, morton_histogram_pass, &job);
+		/* exclusive offsets, digit major then worker */
+		for(d = 0; d < MORTON_RADIX && !skip; d++) {
+			unsigned int total = 0;
+			for(w = 0; w < m->workers; w++) {
+				unsigned int count = m->histogram[w * MORTON_RADIX + d];
+				m->histogram[w * MORTON_RADIX + d] = running;
+				running += count;
+				total += count;
+			}
+			/* every key has this digit, the pass would not move anything */
+			skip = total == s->count;
+		}
+		if(skip) {
+			continue;
+		}
+		parallel_for(pool, s->count, morton_scatter_pass, &job);
+		swap = m->keys;
+		m->keys = m->keys_tmp;
+		m->keys_tmp = (uint32_t*)swap;
+		swap = m->slots;
+		m->slots = m->slots_tmp;
+		m->slots_tmp = (unsigned int*)swap;
+	}
+
+	/* slots are about to stop being the ids */
+	if(store_order(s)) {
+		return(-1);
+	}
+
+	/* permute, then swap in the sorted copies */
+	if(lock != NULL) {
+		pthread_mutex_lock(lock);
+	}
+	parallel_for(pool, s->count, morton_apply_pass, &job);
+	swap = s->vertex;
+	s->vertex = m->vertex;
+	m->vertex = (store_vertex_t*)swap;
+	swap = s->id_of;
+	s->id_of = m->id_of;
+	m->id_of = (unsigned int*)swap;
+	if(lock != NULL) {
+		pthread_mutex_unlock(lock);
+	}
+
+	m->last_sort_seconds = morton_now() - start;
+	m->sort_seconds += m->last_sort_seconds;
+	m->sorts++;
+	return(0);
+}
+
+/*
+@returns bytes held by the keys and scratch columns
+*/
+size_t morton_bytes(const morton_t *m) {
+	return((size_t)m->capacity * (2 * sizeof(uint32_t) +
+		3 * sizeof(unsigned int) + sizeof(store_vertex_t)));
+}
@@ -0,0 +1,64 @@
+/*
+ * morton.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Spatial slot order for the store.  Each published timestep, the slots of
+ * every type range are sorted by the Morton (Z-order) code of their
+ * position on a 512^3 lattice over the world box, so passes that walk
+ * slots (drawing, the grid build) touch memory in space-coherent order.
+ * Keys carry the type code above the Morton bits, so sorting keeps the
+ * type partitions intact.  The sort is a parallel LSD radix sort and is
+ * skipped when no particle changed place.  Particle ids are untouched and
+ * ingest keeps scattering through slot_of.
+ */
+
+#ifndef MORTON_H_
+#define MORTON_H_
+
+#include <stdint.h>
+#include "store.h"
+#include "parallel.h"
+
+/* lattice bits per axis */
+#define MORTON_BITS 9
+/* bits per radix pass */
+#define MORTON_RADIX_BITS 8
+#define MORTON_RADIX (1 << MORTON_RADIX_BITS)
+
+/*
+Sort state and scratch.
+*/
+typedef struct {
+	/* non-zero to keep the store ordered */
+	int enabled;
+	/* length of the per-slot arrays */
+	unsigned int capacity;
+	/* sort keys and the slot each came from, plus radix scratch */
+	uint32_t *keys;
+	uint32_t *keys_tmp;
+	unsigned int *slots;
+	unsigned int *slots_tmp;
+	/* permuted copies, swapped with the store's */
+	store_vertex_t *vertex;
+	unsigned int *id_of;
+	/* per-worker digit histograms and out-of-order neighbor counts */
+	unsigned int *histogram;
+	unsigned int *descents;
+	int workers;
+	/* statistics */
+	unsigned long long sorts;
+	unsigned long long skipped;
+	unsigned int last_descents;
+	double sort_seconds;
+	double last_sort_seconds;
+} morton_t;
+
+void morton_init(morton_t *m, int enabled);
+void morton_free(morton_t *m);
+uint32_t morton_code(unsigned int x, unsigned int y, unsigned int z);
+int morton_order(morton_t *m, store_t *s, parallel_t *pool,
+		const float origin[3], const float size[3], pthread_mutex_t *lock);
+size_t morton_bytes(const morton_t *m);
+
+#endif /* MORTON_H_ */
@@ -0,0 +1,387 @@
+/*
+ * motion.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <time.h>
+#include "motion.h"
+
+/* particles per block of the derivation, a few KB per column */
+#define MOTION_BLOCK 1024
+
+/* parallel pass arguments */
+typedef struct {
+	motion_t *motion;
+	store_t *store;
+	/* first slot of the colored range and colormap entries per speed unit */
+	unsigned int first;
+	float scale;
+} motion_job_t;
+
+/* locals */
+static double motion_now(void);
+static void motion_gather(const store_t *s, unsigned int first,
+		float *restrict x, float *restrict y, float *restrict z,
+		unsigned int n);
+static void motion_axis(const float *restrict x,
+		const float *restrict t, const float *restrict pt,
+		float *restrict px, float *restrict v, unsigned int n);
+static void motion_speed(const float *restrict vx, const float *restrict vy,
+		const float *restrict vz, const float *restrict t,
+		float *restrict pt, float *restrict speed, unsigned int n);
+static void motion_derive(const store_t *s, motion_t *m, unsigned int begin,
+		unsigned int end);
+static void motion_derive_pass(void *user, unsigned int begin, unsigned int end,
+		int worker);
+static void motion_color_pass(void *user, unsigned int begin, unsigned int end,
+		int worker);
+static void motion_release(motion_t *m);
+static int motion_reserve(motion_t *m, unsigned int capacity, int workers);
+
+/*
+@returns monotonic time in seconds
+*/
+static double motion_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return(ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+/*
+Copy the positions of n particles from id first on out of their vertices,
+into id order and world axis order.
+*/
+static void motion_gather(const store_t *s, unsigned int first,
+		float *restrict x, float *restrict y, float *restrict z,
+		unsigned int n) {
+	unsigned int i;
+	for(i = 0; i < n; i++) {
+		const float *p = s->vertex[store_slot(s, first + i)].pos;
+		x[i] = p[0];
+		y[i] = p[2];
+		z[i] = p[1];
+	}
+}
+
+/*
+Difference one axis of the newest samples of n particles against their
+last.  Loads and stores are unconditional and branches are selects, so the
+loop vectorizes (see the flags for motion.o in the Makefile).  A particle
+with no new sample holds that very position, so overwriting it is harmless.
+*/
+static void motion_axis(const float *restrict x,
+		const float *restrict t, const float *restrict pt,
+		float *restrict px, float *restrict v, unsigned int n) {
+	unsigned int i;
+	for(i = 0; i < n; i++) {
+		float c = x[i];
+		float dt = t[i] - pt[i];
+		/* new sample, with an earlier one to difference against */
+		int moving = (dt > 0.0f) & (pt[i] >= 0.0f);
+		float inv = 1.0f / (moving ? dt : 1.0f);
+		/* no new sample holds the estimate, time going backwards clears it */
+		float held = dt < 0.0f ? 0.0f : v[i];
+		v[i] = moving ? (c - px[i]) * inv : held;
+		px[i] = c;
+	}
+}
+
+/*
+Speed of n particles, then take their sample times.
+*/
+static void motion_speed(const float *restrict vx, const float *restrict vy,
+		const float *restrict vz, const float *restrict t,
+		float *restrict pt, float *restrict speed, unsigned int n) {
+	unsigned int i;
+	for(i = 0; i < n; i++) {
+		speed[i] = sqrtf(vx[i] * vx[i] + vy[i] * vy[i] + vz[i] * vz[i]);
+		pt[i] = t[i];
+	}
+}
+
+/*
+Derive particles [begin, end), a block at a time so the times read by each
+axis stay in cache.  Positions are gathered from the vertices into id order
+first, the differencing then runs on contiguous columns.
+*/
+static void motion_derive(const store_t *s, motion_t *m, unsigned int begin,
+		unsigned int end) {
+	float x[MOTION_BLOCK], y[MOTION_BLOCK], z[MOTION_BLOCK];
+	unsigned int i;
+	for(i = begin; i < end; i += MOTION_BLOCK) {
+		unsigned int n = end - i < MOTION_BLOCK ? end - i : MOTION_BLOCK;
+		motion_gather(s, i, x, y, z, n);
+		motion_axis(x, s->t + i, m->pt + i, m->px + i, m->vx + i, n);
+		motion_axis(y, s->t + i, m->pt + i, m->py + i, m->vy + i, n);
+		motion_axis(z, s->t + i, m->pt + i, m->pz + i, m->vz + i, n);
+		motion_speed(m->vx + i, m->vy + i, m->vz + i, s->t + i, m->pt + i,
+			m->speed + i, n);
+	}
+}
+
+/*
+Derive this worker's particles, then gather its statistics.
+*/
+static void motion_derive_pass(void *user, unsigned int begin, unsigned int end,
+		int worker) {
+	motion_job_t *job = (motion_job_t*)user;
+	motion_t *m = job->motion;
+	const store_t *s = job->store;
+	motion_stats_t *st = &m->worker_stats[worker];
+	unsigned int i;
+
+	motion_derive(s, m, begin, end);
+	for(i = begin; i < end; i++) {
+		float v = m->speed[i];
+		/* never sampled */
+		if(m->pt[i] < 0.0f) {
+			continue;
+		}
+		st->stale += s->t[i] != s->current_t;
+		st->sampled++;
+		st->sum_speed += v;
+		st->min_speed = v < st->min_speed ? v : st->min_speed;
+		st->max_speed = v > st->max_speed ? v : st->max_speed;
+	}
+}
+
+/*
+Color this worker's share of the fluid range by speed, flagging only the
+chunks whose colors changed.
+*/
+static void motion_color_pass(void *user, unsigned int begin, unsigned int end,
+		int worker) {
+	motion_job_t *job = (motion_job_t*)user;
+	motion_t *m = job->motion;
+	store_t *s = job->store;
+	unsigned int chunk = (job->first + begin) / STORE_CHUNK;
+	int changed = 0;
+	unsigned int slot;
+	(void)worker;
+	for(slot = job->first + begin; slot < job->first + end; slot++) {
+		float f = m->speed[store_id(s, slot)] * job->scale;
+		const uint8_t *c = m->colormap[f < MOTION_COLORS - 1 ?
+			(int)f : MOTION_COLORS - 1];
+		if(slot / STORE_CHUNK != chunk) {
+			if(changed) {
+				store_dirty_chunk(s, chunk);
+			}
+			chunk = slot / STORE_CHUNK;
+			changed = 0;
+		}
+		if(memcmp(s->vertex[slot].rgba, c, 4)) {
+			memcpy(s->vertex[slot].rgba, c, 4);
+			changed = 1;
+		}
+	}
+	if(changed) {
+		store_dirty_chunk(s, chunk);
+	}
+}
+
+/*
+Release the columns.
+*/
+static void motion_release(motion_t *m) {
+	store_column_free(m->px, m->capacity, sizeof(float));
+	store_column_free(m->py, m->capacity, sizeof(float));
+	store_column_free(m->pz, m->capacity, sizeof(float));
+	store_column_free(m->pt, m->capacity, sizeof(float));
+	store_column_free(m->vx, m->capacity, sizeof(float));
+	store_column_free(m->vy, m->capacity, sizeof(float));
+	store_column_free(m->vz, m->capacity, sizeof(float));
+	store_column_free(m->speed, m->capacity, sizeof(float));
+	m->px = m->py = m->pz = m->pt = NULL;
+	m->vx = m->vy = m->vz = m->speed = NULL;
+	m->capacity = 0;
+}
+
+/*
+Make room for capacity particles, all without a sample, and workers
+statistics.
+
+@returns 0 on success, -1 on allocation failure
+*/
+static int motion_reserve(motion_t *m, unsigned int capacity, int workers) {
+	unsigned int i;
+
+	if(capacity != m->capacity) {
+		motion_release(m);
+		m->px = (float*)store_column(capacity, sizeof(float));
+		m->py = (float*)store_column(capacity, sizeof(float));
+		m->pz = (float*)store_column(capacity, sizeof(float));
+		m->pt = (float*)store_column(capacity, sizeof(float));
+		m->vx = (float*)store_column(capacity, sizeof(float));
+		m->vy = (float*)store_column(capacity, sizeof(float));
+		m->vz = (float*)store_column(capacity, sizeof(float));
+		m->speed = (float*)store_column(capacity, sizeof(float));
+		m->capacity = capacity;
+		if(m->pt != NULL) {
+			for(i = 0; i < capacity; i++) {
+				m->pt[i] = STORE_T_NONE;
+			}
+		}
+	}
+	if(workers > m->workers) {
+		free(m->worker_stats);
+		m->worker_stats = (motion_stats_t*)malloc(workers *
+			sizeof(motion_stats_t));
+		m->workers = workers;
+	}
+	if(!m->px || !m->py || !m->pz || !m->pt || !m->vx || !m->vy || !m->vz ||
+			!m->speed || !m->worker_stats) {
+		perror("motion_reserve");
+		motion_free(m);
+		return(-1);
+	}
+	return(0);
+}
+
+/*
+Initialize, columns are allocated by the first motion_update() that derives.
+
+@param	m	motion state
+@param	color	non-zero to color fluid by speed
+@param	color_max	speed at the top of the colormap, 0 to follow the
+fastest particle
+@param	derive	non-zero to derive for the statistics even when not coloring
+*/
+void motion_init(motion_t *m, int color, float color_max, int derive) {
+	/* blue, cyan, green, yellow, red */
+	static const float stops[5][3] = {
+		{ 0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, 1.0f }, { 0.0f, 1.0f, 0.0f },
+		{ 1.0f, 1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }
+	};
+	int i, j;
+
+	memset(m, 0, sizeof(motion_t));
+	m->color = color;
+	m->color_max = color_max;
+	m->derive = derive;
+	for(i = 0; i < MOTION_COLORS; i++) {
+		float f = (float)i / (MOTION_COLORS - 1) * 4.0f;
+		int stop = f < 4.0f ? (int)f : 3;
+		f -= stop;
+		for(j = 0; j < 3; j++) {
+			float c = stops[stop][j] + (stops[stop + 1][j] - stops[stop][j]) * f;
+			m->colormap[i][j] = (uint8_t)(c * 255.0f + 0.5f);
+		}
+		m->colormap[i][3] = 255;
+	}
+}
+
+/*
+Release the columns.
+*/
+void motion_free(motion_t *m) {
+	motion_release(m);
+	free(m->worker_stats);
+	m->worker_stats = NULL;
+	m->workers = 0;
+}
+
+/*
+@returns non-zero if velocities are derived, for coloring or statistics
+*/
+int motion_enabled(const motion_t *m) {
+	return(m->color || m->derive);
+}
+
+/*
+Derive velocities from the store's newest samples and, if enabled, recolor
+fluid vertices.  Call as each timestep is published; a no-op unless
+motion_enabled().
+
+@param	m	motion state
+@param	s	store
+@param	pool	threads for the passes
+@param	lock	held while the statistics and vertex colors are written, NULL
+for none; deriving only reads the store
+
+@returns 0 on success, -1 on allocation failure
+*/
+int motion_update(motion_t *m, store_t *s, parallel_t *pool,
+		pthread_mutex_t *lock) {
+	double start = motion_now();
+	motion_job_t job;
+	int i;
+
+	if(s->count == 0 || !motion_enabled(m)) {
+		return(0);
+	}
+	if(motion_reserve(m, s->capacity, pool->threads)) {
+		return(-1);
+	}
+	job.motion = m;
+	job.store = s;
+	memset(m->worker_stats, 0, m->workers * sizeof(motion_stats_t));
+	for(i = 0; i < m->workers; i++) {
+		m->worker_stats[i].min_speed = FLT_MAX;
+	}
+	parallel_for(pool, s->count, motion_derive_pass, &job);
+
+	if(lock != NULL) {
+		pthread_mutex_lock(lock);
+	}
+	memset(&m->stats, 0, sizeof(motion_stats_t));
+	m->stats.min_speed = FLT_MAX;
+	for(i = 0; i < m->workers; i++) {
+		motion_stats_t *st = &m->worker_stats[i];
+		m->stats.sampled += st->sampled;
+		m->stats.stale += st->stale;
+		m->stats.sum_speed += st->sum_speed;
+		if(st->min_speed < m->stats.min_speed) {
+			m->stats.min_speed = st->min_speed;
+		}
+		if(st->max_speed > m->stats.max_speed) {
+			m->stats.max_speed = st->max_speed;
+		}
+	}
+	if(m->stats.sampled == 0) {
+		m->stats.min_speed = 0.0f;
+	}
+
+	if(m->color) {
+		float top = m->color_max > 0.0f ? m->color_max : m->stats.max_speed;
+		s->colored_types |= 1U << STORE_TYPE_FLUID;
+		job.first = s->type_start[STORE_TYPE_FLUID];
+		job.scale = top > 0.0f ? (MOTION_COLORS - 1) / top : 0.0f;
+		parallel_for(pool, store_type_count(s, STORE_TYPE_FLUID),
+			motion_color_pass, &job);
+	}
+	if(lock != NULL) {
+		pthread_mutex_unlock(lock);
+	}
+
+	m->last_derive_seconds = motion_now() - start;
+	m->derive_seconds += m->last_derive_seconds;
+	m->derives++;
+	return(0);
+}
+
+/*
+Turn coloring by speed on or off.  Turning it off restores type colors and,
+unless derived for the statistics, releases the columns; on takes effect at
+the next motion_update(), speeds following from the sample after.  Call
+with the store's writer excluded.
+
+@param	m	motion state
+@param	s	store
+@param	color	non-zero to color fluid by speed
+*/
+void motion_set_color(motion_t *m, store_t *s, int color) {
+	m->color = color;
+	if(!color && (s->colored_types & (1U << STORE_TYPE_FLUID))) {
+		s->colored_types &= ~(1U << STORE_TYPE_FLUID);
+		store_set_palette(s, &s->palette);
+	}
+	if(!motion_enabled(m)) {
+		motion_release(m);
+	}
+}
@@ -0,0 +1,80 @@
+/*
+ * motion.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Per-particle velocity and speed, derived from consecutive samples as each
+ * timestep is published (the protocol carries positions only).  Columns are
+ * indexed by particle id like the store's.  A particle missing from a
+ * timestep keeps its last estimate, and its next sample is differenced
+ * against the last one it had, over the whole gap.  A timestamp going
+ * backwards (model restart) clears the estimate.  Optionally colors fluid
+ * vertices by speed.  Nothing is derived or allocated unless speed coloring
+ * or the statistics are wanted.
+ */
+
+#ifndef MOTION_H_
+#define MOTION_H_
+
+#include "store.h"
+#include "parallel.h"
+
+/* colormap entries */
+#define MOTION_COLORS 256
+
+/*
+Statistics of one derivation, per worker and in total.
+*/
+typedef struct {
+	/* speed range and sum over sampled particles, speed is 0 until a
+	particle's second sample */
+	float min_speed;
+	float max_speed;
+	double sum_speed;
+	/* particles sampled at least once */
+	unsigned int sampled;
+	/* sampled particles not updated in the newest timestep */
+	unsigned int stale;
+} motion_stats_t;
+
+/*
+Derived columns and state.
+*/
+typedef struct {
+	/* length of the columns */
+	unsigned int capacity;
+	/* last sample of each particle, time < 0 for none */
+	float *px;
+	float *py;
+	float *pz;
+	float *pt;
+	/* velocity in world units per second, and its magnitude */
+	float *vx;
+	float *vy;
+	float *vz;
+	float *speed;
+	/* non-zero to color fluid by speed */
+	int color;
+	/* non-zero to derive for the statistics even when not coloring */
+	int derive;
+	/* speed at the top of the colormap, 0 to follow the fastest particle */
+	float color_max;
+	uint8_t colormap[MOTION_COLORS][4];
+	/* per-worker statistics */
+	motion_stats_t *worker_stats;
+	int workers;
+	/* statistics */
+	motion_stats_t stats;
+	unsigned long long derives;
+	double derive_seconds;
+	double last_derive_seconds;
+} motion_t;
+
+void motion_init(motion_t *m, int color, float color_max, int derive);
+int motion_enabled(const motion_t *m);
+void motion_free(motion_t *m);
+int motion_update(motion_t *m, store_t *s, parallel_t *pool,
+		pthread_mutex_t *lock);
+void motion_set_color(motion_t *m, store_t *s, int color);
+
+#endif /* MOTION_H_ */
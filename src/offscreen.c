@@ -0,0 +1,119 @@
+/*
+ * offscreen.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "offscreen.h"
+#ifdef SEEWAVES_EGL
+#include <EGL/eglext.h>
+#endif
+
+#ifdef SEEWAVES_EGL
+/* locals */
+static EGLDisplay offscreen_display(void);
+
+/*
+@returns Mesa's surfaceless display if the library has one, else the
+default display
+*/
+static EGLDisplay offscreen_display(void) {
+	const char *extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display;
+
+	if(extensions != NULL &&
+			strstr(extensions, "EGL_MESA_platform_surfaceless") != NULL &&
+			(get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+			eglGetProcAddress("eglGetPlatformDisplayEXT")) != NULL) {
+		return(get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+			EGL_DEFAULT_DISPLAY, NULL));
+	}
+	return(eglGetDisplay(EGL_DEFAULT_DISPLAY));
+}
+#endif
+
+/*
+Make a desktop GL context current on an offscreen surface.
+
+@param	o	offscreen state
+@param	width	surface size in pixels
+@param	height
+@param	depth_bits	depth buffer bits wanted
+
+@returns 0 on success, -1 on error
+*/
+int offscreen_open(offscreen_t *o, int width, int height, int depth_bits) {
+#ifdef SEEWAVES_EGL
+	EGLint config_attributes[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+		EGL_DEPTH_SIZE, depth_bits,
+		EGL_NONE
+	};
+	EGLint surface_attributes[] = {
+		EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE
+	};
+	EGLConfig config;
+	EGLint configs;
+
+	memset(o, 0, sizeof(offscreen_t));
+	o->display = offscreen_display();
+	if(o->display == EGL_NO_DISPLAY ||
+			!eglInitialize(o->display, NULL, NULL)) {
+		fprintf(stderr, "offscreen_open: no EGL display\n");
+		return(-1);
+	}
+	if(!eglChooseConfig(o->display, config_attributes, &config, 1,
+			&configs) || configs < 1 || !eglBindAPI(EGL_OPENGL_API)) {
+		fprintf(stderr, "offscreen_open: no EGL config for desktop GL\n");
+		eglTerminate(o->display);
+		return(-1);
+	}
+	o->surface = eglCreatePbufferSurface(o->display, config,
+		surface_attributes);
+	o->context = eglCreateContext(o->display, config, EGL_NO_CONTEXT, NULL);
+	if(o->surface == EGL_NO_SURFACE || o->context == EGL_NO_CONTEXT ||
+			!eglMakeCurrent(o->display, o->surface, o->surface, o->context)) {
+		fprintf(stderr, "offscreen_open: no EGL context (0x%x)\n",
+			eglGetError());
+		if(o->context != EGL_NO_CONTEXT) {
+			eglDestroyContext(o->display, o->context);
+		}
+		if(o->surface != EGL_NO_SURFACE) {
+			eglDestroySurface(o->display, o->surface);
+		}
+		eglTerminate(o->display);
+		return(-1);
+	}
+	o->width = width;
+	o->height = height;
+	o->open = 1;
+	return(0);
+#else
+	(void)width;
+	(void)height;
+	(void)depth_bits;
+	memset(o, 0, sizeof(offscreen_t));
+	fprintf(stderr, "offscreen_open: built without SEEWAVES_EGL\n");
+	return(-1);
+#endif
+}
+
+/*
+Release the context and surface.
+*/
+void offscreen_close(offscreen_t *o) {
+#ifdef SEEWAVES_EGL
+	if(o->open) {
+		eglMakeCurrent(o->display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+			EGL_NO_CONTEXT);
+		eglDestroyContext(o->display, o->context);
+		eglDestroySurface(o->display, o->surface);
+		eglTerminate(o->display);
+	}
+#endif
+	memset(o, 0, sizeof(offscreen_t));
+}
@@ -0,0 +1,39 @@
+/*
+ * offscreen.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Headless drawing.  Where no window opens, as on a compute node with no
+ * display and no GPU, the client draws into an EGL pbuffer with a desktop
+ * GL context instead.  Mesa's surfaceless platform is preferred, so no
+ * display server is needed, and llvmpipe renders on the CPU.  Built without
+ * SEEWAVES_EGL, there is no offscreen context and opening one fails.
+ */
+
+#ifndef OFFSCREEN_H_
+#define OFFSCREEN_H_
+
+#ifdef SEEWAVES_EGL
+#include <EGL/egl.h>
+#endif
+
+/*
+Offscreen surface and its context.
+*/
+typedef struct {
+#ifdef SEEWAVES_EGL
+	EGLDisplay display;
+	EGLSurface surface;
+	EGLContext context;
+#endif
+	/* surface size in pixels */
+	int width;
+	int height;
+	/* non-zero while the context is current */
+	int open;
+} offscreen_t;
+
+int offscreen_open(offscreen_t *o, int width, int height, int depth_bits);
+void offscreen_close(offscreen_t *o);
+
+#endif /* OFFSCREEN_H_ */
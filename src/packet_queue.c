@@ -0,0 +1,178 @@
+/*
+ * packet_queue.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include "packet_queue.h"
+
+/* Local prototypes */
+static int packet_queue_grow(packet_queue_t *q);
+
+/*
+Double the ring, up to the limit, keeping the queued packets in order.
+Called with the lock held.
+
+@returns 0 on success, -1 on allocation failure
+*/
+static int packet_queue_grow(packet_queue_t *q) {
+	unsigned int capacity = q->capacity ? q->capacity * 2 : PACKET_QUEUE_INITIAL;
+	unsigned int first;
+	ptp_packet_t *packets;
+
+	if(capacity > q->limit) {
+		capacity = q->limit;
+	}
+	packets = (ptp_packet_t*)malloc((size_t)capacity * sizeof(ptp_packet_t));
+	if(packets == NULL) {
+		perror("packet_queue_grow");
+		return(-1);
+	}
+	/* the oldest packets run to the end of the ring, the rest wrap */
+	first = q->capacity - q->head < q->count ? q->capacity - q->head : q->count;
+	if(q->count > 0) {
+		memcpy(packets, &q->packets[q->head], first * sizeof(ptp_packet_t));
+		memcpy(&packets[first], q->packets,
+			(q->count - first) * sizeof(ptp_packet_t));
+	}
+	free(q->packets);
+	q->packets = packets;
+	q->capacity = capacity;
+	q->head = 0;
+	return(0);
+}
+
+/*
+Initialize, empty.  The ring is allocated as packets arrive.
+
+@param	q	queue
+@param	limit	packets held at most, at least 1
+
+@returns 0 on success, -1 on error
+*/
+int packet_queue_init(packet_queue_t *q, unsigned int limit) {
+	memset(q, 0, sizeof(packet_queue_t));
+	q->limit = limit > 0 ? limit : 1;
+	if(pthread_mutex_init(&q->lock, NULL) ||
+			pthread_cond_init(&q->pushed, NULL) ||
+			pthread_cond_init(&q->taken, NULL)) {
+		fprintf(stderr, "packet_queue_init: cannot create lock\n");
+		return(-1);
+	}
+	return(0);
+}
+
+/*
+Release the ring.  Neither thread may use the queue any more.
+*/
+void packet_queue_free(packet_queue_t *q) {
+	free(q->packets);
+	pthread_cond_destroy(&q->taken);
+	pthread_cond_destroy(&q->pushed);
+	pthread_mutex_destroy(&q->lock);
+}
+
+/*
+Queue a copy of a packet, waiting for room if the queue is at its limit.
+Data thread.
+
+@param	q	queue
+@param	packet	packet received
+
+@returns 0 on success, -1 if the queue is closed or cannot grow
+*/
+int packet_queue_push(packet_queue_t *q, const ptp_packet_t *packet) {
+	pthread_mutex_lock(&q->lock);
+	if(q->count == q->limit && !q->closed) {
+		q->waits++;
+		while(q->count == q->limit && !q->closed) {
+			pthread_cond_wait(&q->taken, &q->lock);
+		}
+	}
+	if(q->closed || (q->count == q->capacity && packet_queue_grow(q))) {
+		pthread_mutex_unlock(&q->lock);
+		return(-1);
+	}
+	q->packets[(q->head + q->count) % q->capacity] = *packet;
+	q->count++;
+	if(q->count > q->peak) {
+		q->peak = q->count;
+	}
+	pthread_cond_signal(&q->pushed);
+	pthread_mutex_unlock(&q->lock);
+	return(0);
+}
+
+/*
+Take the oldest packets off, waiting for one if the queue is empty.
+Publish thread.
+
+@param	q	queue
+@param	packets	room for max packets, filled oldest first
+@param	max	packets taken at most
+@param	timeout_ms	longest wait for a packet, negative for no limit
+
+@returns packets taken, 0 if none came in time, -1 once the queue is closed
+*/
+int packet_queue_take(packet_queue_t *q, ptp_packet_t *packets,
+		unsigned int max, int timeout_ms) {
+	struct timespec deadline;
+	unsigned int n = 0;
+	int closed;
+
+	if(timeout_ms >= 0) {
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += timeout_ms / 1000;
+		deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+		if(deadline.tv_nsec >= 1000000000L) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000L;
+		}
+	}
+	pthread_mutex_lock(&q->lock);
+	while(q->count == 0 && !q->closed) {
+		if(timeout_ms < 0) {
+			pthread_cond_wait(&q->pushed, &q->lock);
+		} else if(pthread_cond_timedwait(&q->pushed, &q->lock,
+				&deadline) == ETIMEDOUT) {
+			break;
+		}
+	}
+	closed = q->closed;
+	if(!closed && q->count > 0) {
+		/* copy out up to the end of the ring, then from its start */
+		while(n < max && q->count > 0) {
+			unsigned int run = q->capacity - q->head;
+			if(run > q->count) {
+				run = q->count;
+			}
+			if(run > max - n) {
+				run = max - n;
+			}
+			memcpy(&packets[n], &q->packets[q->head], run * sizeof(ptp_packet_t));
+			q->head = (q->head + run) % q->capacity;
+			q->count -= run;
+			n += run;
+		}
+		pthread_cond_signal(&q->taken);
+	}
+	pthread_mutex_unlock(&q->lock);
+	return(closed ? -1 : (int)n);
+}
+
+/*
+Close the queue and wake both threads.  Packets still queued are dropped.
+*/
+void packet_queue_close(packet_queue_t *q) {
+	pthread_mutex_lock(&q->lock);
+	q->closed = 1;
+	q->count = 0;
+	pthread_cond_broadcast(&q->pushed);
+	pthread_cond_broadcast(&q->taken);
+	pthread_mutex_unlock(&q->lock);
+}
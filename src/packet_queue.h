@@ -0,0 +1,53 @@
+/*
+ * packet_queue.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Packets received and not yet applied to the store.  The data thread only
+ * receives: it tracks completeness and queues each packet, so NACKs and the
+ * socket are never held up by the store.  The publish thread takes packets
+ * off in batches, applies them and runs the per-timestep passes.  The ring
+ * grows as needed up to a limit; beyond it the receiver waits for room and
+ * the socket's buffer takes up the slack.
+ */
+
+#ifndef PACKET_QUEUE_H_
+#define PACKET_QUEUE_H_
+
+#include <pthread.h>
+#include "ptp.h"
+
+/* packets the ring is first allocated for */
+#define PACKET_QUEUE_INITIAL 256
+
+/*
+Ring of packets and its handoff state.
+*/
+typedef struct {
+	/* guards everything below */
+	pthread_mutex_t lock;
+	/* signalled when a packet is queued, or room is made, or on close */
+	pthread_cond_t pushed;
+	pthread_cond_t taken;
+	/* ring, capacity packets, count of them from head on */
+	ptp_packet_t *packets;
+	unsigned int capacity;
+	unsigned int head;
+	unsigned int count;
+	/* packets held at most */
+	unsigned int limit;
+	/* non-zero once closed, pushes fail and takes return nothing */
+	int closed;
+	/* statistics: most packets held, pushes that waited for room */
+	unsigned int peak;
+	unsigned long long waits;
+} packet_queue_t;
+
+int packet_queue_init(packet_queue_t *q, unsigned int limit);
+void packet_queue_free(packet_queue_t *q);
+int packet_queue_push(packet_queue_t *q, const ptp_packet_t *packet);
+int packet_queue_take(packet_queue_t *q, ptp_packet_t *packets,
+		unsigned int max, int timeout_ms);
+void packet_queue_close(packet_queue_t *q);
+
+#endif /* PACKET_QUEUE_H_ */
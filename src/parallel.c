@@ -0,0 +1,172 @@
+/*
+ * parallel.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "parallel.h"
+
+/* worker start argument */
+typedef struct {
+	parallel_t *pool;
+	int worker;
+} parallel_worker_t;
+
+/* locals */
+static void *parallel_worker_main(void *arg);
+static void parallel_run(parallel_t *p, int worker);
+
+/*
+Run one worker's share of the current job.
+*/
+static void parallel_run(parallel_t *p, int worker) {
+	unsigned int begin = (unsigned int)((unsigned long long)p->n * worker / p->threads);
+	unsigned int end = (unsigned int)((unsigned long long)p->n * (worker + 1) / p->threads);
+	if(begin < end) {
+		p->fn(p->user, begin, end, worker);
+	}
+}
+
+/*
+Worker thread loop.
+*/
+static void *parallel_worker_main(void *arg) {
+	parallel_worker_t w = *(parallel_worker_t*)arg;
+	parallel_t *p = w.pool;
+	unsigned long seen = 0;
+
+	free(arg);
+	for(;;) {
+		pthread_mutex_lock(&p->lock);
+		while(!p->quit && p->generation == seen) {
+			pthread_cond_wait(&p->start, &p->lock);
+		}
+		if(p->quit) {
+			pthread_mutex_unlock(&p->lock);
+			break;
+		}
+		seen = p->generation;
+		pthread_mutex_unlock(&p->lock);
+
+		parallel_run(p, w.worker);
+
+		pthread_mutex_lock(&p->lock);
+		if(--p->pending == 0) {
+			pthread_cond_signal(&p->done);
+		}
+		pthread_mutex_unlock(&p->lock);
+	}
+	return(NULL);
+}
+
+/*
+Start a pool.
+
+@param	p	pool
+@param	threads	number of workers including the caller, 0 for one per
+online CPU
+
+@returns 0 on success, -1 on error
+*/
+int parallel_init(parallel_t *p, int threads) {
+	int i;
+
+	memset(p, 0, sizeof(parallel_t));
+	if(threads <= 0) {
+		threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	}
+	if(threads <= 0) {
+		threads = 1;
+	}
+	if(threads > PARALLEL_MAX_THREADS) {
+		threads = PARALLEL_MAX_THREADS;
+	}
+	pthread_mutex_init(&p->call_lock, NULL);
+	pthread_mutex_init(&p->lock, NULL);
+	pthread_cond_init(&p->start, NULL);
+	pthread_cond_init(&p->done, NULL);
+	p->threads = 1;
+	if(threads == 1) {
+		return(0);
+	}
+	if((p->tids = (pthread_t*)calloc(threads, sizeof(pthread_t))) == NULL) {
+		perror("parallel_init");
+		return(-1);
+	}
+	for(i = 1; i < threads; i++) {
+		parallel_worker_t *w = (parallel_worker_t*)malloc(sizeof(parallel_worker_t));
+		int err;
+		if(w == NULL) {
+			perror("parallel_init");
+			break;
+		}
+		w->pool = p;
+		w->worker = i;
+		if((err = pthread_create(&p->tids[i], NULL, parallel_worker_main, w))) {
+			fprintf(stderr, "parallel_init: %s\n", strerror(err));
+			free(w);
+			break;
+		}
+		p->threads++;
+	}
+	return(0);
+}
+
+/*
+Split n items across the pool and wait for all of them.
+
+@param	p	pool
+@param	n	number of items
+@param	fn	work function
+@param	user	passed to fn
+*/
+void parallel_for(parallel_t *p, unsigned int n, parallel_fn_t fn, void *user) {
+	if(n == 0) {
+		return;
+	}
+	if(p->threads <= 1) {
+		fn(user, 0, n, 0);
+		return;
+	}
+	pthread_mutex_lock(&p->call_lock);
+	pthread_mutex_lock(&p->lock);
+	p->fn = fn;
+	p->user = user;
+	p->n = n;
+	p->pending = p->threads - 1;
+	p->generation++;
+	pthread_cond_broadcast(&p->start);
+	pthread_mutex_unlock(&p->lock);
+
+	parallel_run(p, 0);
+
+	pthread_mutex_lock(&p->lock);
+	while(p->pending > 0) {
+		pthread_cond_wait(&p->done, &p->lock);
+	}
+	pthread_mutex_unlock(&p->lock);
+	pthread_mutex_unlock(&p->call_lock);
+}
+
+/*
+Stop the workers.
+*/
+void parallel_free(parallel_t *p) {
+	int i;
+	if(p->tids != NULL) {
+		pthread_mutex_lock(&p->lock);
+		p->quit = 1;
+		pthread_cond_broadcast(&p->start);
+		pthread_mutex_unlock(&p->lock);
+		for(i = 1; i < p->threads; i++) {
+			pthread_join(p->tids[i], NULL);
+		}
+		free(p->tids);
+		p->tids = NULL;
+	}
+	p->threads = 1;
+}
@@ -0,0 +1,54 @@
+/*
+ * parallel.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Minimal fork/join thread pool for data-parallel passes over particles.
+ * The calling thread takes part as worker 0, so a pool of one thread runs
+ * everything inline.
+ */
+
+#ifndef PARALLEL_H_
+#define PARALLEL_H_
+
+#include <pthread.h>
+
+/* upper bound on pool size */
+#define PARALLEL_MAX_THREADS 256
+
+/*
+Work function, called once per worker with its share [begin, end) of the
+items.
+*/
+typedef void (*parallel_fn_t)(void *user, unsigned int begin, unsigned int end,
+		int worker);
+
+/*
+Thread pool.
+*/
+typedef struct {
+	/* workers, including the caller */
+	int threads;
+	pthread_t *tids;
+	/* serializes parallel_for() callers */
+	pthread_mutex_t call_lock;
+	/* guards the fields below */
+	pthread_mutex_t lock;
+	pthread_cond_t start;
+	pthread_cond_t done;
+	/* current job */
+	parallel_fn_t fn;
+	void *user;
+	unsigned int n;
+	/* bumped for every job, workers wait for it to change */
+	unsigned long generation;
+	/* workers still running the current job */
+	int pending;
+	int quit;
+} parallel_t;
+
+int parallel_init(parallel_t *p, int threads);
+void parallel_for(parallel_t *p, unsigned int n, parallel_fn_t fn, void *user);
+void parallel_free(parallel_t *p);
+
+#endif /* PARALLEL_H_ */
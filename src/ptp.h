@@ -33,7 +33,7 @@
 #ifndef PTP_H_
 #define PTP_H_
 
-#define PTP_VERSION 0
+#define PTP_VERSION 1
 #define PTP_UDP_PACKET_MAX 1472
 #define PTP_HEARTBEAT_TTL_S 1
 #define PTP_DEFAULT_CLIENT_PORT 50000
@@ -41,6 +41,33 @@
 #define PTP_DEFAULT_SERVER_HOST "127.0.0.1"
 #define PTP_DEFAULT_CLIENT_HOST "127.0.0.1"
 
+/* packet flags */
+#define PTP_FLAG_KEYFRAME   0x01    /* part of a full refresh of the model */
+#define PTP_FLAG_RETRANSMIT 0x02    /* resent in response to a NACK */
+#define PTP_FLAG_SUBSET     0x04    /* part of the tracked subset, not the full field */
+
+/*
+Particle types are a primary type, a multiple of 16 below 256, plus flags
+from 256 up.  A type is bucketed by its primary type with the flags masked
+off, except that surface-flagged fluid has a bucket of its own, so e.g. 272,
+a boundary particle on the surface, is a boundary particle.
+*/
+#define PTP_TYPE_SURFACE_FLAG 256
+#define PTP_TYPE_PRIMARY(particle_type) (((unsigned int)(particle_type) & 0xff) >> 4)
+#define PTP_TYPE_SURFACE_BUCKET 16
+#define PTP_TYPE_BUCKET(particle_type) \
+	(PTP_TYPE_PRIMARY(particle_type) == 0 && \
+	((unsigned int)(particle_type) & PTP_TYPE_SURFACE_FLAG) ? \
+	PTP_TYPE_SURFACE_BUCKET : PTP_TYPE_PRIMARY(particle_type))
+
+/* subscription bit of a particle type */
+#define PTP_TYPE_BIT(particle_type) (1u << PTP_TYPE_BUCKET(particle_type))
+
+/* maximum number of missing id ranges carried by one heartbeat */
+#define PTP_NACK_MAX_RANGES 128
+/* minimum interval between two NACK-carrying heartbeats */
+#define PTP_NACK_INTERVAL_MS 50
+
 typedef struct __attribute__ ((packed)) {
     unsigned int id;
     double position[4];
@@ -52,6 +79,7 @@ typedef struct __attribute__ ((packed)) {
 
 typedef struct __attribute__ ((packed)) {
     unsigned char   version;
+    unsigned char   flags;
     pid_t           model_id;
     unsigned int total_particle_count;
     unsigned int particle_count;
@@ -61,9 +89,35 @@ typedef struct __attribute__ ((packed)) {
     ptp_particle_data_t data[PTP_PARTICLES_PER_PACKET];
 } ptp_packet_t;
 
+/* range of particle ids missing from a timestep, [first_id, first_id + count) */
+typedef struct __attribute__ ((packed)) {
+	unsigned int first_id;
+	unsigned int count;
+} ptp_nack_range_t;
+
+/*
+Heartbeat packet.  Only the first nack_count ranges are sent, so a plain
+heartbeat is PTP_HEARTBEAT_HEADER_SIZE bytes long.
+*/
 typedef struct __attribute__ ((packed)) {
 	unsigned int count;
+	/*
+	subscription: particles whose PTP_TYPE_BIT is in tracked_types are sent
+	every tracked_stride steps, the full field every full_stride steps.
+	A stride of 0 disables that class.
+	*/
+	unsigned int tracked_types;
+	unsigned short tracked_stride;
+	unsigned short full_stride;
+	/* model and timestep the NACK ranges refer to */
+	pid_t model_id;
+	float nack_t;
+	unsigned short nack_count;
+	ptp_nack_range_t nack[PTP_NACK_MAX_RANGES];
 } ptp_heartbeat_packet_t;
 
+#define PTP_HEARTBEAT_HEADER_SIZE (sizeof(ptp_heartbeat_packet_t) - \
+	(PTP_NACK_MAX_RANGES * sizeof(ptp_nack_range_t)))
+
 
 #endif /* PTP_H_ */
@@ -0,0 +1,569 @@
+/*
+ * ptp_loadgen.c
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Synthetic GPUSPH load generator.  Streams analytic wave or dam-break
+ * motion for any number of particles to every client heartbeating at it,
+ * optionally dropping and reordering packets, so the client can be
+ * benchmarked without a GPU cluster.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+#include <signal.h>
+#include <getopt.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include "ptp_sender.h"
+
+#define LOADGEN_GRAVITY 9.81
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+typedef enum { WAVE, DAMBREAK } loadgen_motion_t;
+
+/* particle types, as in GPUSPH */
+static const struct {
+	const char *name;
+	short particle_type;
+} g_loadgen_types[] = {
+		{ "fluid",     0 },
+		{ "boundary",  16 },
+		{ "piston",    32 },
+		{ "paddle",    48 },
+		{ "gate",      64 },
+		{ "object",    80 },
+		{ "testpoint", 96 },
+		{ "surface",   256 },
+		{ NULL,        0 }
+};
+
+/* Generator settings and state */
+typedef struct {
+	/* settings */
+	unsigned int particles;
+	loadgen_motion_t motion;
+	double steps_per_second;
+	double packets_per_second;
+	double dt;
+	double loss;
+	double reorder;
+	unsigned int restart_steps;
+	unsigned int keyframe_steps;
+	double duration;
+	unsigned int seed;
+	int verbosity;
+	char host[64];
+	uint16_t port;
+	uint16_t client_port;
+	/* percentage of each entry of g_loadgen_types */
+	double mix[16];
+	/* lattice of moving particles */
+	unsigned int fluid_count;
+	unsigned int nx, ny, nz;
+	double spacing;
+	/* world */
+	float world_origin[3];
+	float world_size[3];
+	/* particle arrays */
+	double *pos;
+	short *types;
+	/* impairment random state */
+	unsigned long long rng;
+	unsigned long long dropped;
+	unsigned long long reordered;
+} loadgen_t;
+
+static volatile sig_atomic_t g_loadgen_done = 0;
+
+/* Local prototypes */
+static void loadgen_usage(void);
+static void loadgen_on_signal(int sig);
+static double loadgen_random(loadgen_t *g);
+static int loadgen_parse_mix(loadgen_t *g, const char *spec);
+static void loadgen_impair(void *user, ptp_packet_t *batch, unsigned int *count);
+static int loadgen_setup(loadgen_t *g);
+static void loadgen_step(loadgen_t *g, double t);
+static double loadgen_now(void);
+
+static void loadgen_usage(void) {
+	printf("usage: ptp_loadgen [ options ]\n\n");
+	printf("Options:\n\n");
+	printf("--particles -n <count>   Particle count, 1k to 50M (100000)\n");
+	printf("--motion -m <name>       wave or dambreak (wave)\n");
+	printf("--mix -X <spec>          Type mix in percent (fluid=95,boundary=5)\n");
+	printf("--rate -s <steps/s>      Timestep rate (10)\n");
+	printf("--packet_rate -k <pkt/s> Packet rate, 0 for unpaced (0)\n");
+	printf("--dt -d <seconds>        Simulation time per step (0.01)\n");
+	printf("--loss -l <fraction>     Packet loss probability (0)\n");
+	printf("--reorder -o <fraction>  Packet reorder probability (0)\n");
+	printf("--restart -r <steps>     Start a new model every n steps (never)\n");
+	printf("--keyframe -K <steps>    Flag every n-th step as a keyframe (never)\n");
+	printf("--time -T <seconds>      Run time, 0 for forever (0)\n");
+	printf("--seed -S <n>            Impairment random seed (1)\n");
+	printf("--host -h <address>      Local address for heartbeats (all)\n");
+	printf("--port -p <port>         Local port for heartbeats (%i)\n",
+		PTP_DEFAULT_SERVER_PORT);
+	printf("--client_port -c <port>  Client data port (%i)\n",
+		PTP_DEFAULT_CLIENT_PORT);
+	printf("--verbosity -v           Print statistics every second\n");
+}
+
+static void loadgen_on_signal(int sig) {
+	(void)sig;
+	g_loadgen_done = 1;
+}
+
+/*
+@returns uniform random number in [0, 1), xorshift64*
+*/
+static double loadgen_random(loadgen_t *g) {
+	g->rng ^= g->rng >> 12;
+	g->rng ^= g->rng << 25;
+	g->rng ^= g->rng >> 27;
+	return((double)((g->rng * 2685821657736338717ULL) >> 11) / 9007199254740992.0);
+}
+
+/*
+Parse a type mix such as "fluid=90,boundary=8,testpoint=2".
+
+@returns 0 on success, -1 on error
+*/
+static int loadgen_parse_mix(loadgen_t *g, const char *spec) {
+	char buf[256];
+	char *item;
+	char *save = NULL;
+	int i;
+
+	memset(g->mix, 0, sizeof(g->mix));
+	snprintf(buf, sizeof(buf), "%s", spec);
+	for(item = strtok_r(buf, ",", &save); item != NULL;
+			item = strtok_r(NULL, ",", &save)) {
+		char *eq = strchr(item, '=');
+		if(eq == NULL) {
+			fprintf(stderr, "Bad mix entry '%s'\n", item);
+			return(-1);
+		}
+		*eq = '\0';
+		for(i = 0; g_loadgen_types[i].name != NULL; i++) {
+			if(!strcmp(item, g_loadgen_types[i].name)) {
+				g->mix[i] = atof(eq + 1);
+				break;
+			}
+		}
+		if(g_loadgen_types[i].name == NULL) {
+			fprintf(stderr, "Unknown particle type '%s'\n", item);
+			return(-1);
+		}
+	}
+	return(0);
+}
+
+/*
+Sender batch hook: drop and reorder packets.
+*/
+static void loadgen_impair(void *user, ptp_packet_t *batch, unsigned int *count) {
+	loadgen_t *g = (loadgen_t*)user;
+	unsigned int i;
+	unsigned int kept = 0;
+
+	if(g->loss > 0.0) {
+		for(i = 0; i < *count; i++) {
+			if(loadgen_random(g) < g->loss) {
+				g->dropped++;
+				continue;
+			}
+			if(kept != i) {
+				batch[kept] = batch[i];
+			}
+			kept++;
+		}
+		*count = kept;
+	}
+	if(g->reorder > 0.0) {
+		for(i = 0; i + 1 < *count; i++) {
+			if(loadgen_random(g) < g->reorder) {
+				/* swap with a later packet of the batch */
+				unsigned int j = i + 1 + (unsigned int)(loadgen_random(g) *
+					(*count - i - 1));
+				ptp_packet_t tmp = batch[i];
+				batch[i] = batch[j];
+				batch[j] = tmp;
+				g->reordered++;
+			}
+		}
+	}
+}
+
+/*
+Allocate arrays, assign types and lay out the lattice of moving particles.
+Moving (fluid and surface) particles come first, then the rest, which sit
+still on the floor of the world.
+
+@returns 0 on success, -1 on error
+*/
+static int loadgen_setup(loadgen_t *g) {
+	double total = 0.0;
+	double fluid_depth;
+	unsigned int first = 0;
+	unsigned int i;
+	int k;
+
+	g->world_origin[0] = g->world_origin[1] = g->world_origin[2] = 0.0;
+	g->world_size[0] = 4.0;
+	g->world_size[1] = 1.0;
+	g->world_size[2] = 1.0;
+
+	for(k = 0; g_loadgen_types[k].name != NULL; k++) {
+		total += g->mix[k];
+	}
+	if(total <= 0.0) {
+		fprintf(stderr, "Empty type mix\n");
+		return(-1);
+	}
+
+	g->pos = (double*)calloc((size_t)g->particles * 4, sizeof(double));
+	g->types = (short*)calloc(g->particles, sizeof(short));
+	if(g->pos == NULL || g->types == NULL) {
+		perror("loadgen_setup");
+		return(-1);
+	}
+
+	/* moving particles first, in mix order */
+	for(k = 0; g_loadgen_types[k].name != NULL; k++) {
+		short type = g_loadgen_types[k].particle_type;
+		unsigned int n;
+		if(type != 0 && type != 256) {
+			continue;
+		}
+		n = (unsigned int)(g->particles * (g->mix[k] / total));
+		for(i = first; i < first + n && i < g->particles; i++) {
+			g->types[i] = type;
+		}
+		first = i;
+	}
+	g->fluid_count = first;
+
+	/* then everything else */
+	for(k = 0; g_loadgen_types[k].name != NULL; k++) {
+		short type = g_loadgen_types[k].particle_type;
+		unsigned int n;
+		if(type == 0 || type == 256) {
+			continue;
+		}
+		n = (unsigned int)(g->particles * (g->mix[k] / total) + 0.5);
+		for(i = first; i < first + n && i < g->particles; i++) {
+			g->types[i] = type;
+		}
+		first = i;
+	}
+	for(i = first; i < g->particles; i++) {
+		/* rounding leftovers */
+		g->types[i] = 16;
+	}
+
+	/* cubic lattice holding the moving particles at rest */
+	fluid_depth = (g->motion == DAMBREAK ? 0.8 : 0.5) * g->world_size[2];
+	if(g->fluid_count > 0) {
+		double length = g->motion == DAMBREAK ? g->world_size[0] / 4.0 :
+			g->world_size[0];
+		g->spacing = cbrt(length * g->world_size[1] * fluid_depth /
+			g->fluid_count);
+		g->nx = (unsigned int)ceil(length / g->spacing);
+		g->ny = (unsigned int)ceil(g->world_size[1] / g->spacing);
+		g->nz = (unsigned int)ceil((double)g->fluid_count / (g->nx * g->ny));
+	}
+
+	/* static particles on a square lattice over the floor */
+	if(g->particles > g->fluid_count) {
+		unsigned int n = g->particles - g->fluid_count;
+		double s = sqrt(g->world_size[0] * g->world_size[1] / n);
+		unsigned int cols = (unsigned int)ceil(g->world_size[0] / s);
+		for(i = 0; i < n; i++) {
+			double *p = &g->pos[4 * (size_t)(g->fluid_count + i)];
+			p[0] = g->world_origin[0] + (i % cols) * s;
+			p[1] = g->world_origin[1] + (i / cols) * s;
+			p[2] = g->world_origin[2];
+			p[3] = 1.0;
+		}
+	}
+	return(0);
+}
+
+/*
+Move the fluid particles to their analytic position at time t.
+
+wave: linear deep-water wave, each particle on its orbit with amplitude
+decaying with depth.
+dambreak: Ritter solution, a column of the first quarter of the tank
+collapsing; particles keep their relative position in the water body.
+*/
+static void loadgen_step(loadgen_t *g, double t) {
+	double depth = (g->motion == DAMBREAK ? 0.8 : 0.5) * g->world_size[2];
+	double length = g->world_size[0];
+	double k = 2.0 * M_PI / (length / 2.0);
+	double omega = sqrt(LOADGEN_GRAVITY * k);
+	double amplitude = 0.05 * depth;
+	double c0 = sqrt(LOADGEN_GRAVITY * depth);
+	double dam = length / 4.0;
+	double front = dam + 2.0 * c0 * t;
+	unsigned int i;
+
+	if(front > length) {
+		front = length;
+	}
+	for(i = 0; i < g->fluid_count; i++) {
+		double *p = &g->pos[4 * (size_t)i];
+		unsigned int ix = i % g->nx;
+		unsigned int iy = (i / g->nx) % g->ny;
+		unsigned int iz = i / (g->nx * g->ny);
+		double x0 = (ix + 0.5) * g->spacing;
+		double y0 = (iy + 0.5) * g->spacing;
+		double z0 = (iz + 0.5) * g->spacing;
+
+		if(g->motion == WAVE) {
+			double decay = exp(k * (z0 - depth));
+			double phase = k * x0 - omega * t;
+			p[0] = x0 + amplitude * decay * cos(phase);
+			p[2] = z0 + amplitude * decay * sin(phase);
+		} else {
+			/* relative position in the initial column */
+			double u = x0 / dam;
+			double v = z0 / depth;
+			double x = u * front;
+			double h = depth;
+			double xi = (x - dam) / (t > 0.0 ? t : 1e-9);
+			if(xi >= 2.0 * c0) {
+				h = 0.0;
+			} else if(xi > -c0) {
+				h = (4.0 / (9.0 * LOADGEN_GRAVITY)) *
+					(c0 - xi / 2.0) * (c0 - xi / 2.0);
+			}
+			if(h < g->spacing) {
+				h = g->spacing;
+			}
+			p[0] = x;
+			p[2] = v * h;
+		}
+		p[0] += g->world_origin[0];
+		p[1] = g->world_origin[1] + y0;
+		p[2] += g->world_origin[2];
+		p[3] = 1.0;
+	}
+}
+
+/*
+@returns monotonic time in seconds
+*/
+static double loadgen_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return(ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+int main(int argc, char **argv) {
+	loadgen_t g;
+	ptp_sender_t sender;
+	ptp_sender_frame_t frame;
+	double start, next_step, last_report;
+	unsigned long long last_particles = 0;
+	unsigned int step = 0;
+	pid_t model_id;
+	int option_index;
+	int opt;
+
+	static struct option long_options[] = {
+		{"help", no_argument, 0, 'x' },
+		{"particles", required_argument, 0, 'n' },
+		{"motion", required_argument, 0, 'm' },
+		{"mix", required_argument, 0, 'X' },
+		{"rate", required_argument, 0, 's' },
+		{"packet_rate", required_argument, 0, 'k' },
+		{"dt", required_argument, 0, 'd' },
+		{"loss", required_argument, 0, 'l' },
+		{"reorder", required_argument, 0, 'o' },
+		{"restart", required_argument, 0, 'r' },
+		{"keyframe", required_argument, 0, 'K' },
+		{"time", required_argument, 0, 'T' },
+		{"seed", required_argument, 0, 'S' },
+		{"host", required_argument, 0, 'h' },
+		{"port", required_argument, 0, 'p' },
+		{"client_port", required_argument, 0, 'c' },
+		{"verbosity", no_argument, 0, 'v' },
+		{ 0, 0, 0, 0 }
+	};
+
+	memset(&g, 0, sizeof(g));
+	g.particles = 100000;
+	g.motion = WAVE;
+	g.steps_per_second = 10.0;
+	g.dt = 0.01;
+	g.seed = 1;
+	g.port = PTP_DEFAULT_SERVER_PORT;
+	g.client_port = PTP_DEFAULT_CLIENT_PORT;
+	loadgen_parse_mix(&g, "fluid=95,boundary=5");
+
+	while((opt = getopt_long(argc, argv, "n:m:X:s:k:d:l:o:r:K:T:S:h:p:c:v",
+			long_options, &option_index)) != -1) {
+		switch(opt) {
+			case 'n':
+				g.particles = (unsigned int)atol(optarg);
+				break;
+			case 'm':
+				if(!strcmp(optarg, "wave")) {
+					g.motion = WAVE;
+				} else if(!strcmp(optarg, "dambreak")) {
+					g.motion = DAMBREAK;
+				} else {
+					fprintf(stderr, "Unknown motion '%s'\n", optarg);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'X':
+				if(loadgen_parse_mix(&g, optarg)) {
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 's':
+				g.steps_per_second = atof(optarg);
+				break;
+			case 'k':
+				g.packets_per_second = atof(optarg);
+				break;
+			case 'd':
+				g.dt = atof(optarg);
+				break;
+			case 'l':
+				g.loss = atof(optarg);
+				break;
+			case 'o':
+				g.reorder = atof(optarg);
+				break;
+			case 'r':
+				g.restart_steps = (unsigned int)atoi(optarg);
+				break;
+			case 'K':
+				g.keyframe_steps = (unsigned int)atoi(optarg);
+				break;
+			case 'T':
+				g.duration = atof(optarg);
+				break;
+			case 'S':
+				g.seed = (unsigned int)atoi(optarg);
+				break;
+			case 'h':
+				snprintf(g.host, sizeof(g.host), "%s", optarg);
+				break;
+			case 'p':
+				g.port = (uint16_t)atoi(optarg);
+				break;
+			case 'c':
+				g.client_port = (uint16_t)atoi(optarg);
+				break;
+			case 'v':
+				g.verbosity = 1;
+				break;
+			default:
+				loadgen_usage();
+				exit(EXIT_FAILURE);
+		}
+	}
+	if(g.particles < 1) {
+		fprintf(stderr, "Need at least one particle\n");
+		exit(EXIT_FAILURE);
+	}
+	g.rng = 0x9E3779B97F4A7C15ULL ^ g.seed;
+
+	if(loadgen_setup(&g)) {
+		exit(EXIT_FAILURE);
+	}
+	if(ptp_sender_open(&sender, g.host[0] ? g.host : NULL, g.port,
+			g.client_port)) {
+		exit(EXIT_FAILURE);
+	}
+	if(g.packets_per_second > 0.0) {
+		ptp_sender_set_rate(&sender, g.packets_per_second * sizeof(ptp_packet_t), 0.0);
+	}
+	if(g.loss > 0.0 || g.reorder > 0.0) {
+		sender.batch_hook = loadgen_impair;
+		sender.batch_hook_user = &g;
+	}
+
+	signal(SIGINT, loadgen_on_signal);
+	signal(SIGTERM, loadgen_on_signal);
+
+	model_id = getpid();
+	memset(&frame, 0, sizeof(frame));
+	frame.total_particle_count = g.particles;
+	frame.count = g.particles;
+	frame.pos = g.pos;
+	frame.types = g.types;
+	memcpy(frame.world_origin, g.world_origin, sizeof(frame.world_origin));
+	memcpy(frame.world_size, g.world_size, sizeof(frame.world_size));
+
+	start = loadgen_now();
+	next_step = start;
+	last_report = start;
+	while(!g_loadgen_done) {
+		double now = loadgen_now();
+
+		if(g.duration > 0.0 && now - start >= g.duration) {
+			break;
+		}
+		if(now < next_step) {
+			/* keep answering heartbeats and NACKs between steps */
+			ptp_sender_poll(&sender);
+			usleep(1000);
+			continue;
+		}
+		next_step += g.steps_per_second > 0.0 ? 1.0 / g.steps_per_second : 0.0;
+		if(next_step < now) {
+			/* running behind, don't try to catch up */
+			next_step = now;
+		}
+
+		if(g.restart_steps && step == g.restart_steps) {
+			/* pretend the simulation was restarted */
+			model_id++;
+			step = 0;
+		}
+		loadgen_step(&g, step * g.dt);
+		frame.model_id = model_id;
+		frame.step = step;
+		frame.t = (float)(step * g.dt);
+		frame.flags = (g.keyframe_steps && step % g.keyframe_steps == 0) ?
+			PTP_FLAG_KEYFRAME : 0;
+		ptp_sender_publish(&sender, &frame);
+		step++;
+
+		if(g.verbosity && now - last_report >= 1.0) {
+			struct rusage usage;
+			double cpu;
+			getrusage(RUSAGE_SELF, &usage);
+			cpu = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+				(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+			printf("step %u model %i clients %i: %.0f particles/s, "
+				"%llu packets, %llu dropped, %llu reordered, "
+				"%llu retransmitted, %.0f particles/cpu-s\n",
+				step, (int)model_id, ptp_sender_client_count(&sender),
+				(sender.particles_sent - last_particles) / (now - last_report),
+				sender.packets_sent, g.dropped, g.reordered,
+				sender.retransmits_sent,
+				cpu > 0.0 ? sender.particles_sent / cpu : 0.0);
+			fflush(stdout);
+			last_particles = sender.particles_sent;
+			last_report = now;
+		}
+	}
+
+	ptp_sender_close(&sender);
+	free(g.pos);
+	free(g.types);
+	exit(EXIT_SUCCESS);
+}
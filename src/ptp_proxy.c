@@ -0,0 +1,606 @@
+/*
+ * ptp_proxy.c
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * User-space UDP impairment proxy.  Sits between a PTP sender and seewaves
+ * and applies loss, burst loss, reordering, duplication, delay jitter and a
+ * bandwidth cap to data going one way and heartbeats going the other, so
+ * ingest can be measured under WAN conditions without tc/netem.
+ *
+ *   sender --data--> [listen] proxy --> client data port (seewaves)
+ *   sender <--hb---- proxy [hb_listen] <--hb-- seewaves
+ *
+ * The sender sends data to the host its heartbeats come from on a fixed
+ * client port, so point it at the proxy's listen port (ptp_loadgen -c) and
+ * point seewaves' heartbeats at hb_listen (seewaves -p).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <signal.h>
+#include <getopt.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "ptp.h"
+
+#define PROXY_DEFAULT_LISTEN_PORT 50010
+#define PROXY_DEFAULT_HB_LISTEN_PORT 50011
+#define PROXY_MAX_DATAGRAM 65536
+#define PROXY_DEFAULT_QUEUE_BYTES (4 * 1024 * 1024)
+#define PROXY_DEFAULT_REORDER_MS 5.0
+
+typedef enum { FORWARD, REVERSE } proxy_direction_t;
+
+/* Impairments applied to one direction */
+typedef struct {
+	/* independent loss probability */
+	double loss;
+	/* Gilbert-Elliott burst loss, probability of entering and leaving the
+	lossy state per packet */
+	double burst_enter;
+	double burst_exit;
+	int in_burst;
+	/* probability of holding a packet back so later ones overtake it */
+	double reorder;
+	double reorder_ms;
+	/* duplication probability */
+	double duplicate;
+	/* one-way delay and uniform jitter */
+	double delay_ms;
+	double jitter_ms;
+	/* bandwidth cap, bits per second, 0 for none */
+	double rate_bps;
+	/* bytes allowed to wait for the link before tail drop */
+	double queue_bytes;
+	/* when the link is next free */
+	double link_free;
+	/* random state */
+	unsigned long long rng;
+	/* statistics */
+	unsigned long long in;
+	unsigned long long out;
+	unsigned long long lost;
+	unsigned long long burst_lost;
+	unsigned long long queue_dropped;
+	unsigned long long duplicated;
+	unsigned long long reordered;
+} proxy_link_t;
+
+/* A datagram waiting to be released */
+typedef struct {
+	double due;
+	unsigned long long seq;
+	proxy_direction_t direction;
+	size_t len;
+	unsigned char *data;
+} proxy_entry_t;
+
+/* Proxy state */
+typedef struct {
+	int data_fd;
+	int hb_fd;
+	struct sockaddr_storage client;
+	socklen_t client_len;
+	struct sockaddr_storage server;
+	socklen_t server_len;
+	proxy_link_t link[2];
+	/* min-heap of pending datagrams, by due time then arrival */
+	proxy_entry_t *heap;
+	size_t heap_len;
+	size_t heap_cap;
+	unsigned long long seq;
+	int verbosity;
+} proxy_t;
+
+static volatile sig_atomic_t g_proxy_done = 0;
+
+/* Local prototypes */
+static void proxy_usage(void);
+static void proxy_on_signal(int sig);
+static double proxy_now(void);
+static double proxy_random(proxy_link_t *l);
+static int proxy_parse_link(proxy_link_t *l, const char *spec);
+static int proxy_resolve(const char *spec, struct sockaddr_storage *addr,
+		socklen_t *len);
+static int proxy_bind(uint16_t port);
+static int proxy_push(proxy_t *p, proxy_entry_t *e);
+static void proxy_pop(proxy_t *p, proxy_entry_t *e);
+static void proxy_receive(proxy_t *p, int fd, proxy_direction_t direction);
+static void proxy_release(proxy_t *p);
+static void proxy_report(proxy_t *p);
+
+static void proxy_usage(void) {
+	printf("usage: ptp_proxy [ options ]\n\n");
+	printf("Options:\n\n");
+	printf("--listen -l <port>        Data port the sender sends to (%i)\n",
+		PROXY_DEFAULT_LISTEN_PORT);
+	printf("--client -c <host:port>   Where data is forwarded (%s:%i)\n",
+		PTP_DEFAULT_CLIENT_HOST, PTP_DEFAULT_CLIENT_PORT);
+	printf("--hb_listen -b <port>     Heartbeat port seewaves sends to (%i)\n",
+		PROXY_DEFAULT_HB_LISTEN_PORT);
+	printf("--server -s <host:port>   Where heartbeats are forwarded (%s:%i)\n",
+		PTP_DEFAULT_SERVER_HOST, PTP_DEFAULT_SERVER_PORT);
+	printf("--forward -f <spec>       Data impairments\n");
+	printf("--reverse -r <spec>       Heartbeat impairments\n");
+	printf("--seed -S <n>             Random seed (1)\n");
+	printf("--verbosity -v            Print statistics every second\n\n");
+	printf("spec is a comma separated list of:\n");
+	printf("  loss=<p>                independent loss probability\n");
+	printf("  burst=<enter>:<exit>    Gilbert-Elliott burst loss\n");
+	printf("  reorder=<p>             hold packets back by reorder_ms\n");
+	printf("  reorder_ms=<ms>         reorder hold time (%.0f)\n",
+		PROXY_DEFAULT_REORDER_MS);
+	printf("  dup=<p>                 duplication probability\n");
+	printf("  delay=<ms>              one-way delay\n");
+	printf("  jitter=<ms>             uniform delay jitter\n");
+	printf("  rate=<bits/s>           bandwidth cap, k/M/G suffixes\n");
+	printf("  queue=<bytes>           link queue before tail drop (%i)\n",
+		PROXY_DEFAULT_QUEUE_BYTES);
+}
+
+static void proxy_on_signal(int sig) {
+	(void)sig;
+	g_proxy_done = 1;
+}
+
+/*
+@returns monotonic time in seconds
+*/
+static double proxy_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return(ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+/*
+@returns uniform random number in [0, 1), xorshift64*
+*/
+static double proxy_random(proxy_link_t *l) {
+	l->rng ^= l->rng >> 12;
+	l->rng ^= l->rng << 25;
+	l->rng ^= l->rng >> 27;
+	return((double)((l->rng * 2685821657736338717ULL) >> 11) / 9007199254740992.0);
+}
+
+/*
+Parse an impairment spec such as "loss=0.01,delay=20,rate=100M".
+
+@returns 0 on success, -1 on error
+*/
+static int proxy_parse_link(proxy_link_t *l, const char *spec) {
+	char buf[512];
+	char *item;
+	char *save = NULL;
+
+	snprintf(buf, sizeof(buf), "%s", spec);
+	for(item = strtok_r(buf, ",", &save); item != NULL;
+			item = strtok_r(NULL, ",", &save)) {
+		char *value = strchr(item, '=');
+		char *end;
+		double v;
+		if(value == NULL) {
+			fprintf(stderr, "Bad impairment '%s'\n", item);
+			return(-1);
+		}
+		*value++ = '\0';
+		v = strtod(value, &end);
+		if(!strcmp(item, "loss")) {
+			l->loss = v;
+		} else if(!strcmp(item, "burst")) {
+			l->burst_enter = v;
+			l->burst_exit = (*end == ':') ? atof(end + 1) : 0.5;
+		} else if(!strcmp(item, "reorder")) {
+			l->reorder = v;
+		} else if(!strcmp(item, "reorder_ms")) {
+			l->reorder_ms = v;
+		} else if(!strcmp(item, "dup")) {
+			l->duplicate = v;
+		} else if(!strcmp(item, "delay")) {
+			l->delay_ms = v;
+		} else if(!strcmp(item, "jitter")) {
+			l->jitter_ms = v;
+		} else if(!strcmp(item, "rate")) {
+			if(*end == 'k' || *end == 'K') {
+				v *= 1e3;
+			} else if(*end == 'm' || *end == 'M') {
+				v *= 1e6;
+			} else if(*end == 'g' || *end == 'G') {
+				v *= 1e9;
+			}
+			l->rate_bps = v;
+		} else if(!strcmp(item, "queue")) {
+			l->queue_bytes = v;
+		} else {
+			fprintf(stderr, "Unknown impairment '%s'\n", item);
+			return(-1);
+		}
+	}
+	return(0);
+}
+
+/*
+Resolve "host:port".
+
+@returns 0 on success, -1 on error
+*/
+static int proxy_resolve(const char *spec, struct sockaddr_storage *addr,
+		socklen_t *len) {
+	char host[256];
+	struct addrinfo hints;
+	struct addrinfo *res;
+	char *colon;
+	int err;
+
+	snprintf(host, sizeof(host), "%s", spec);
+	if((colon = strrchr(host, ':')) == NULL) {
+		fprintf(stderr, "Expected host:port, got '%s'\n", spec);
+		return(-1);
+	}
+	*colon = '\0';
+	memset(&hints, 0, sizeof hints);
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	if((err = getaddrinfo(host, colon + 1, &hints, &res))) {
+		fprintf(stderr, "getaddrinfo: %s\n", gai_strerror(err));
+		return(-1);
+	}
+	memcpy(addr, res->ai_addr, res->ai_addrlen);
+	*len = res->ai_addrlen;
+	freeaddrinfo(res);
+	return(0);
+}
+
+/*
+@returns non-blocking UDP socket bound to port on all interfaces, or -1
+*/
+static int proxy_bind(uint16_t port) {
+	struct sockaddr_in addr;
+	int optval = 1;
+	int size = 16 * 1024 * 1024;
+	int fd;
+
+	if((fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) == -1) {
+		perror("socket");
+		return(-1);
+	}
+	if(setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof optval) == -1) {
+		perror("setsockopt(SO_REUSEADDR)");
+	}
+	/* best effort, the proxy must not become the bottleneck */
+	(void)setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof size);
+	(void)setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof size);
+	memset(&addr, 0, sizeof addr);
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	if(bind(fd, (struct sockaddr*)&addr, sizeof addr) == -1) {
+		perror("bind");
+		close(fd);
+		return(-1);
+	}
+	fcntl(fd, F_SETFL, O_NONBLOCK);
+	return(fd);
+}
+
+/*
+Add a datagram to the release heap, taking ownership of its data.
+
+@returns 0 on success, -1 on allocation failure
+*/
+static int proxy_push(proxy_t *p, proxy_entry_t *e) {
+	size_t i;
+	if(p->heap_len == p->heap_cap) {
+		size_t cap = p->heap_cap ? 2 * p->heap_cap : 1024;
+		proxy_entry_t *heap = (proxy_entry_t*)realloc(p->heap,
+			cap * sizeof(proxy_entry_t));
+		if(heap == NULL) {
+			perror("proxy_push");
+			return(-1);
+		}
+		p->heap = heap;
+		p->heap_cap = cap;
+	}
+	e->seq = p->seq++;
+	i = p->heap_len++;
+	while(i > 0) {
+		size_t parent = (i - 1) / 2;
+		proxy_entry_t *q = &p->heap[parent];
+		if(q->due < e->due || (q->due == e->due && q->seq < e->seq)) {
+			break;
+		}
+		p->heap[i] = *q;
+		i = parent;
+	}
+	p->heap[i] = *e;
+	return(0);
+}
+
+/*
+Remove the earliest datagram from the heap.
+*/
+static void proxy_pop(proxy_t *p, proxy_entry_t *e) {
+	proxy_entry_t last;
+	size_t i = 0;
+
+	*e = p->heap[0];
+	last = p->heap[--p->heap_len];
+	for(;;) {
+		size_t child = 2 * i + 1;
+		proxy_entry_t *c;
+		if(child >= p->heap_len) {
+			break;
+		}
+		if(child + 1 < p->heap_len && (p->heap[child + 1].due < p->heap[child].due ||
+				(p->heap[child + 1].due == p->heap[child].due &&
+				p->heap[child + 1].seq < p->heap[child].seq))) {
+			child++;
+		}
+		c = &p->heap[child];
+		if(last.due < c->due || (last.due == c->due && last.seq < c->seq)) {
+			break;
+		}
+		p->heap[i] = *c;
+		i = child;
+	}
+	if(p->heap_len > 0) {
+		p->heap[i] = last;
+	}
+}
+
+/*
+Read every datagram waiting on fd and schedule its release, or drop it.
+*/
+static void proxy_receive(proxy_t *p, int fd, proxy_direction_t direction) {
+	proxy_link_t *l = &p->link[direction];
+	unsigned char buf[PROXY_MAX_DATAGRAM];
+
+	for(;;) {
+		ssize_t len = recv(fd, buf, sizeof(buf), 0);
+		double now = proxy_now();
+		double due;
+		int copies;
+		int i;
+
+		if(len < 0) {
+			if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+				perror("proxy recv");
+			}
+			return;
+		}
+		l->in++;
+
+		/* burst loss state machine, then independent loss */
+		if(l->burst_enter > 0.0) {
+			if(l->in_burst) {
+				l->in_burst = !(proxy_random(l) < l->burst_exit);
+			} else {
+				l->in_burst = (proxy_random(l) < l->burst_enter);
+			}
+			if(l->in_burst) {
+				l->burst_lost++;
+				continue;
+			}
+		}
+		if(l->loss > 0.0 && proxy_random(l) < l->loss) {
+			l->lost++;
+			continue;
+		}
+
+		copies = 1;
+		if(l->duplicate > 0.0 && proxy_random(l) < l->duplicate) {
+			copies = 2;
+			l->duplicated++;
+		}
+		for(i = 0; i < copies; i++) {
+			proxy_entry_t e;
+			due = now + l->delay_ms / 1000.0;
+			if(l->jitter_ms > 0.0) {
+				due += proxy_random(l) * l->jitter_ms / 1000.0;
+			}
+			if(l->reorder > 0.0 && proxy_random(l) < l->reorder) {
+				due += l->reorder_ms / 1000.0;
+				l->reordered++;
+			}
+			if(l->rate_bps > 0.0) {
+				/* serialize onto the capped link, tail drop when backed up */
+				double start = due > l->link_free ? due : l->link_free;
+				if((start - due) * l->rate_bps / 8.0 > l->queue_bytes) {
+					l->queue_dropped++;
+					continue;
+				}
+				l->link_free = start + len * 8.0 / l->rate_bps;
+				due = l->link_free;
+			}
+			e.due = due;
+			e.direction = direction;
+			e.len = (size_t)len;
+			if((e.data = (unsigned char*)malloc(e.len)) == NULL) {
+				perror("proxy_receive");
+				continue;
+			}
+			memcpy(e.data, buf, e.len);
+			if(proxy_push(p, &e)) {
+				free(e.data);
+			}
+		}
+	}
+}
+
+/*
+Send every datagram that is due.
+*/
+static void proxy_release(proxy_t *p) {
+	double now = proxy_now();
+	while(p->heap_len > 0 && p->heap[0].due <= now) {
+		proxy_entry_t e;
+		proxy_pop(p, &e);
+		if(e.direction == FORWARD) {
+			if(sendto(p->data_fd, e.data, e.len, 0,
+					(struct sockaddr*)&p->client, p->client_len) >= 0) {
+				p->link[FORWARD].out++;
+			}
+		} else {
+			if(sendto(p->hb_fd, e.data, e.len, 0,
+					(struct sockaddr*)&p->server, p->server_len) >= 0) {
+				p->link[REVERSE].out++;
+			}
+		}
+		free(e.data);
+	}
+}
+
+static void proxy_report(proxy_t *p) {
+	int d;
+	for(d = FORWARD; d <= REVERSE; d++) {
+		proxy_link_t *l = &p->link[d];
+		printf("%s in %llu out %llu lost %llu burst_lost %llu queue_dropped %llu "
+			"duplicated %llu reordered %llu%s",
+			d == FORWARD ? "data:" : " heartbeat:", l->in, l->out, l->lost,
+			l->burst_lost, l->queue_dropped, l->duplicated, l->reordered,
+			d == FORWARD ? "" : "\n");
+	}
+	fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+	proxy_t p;
+	uint16_t listen_port = PROXY_DEFAULT_LISTEN_PORT;
+	uint16_t hb_listen_port = PROXY_DEFAULT_HB_LISTEN_PORT;
+	char client[300];
+	char server[300];
+	unsigned int seed = 1;
+	double last_report;
+	int option_index;
+	int opt;
+	int d;
+
+	static struct option long_options[] = {
+		{"help", no_argument, 0, 'x' },
+		{"listen", required_argument, 0, 'l' },
+		{"client", required_argument, 0, 'c' },
+		{"hb_listen", required_argument, 0, 'b' },
+		{"server", required_argument, 0, 's' },
+		{"forward", required_argument, 0, 'f' },
+		{"reverse", required_argument, 0, 'r' },
+		{"seed", required_argument, 0, 'S' },
+		{"verbosity", no_argument, 0, 'v' },
+		{ 0, 0, 0, 0 }
+	};
+
+	memset(&p, 0, sizeof(p));
+	for(d = FORWARD; d <= REVERSE; d++) {
+		p.link[d].reorder_ms = PROXY_DEFAULT_REORDER_MS;
+		p.link[d].queue_bytes = PROXY_DEFAULT_QUEUE_BYTES;
+	}
+	snprintf(client, sizeof(client), "%s:%i", PTP_DEFAULT_CLIENT_HOST,
+		PTP_DEFAULT_CLIENT_PORT);
+	snprintf(server, sizeof(server), "%s:%i", PTP_DEFAULT_SERVER_HOST,
+		PTP_DEFAULT_SERVER_PORT);
+
+	while((opt = getopt_long(argc, argv, "l:c:b:s:f:r:S:v", long_options,
+			&option_index)) != -1) {
+		switch(opt) {
+			case 'l':
+				listen_port = (uint16_t)atoi(optarg);
+				break;
+			case 'c':
+				snprintf(client, sizeof(client), "%s", optarg);
+				break;
+			case 'b':
+				hb_listen_port = (uint16_t)atoi(optarg);
+				break;
+			case 's':
+				snprintf(server, sizeof(server), "%s", optarg);
+				break;
+			case 'f':
+				if(proxy_parse_link(&p.link[FORWARD], optarg)) {
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'r':
+				if(proxy_parse_link(&p.link[REVERSE], optarg)) {
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'S':
+				seed = (unsigned int)atoi(optarg);
+				break;
+			case 'v':
+				p.verbosity = 1;
+				break;
+			default:
+				proxy_usage();
+				exit(EXIT_FAILURE);
+		}
+	}
+	p.link[FORWARD].rng = 0x9E3779B97F4A7C15ULL ^ seed;
+	p.link[REVERSE].rng = 0xC2B2AE3D27D4EB4FULL ^ seed;
+
+	if(proxy_resolve(client, &p.client, &p.client_len) ||
+			proxy_resolve(server, &p.server, &p.server_len)) {
+		exit(EXIT_FAILURE);
+	}
+	if((p.data_fd = proxy_bind(listen_port)) == -1 ||
+			(p.hb_fd = proxy_bind(hb_listen_port)) == -1) {
+		exit(EXIT_FAILURE);
+	}
+
+	signal(SIGINT, proxy_on_signal);
+	signal(SIGTERM, proxy_on_signal);
+
+	last_report = proxy_now();
+	while(!g_proxy_done) {
+		struct pollfd fds[2];
+		int timeout = 100;
+		double now = proxy_now();
+
+		if(p.heap_len > 0) {
+			double wait = (p.heap[0].due - now) * 1000.0;
+			timeout = wait <= 0.0 ? 0 : (int)wait + 1;
+			if(timeout > 100) {
+				timeout = 100;
+			}
+		}
+		fds[0].fd = p.data_fd;
+		fds[0].events = POLLIN;
+		fds[1].fd = p.hb_fd;
+		fds[1].events = POLLIN;
+		if(poll(fds, 2, timeout) == -1 && errno != EINTR) {
+			perror("poll");
+			break;
+		}
+		if(fds[0].revents & POLLIN) {
+			proxy_receive(&p, p.data_fd, FORWARD);
+		}
+		if(fds[1].revents & POLLIN) {
+			proxy_receive(&p, p.hb_fd, REVERSE);
+		}
+		proxy_release(&p);
+
+		if(p.verbosity && proxy_now() - last_report >= 1.0) {
+			proxy_report(&p);
+			last_report = proxy_now();
+		}
+	}
+
+	if(p.verbosity) {
+		proxy_report(&p);
+	}
+	while(p.heap_len > 0) {
+		proxy_entry_t e;
+		proxy_pop(&p, &e);
+		free(e.data);
+	}
+	free(p.heap);
+	close(p.data_fd);
+	close(p.hb_fd);
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,690 @@
+/*
+ * ptp_sender.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/* sendmmsg() */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "ptp_sender.h"
+
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+/* locals */
+static void ptp_bucket_init(ptp_token_bucket_t *b, double rate, double burst);
+static void ptp_bucket_refill(ptp_token_bucket_t *b);
+static void ptp_bucket_wait(ptp_token_bucket_t *b, double bytes);
+static int ptp_sender_same_host(const struct sockaddr_storage *a,
+		const struct sockaddr_storage *b);
+static uint16_t ptp_sender_port(const struct sockaddr_storage *a);
+static ptp_sender_client_t *ptp_sender_client_for(ptp_sender_t *s,
+		struct sockaddr_storage *from, socklen_t from_len);
+static void ptp_sender_heartbeat(ptp_sender_t *s, ptp_sender_client_t *c,
+		const unsigned char *buf, ssize_t len);
+static int ptp_sender_send(ptp_sender_t *s, int gso);
+static int ptp_sender_flush(ptp_sender_t *s);
+static ptp_packet_t *ptp_sender_queue(ptp_sender_t *s, ptp_sender_client_t *c);
+static void ptp_sender_header(ptp_packet_t *p, pid_t model_id, float t,
+		const float world_origin[3], const float world_size[3],
+		unsigned int total_particle_count, unsigned char flags);
+static int ptp_sender_id_order(const void *a, const void *b);
+static void ptp_sender_keep(ptp_sender_t *s, const ptp_sender_frame_t *f);
+static ptp_sender_keyframe_t *ptp_sender_keyframe_for(ptp_sender_t *s,
+		pid_t model_id, float t);
+static unsigned int ptp_sender_lower_bound(const ptp_sender_keyframe_t *kf,
+		unsigned int id);
+static void ptp_sender_retransmit(ptp_sender_t *s, ptp_sender_client_t *c);
+
+/*
+Initialize a token bucket, full.
+*/
+static void ptp_bucket_init(ptp_token_bucket_t *b, double rate, double burst) {
+	b->rate = rate;
+	b->burst = burst;
+	b->tokens = burst;
+	clock_gettime(CLOCK_MONOTONIC, &b->last);
+}
+
+/*
+Add the tokens accumulated since the last refill.
+*/
+static void ptp_bucket_refill(ptp_token_bucket_t *b) {
+	struct timespec now;
+	double dt;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	dt = (now.tv_sec - b->last.tv_sec) + (now.tv_nsec - b->last.tv_nsec) / 1e9;
+	b->last = now;
+	b->tokens += dt * b->rate;
+	if(b->tokens > b->burst) {
+		b->tokens = b->burst;
+	}
+}
+
+/*
+Block until the bucket can pay for bytes, then take them.  Requests larger
+than the bucket only wait for a full bucket and leave it in debt.
+*/
+static void ptp_bucket_wait(ptp_token_bucket_t *b, double bytes) {
+	double need = bytes < b->burst ? bytes : b->burst;
+	if(b->rate <= 0.0) {
+		return;
+	}
+	ptp_bucket_refill(b);
+	while(b->tokens < need) {
+		double wait = (need - b->tokens) / b->rate;
+		struct timespec ts;
+		ts.tv_sec = (time_t)wait;
+		ts.tv_nsec = (long)((wait - ts.tv_sec) * 1e9);
+		nanosleep(&ts, NULL);
+		ptp_bucket_refill(b);
+	}
+	b->tokens -= bytes;
+}
+
+/*
+@returns non-zero if both addresses are the same host
+*/
+static int ptp_sender_same_host(const struct sockaddr_storage *a,
+		const struct sockaddr_storage *b) {
+	if(a->ss_family != b->ss_family) {
+		return(0);
+	}
+	if(a->ss_family == AF_INET) {
+		return(((const struct sockaddr_in*)a)->sin_addr.s_addr ==
+			((const struct sockaddr_in*)b)->sin_addr.s_addr);
+	}
+	return(!memcmp(&((const struct sockaddr_in6*)a)->sin6_addr,
+		&((const struct sockaddr_in6*)b)->sin6_addr, sizeof(struct in6_addr)));
+}
+
+/*
+@returns port of an address, network order
+*/
+static uint16_t ptp_sender_port(const struct sockaddr_storage *a) {
+	if(a->ss_family == AF_INET) {
+		return(((const struct sockaddr_in*)a)->sin_port);
+	}
+	return(((const struct sockaddr_in6*)a)->sin6_port);
+}
+
+/*
+Find the client a heartbeat came from, by host and source port, adding it
+if new.  Data goes to the heartbeat's source host on client_port.
+
+@returns client or NULL if the client table is full
+*/
+static ptp_sender_client_t *ptp_sender_client_for(ptp_sender_t *s,
+		struct sockaddr_storage *from, socklen_t from_len) {
+	ptp_sender_client_t *free_slot = NULL;
+	int i;
+	for(i = 0; i < PTP_SENDER_MAX_CLIENTS; i++) {
+		ptp_sender_client_t *c = &s->clients[i];
+		if(!c->used) {
+			if(free_slot == NULL) {
+				free_slot = c;
+			}
+		} else if(ptp_sender_same_host(&c->address, from) &&
+				c->heartbeat_port == ptp_sender_port(from)) {
+			return(c);
+		}
+	}
+	if(free_slot == NULL) {
+		return(NULL);
+	}
+	memset(free_slot, 0, sizeof(ptp_sender_client_t));
+	free_slot->used = 1;
+	free_slot->address = *from;
+	free_slot->address_len = from_len;
+	free_slot->heartbeat_port = ptp_sender_port(from);
+	if(from->ss_family == AF_INET) {
+		((struct sockaddr_in*)&free_slot->address)->sin_port = htons(s->client_port);
+	} else {
+		((struct sockaddr_in6*)&free_slot->address)->sin6_port = htons(s->client_port);
+	}
+	free_slot->full_stride = 1;
+	return(free_slot);
+}
+
+/*
+Apply a heartbeat to its client.  Short (version 0) heartbeats keep the
+default subscription, the full field every step.
+*/
+static void ptp_sender_heartbeat(ptp_sender_t *s, ptp_sender_client_t *c,
+		const unsigned char *buf, ssize_t len) {
+	ptp_heartbeat_packet_t hb;
+
+	time(&c->last_heartbeat);
+	s->heartbeats_received++;
+	if((size_t)len < PTP_HEARTBEAT_HEADER_SIZE) {
+		return;
+	}
+	memset(&hb, 0, sizeof(hb));
+	memcpy(&hb, buf, (size_t)len < sizeof(hb) ? (size_t)len : sizeof(hb));
+	c->tracked_types = hb.tracked_types;
+	c->tracked_stride = hb.tracked_stride;
+	c->full_stride = hb.full_stride;
+	if(hb.nack_count > 0 && hb.nack_count <= PTP_NACK_MAX_RANGES &&
+			(size_t)len >= PTP_HEARTBEAT_HEADER_SIZE +
+			hb.nack_count * sizeof(ptp_nack_range_t)) {
+		/* a newer NACK replaces whatever is left of the previous one */
+		c->nack_model_id = hb.model_id;
+		c->nack_t = hb.nack_t;
+		c->nack_count = hb.nack_count;
+		c->nack_next = 0;
+		c->nack_offset = 0;
+		memcpy(c->nack, hb.nack, hb.nack_count * sizeof(ptp_nack_range_t));
+		s->nacks_received++;
+	}
+}
+
+/*
+Send the queued batch with one sendmmsg() call, optionally coalescing
+packets into UDP_SEGMENT super-datagrams.
+
+@returns 0 on success, -1 on error
+*/
+static int ptp_sender_send(ptp_sender_t *s, int gso) {
+	struct mmsghdr msgs[PTP_SENDER_BATCH];
+	struct iovec iov[PTP_SENDER_BATCH];
+	char control[PTP_SENDER_BATCH][CMSG_SPACE(sizeof(uint16_t))];
+	unsigned int per_msg = gso ? PTP_SENDER_GSO_SEGMENTS : 1;
+	unsigned int nmsgs = 0;
+	unsigned int sent = 0;
+	unsigned int i;
+
+	memset(msgs, 0, sizeof(msgs));
+	for(i = 0; i < s->batch_count; i += per_msg) {
+		unsigned int n = s->batch_count - i < per_msg ? s->batch_count - i : per_msg;
+		struct msghdr *h = &msgs[nmsgs].msg_hdr;
+		iov[nmsgs].iov_base = &s->batch[i];
+		iov[nmsgs].iov_len = n * sizeof(ptp_packet_t);
+		h->msg_name = &s->batch_client->address;
+		h->msg_namelen = s->batch_client->address_len;
+		h->msg_iov = &iov[nmsgs];
+		h->msg_iovlen = 1;
+		if(gso && n > 1) {
+			struct cmsghdr *cm;
+			h->msg_control = control[nmsgs];
+			h->msg_controllen = sizeof(control[nmsgs]);
+			cm = CMSG_FIRSTHDR(h);
+			cm->cmsg_level = SOL_UDP;
+			cm->cmsg_type = UDP_SEGMENT;
+			cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+			*((uint16_t*)CMSG_DATA(cm)) = (uint16_t)sizeof(ptp_packet_t);
+		}
+		nmsgs++;
+	}
+	while(sent < nmsgs) {
+		int rc = sendmmsg(s->fd, &msgs[sent], nmsgs - sent, 0);
+		if(rc == -1) {
+			if(errno == EINTR) {
+				continue;
+			}
+			if(gso && sent == 0 && (errno == EIO || errno == EINVAL ||
+					errno == ENOPROTOOPT || errno == EOPNOTSUPP)) {
+				/* no segmentation offload on this path, don't try again */
+				s->use_gso = 0;
+				return(ptp_sender_send(s, 0));
+			}
+			perror("sendmmsg");
+			return(-1);
+		}
+		sent += (unsigned int)rc;
+		s->send_calls++;
+	}
+	return(0);
+}
+
+/*
+Pace and send everything queued.
+
+@returns 0 on success, -1 on error
+*/
+static int ptp_sender_flush(ptp_sender_t *s) {
+	int err;
+	unsigned int i;
+	if(s->batch_hook != NULL) {
+		s->batch_hook(s->batch_hook_user, s->batch, &s->batch_count);
+	}
+	if(s->batch_count == 0) {
+		return(0);
+	}
+	ptp_bucket_wait(&s->pacing, (double)s->batch_count * sizeof(ptp_packet_t));
+	err = ptp_sender_send(s, s->use_gso);
+	if(!err) {
+		s->packets_sent += s->batch_count;
+		s->bytes_sent += (unsigned long long)s->batch_count * sizeof(ptp_packet_t);
+		for(i = 0; i < s->batch_count; i++) {
+			s->particles_sent += s->batch[i].particle_count;
+		}
+	}
+	s->batch_count = 0;
+	return(err);
+}
+
+/*
+@returns a cleared packet at the end of the batch for client c
+*/
+static ptp_packet_t *ptp_sender_queue(ptp_sender_t *s, ptp_sender_client_t *c) {
+	ptp_packet_t *p;
+	if(s->batch_count == PTP_SENDER_BATCH ||
+			(s->batch_count > 0 && s->batch_client != c)) {
+		ptp_sender_flush(s);
+	}
+	s->batch_client = c;
+	p = &s->batch[s->batch_count++];
+	memset(p, 0, sizeof(ptp_packet_t));
+	return(p);
+}
+
+/*
+Fill a packet header.
+*/
+static void ptp_sender_header(ptp_packet_t *p, pid_t model_id, float t,
+		const float world_origin[3], const float world_size[3],
+		unsigned int total_particle_count, unsigned char flags) {
+	p->version = PTP_VERSION;
+	p->flags = flags;
+	p->model_id = model_id;
+	p->total_particle_count = total_particle_count;
+	p->particle_count = 0;
+	p->t = t;
+	memcpy(p->world_origin, world_origin, sizeof(p->world_origin));
+	memcpy(p->world_size, world_size, sizeof(p->world_size));
+}
+
+/*
+qsort() comparison of particles by id.
+*/
+static int ptp_sender_id_order(const void *a, const void *b) {
+	unsigned int ia = ((const ptp_particle_data_t*)a)->id;
+	unsigned int ib = ((const ptp_particle_data_t*)b)->id;
+	return(ia < ib ? -1 : ia > ib);
+}
+
+/*
+Copy a frame into the keyframe history, replacing the oldest.  Particles
+are sorted by id once here, so each NACK range is a binary search away.
+*/
+static void ptp_sender_keep(ptp_sender_t *s, const ptp_sender_frame_t *f) {
+	ptp_sender_keyframe_t *kf = &s->history[s->history_next];
+	unsigned int i;
+	int sorted = 1;
+
+	if(kf->capacity < f->count) {
+		ptp_particle_data_t *data = (ptp_particle_data_t*)realloc(kf->data,
+			f->count * sizeof(ptp_particle_data_t));
+		if(data == NULL) {
+			perror("ptp_sender_keep");
+			kf->used = 0;
+			return;
+		}
+		kf->data = data;
+		kf->capacity = f->count;
+	}
+	for(i = 0; i < f->count; i++) {
+		ptp_particle_data_t *d = &kf->data[i];
+		d->id = f->ids ? f->ids[i] : i;
+		memcpy(d->position, &f->pos[4 * i], sizeof(d->position));
+		d->particle_type = f->types[i];
+		if(i > 0 && d->id < kf->data[i - 1].id) {
+			sorted = 0;
+		}
+	}
+	if(!sorted) {
+		qsort(kf->data, f->count, sizeof(ptp_particle_data_t),
+			ptp_sender_id_order);
+	}
+	kf->used = 1;
+	kf->model_id = f->model_id;
+	kf->t = f->t;
+	kf->count = f->count;
+	kf->total_particle_count = f->total_particle_count;
+	memcpy(kf->world_origin, f->world_origin, sizeof(kf->world_origin));
+	memcpy(kf->world_size, f->world_size, sizeof(kf->world_size));
+	s->history_next = (s->history_next + 1) % PTP_SENDER_HISTORY;
+}
+
+/*
+@returns kept keyframe for model_id at time t, or NULL
+*/
+static ptp_sender_keyframe_t *ptp_sender_keyframe_for(ptp_sender_t *s,
+		pid_t model_id, float t) {
+	int i;
+	for(i = 0; i < PTP_SENDER_HISTORY; i++) {
+		ptp_sender_keyframe_t *kf = &s->history[i];
+		if(kf->used && kf->model_id == model_id && kf->t == t) {
+			return(kf);
+		}
+	}
+	return(NULL);
+}
+
+/*
+@returns index of the first particle with an id not less than id
+*/
+static unsigned int ptp_sender_lower_bound(const ptp_sender_keyframe_t *kf,
+		unsigned int id) {
+	unsigned int lo = 0;
+	unsigned int hi = kf->count;
+	while(lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+		if(kf->data[mid].id < id) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return(lo);
+}
+
+/*
+Resend what a client's pending NACK asks for, as far as the retransmit
+budget allows.  Retransmissions are flushed through the live bucket as well,
+so the total output rate is unchanged and at most the retransmit share of it
+goes to old data.
+*/
+static void ptp_sender_retransmit(ptp_sender_t *s, ptp_sender_client_t *c) {
+	ptp_sender_keyframe_t *kf;
+	ptp_packet_t *p = NULL;
+	unsigned char flags = PTP_FLAG_KEYFRAME | PTP_FLAG_RETRANSMIT;
+
+	if(c->nack_next >= c->nack_count) {
+		return;
+	}
+	if((kf = ptp_sender_keyframe_for(s, c->nack_model_id, c->nack_t)) == NULL) {
+		/* no longer in history, nothing we can do */
+		c->nack_count = 0;
+		return;
+	}
+	ptp_bucket_refill(&s->retransmit_pacing);
+	while(c->nack_next < c->nack_count) {
+		ptp_nack_range_t *r = &c->nack[c->nack_next];
+		unsigned int first = r->first_id + c->nack_offset;
+		unsigned int end = r->first_id + r->count;
+		unsigned int i;
+
+		for(i = ptp_sender_lower_bound(kf, first); i < kf->count &&
+				kf->data[i].id < end; i++) {
+			ptp_particle_data_t *d = &kf->data[i];
+			if(p == NULL || p->particle_count == PTP_PARTICLES_PER_PACKET) {
+				if(s->retransmit_pacing.rate > 0.0 &&
+						s->retransmit_pacing.tokens < (double)sizeof(ptp_packet_t)) {
+					/* out of budget, resume from here next time */
+					c->nack_offset = d->id - r->first_id;
+					ptp_sender_flush(s);
+					return;
+				}
+				s->retransmit_pacing.tokens -= sizeof(ptp_packet_t);
+				s->retransmits_sent++;
+				p = ptp_sender_queue(s, c);
+				ptp_sender_header(p, kf->model_id, kf->t, kf->world_origin,
+					kf->world_size, kf->total_particle_count, flags);
+			}
+			p->data[p->particle_count++] = *d;
+		}
+		c->nack_next++;
+		c->nack_offset = 0;
+	}
+	ptp_sender_flush(s);
+}
+
+/*
+Open a sender.
+
+@param	s	sender
+@param	host	local address to bind, or NULL for all
+@param	port	local port, where heartbeats arrive
+@param	client_port	port clients receive data on
+
+@returns 0 on success, -1 on error
+*/
+int ptp_sender_open(ptp_sender_t *s, const char *host, uint16_t port,
+		uint16_t client_port) {
+	struct addrinfo hints;
+	struct addrinfo *res;
+	char port_as_string[16];
+	int optval = 1;
+	int gso_size = sizeof(ptp_packet_t);
+	int sndbuf = 4 * 1024 * 1024;
+	int err;
+
+	memset(s, 0, sizeof(ptp_sender_t));
+	s->fd = -1;
+	s->client_port = client_port;
+
+	memset(&hints, 0, sizeof hints);
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	hints.ai_flags = AI_PASSIVE;
+	sprintf(port_as_string, "%i", port);
+	if((err = getaddrinfo(host, port_as_string, &hints, &res))) {
+		fprintf(stderr, "getaddrinfo: %s\n", gai_strerror(err));
+		return(-1);
+	}
+	if((s->fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol)) == -1) {
+		perror("socket");
+		freeaddrinfo(res);
+		return(-1);
+	}
+	if(setsockopt(s->fd, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof optval) == -1) {
+		perror("setsockopt(SO_REUSEADDR)");
+	}
+	if(bind(s->fd, res->ai_addr, res->ai_addrlen) == -1) {
+		perror("bind");
+		freeaddrinfo(res);
+		ptp_sender_close(s);
+		return(-1);
+	}
+	freeaddrinfo(res);
+
+	/* best effort, a large send buffer keeps sendmmsg() from blocking */
+	(void)setsockopt(s->fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof sndbuf);
+
+	/* probe for UDP segmentation offload, we set it per message */
+	s->use_gso = (setsockopt(s->fd, SOL_UDP, UDP_SEGMENT, &gso_size,
+		sizeof gso_size) == 0);
+	if(s->use_gso) {
+		gso_size = 0;
+		(void)setsockopt(s->fd, SOL_UDP, UDP_SEGMENT, &gso_size, sizeof gso_size);
+	}
+
+	if((s->batch = (ptp_packet_t*)malloc(PTP_SENDER_BATCH *
+			sizeof(ptp_packet_t))) == NULL) {
+		perror("ptp_sender_open");
+		ptp_sender_close(s);
+		return(-1);
+	}
+	ptp_sender_set_rate(s, 0.0, 0.0);
+	return(0);
+}
+
+/*
+Set the output rate.  The retransmit rate follows as
+PTP_SENDER_RETRANSMIT_SHARE of it.
+
+@param	s	sender
+@param	bytes_per_second	rate, 0 for unlimited
+@param	burst_bytes	bucket depth, 0 for one batch
+*/
+void ptp_sender_set_rate(ptp_sender_t *s, double bytes_per_second,
+		double burst_bytes) {
+	if(burst_bytes <= 0.0) {
+		burst_bytes = (double)PTP_SENDER_BATCH * sizeof(ptp_packet_t);
+	}
+	ptp_bucket_init(&s->pacing, bytes_per_second, burst_bytes);
+	ptp_sender_set_retransmit_rate(s, bytes_per_second > 0.0 ?
+		bytes_per_second * PTP_SENDER_RETRANSMIT_SHARE :
+		PTP_SENDER_RETRANSMIT_RATE);
+}
+
+/*
+Set the retransmit rate in bytes per second.
+*/
+void ptp_sender_set_retransmit_rate(ptp_sender_t *s, double bytes_per_second) {
+	ptp_bucket_init(&s->retransmit_pacing, bytes_per_second,
+		(double)PTP_SENDER_BATCH * sizeof(ptp_packet_t));
+}
+
+/*
+Read pending heartbeats, expire silent clients and answer NACKs.  Never
+blocks on input.
+
+@returns number of heartbeats read
+*/
+int ptp_sender_poll(ptp_sender_t *s) {
+	unsigned char buf[sizeof(ptp_heartbeat_packet_t)];
+	int heartbeats = 0;
+	time_t now;
+	int i;
+
+	for(;;) {
+		struct sockaddr_storage from;
+		socklen_t from_len = sizeof(from);
+		ptp_sender_client_t *c;
+		ssize_t len = recvfrom(s->fd, buf, sizeof(buf), MSG_DONTWAIT,
+			(struct sockaddr*)&from, &from_len);
+		if(len < 0) {
+			if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+				perror("heartbeat recvfrom");
+			}
+			break;
+		}
+		if((c = ptp_sender_client_for(s, &from, from_len)) != NULL) {
+			ptp_sender_heartbeat(s, c, buf, len);
+		}
+		heartbeats++;
+	}
+
+	time(&now);
+	for(i = 0; i < PTP_SENDER_MAX_CLIENTS; i++) {
+		ptp_sender_client_t *c = &s->clients[i];
+		if(!c->used) {
+			continue;
+		}
+		if(difftime(now, c->last_heartbeat) > PTP_SENDER_CLIENT_TTL_S) {
+			c->used = 0;
+			continue;
+		}
+		ptp_sender_retransmit(s, c);
+	}
+	return(heartbeats);
+}
+
+/*
+Publish one step to every subscribed client.  Each client gets the full
+field when the step is a multiple of its full stride, otherwise its tracked
+types when the step is a multiple of its tracked stride.  Low-rate full
+refreshes are flagged as keyframes and kept for retransmission.
+
+@param	s	sender
+@param	frame	particle data
+
+@returns number of clients sent to, -1 on error
+*/
+int ptp_sender_publish(ptp_sender_t *s, const ptp_sender_frame_t *frame) {
+	int keep = frame->flags & PTP_FLAG_KEYFRAME;
+	int sent = 0;
+	int i;
+
+	ptp_sender_poll(s);
+	for(i = 0; i < PTP_SENDER_MAX_CLIENTS; i++) {
+		ptp_sender_client_t *c = &s->clients[i];
+		ptp_packet_t *p = NULL;
+		unsigned char flags;
+		unsigned int j;
+		int full;
+		int tracked;
+
+		if(!c->used) {
+			continue;
+		}
+		full = c->full_stride && (frame->step % c->full_stride) == 0;
+		tracked = !full && c->tracked_stride && c->tracked_types &&
+			(frame->step % c->tracked_stride) == 0;
+		if(!full && !tracked) {
+			continue;
+		}
+		if(full) {
+			flags = frame->flags & PTP_FLAG_KEYFRAME;
+			if(c->full_stride > 1) {
+				flags |= PTP_FLAG_KEYFRAME;
+			}
+			keep |= flags;
+		} else {
+			flags = PTP_FLAG_SUBSET;
+		}
+		for(j = 0; j < frame->count; j++) {
+			ptp_particle_data_t *d;
+			if(tracked && !(c->tracked_types & PTP_TYPE_BIT(frame->types[j]))) {
+				continue;
+			}
+			if(p == NULL || p->particle_count == PTP_PARTICLES_PER_PACKET) {
+				p = ptp_sender_queue(s, c);
+				ptp_sender_header(p, frame->model_id, frame->t,
+					frame->world_origin, frame->world_size,
+					frame->total_particle_count, flags);
+			}
+			d = &p->data[p->particle_count++];
+			d->id = frame->ids ? frame->ids[j] : j;
+			memcpy(d->position, &frame->pos[4 * j], sizeof(d->position));
+			d->particle_type = frame->types[j];
+		}
+		if(ptp_sender_flush(s)) {
+			return(-1);
+		}
+		sent++;
+	}
+	if(keep) {
+		ptp_sender_keep(s, frame);
+	}
+	return(sent);
+}
+
+/*
+@returns number of subscribed clients
+*/
+int ptp_sender_client_count(ptp_sender_t *s) {
+	int i;
+	int n = 0;
+	for(i = 0; i < PTP_SENDER_MAX_CLIENTS; i++) {
+		n += s->clients[i].used;
+	}
+	return(n);
+}
+
+/*
+Close a sender and release its memory.
+*/
+void ptp_sender_close(ptp_sender_t *s) {
+	int i;
+	if(s->fd != -1) {
+		close(s->fd);
+		s->fd = -1;
+	}
+	for(i = 0; i < PTP_SENDER_HISTORY; i++) {
+		free(s->history[i].data);
+		s->history[i].data = NULL;
+		s->history[i].used = 0;
+	}
+	free(s->batch);
+	s->batch = NULL;
+}
@@ -0,0 +1,167 @@
+/*
+ * ptp_sender.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Reference PTP sender.  A simulation opens a sender on the server port,
+ * publishes its particle arrays once per step and polls in between.  The
+ * sender tracks clients by their heartbeats, honors their subscriptions,
+ * paces output with a token bucket and answers NACKs from a short history
+ * of keyframes.
+ */
+
+#ifndef PTP_SENDER_H_
+#define PTP_SENDER_H_
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <stdint.h>
+#include <time.h>
+#include "ptp.h"
+
+/* maximum number of simultaneous clients */
+#define PTP_SENDER_MAX_CLIENTS 16
+/* packets queued before a flush, one sendmmsg() call */
+#define PTP_SENDER_BATCH 64
+/* packets per UDP_SEGMENT (GSO) super-datagram, must stay under 64KB */
+#define PTP_SENDER_GSO_SEGMENTS 40
+/* number of keyframes kept for retransmission */
+#define PTP_SENDER_HISTORY 2
+/* clients are dropped after this long without a heartbeat */
+#define PTP_SENDER_CLIENT_TTL_S (3 * PTP_HEARTBEAT_TTL_S)
+/* retransmit rate when output is not paced, bytes per second */
+#define PTP_SENDER_RETRANSMIT_RATE 12500000.0
+/* share of the paced rate available to retransmissions */
+#define PTP_SENDER_RETRANSMIT_SHARE 0.1
+
+/*
+Token bucket.  A rate of 0 means unlimited.
+*/
+typedef struct {
+	/* bytes per second */
+	double rate;
+	/* bucket depth in bytes */
+	double burst;
+	/* bytes currently available, may go negative */
+	double tokens;
+	/* last refill */
+	struct timespec last;
+} ptp_token_bucket_t;
+
+/*
+A subscribed client.
+*/
+typedef struct {
+	/* non-zero if slot is in use */
+	int used;
+	/* where data is sent */
+	struct sockaddr_storage address;
+	socklen_t address_len;
+	/* source port of its heartbeats, network order; with the host it tells
+	clients apart */
+	uint16_t heartbeat_port;
+	/* last heartbeat received */
+	time_t last_heartbeat;
+	/* subscription, see ptp_heartbeat_packet_t */
+	unsigned int tracked_types;
+	unsigned short tracked_stride;
+	unsigned short full_stride;
+	/* pending NACK and how far through it we are */
+	pid_t nack_model_id;
+	float nack_t;
+	unsigned short nack_count;
+	unsigned short nack_next;
+	unsigned int nack_offset;
+	ptp_nack_range_t nack[PTP_NACK_MAX_RANGES];
+} ptp_sender_client_t;
+
+/*
+A keyframe kept for retransmission.
+*/
+typedef struct {
+	int used;
+	pid_t model_id;
+	float t;
+	float world_origin[3];
+	float world_size[3];
+	unsigned int total_particle_count;
+	/* particles in ascending id order, sorted as kept */
+	unsigned int count;
+	unsigned int capacity;
+	ptp_particle_data_t *data;
+} ptp_sender_keyframe_t;
+
+/*
+One step of particle data to publish.
+*/
+typedef struct {
+	/* model id, a change tells clients to reallocate */
+	pid_t model_id;
+	/* simulation step, used for subscription strides */
+	unsigned int step;
+	/* simulation time */
+	float t;
+	float world_origin[3];
+	float world_size[3];
+	/* number of particles in the model */
+	unsigned int total_particle_count;
+	/* number of particles in the arrays below */
+	unsigned int count;
+	/* particle ids, or NULL for 0..count-1 */
+	const unsigned int *ids;
+	/* positions, 4 doubles per particle */
+	const double *pos;
+	/* particle types */
+	const short *types;
+	/* PTP_FLAG_KEYFRAME forces the step to be kept for retransmission */
+	unsigned char flags;
+} ptp_sender_frame_t;
+
+/*
+Sender state.
+*/
+typedef struct {
+	/* socket, bound to the server (heartbeat) port */
+	int fd;
+	/* port clients receive data on */
+	uint16_t client_port;
+	/* non-zero while UDP_SEGMENT is usable */
+	int use_gso;
+	/* live data pacing */
+	ptp_token_bucket_t pacing;
+	/* retransmission pacing */
+	ptp_token_bucket_t retransmit_pacing;
+	/* subscribed clients */
+	ptp_sender_client_t clients[PTP_SENDER_MAX_CLIENTS];
+	/* keyframe history ring */
+	ptp_sender_keyframe_t history[PTP_SENDER_HISTORY];
+	int history_next;
+	/* queued packets and their destination */
+	ptp_packet_t *batch;
+	unsigned int batch_count;
+	ptp_sender_client_t *batch_client;
+	/* optional hook run on each batch before it is sent, may drop or
+	reorder packets by rewriting batch and count */
+	void (*batch_hook)(void *user, ptp_packet_t *batch, unsigned int *count);
+	void *batch_hook_user;
+	/* statistics */
+	unsigned long long packets_sent;
+	unsigned long long bytes_sent;
+	unsigned long long particles_sent;
+	unsigned long long retransmits_sent;
+	unsigned long long send_calls;
+	unsigned long long heartbeats_received;
+	unsigned long long nacks_received;
+} ptp_sender_t;
+
+int ptp_sender_open(ptp_sender_t *s, const char *host, uint16_t port,
+		uint16_t client_port);
+void ptp_sender_set_rate(ptp_sender_t *s, double bytes_per_second,
+		double burst_bytes);
+void ptp_sender_set_retransmit_rate(ptp_sender_t *s, double bytes_per_second);
+int ptp_sender_poll(ptp_sender_t *s);
+int ptp_sender_publish(ptp_sender_t *s, const ptp_sender_frame_t *frame);
+int ptp_sender_client_count(ptp_sender_t *s);
+void ptp_sender_close(ptp_sender_t *s);
+
+#endif /* PTP_SENDER_H_ */
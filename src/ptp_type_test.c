@@ -0,0 +1,75 @@
+/*
+ * ptp_type_test.c
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Checks that combined particle types, a primary type plus flags, land in
+ * the same bucket on both sides: the sender's subscription filter
+ * (PTP_TYPE_BIT) and the client's type partition (store_type_code).
+ * Exits non-zero on the first mismatch.  Run by "make check".
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "ptp.h"
+#include "store.h"
+
+/* wire types of the primary types, in store_type_t order */
+static const short primary_types[] = { 0, 16, 32, 48, 64, 80, 96 };
+
+/* Local prototypes */
+static int check(short particle_type, uint8_t code, unsigned int bit);
+
+/*
+@returns 0 if particle_type maps to code and subscription bit, else 1
+*/
+static int check(short particle_type, uint8_t code, unsigned int bit) {
+	if(store_type_code(particle_type) != code ||
+			PTP_TYPE_BIT(particle_type) != bit) {
+		fprintf(stderr, "type %i: code %u bit 0x%x, expected code %u bit 0x%x\n",
+			particle_type, store_type_code(particle_type),
+			PTP_TYPE_BIT(particle_type), code, bit);
+		return(1);
+	}
+	return(0);
+}
+
+int main(void) {
+	unsigned int surface = 1u << PTP_TYPE_SURFACE_BUCKET;
+	int failed = 0;
+	unsigned int i;
+
+	for(i = 0; i < sizeof(primary_types) / sizeof(primary_types[0]); i++) {
+		short type = primary_types[i];
+		unsigned int bit = 1u << i;
+
+		/* plain primary types */
+		failed |= check(type, (uint8_t)i, bit);
+		if(i == STORE_TYPE_FLUID) {
+			/* fluid on the surface has its own bucket */
+			failed |= check(type | PTP_TYPE_SURFACE_FLAG, STORE_TYPE_SURFACE,
+				surface);
+			failed |= check(type | PTP_TYPE_SURFACE_FLAG | 512,
+				STORE_TYPE_SURFACE, surface);
+		} else {
+			/* anything else keeps its primary type whatever the flags */
+			failed |= check(type | PTP_TYPE_SURFACE_FLAG, (uint8_t)i, bit);
+			failed |= check(type | 512, (uint8_t)i, bit);
+			failed |= check(type | PTP_TYPE_SURFACE_FLAG | 1024, (uint8_t)i,
+				bit);
+		}
+	}
+
+	/* unknown primary types subscribe by their own bit but store as other */
+	failed |= check(112, STORE_TYPE_OTHER, 1u << 7);
+	failed |= check(112 | PTP_TYPE_SURFACE_FLAG, STORE_TYPE_OTHER, 1u << 7);
+	if(store_type_code(17) != STORE_TYPE_OTHER ||
+			store_type_code(-16) != STORE_TYPE_OTHER) {
+		fprintf(stderr, "malformed types are not STORE_TYPE_OTHER\n");
+		failed = 1;
+	}
+
+	printf("ptp_type_test: %s\n", failed ? "FAILED" : "ok");
+	return(failed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -0,0 +1,103 @@
+/*
+ * redraw.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include "redraw.h"
+
+/* names of redraw_reason_t values */
+static const char *g_redraw_reason_names[REDRAW_REASON_COUNT] = {
+	"data", "input", "resize", "animation"
+};
+
+/*
+Initialize with a first frame pending.
+
+@returns 0 on success, -1 on error
+*/
+int redraw_init(redraw_t *r) {
+	int err;
+
+	memset(r, 0, sizeof(redraw_t));
+	if((err = pthread_mutex_init(&r->lock, NULL)) ||
+			(err = pthread_cond_init(&r->posted, NULL))) {
+		fprintf(stderr, "redraw_init: %s\n", strerror(err));
+		return(-1);
+	}
+	r->pending = 1U << REDRAW_RESIZE;
+	return(0);
+}
+
+/*
+Release.
+*/
+void redraw_free(redraw_t *r) {
+	pthread_cond_destroy(&r->posted);
+	pthread_mutex_destroy(&r->lock);
+}
+
+/*
+Ask for a frame.  Any thread.
+
+@param	r	redraw state
+@param	reason	redraw_reason_t
+*/
+void redraw_post(redraw_t *r, int reason) {
+	pthread_mutex_lock(&r->lock);
+	r->pending |= 1U << reason;
+	pthread_cond_signal(&r->posted);
+	pthread_mutex_unlock(&r->lock);
+}
+
+/*
+Wait for reasons to draw, and take them.  Render thread.
+
+@param	r	redraw state
+@param	timeout	seconds to wait at most
+
+@returns bit per redraw_reason_t posted, 0 on timeout
+*/
+unsigned int redraw_wait(redraw_t *r, double timeout) {
+	struct timespec deadline;
+	unsigned int reasons;
+	int i;
+
+	/* condition variables time out against the realtime clock */
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += (time_t)timeout;
+	deadline.tv_nsec += (long)((timeout - (time_t)timeout) * 1e9);
+	if(deadline.tv_nsec >= 1000000000L) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+	pthread_mutex_lock(&r->lock);
+	while(r->pending == 0) {
+		if(pthread_cond_timedwait(&r->posted, &r->lock, &deadline) == ETIMEDOUT) {
+			break;
+		}
+	}
+	reasons = r->pending;
+	r->pending = 0;
+	pthread_mutex_unlock(&r->lock);
+
+	if(reasons == 0) {
+		r->idle_wakeups++;
+	}
+	for(i = 0; i < REDRAW_REASON_COUNT; i++) {
+		r->frames[i] += (reasons >> i) & 1;
+	}
+	return(reasons);
+}
+
+/*
+@returns name of a redraw_reason_t
+*/
+const char *redraw_reason_name(int reason) {
+	return(reason >= 0 && reason < REDRAW_REASON_COUNT ?
+		g_redraw_reason_names[reason] : "unknown");
+}
@@ -0,0 +1,47 @@
+/*
+ * redraw.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Reasons to draw a frame.  Any thread posts a reason (a published
+ * timestep, input, a resize, an animation running) and the render loop
+ * sleeps on a condition variable until one arrives, so an idle viewer
+ * draws nothing.  Reasons posted while a frame is drawn are kept for the
+ * next one.
+ */
+
+#ifndef REDRAW_H_
+#define REDRAW_H_
+
+#include <pthread.h>
+
+/* reasons, one bit each */
+typedef enum {
+	REDRAW_DATA,
+	REDRAW_INPUT,
+	REDRAW_RESIZE,
+	REDRAW_ANIMATION,
+	REDRAW_REASON_COUNT
+} redraw_reason_t;
+
+/*
+Pending reasons and counts.
+*/
+typedef struct {
+	/* guards pending */
+	pthread_mutex_t lock;
+	pthread_cond_t posted;
+	/* bit per redraw_reason_t */
+	unsigned int pending;
+	/* frames each reason was part of, waits that ended with none */
+	unsigned long long frames[REDRAW_REASON_COUNT];
+	unsigned long long idle_wakeups;
+} redraw_t;
+
+int redraw_init(redraw_t *r);
+void redraw_free(redraw_t *r);
+void redraw_post(redraw_t *r, int reason);
+unsigned int redraw_wait(redraw_t *r, double timeout);
+const char *redraw_reason_name(int reason);
+
+#endif /* REDRAW_H_ */
@@ -0,0 +1,249 @@
+/*
+ * render.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/* GL 1.4 multi-draw entry point */
+#define GL_GLEXT_PROTOTYPES 1
+
+#include <stdio.h>
+#include <string.h>
+#include "render.h"
+
+/* names of render_mode_t values */
+static const char *g_render_mode_names[RENDER_MODE_COUNT] = {
+	"immediate", "arrays", "vbo", "stream"
+};
+
+/* locals */
+static void render_immediate(const store_t *s, const sprite_t *sp,
+		cull_t *cull, unsigned int hidden_types);
+static void render_lod_immediate(const store_t *s, const sprite_t *sp,
+		const lod_t *lod);
+static void render_arrays(const unsigned int *type_start,
+		const GLvoid *vertices, const sprite_t *sp, cull_t *cull,
+		uint32_t colored_types, unsigned int hidden_types);
+static void render_lod_arrays(const GLvoid *vertices, const sprite_t *sp,
+		const lod_t *lod, uint32_t colored_types);
+
+/*
+Draw with a glColor/glVertex pair per particle, as spheres if sp is not
+NULL, only chunks found visible if cull is not NULL.
+*/
+static void render_immediate(const store_t *s, const sprite_t *sp,
+		cull_t *cull, unsigned int hidden_types) {
+	unsigned int slot;
+	GLsizei runs, run;
+	int i;
+
+	for(i = 0; i < STORE_TYPE_COUNT; i++) {
+		if(hidden_types & (1 << i)) {
+			continue;
+		}
+		runs = cull != NULL ? cull_ranges(cull, s->type_start[i],
+			s->type_start[i + 1]) : 1;
+		if(sp != NULL) {
+			sprite_type(sp, i, s->colored_types & (1U << i));
+		}
+		glBegin(GL_POINTS);
+		for(run = 0; run < runs; run++) {
+			unsigned int begin = cull != NULL ? (unsigned int)cull->first[run] :
+				s->type_start[i];
+			unsigned int end = cull != NULL ? begin + cull->length[run] :
+				s->type_start[i + 1];
+			for(slot = begin; slot < end; slot++) {
+				glColor4ubv(s->vertex[slot].rgba);
+				glVertex3fv(s->vertex[slot].pos);
+			}
+		}
+		glEnd();
+	}
+}
+
+/*
+Draw the nodes chosen by lod_select() with a glColor/glVertex pair per
+particle, hidden types were left out by the selection.
+*/
+static void render_lod_immediate(const store_t *s, const sprite_t *sp,
+		const lod_t *lod) {
+	unsigned int run, slot, i;
+	int t;
+
+	for(t = 0; t < STORE_TYPE_COUNT; t++) {
+		if(lod->run_start[t] == lod->run_start[t + 1] &&
+				lod->index_start[t] == lod->index_start[t + 1]) {
+			continue;
+		}
+		if(sp != NULL) {
+			sprite_type(sp, t, s->colored_types & (1U << t));
+		}
+		glBegin(GL_POINTS);
+		for(run = lod->run_start[t]; run < lod->run_start[t + 1]; run++) {
+			for(slot = lod->first[run];
+					slot < (unsigned int)(lod->first[run] + lod->length[run]);
+					slot++) {
+				glColor4ubv(s->vertex[slot].rgba);
+				glVertex3fv(s->vertex[slot].pos);
+			}
+		}
+		for(i = lod->index_start[t]; i < lod->index_start[t + 1]; i++) {
+			slot = lod->indices[i];
+			glColor4ubv(s->vertex[slot].rgba);
+			glVertex3fv(s->vertex[slot].pos);
+		}
+		glEnd();
+	}
+}
+
+/*
+Draw one range per visible type from interleaved vertices, either client
+memory or an offset into the bound buffer object, as spheres if sp is not
+NULL.  If cull is not NULL each type draws its visible chunks instead, with
+one glMultiDrawArrays.
+*/
+static void render_arrays(const unsigned int *type_start,
+		const GLvoid *vertices, const sprite_t *sp, cull_t *cull,
+		uint32_t colored_types, unsigned int hidden_types) {
+	GLsizei runs;
+	int i;
+
+	glInterleavedArrays(GL_C4UB_V3F, 0, vertices);
+	for(i = 0; i < STORE_TYPE_COUNT; i++) {
+		unsigned int count = type_start[i + 1] - type_start[i];
+		if(count == 0 || (hidden_types & (1 << i))) {
+			continue;
+		}
+		runs = cull != NULL ? cull_ranges(cull, type_start[i],
+			type_start[i + 1]) : 1;
+		if(runs == 0) {
+			continue;
+		}
+		if(sp != NULL) {
+			sprite_type(sp, i, colored_types & (1U << i));
+		}
+		if(cull != NULL) {
+			glMultiDrawArrays(GL_POINTS, cull->first, cull->length, runs);
+		} else {
+			glDrawArrays(GL_POINTS, type_start[i], count);
+		}
+	}
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+/*
+Draw the nodes chosen by lod_select() from interleaved vertices, client
+memory or an offset into the bound buffer object.  Each type draws its
+whole nodes with one glMultiDrawArrays and its subsamples with one
+glDrawElements.
+*/
+static void render_lod_arrays(const GLvoid *vertices, const sprite_t *sp,
+		const lod_t *lod, uint32_t colored_types) {
+	GLsizei runs, samples;
+	int t;
+
+	glInterleavedArrays(GL_C4UB_V3F, 0, vertices);
+	for(t = 0; t < STORE_TYPE_COUNT; t++) {
+		runs = (GLsizei)(lod->run_start[t + 1] - lod->run_start[t]);
+		samples = (GLsizei)(lod->index_start[t + 1] - lod->index_start[t]);
+		if(runs == 0 && samples == 0) {
+			continue;
+		}
+		if(sp != NULL) {
+			sprite_type(sp, t, colored_types & (1U << t));
+		}
+		if(runs > 0) {
+			glMultiDrawArrays(GL_POINTS, &lod->first[lod->run_start[t]],
+				&lod->length[lod->run_start[t]], runs);
+		}
+		if(samples > 0) {
+			glDrawElements(GL_POINTS, samples, GL_UNSIGNED_INT,
+				&lod->indices[lod->index_start[t]]);
+		}
+	}
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+/*
+@returns render_mode_t for name, -1 if unknown
+*/
+int render_mode_code(const char *name) {
+	int i;
+	for(i = 0; i < RENDER_MODE_COUNT; i++) {
+		if(!strcmp(name, g_render_mode_names[i])) {
+			return(i);
+		}
+	}
+	return(-1);
+}
+
+/*
+@returns name of a render_mode_t
+*/
+const char *render_mode_name(int mode) {
+	return(mode >= 0 && mode < RENDER_MODE_COUNT ?
+		g_render_mode_names[mode] : "unknown");
+}
+
+/*
+Draw the store's particles, except hidden types.  Streaming falls back to a
+buffer object for a store not in the ring or before its first publish,
+which falls back to client arrays if buffer objects are unavailable.
+
+@param	v	buffer object, brought up to date in RENDER_VBO mode
+@param	st	streaming ring
+@param	sp	sprites begun with sprite_begin(), NULL to draw points
+@param	cull	chunks tested by cull_frustum(), NULL to draw all
+@param	lod	nodes chosen by lod_select(), NULL to draw by cull instead
+@param	s	store
+@param	mode	render_mode_t wanted
+@param	hidden_types	bit per store_type_t not to draw
+
+@returns render_mode_t used
+*/
+int render_particles(vbo_t *v, stream_t *st, const sprite_t *sp,
+		cull_t *cull, const lod_t *lod, store_t *s, int mode,
+		unsigned int hidden_types) {
+	int buffer;
+
+	if(mode == RENDER_STREAM) {
+		if(st->store == s && (buffer = stream_claim(st)) >= 0) {
+			if(lod != NULL) {
+				render_lod_arrays(NULL, sp, lod, s->colored_types);
+			} else {
+				render_arrays(st->type_start[buffer], NULL, sp, cull,
+					s->colored_types, hidden_types);
+			}
+			stream_release(st, buffer);
+			return(RENDER_STREAM);
+		}
+		mode = RENDER_VBO;
+	}
+	if(mode == RENDER_VBO && vbo_update(v, s) == 0) {
+		if(lod != NULL) {
+			render_lod_arrays(NULL, sp, lod, s->colored_types);
+		} else {
+			render_arrays(s->type_start, NULL, sp, cull, s->colored_types,
+				hidden_types);
+		}
+		vbo_unbind(v);
+		return(RENDER_VBO);
+	}
+	if(mode == RENDER_IMMEDIATE) {
+		if(lod != NULL) {
+			render_lod_immediate(s, sp, lod);
+		} else {
+			render_immediate(s, sp, cull, hidden_types);
+		}
+		return(RENDER_IMMEDIATE);
+	}
+	if(lod != NULL) {
+		render_lod_arrays(s->vertex, sp, lod, s->colored_types);
+	} else {
+		render_arrays(s->type_start, s->vertex, sp, cull, s->colored_types,
+			hidden_types);
+	}
+	return(RENDER_ARRAYS);
+}
@@ -0,0 +1,43 @@
+/*
+ * render.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Particle drawing.  The store's vertices are drawn with one glDrawArrays
+ * per visible type range, from a buffer object kept current by vbo.h or,
+ * where buffer objects are missing, from client memory.  Streaming draws
+ * from the ring of stream.h, which the publish thread fills directly.  Any
+ * mode draws points, or spheres between sprite_begin() and sprite_end(),
+ * and may skip chunks outside the view found by cull.h, or draw only the
+ * octree nodes chosen by lod.h, whole or by subsample.  Immediate mode
+ * (a glVertex call per particle) remains as a last resort and for
+ * comparison, see render_bench.
+ */
+
+#ifndef RENDER_H_
+#define RENDER_H_
+
+#include "GL/glfw.h"
+#include "store.h"
+#include "vbo.h"
+#include "stream.h"
+#include "sprite.h"
+#include "cull.h"
+#include "lod.h"
+
+/* how particles reach GL, best last */
+typedef enum {
+	RENDER_IMMEDIATE,
+	RENDER_ARRAYS,
+	RENDER_VBO,
+	RENDER_STREAM,
+	RENDER_MODE_COUNT
+} render_mode_t;
+
+int render_mode_code(const char *name);
+const char *render_mode_name(int mode);
+int render_particles(vbo_t *v, stream_t *st, const sprite_t *sp,
+		cull_t *cull, const lod_t *lod, store_t *s, int mode,
+		unsigned int hidden_types);
+
+#endif /* RENDER_H_ */
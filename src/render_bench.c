@@ -0,0 +1,324 @@
+/*
+ * render_bench.c
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Particle drawing benchmark.  Renders a field of random particles into an
+ * offscreen EGL surface with each render mode, for particle counts growing
+ * tenfold up to the maximum, and reports frame times.  Between frames a
+ * share of the particles moves, as a live simulation does, so buffer object
+ * frames include their uploads.  Streaming frames do not: catching up
+ * buffers is part of publishing, on the data thread, and is timed apart.
+ * Zooming in draws part of the field; the particles are put in Morton order
+ * and chunks outside the view are culled, with the boxes rebuilt as part of
+ * publishing.  A point budget draws by octree level of detail instead, the
+ * tree likewise rebuilt as part of publishing.
+ * Run headless on Mesa with EGL_PLATFORM=surfaceless.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <EGL/egl.h>
+#include "store.h"
+#include "vbo.h"
+#include "render.h"
+#include "morton.h"
+
+/* offscreen surface size */
+#define BENCH_SIZE 512
+
+/* Local prototypes */
+static void bench_usage(void);
+static double bench_now(void);
+static double bench_random(unsigned long long *rng);
+static int bench_context(void);
+static void bench_move(store_t *store, unsigned long long *rng,
+		unsigned int moved, float t);
+static int bench_count(unsigned int particles, int frames, double moving,
+		float radius, float zoom, unsigned int budget);
+
+static void bench_usage(void) {
+	printf("usage: render_bench [ options ]\n\n");
+	printf("Options:\n\n");
+	printf("--particles -n <count>   Largest particle count, from 10000 up (1000000)\n");
+	printf("--frames -f <count>      Frames to time per mode (20)\n");
+	printf("--moving -m <pct>        Particles moved per frame (100)\n");
+	printf("--spheres -s <radius>    Draw spheres of a radius, 0 for points (0)\n");
+	printf("--zoom -z <factor>       Show 1/factor of the field, culling the rest (1)\n");
+	printf("--budget -b <count>      Draw by level of detail, at most count points (0)\n");
+}
+
+/*
+@returns monotonic time in seconds
+*/
+static double bench_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return(ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+/*
+@returns uniform random number in [0, 1), xorshift64*
+*/
+static double bench_random(unsigned long long *rng) {
+	*rng ^= *rng >> 12;
+	*rng ^= *rng << 25;
+	*rng ^= *rng >> 27;
+	return((double)((*rng * 2685821657736338717ULL) >> 11) / 9007199254740992.0);
+}
+
+/*
+Make a desktop GL context current on an offscreen surface.
+
+@returns 0 on success, -1 on error
+*/
+static int bench_context(void) {
+	EGLint config_attributes[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+		EGL_DEPTH_SIZE, 16,
+		EGL_NONE
+	};
+	EGLint surface_attributes[] = {
+		EGL_WIDTH, BENCH_SIZE, EGL_HEIGHT, BENCH_SIZE, EGL_NONE
+	};
+	EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	EGLConfig config;
+	EGLSurface surface;
+	EGLContext context;
+	EGLint configs;
+
+	if(display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)) {
+		fprintf(stderr, "render_bench: no EGL display\n");
+		return(-1);
+	}
+	if(!eglChooseConfig(display, config_attributes, &config, 1, &configs) ||
+			configs < 1 || !eglBindAPI(EGL_OPENGL_API)) {
+		fprintf(stderr, "render_bench: no EGL config for desktop GL\n");
+		return(-1);
+	}
+	surface = eglCreatePbufferSurface(display, config, surface_attributes);
+	context = eglCreateContext(display, config, EGL_NO_CONTEXT, NULL);
+	if(surface == EGL_NO_SURFACE || context == EGL_NO_CONTEXT ||
+			!eglMakeCurrent(display, surface, surface, context)) {
+		fprintf(stderr, "render_bench: no EGL context (0x%x)\n", eglGetError());
+		return(-1);
+	}
+	return(0);
+}
+
+/*
+Move a contiguous run of moved particles, starting at a random one.
+*/
+static void bench_move(store_t *store, unsigned long long *rng,
+		unsigned int moved, float t) {
+	unsigned int first = (unsigned int)(bench_random(rng) * store->count);
+	unsigned int i;
+	for(i = 0; i < moved; i++) {
+		unsigned int id = (first + i) % store->count;
+		const float *p = store->vertex[store_slot(store, id)].pos;
+		store_set(store, id, t, p[0] + 0.01, p[2], p[1], STORE_TYPE_FLUID);
+	}
+}
+
+/*
+Time each render mode at one particle count.
+
+@returns 0 on success, -1 on error
+*/
+static int bench_count(unsigned int particles, int frames, double moving,
+		float radius, float zoom, unsigned int budget) {
+	static const float origin[3] = { -1.0f, -1.0f, -1.0f };
+	static const float size[3] = { 2.0f, 2.0f, 2.0f };
+	unsigned long long rng = 1;
+	unsigned int moved = (unsigned int)(particles * moving / 100.0);
+	store_palette_t palette;
+	store_t store;
+	vbo_t vbo;
+	stream_t stream;
+	sprite_t sprites;
+	sprite_t *sp = NULL;
+	parallel_t pool;
+	morton_t order;
+	cull_t culling;
+	cull_t *cull = NULL;
+	lod_t levels;
+	lod_t *lod = NULL;
+	double modelview[16];
+	double projection[16];
+	unsigned int id;
+	int mode, used, frame;
+
+	memset(&palette, 0, sizeof(palette));
+	palette.rgba[STORE_TYPE_FLUID][2] = 255;
+	palette.rgba[STORE_TYPE_FLUID][3] = 255;
+	if(store_init(&store, particles, &palette)) {
+		return(-1);
+	}
+	for(id = 0; id < particles; id++) {
+		store_set(&store, id, 0.0f, bench_random(&rng) * 2.0 - 1.0,
+			bench_random(&rng) * 2.0 - 1.0, bench_random(&rng) * 2.0 - 1.0,
+			STORE_TYPE_FLUID);
+	}
+	/* spatial order gives chunks small boxes */
+	if(parallel_init(&pool, 0)) {
+		return(-1);
+	}
+	morton_init(&order, 1);
+	cull_init(&culling, zoom > 1.0f && budget == 0);
+	lod_init(&levels, budget > 0, budget, budget);
+	if(culling.enabled || levels.enabled) {
+		(void)morton_order(&order, &store, &pool, origin, size, NULL);
+		glGetDoublev(GL_MODELVIEW_MATRIX, modelview);
+		glGetDoublev(GL_PROJECTION_MATRIX, projection);
+	}
+	vbo_init(&vbo);
+	stream_init(&stream);
+	sprite_init(&sprites);
+	if(radius > 0.0f) {
+		sprite_palette(&sprites, &palette);
+		if(sprite_begin(&sprites, radius, BENCH_SIZE) == 0) {
+			sp = &sprites;
+		}
+	}
+
+	for(mode = 0; mode < RENDER_MODE_COUNT; mode++) {
+		double draw_s = 0.0;
+		double publish_s = 0.0;
+		double start;
+		if(mode == RENDER_STREAM) {
+			(void)stream_attach(&stream, &store);
+		}
+		/* one untimed frame, a buffer object's first upload is a full one */
+		(void)cull_bounds(&culling, &store, &pool);
+		(void)lod_build(&levels, &store, &order, &pool);
+		used = render_particles(&vbo, &stream, sp, NULL, NULL, &store, mode, 0);
+		glFinish();
+		for(frame = 1; frame <= frames; frame++) {
+			bench_move(&store, &rng, moved, (float)frame);
+			/* the data thread's share of streaming */
+			start = bench_now();
+			(void)cull_bounds(&culling, &store, &pool);
+			(void)lod_build(&levels, &store, &order, &pool);
+			stream_publish(&stream, &store);
+			publish_s += bench_now() - start;
+			start = bench_now();
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			cull = culling.enabled && cull_frustum(&culling, &store, &pool,
+				modelview, projection, radius) == 0 ? &culling : NULL;
+			lod = levels.enabled && lod_select(&levels, &store, modelview,
+				projection, BENCH_SIZE, radius, 0) == 0 ? &levels : NULL;
+			used = render_particles(&vbo, &stream, sp, cull, lod, &store, mode,
+				0);
+			glFinish();
+			draw_s += bench_now() - start;
+		}
+		stream_detach(&stream, &store);
+		if(glGetError() != GL_NO_ERROR) {
+			fprintf(stderr, "render_bench: GL error in %s mode\n",
+				render_mode_name(mode));
+		}
+		printf("%9u %-10s frame(%8.2fms %7.1fM particles/s) publish(%6.2fms) submitted(%5.1f%%)%s%s\n",
+			particles, render_mode_name(mode), draw_s * 1000.0 / frames,
+			particles * frames / draw_s / 1e6, publish_s * 1000.0 / frames,
+			lod != NULL ? 100.0 * levels.last_points / particles :
+			cull != NULL ? 100.0 * culling.last_submitted / particles : 100.0,
+			used != mode ? " fell back to " : "",
+			used != mode ? render_mode_name(used) : "");
+	}
+
+	if(sp != NULL) {
+		sprite_end(sp);
+	}
+	sprite_free(&sprites);
+	stream_free(&stream);
+	vbo_free(&vbo);
+	cull_free(&culling);
+	lod_free(&levels);
+	morton_free(&order);
+	parallel_free(&pool);
+	store_free(&store);
+	return(0);
+}
+
+int main(int argc, char *argv[]) {
+	static struct option long_options[] = {
+		{ "particles", required_argument, 0, 'n' },
+		{ "frames", required_argument, 0, 'f' },
+		{ "moving", required_argument, 0, 'm' },
+		{ "spheres", required_argument, 0, 's' },
+		{ "zoom", required_argument, 0, 'z' },
+		{ "budget", required_argument, 0, 'b' },
+		{ "help", no_argument, 0, '?' },
+		{ 0, 0, 0, 0 }
+	};
+	unsigned int max_particles = 1000000;
+	unsigned int particles;
+	int frames = 20;
+	double moving = 100.0;
+	float radius = 0.0f;
+	float zoom = 1.0f;
+	unsigned int budget = 0;
+	int c;
+
+	while((c = getopt_long(argc, argv, "n:f:m:s:z:b:?", long_options,
+			NULL)) != -1) {
+		switch(c) {
+		case 'n':
+			max_particles = (unsigned int)strtoul(optarg, NULL, 10);
+			break;
+		case 'f':
+			frames = atoi(optarg);
+			break;
+		case 'm':
+			moving = atof(optarg);
+			break;
+		case 's':
+			radius = (float)atof(optarg);
+			break;
+		case 'z':
+			zoom = (float)atof(optarg);
+			break;
+		case 'b':
+			budget = (unsigned int)strtoul(optarg, NULL, 10);
+			break;
+		default:
+			bench_usage();
+			return(EXIT_FAILURE);
+		}
+	}
+	if(max_particles < 10000 || frames <= 0 || moving < 0.0 || moving > 100.0 ||
+			zoom < 1.0f) {
+		bench_usage();
+		return(EXIT_FAILURE);
+	}
+	if(bench_context()) {
+		return(EXIT_FAILURE);
+	}
+	printf("renderer(%s %s) surface(%ix%i) frames(%i) moving(%.0f%%) zoom(%.1f) budget(%u) %s\n",
+		(const char*)glGetString(GL_RENDERER),
+		(const char*)glGetString(GL_VERSION), BENCH_SIZE, BENCH_SIZE,
+		frames, moving, zoom, budget, radius > 0.0f ? "spheres" : "points");
+
+	/* points fill the clip volume, as the client's view does the world,
+	 * unless zoomed in on its center */
+	glViewport(0, 0, BENCH_SIZE, BENCH_SIZE);
+	glMatrixMode(GL_PROJECTION);
+	glLoadIdentity();
+	glOrtho(-1.0 / zoom, 1.0 / zoom, -1.0 / zoom, 1.0 / zoom, -1.0, 1.0);
+	glMatrixMode(GL_MODELVIEW);
+	glLoadIdentity();
+	glEnable(GL_DEPTH_TEST);
+	glPointSize(1.0f);
+
+	for(particles = 10000; particles <= max_particles; particles *= 10) {
+		if(bench_count(particles, frames, moving, radius, zoom, budget)) {
+			return(EXIT_FAILURE);
+		}
+	}
+	return(EXIT_SUCCESS);
+}
@@ -0,0 +1,221 @@
+/*
+ * replay.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "replay.h"
+
+/*
+Initialize replay, starting live.
+
+@param	r	replay state
+@param	palette	colors for decoded frames
+*/
+void replay_init(replay_t *r, const store_palette_t *palette) {
+	memset(r, 0, sizeof(replay_t));
+	r->mode = REPLAY_LIVE;
+	r->rate = 1.0;
+	r->palette = *palette;
+}
+
+/*
+Release the decoded frame and script.
+*/
+void replay_free(replay_t *r) {
+	int i;
+	store_free(&r->store);
+	for(i = 0; i < r->script_length; i++) {
+		free(r->script[i]);
+	}
+	r->script_length = 0;
+}
+
+/*
+Freeze the view on the newest frame, or stop playback where it is.
+*/
+void replay_pause(replay_t *r, const history_t *h) {
+	if(r->mode == REPLAY_LIVE) {
+		if(h->length == 0) {
+			return;
+		}
+		r->t = history_time(h, h->length - 1);
+	}
+	r->mode = REPLAY_PAUSED;
+}
+
+/*
+Return to the live view.
+*/
+void replay_live(replay_t *r) {
+	r->mode = REPLAY_LIVE;
+}
+
+/*
+Show the frame at or before simulation time t.
+*/
+void replay_seek(replay_t *r, const history_t *h, double t) {
+	replay_pause(r, h);
+	r->t = t;
+}
+
+/*
+Move a number of frames from the one being shown.
+*/
+void replay_step(replay_t *r, const history_t *h, int frames) {
+	int index;
+	replay_pause(r, h);
+	if((index = history_find(h, (float)r->t)) < 0) {
+		return;
+	}
+	index += frames;
+	if(index < 0) {
+		index = 0;
+	}
+	if(index >= (int)h->length) {
+		index = h->length - 1;
+	}
+	r->t = history_time(h, index);
+}
+
+/*
+Play from the frame being shown.
+
+@param	r	replay state
+@param	h	history
+@param	rate	simulation seconds per wall second, negative for backwards
+*/
+void replay_play(replay_t *r, const history_t *h, double rate) {
+	replay_pause(r, h);
+	if(r->mode == REPLAY_PAUSED) {
+		r->mode = REPLAY_PLAYING;
+		r->rate = rate;
+		r->last_update = 0.0;
+	}
+}
+
+/*
+Advance playback and decode the frame to show.  Must be called with the
+history locked.
+
+@param	r	replay state
+@param	h	history
+@param	now	wall time in seconds
+
+@returns store to draw, or NULL for the live store
+*/
+store_t *replay_update(replay_t *r, history_t *h, double now) {
+	int index;
+	float t;
+
+	if(r->mode == REPLAY_LIVE || h->length == 0) {
+		r->mode = REPLAY_LIVE;
+		return(NULL);
+	}
+	if(r->mode == REPLAY_PLAYING) {
+		float first = history_time(h, 0);
+		float last = history_time(h, h->length - 1);
+		if(r->last_update > 0.0) {
+			r->t += r->rate * (now - r->last_update);
+		}
+		/* stop at either end of the history */
+		if(r->t >= last) {
+			r->t = last;
+			r->mode = REPLAY_PAUSED;
+		} else if(r->t <= first) {
+			r->t = first;
+			r->mode = REPLAY_PAUSED;
+		}
+	}
+	r->last_update = now;
+
+	index = history_find(h, (float)r->t);
+	t = history_time(h, index);
+	if(r->store.count != h->count) {
+		store_free(&r->store);
+		if(store_init(&r->store, h->count, &r->palette)) {
+			r->mode = REPLAY_LIVE;
+			return(NULL);
+		}
+		r->decoded = 0;
+	}
+	if(!r->decoded || r->decoded_t != t) {
+		if(history_decode(h, index, &r->store)) {
+			return(NULL);
+		}
+		r->decoded_t = t;
+		r->decoded = 1;
+	}
+	return(&r->store);
+}
+
+/*
+Load a control script.
+
+@param	r	replay state
+@param	path	script file
+
+@returns 0 on success, -1 on error
+*/
+int replay_script_load(replay_t *r, const char *path) {
+	char line[256];
+	FILE *fp = fopen(path, "r");
+	if(fp == NULL) {
+		perror(path);
+		return(-1);
+	}
+	while(fgets(line, sizeof(line), fp) && r->script_length < REPLAY_SCRIPT_MAX) {
+		char *p = line + strspn(line, " \t");
+		p[strcspn(p, "\r\n#")] = '\0';
+		if(*p == '\0') {
+			continue;
+		}
+		r->script[r->script_length++] = strdup(p);
+	}
+	fclose(fp);
+	r->script_next = 0;
+	r->script_wait_until = 0.0;
+	return(0);
+}
+
+/*
+Run script commands until the next wait.
+
+@param	r	replay state
+@param	h	history, locked
+@param	now	wall time in seconds
+
+@returns 1 if the script asked to quit, 0 otherwise
+*/
+int replay_script_run(replay_t *r, const history_t *h, double now) {
+	while(r->script_next < r->script_length && now >= r->script_wait_until) {
+		char command[32];
+		double value = 0.0;
+		const char *line = r->script[r->script_next++];
+		int n = sscanf(line, "%31s %lf", command, &value);
+		if(n < 1) {
+			continue;
+		}
+		if(!strcmp(command, "pause")) {
+			replay_pause(r, h);
+		} else if(!strcmp(command, "live")) {
+			replay_live(r);
+		} else if(!strcmp(command, "seek") && n == 2) {
+			replay_seek(r, h, value);
+		} else if(!strcmp(command, "step") && n == 2) {
+			replay_step(r, h, (int)value);
+		} else if(!strcmp(command, "play")) {
+			replay_play(r, h, n == 2 ? value : 1.0);
+		} else if(!strcmp(command, "wait") && n == 2) {
+			r->script_wait_until = now + value;
+		} else if(!strcmp(command, "quit")) {
+			return(1);
+		} else {
+			fprintf(stderr, "Bad replay command '%s'\n", line);
+		}
+	}
+	return(0);
+}
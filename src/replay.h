@@ -0,0 +1,66 @@
+/*
+ * replay.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Pause, scrub and playback over the timestep history.  While replaying,
+ * frames are decoded into a private store that the renderer draws instead
+ * of the live one; ingest carries on in the background.  The same controls
+ * can be driven from a script file, one command per line:
+ *
+ *   pause            freeze on the newest frame
+ *   live             return to the live view
+ *   seek <t>         show the frame at simulation time t
+ *   step <n>         move n frames, negative for backwards
+ *   play <rate>      play at rate simulation seconds per second
+ *   wait <seconds>   let the display run before the next command
+ *   quit             exit the application
+ */
+
+#ifndef REPLAY_H_
+#define REPLAY_H_
+
+#include "history.h"
+#include "store.h"
+
+/* maximum number of script commands */
+#define REPLAY_SCRIPT_MAX 1024
+
+typedef enum { REPLAY_LIVE, REPLAY_PAUSED, REPLAY_PLAYING } replay_mode_t;
+
+/*
+Replay state, owned by the render thread.
+*/
+typedef struct {
+	replay_mode_t mode;
+	/* simulation time being shown */
+	double t;
+	/* simulation seconds per wall second, negative plays backwards */
+	double rate;
+	/* wall time of the last update */
+	double last_update;
+	/* time of the frame decoded into store, valid if decoded */
+	float decoded_t;
+	int decoded;
+	/* decoded frame */
+	store_t store;
+	store_palette_t palette;
+	/* script commands and progress */
+	char *script[REPLAY_SCRIPT_MAX];
+	int script_length;
+	int script_next;
+	double script_wait_until;
+} replay_t;
+
+void replay_init(replay_t *r, const store_palette_t *palette);
+void replay_free(replay_t *r);
+void replay_pause(replay_t *r, const history_t *h);
+void replay_live(replay_t *r);
+void replay_seek(replay_t *r, const history_t *h, double t);
+void replay_step(replay_t *r, const history_t *h, int frames);
+void replay_play(replay_t *r, const history_t *h, double rate);
+store_t *replay_update(replay_t *r, history_t *h, double now);
+int replay_script_load(replay_t *r, const char *path);
+int replay_script_run(replay_t *r, const history_t *h, double now);
+
+#endif /* REPLAY_H_ */
@@ -0,0 +1,265 @@
+/*
+ * scene.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/* GL 1.5 buffer entry points */
+#define GL_GLEXT_PROTOTYPES 1
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "scene.h"
+
+/* grid spacings, finest first, and their gray levels */
+#define SCENE_GRID_LEVELS 3
+static const float g_scene_grid_space[SCENE_GRID_LEVELS] = { 0.1f, 1.0f, 10.0f };
+static const uint8_t g_scene_grid_gray[SCENE_GRID_LEVELS] = { 230, 204, 179 };
+
+/* locals */
+static int scene_supported(void);
+static void scene_vertex(store_vertex_t *v, const uint8_t rgba[4], float x,
+		float y, float z);
+static unsigned int scene_grid(store_vertex_t *v, float extent);
+static unsigned int scene_axes(store_vertex_t *v, float length);
+static unsigned int scene_box(store_vertex_t *v, const float origin[3],
+		const float size[3]);
+
+/*
+@returns non-zero if the context has buffer objects
+*/
+static int scene_supported(void) {
+	const char *version = (const char*)glGetString(GL_VERSION);
+	const char *extensions = (const char*)glGetString(GL_EXTENSIONS);
+	int major = 0;
+	int minor = 0;
+
+	if(version != NULL && sscanf(version, "%d.%d", &major, &minor) == 2 &&
+			(major > 1 || (major == 1 && minor >= 5))) {
+		return(1);
+	}
+	return(extensions != NULL &&
+		strstr(extensions, "GL_ARB_vertex_buffer_object") != NULL);
+}
+
+static void scene_vertex(store_vertex_t *v, const uint8_t rgba[4], float x,
+		float y, float z) {
+	memcpy(v->rgba, rgba, sizeof(v->rgba));
+	v->pos[0] = x;
+	v->pos[1] = y;
+	v->pos[2] = z;
+}
+
+/*
+Lines of the three grids, in the xy, xz and yz planes from the origin out
+to extent.  Each spacing leaves out the lines of the next coarser one.
+
+@returns vertices written
+*/
+static unsigned int scene_grid(store_vertex_t *v, float extent) {
+	unsigned int n = 0;
+	int plane, level, i;
+
+	for(plane = 0; plane < 3; plane++) {
+		for(level = 0; level < SCENE_GRID_LEVELS; level++) {
+			float space = g_scene_grid_space[level];
+			int count = (int)(extent / space);
+			uint8_t rgba[4];
+			rgba[0] = rgba[1] = rgba[2] = g_scene_grid_gray[level];
+			rgba[3] = 255;
+			for(i = 1; i < count; i++) {
+				float a = space * i;
+				if(i % 10 == 0) {
+					continue;
+				}
+				/* a line across b, then one across a */
+				if(plane == 0) {
+					scene_vertex(&v[n++], rgba, a, 0.0f, 0.0f);
+					scene_vertex(&v[n++], rgba, a, extent, 0.0f);
+					scene_vertex(&v[n++], rgba, 0.0f, a, 0.0f);
+					scene_vertex(&v[n++], rgba, extent, a, 0.0f);
+				} else if(plane == 1) {
+					scene_vertex(&v[n++], rgba, a, 0.0f, 0.0f);
+					scene_vertex(&v[n++], rgba, a, 0.0f, extent);
+					scene_vertex(&v[n++], rgba, 0.0f, 0.0f, a);
+					scene_vertex(&v[n++], rgba, extent, 0.0f, a);
+				} else {
+					scene_vertex(&v[n++], rgba, 0.0f, a, 0.0f);
+					scene_vertex(&v[n++], rgba, 0.0f, a, extent);
+					scene_vertex(&v[n++], rgba, 0.0f, 0.0f, a);
+					scene_vertex(&v[n++], rgba, 0.0f, extent, a);
+				}
+			}
+		}
+	}
+	return(n);
+}
+
+/*
+Axes from the origin, x red, y blue and z green.
+
+@returns vertices written
+*/
+static unsigned int scene_axes(store_vertex_t *v, float length) {
+	static const uint8_t red[4] = { 255, 0, 0, 255 };
+	static const uint8_t green[4] = { 0, 255, 0, 255 };
+	static const uint8_t blue[4] = { 0, 0, 255, 255 };
+
+	scene_vertex(&v[0], red, 0.0f, 0.0f, 0.0f);
+	scene_vertex(&v[1], red, length, 0.0f, 0.0f);
+	scene_vertex(&v[2], blue, 0.0f, 0.0f, 0.0f);
+	scene_vertex(&v[3], blue, 0.0f, length, 0.0f);
+	scene_vertex(&v[4], green, 0.0f, 0.0f, 0.0f);
+	scene_vertex(&v[5], green, 0.0f, 0.0f, length);
+	return(6);
+}
+
+/*
+Translucent faces of the world box, all but the top.  Sizes are in world
+order, so size[2] spans GL y.
+
+@returns vertices written, 0 if the world has no volume
+*/
+static unsigned int scene_box(store_vertex_t *v, const float origin[3],
+		const float size[3]) {
+	static const uint8_t rgba[4] = { 255, 0, 0, 10 };
+	float x0 = origin[0];
+	float y0 = origin[1];
+	float z0 = origin[2];
+	float x1 = origin[0] + size[0];
+	float y1 = origin[1] + size[2];
+	float z1 = origin[2] + size[1];
+
+	if((size[0] == 0.0f) || (size[1] == 0.0f) || (size[2] == 0.0f)) {
+		return(0);
+	}
+	/* back */
+	scene_vertex(&v[0], rgba, x0, y0, z0);
+	scene_vertex(&v[1], rgba, x1, y0, z0);
+	scene_vertex(&v[2], rgba, x1, y1, z0);
+	scene_vertex(&v[3], rgba, x0, y1, z0);
+	/* right */
+	scene_vertex(&v[4], rgba, x1, y0, z0);
+	scene_vertex(&v[5], rgba, x1, y0, z1);
+	scene_vertex(&v[6], rgba, x1, y1, z1);
+	scene_vertex(&v[7], rgba, x1, y1, z0);
+	/* front */
+	scene_vertex(&v[8], rgba, x1, y0, z1);
+	scene_vertex(&v[9], rgba, x0, y0, z1);
+	scene_vertex(&v[10], rgba, x0, y1, z1);
+	scene_vertex(&v[11], rgba, x1, y1, z1);
+	/* left */
+	scene_vertex(&v[12], rgba, x0, y0, z1);
+	scene_vertex(&v[13], rgba, x0, y0, z0);
+	scene_vertex(&v[14], rgba, x0, y1, z0);
+	scene_vertex(&v[15], rgba, x0, y1, z1);
+	/* bottom */
+	scene_vertex(&v[16], rgba, x0, y0, z0);
+	scene_vertex(&v[17], rgba, x1, y0, z0);
+	scene_vertex(&v[18], rgba, x1, y0, z1);
+	scene_vertex(&v[19], rgba, x0, y0, z1);
+	return(20);
+}
+
+/*
+Create the buffer object, if the context has them.  Vertices are built by
+the first scene_update().  Needs a current GL context.
+
+@param	sc	scene, id is 0 if vertices must stay in client memory
+*/
+void scene_init(scene_t *sc) {
+	memset(sc, 0, sizeof(scene_t));
+	if(scene_supported()) {
+		glGenBuffers(1, &sc->id);
+	}
+}
+
+/*
+Delete the buffer object and vertices.
+*/
+void scene_free(scene_t *sc) {
+	if(sc->id != 0) {
+		glDeleteBuffers(1, &sc->id);
+	}
+	free(sc->vertices);
+	memset(sc, 0, sizeof(scene_t));
+}
+
+/*
+Build the vertices, unless they were built for this world already.
+
+@param	sc	scene
+@param	origin	world origin
+@param	size	world size
+@param	extent	length of the grids and axes
+
+@returns 0 on success, -1 on error
+*/
+int scene_update(scene_t *sc, const float origin[3], const float size[3],
+		float extent) {
+	unsigned int bound = 6 + 20;
+	unsigned int n;
+	int level;
+
+	if(sc->vertices != NULL && sc->extent == extent &&
+			!memcmp(sc->origin, origin, sizeof(sc->origin)) &&
+			!memcmp(sc->size, size, sizeof(sc->size))) {
+		return(0);
+	}
+	for(level = 0; level < SCENE_GRID_LEVELS; level++) {
+		bound += 3 * 4 * (unsigned int)(extent / g_scene_grid_space[level]);
+	}
+	free(sc->vertices);
+	if((sc->vertices = (store_vertex_t*)malloc(bound *
+			sizeof(store_vertex_t))) == NULL) {
+		perror("scene_update");
+		return(-1);
+	}
+	n = 0;
+	sc->first[SCENE_GRID] = n;
+	n += scene_grid(&sc->vertices[n], extent);
+	sc->first[SCENE_AXES] = n;
+	n += scene_axes(&sc->vertices[n], extent);
+	sc->first[SCENE_BOX] = n;
+	n += scene_box(&sc->vertices[n], origin, size);
+	sc->first[SCENE_PART_COUNT] = n;
+	if(sc->id != 0) {
+		glBindBuffer(GL_ARRAY_BUFFER, sc->id);
+		glBufferData(GL_ARRAY_BUFFER, n * sizeof(store_vertex_t), sc->vertices,
+			GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+	memcpy(sc->origin, origin, sizeof(sc->origin));
+	memcpy(sc->size, size, sizeof(sc->size));
+	sc->extent = extent;
+	sc->builds++;
+	return(0);
+}
+
+/*
+Draw one part in the current modelview.
+
+@param	sc	scene, built by scene_update()
+@param	part	scene_part_t
+*/
+void scene_draw(const scene_t *sc, scene_part_t part) {
+	unsigned int count = sc->first[part + 1] - sc->first[part];
+
+	if(sc->vertices == NULL || count == 0) {
+		return;
+	}
+	if(sc->id != 0) {
+		glBindBuffer(GL_ARRAY_BUFFER, sc->id);
+		glInterleavedArrays(GL_C4UB_V3F, 0, NULL);
+	} else {
+		glInterleavedArrays(GL_C4UB_V3F, 0, sc->vertices);
+	}
+	glDrawArrays(part == SCENE_BOX ? GL_QUADS : GL_LINES,
+		sc->first[part], count);
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	if(sc->id != 0) {
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+}
@@ -0,0 +1,50 @@
+/*
+ * scene.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Static scene geometry: the reference grids, the axes and the world box.
+ * Their vertices are built once, and again only when the world's origin or
+ * size changes, into a GL buffer object holding every part; each part is
+ * then drawn with a single glDrawArrays.  Without buffer objects the same
+ * vertices are drawn from client memory.
+ */
+
+#ifndef SCENE_H_
+#define SCENE_H_
+
+#include "GL/glfw.h"
+#include "store.h"
+
+/* parts, drawn separately */
+typedef enum {
+	SCENE_GRID,
+	SCENE_AXES,
+	SCENE_BOX,
+	SCENE_PART_COUNT
+} scene_part_t;
+
+/*
+Scene vertices, their buffer object and the world they were built for.
+*/
+typedef struct {
+	/* buffer name, 0 if buffer objects are unavailable */
+	GLuint id;
+	/* every part's vertices, first vertex of each part and the end */
+	store_vertex_t *vertices;
+	unsigned int first[SCENE_PART_COUNT + 1];
+	/* world and grid extent the vertices were built for */
+	float origin[3];
+	float size[3];
+	float extent;
+	/* times the vertices were built */
+	unsigned long long builds;
+} scene_t;
+
+void scene_init(scene_t *sc);
+void scene_free(scene_t *sc);
+int scene_update(scene_t *sc, const float origin[3], const float size[3],
+		float extent);
+void scene_draw(const scene_t *sc, scene_part_t part);
+
+#endif /* SCENE_H_ */
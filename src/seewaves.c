@@ -13,8 +13,8 @@ Strategy    : PTP uses User Datagram Protocol (UDP) over Internet Protocol (IP)
               Seewaves, therefore, may start and stop at different times from
               different locations on the network and join a particle simulation
               in progress.
-              Seewaves is a multi-threaded application consisting of three
-              threads; main, heartbeat and data:
+              Seewaves is a multi-threaded application consisting of four
+              threads; main, heartbeat, data and publish:
                 - main thread.  This thread opens a single OpenGL window using
                 the glfw cross-platform library.  It goes into a main loop where
                 it polls user events and renders particle data as received.
@@ -26,7 +26,9 @@ Strategy    : PTP uses User Datagram Protocol (UDP) over Internet Protocol (IP)
                 simple request information to the server, for example telling
                 the server which particle type to send.
                 - data thread.  This thread listens for incoming UDP packets,
-                decodes them, and updates internal data structures.
+                tracks what has arrived and queues them.
+                - publish thread.  This thread applies queued packets to the
+                particle store and publishes each timestep to the renderer.
 Usage       : seewaves --help
 ============================================================================*/
 
@@ -46,6 +48,7 @@ Usage       : seewaves --help
 #include <fcntl.h>
 #include <getopt.h>
 #include <assert.h>
+#include <signal.h>
 #include "heartbeat.h"
 #include "data_thread.h"
 #include "ptp.h"
@@ -56,9 +59,6 @@ Usage       : seewaves --help
 #include "util.h"
 #include "seewaves.h"
 
-// Uncomment for experimental mutex locking, not sure it's needed
-//#define LOCK 1
-
 /* External variables */
 extern char *optarg;
 
@@ -76,13 +76,14 @@ void camera_set_raw(GLfloat eye_x, GLfloat eye_y, GLfloat eye_z,
 		GLfloat target_x, GLfloat target_y, GLfloat target_z);
 void camera_dolly(int units);
 void render_string(GLfloat x, GLfloat y, GLfloat z, char *s);
-void render_grid_sub(float extent, float space);
 void push_ortho(void);
 void pop_ortho(void);
 void render_fading_text(GLfloat x, GLfloat y, GLfloat z, char *s, GLfloat t);
-void render_grid(GLfloat extent);
 void opengl_pos_from_mouse_pos(int mx, int my, GLdouble *x, GLdouble *y,
     GLdouble *z);
+void pick_particle(int mx, int my);
+double frame_time(void);
+void on_signal(int sig);
 void GLFWCALL on_mouse(int x, int y);
 void GLFWCALL on_mouse_button(int button, int action);
 void GLFWCALL on_mouse_wheel(int pos);
@@ -94,13 +95,32 @@ int application_reconfigure(seewaves_t *s, const char *dirname,
     const char *filename, int create);
 float *get_float3(char *name, float *value);
 void set_float3(char *name, float x, float y, float z);
+void *setting_value(char *name, cfg_option_which_t which);
+void settings_resolve(seewaves_settings_t *settings);
 const char *byte_to_binary(int x);
-void render_axes(float x, float y, float z, float length);
-void render_box(float origin[3], float size[3]);
+unsigned int particle_type_mask(const char *names);
+void palette_from_config(store_palette_t *palette);
+const char *particle_type_name(int code);
 
 /* Global application data variable */
 static seewaves_t g_seewaves;
 
+/* Particle type names, as used in configuration */
+static const struct {
+	const char *name;
+	short particle_type;
+} g_particle_types[] = {
+		{ "fluid",     0 },
+		{ "boundary",  16 },
+		{ "piston",    32 },
+		{ "paddle",    48 },
+		{ "gate",      64 },
+		{ "object",    80 },
+		{ "testpoint", 96 },
+		{ "surface",   256 },
+		{ NULL,        0 }
+};
+
 /* Print pthreads error user-defined and internal error message. */
 #define PT_ERR_MSG(str, code) { \
 		fprintf(stderr, "%s: %s\n", str, strerror(code)); \
@@ -126,6 +146,40 @@ cfg_option_t g_config_options[] = {
 		{ CFG_OBJECT_COLOR,"Object color",         FLOAT3,  { .ival=0 }, { .f3val = { 0.0, 0.0, 0.0 } } },
 		{ CFG_TESTPOINT_COLOR,"Test point color",  FLOAT3,  { .ival=0 }, { .f3val = { 1.0, 0.0, 0.0 } } },
 		{ CFG_SURFACE_COLOR,"Surface color",       FLOAT3,  { .ival=0 }, { .f3val = { 1.0, 0.0, 0.0 } } },
+		{ CFG_TRACKED_TYPES,"Particle types streamed at the tracked rate (e.g. testpoint surface)", STRING, { "" }, { "" } },
+		{ CFG_TRACKED_STRIDE,"Steps between tracked subset updates (0 disables)", INTEGER, { .ival=0 }, { .ival=1 } },
+		{ CFG_FULL_STRIDE,"Steps between full field updates",  INTEGER, { .ival=0 }, { .ival=1 } },
+		{ CFG_HISTORY_FRAMES,"Timesteps kept for replay (0 for no limit)", INTEGER, { .ival=0 }, { .ival=0 } },
+		{ CFG_HISTORY_MEGABYTES,"Memory for replay history in MB (0 for no limit, both 0 disables)", INTEGER, { .ival=0 }, { .ival=0 } },
+		{ CFG_HISTORY_KEYFRAME,"Timesteps between history keyframes", INTEGER, { .ival=0 }, { .ival=HISTORY_KEYFRAME_INTERVAL } },
+		{ CFG_THREADS,"Worker threads for per-timestep work (0 for one per CPU)", INTEGER, { .ival=0 }, { .ival=0 } },
+		{ CFG_STORE_PAGES,"Particle array pages: default (heap), small, transparent or huge", STRING, { "" }, { "transparent" } },
+		{ CFG_STORE_NUMA,"Particle array placement: first-touch, interleave, local or a node number", STRING, { "" }, { "first-touch" } },
+		{ CFG_MORTON_ORDER,"Keep particles in Morton order for locality (0 or 1)", INTEGER, { .ival=0 }, { .ival=1 } },
+		{ CFG_COLOR_SPEED,"Color fluid by speed (0 or 1)", INTEGER, { .ival=0 }, { .ival=0 } },
+		{ CFG_COLOR_SPEED_MAX,"Speed at the top of the colormap (0 follows the fastest particle)", FLOAT, { .fval=0 }, { .fval=0.0 } },
+		{ CFG_RENDER_MODE,"Particle drawing: stream (mapped ring), vbo, arrays (client memory) or immediate", STRING, { "" }, { "vbo" } },
+		{ CFG_RENDER_SPHERES,"Draw particles as shaded spheres where GLSL is available (0 or 1)", INTEGER, { .ival=0 }, { .ival=1 } },
+		{ CFG_PARTICLE_RADIUS,"Sphere radius in world units (0 derives it from the particle spacing)", FLOAT, { .fval=0 }, { .fval=0.0 } },
+		{ CFG_RENDER_CULL,"Skip particles outside the view, by chunk (0 or 1)", INTEGER, { .ival=0 }, { .ival=1 } },
+		{ CFG_RENDER_LOD,"Draw large fields by octree level of detail, needs Morton order (0 or 1)", INTEGER, { .ival=0 }, { .ival=1 } },
+		{ CFG_RENDER_LOD_BUDGET,"Particles a frame draws while the camera moves (0 for all)", INTEGER, { .ival=0 }, { .ival=1000000 } },
+		{ CFG_RENDER_LOD_LIMIT,"Particles drawn at most once the camera stops (0 for all)", INTEGER, { .ival=0 }, { .ival=0 } },
+		{ CFG_RENDER_FPS_MAX,"Frames per second at most (0 for no limit)", INTEGER, { .ival=0 }, { .ival=60 } },
+		{ CFG_RENDER_VSYNC,"Swap buffers on vertical retrace (0 or 1)", INTEGER, { .ival=0 }, { .ival=1 } },
+		{ CFG_RENDER_INPUT_POLL,"Milliseconds between input checks while idle", INTEGER, { .ival=0 }, { .ival=10 } },
+		{ CFG_HUD_REFRESH,"Heads-up display refreshes per second (0 for every frame)", FLOAT, { .fval=0 }, { .fval=4.0 } },
+		{ CFG_HUD_SCALE,"Heads-up display text size, pixels per font pixel", INTEGER, { .ival=0 }, { .ival=1 } },
+		{ CFG_HUD_SPEED,"Derive speed for the heads-up display even when not coloring by it (0 or 1)", INTEGER, { .ival=0 }, { .ival=0 } },
+		{ CFG_HEADLESS,"Draw offscreen at the window size: 0 only if no window opens, 1 always", INTEGER, { .ival=0 }, { .ival=0 } },
+		{ CFG_CAPTURE_PATH,"File name prefix of captured frames (empty disables)", STRING, { "" }, { "" } },
+		{ CFG_CAPTURE_FORMAT,"Captured frames: png (numbered files) or y4m (one stream)", STRING, { "" }, { "png" } },
+		{ CFG_CAPTURE_INTERVAL,"Simulation seconds between captured frames (0 for every timestep)", FLOAT, { .fval=0 }, { .fval=0.0 } },
+		{ CFG_CAPTURE_FPS,"Frames per second a y4m stream plays at", INTEGER, { .ival=0 }, { .ival=30 } },
+		{ CFG_CAPTURE_THREADS,"Threads encoding captured frames", INTEGER, { .ival=0 }, { .ival=2 } },
+		{ CFG_CAPTURE_QUEUE,"Captured frames waiting to be encoded at most, more are dropped unless drawing offscreen", INTEGER, { .ival=0 }, { .ival=8 } },
+		{ CFG_INGEST_QUEUE,"Packets received ahead of the publish thread at most, the receiver waits beyond", INTEGER, { .ival=0 }, { .ival=65536 } },
+		{ CFG_GRID_PARTICLES_PER_CELL,"Spatial index particles per cell (0 disables)", INTEGER, { .ival=0 }, { .ival=GRID_PARTICLES_PER_CELL } },
 		{ NULL,          NULL,                     0,       { ""      }, { NULL       } }
 };
 
@@ -168,6 +222,7 @@ Print structure information.
 */
 void util_print_seewaves(seewaves_t *s, seewaves_format_t format, int fd) {
 	float fv[3];
+	int i;
 	FILE *fp = fdopen(fd, "w+");
 	if(fp == NULL) {
 		perror("util_print_seewaves");
@@ -188,6 +243,17 @@ void util_print_seewaves(seewaves_t *s, seewaves_format_t format, int fd) {
         sizeof(ptp_particle_data_t), PTP_PARTICLES_PER_PACKET, sizeof(ptp_packet_t));
 	fprintf(fp, "packet_per_udp_buf:\t%ld\n", (s->udp_buffer_size/sizeof(ptp_packet_t)));
 	fprintf(fp, "packets_received:\t%i\n", s->packets_received);
+	fprintf(fp, "ingest_queue:\t\t%u queued, %u peak of %u, %llu waits\n",
+		s->queue.count, s->queue.peak, s->queue.limit, s->queue.waits);
+	fprintf(fp, "frames_complete:\t%i/%i\n", s->completeness.frames_complete,
+		s->completeness.frames_seen);
+	fprintf(fp, "keyframes_complete:\t%i/%i\n", s->completeness.keyframes_complete,
+		s->completeness.keyframes_seen);
+	fprintf(fp, "subscription:\t\ttracked(0x%x every %i) full(every %i)\n",
+		s->tracked_types, s->tracked_stride, s->full_stride);
+	fprintf(fp, "subset_packets:\t\t%i\n", s->completeness.subset_packets);
+	fprintf(fp, "nacks_sent:\t\t%i\n", s->completeness.nacks_sent);
+	fprintf(fp, "retransmits_received:\t%i\n", s->completeness.retransmits_received);
 	fprintf(fp, "win_width:\t\t%i\n", get_int(CFG_WIN_WIDTH));
 	fprintf(fp, "win_height:\t\t%i\n", get_int(CFG_WIN_HEIGHT));
 	fprintf(fp, "data_host:\t\t%s\n", s->data_host);
@@ -196,11 +262,166 @@ void util_print_seewaves(seewaves_t *s, seewaves_format_t format, int fd) {
 	fprintf(fp, "gpusph_port:\t\t%i\n", s->gpusph_port);
 	fprintf(fp, "most_recent_timestamp:\t%.2f\n", s->most_recent_timestamp);
 	fprintf(fp, "UDP buffer size:\t%i\n", s->udp_buffer_size);
+	fprintf(fp, "store:\t\t\t%u particles, %lu bytes, %.1f per particle (%s)\n",
+		s->store.count, (unsigned long)store_bytes(&s->store),
+		s->store.count ? (double)store_bytes(&s->store) / s->store.count : 0.0,
+		store_policy_name());
+	fprintf(fp, "type_moves:\t\t%llu\n", s->store.type_moves);
+	fprintf(fp, "hidden_types:\t\t0x%x\n", s->hidden_types);
+	fprintf(fp, "history:\t\t%u frames, %lu bytes, %llu added, %llu evicted\n",
+		s->history.length, (unsigned long)s->history.bytes,
+		s->history.frames_added, s->history.frames_evicted);
+	fprintf(fp, "history_encode_ms:\t%.3f\n", s->history.frames_added ?
+		s->history.encode_seconds * 1000.0 / s->history.frames_added : 0.0);
+	fprintf(fp, "history_decode_rate:\t%.0f particles/s\n",
+		s->history.decode_seconds > 0.0 ?
+		s->history.decoded_particles / s->history.decode_seconds : 0.0);
+	fprintf(fp, "threads:\t\t%i\n", s->pool.threads);
+	fprintf(fp, "grid:\t\t\t%u cells (%ix%ix%i), %llu builds\n", s->grid.cells,
+		s->grid.dims[0], s->grid.dims[1], s->grid.dims[2], s->grid.builds);
+	fprintf(fp, "grid_build_ms:\t\t%.3f\n", s->grid.builds ?
+		s->grid.build_seconds * 1000.0 / s->grid.builds : 0.0);
+	fprintf(fp, "morton_order:\t\t%llu sorts, %llu skipped, %.3f ms/sort, %lu bytes\n",
+		s->order.sorts, s->order.skipped, s->order.sorts ?
+		s->order.sort_seconds * 1000.0 / s->order.sorts : 0.0,
+		(unsigned long)morton_bytes(&s->order));
+	fprintf(fp, "motion:\t\t\t%u sampled, %u stale, speed %.3f..%.3f\n",
+		s->motion.stats.sampled, s->motion.stats.stale,
+		s->motion.stats.min_speed, s->motion.stats.max_speed);
+	fprintf(fp, "motion_derive_ms:\t%.3f\n", s->motion.derives ?
+		s->motion.derive_seconds * 1000.0 / s->motion.derives : 0.0);
+	fprintf(fp, "ids:\t\t\t%s, %u hashed, %u free, %llu dropped, %llu removed, %lu bytes\n",
+		s->ids.identity_size ? "identity" : "mapped", s->ids.hashed,
+		s->ids.free_count - s->ids.free_next, s->ids.dropped, s->ids.removed,
+		(unsigned long)idmap_bytes(&s->ids));
+	fprintf(fp, "render_mode:\t\t%s (%s wanted)\n",
+		render_mode_name(s->render_used), render_mode_name(s->render_mode));
+	fprintf(fp, "vbo:\t\t\t%s, %llu updates\n", s->vbo.id ? "buffer object" :
+		"client arrays", s->vbo.updates);
+	fprintf(fp, "vbo_upload:\t\t%llu bytes of %llu\n", s->vbo.bytes,
+		s->vbo.bytes_if_full);
+	fprintf(fp, "cull:\t\t\t%s, %u/%u chunks, %u particles submitted\n",
+		s->culling ? "on" : (s->cull.enabled ? "off" : "disabled"),
+		s->cull.last_visible, s->cull.visible_chunks, s->cull.last_submitted);
+	fprintf(fp, "cull_bounds_ms:\t\t%.3f\n", s->cull.bounds ?
+		s->cull.bound_seconds * 1000.0 / s->cull.bounds : 0.0);
+	fprintf(fp, "lod:\t\t\t%s, %u/%u nodes, %u particles of %llu budget\n",
+		s->leveling ? "on" : (s->lod.enabled ? "off" : "disabled"),
+		s->lod.last_nodes, s->lod.node_count, s->lod.last_points,
+		s->lod.last_budget);
+	fprintf(fp, "lod_build_ms:\t\t%.3f\n", s->lod.builds ?
+		s->lod.build_seconds * 1000.0 / s->lod.builds : 0.0);
+	fprintf(fp, "display:\t\t%s\n", s->headless ? "offscreen" : "window");
+	fprintf(fp, "capture:\t\t%s, %llu frames, %llu encoded, %llu dropped, %llu errors\n",
+		s->capture.enabled ? capture_format_name(s->capture.format) :
+		"disabled", s->capture.captured, s->capture.encoded,
+		s->capture.dropped, s->capture.errors);
+	fprintf(fp, "spheres:\t\t%s, radius %.4f, %llu palette loads\n",
+		s->spheres && s->sprite.program ? "on" : (s->sprite.program ?
+		"off" : "unavailable"), s->particle_radius, s->sprite.lut_updates);
+	fprintf(fp, "stream:\t\t\t%s, %llu published, %llu stalls\n",
+		s->stream.store ? "attached" : (s->stream.supported ? "detached" :
+		"unavailable"), s->stream.published, s->stream.stalls);
+	fprintf(fp, "stream_catchup:\t\t%llu bytes\n", s->stream.catchup_bytes);
+	fprintf(fp, "redraw:\t\t\t%.1f fps, %llu idle wakeups, frames for",
+		s->fps, s->redraw.idle_wakeups);
+	for(i = 0; i < REDRAW_REASON_COUNT; i++) {
+		fprintf(fp, " %s %llu", redraw_reason_name(i), s->redraw.frames[i]);
+	}
+	fprintf(fp, "\n");
+	fprintf(fp, "scene:\t\t\t%s, %u vertices, %llu builds\n",
+		s->scene.id ? "buffer object" : "client arrays",
+		s->scene.first[SCENE_PART_COUNT], s->scene.builds);
+	fprintf(fp, "hud:\t\t\t%s, %llu refreshes, %llu rebuilds\n",
+		s->hud.atlas ? "atlas" : "glut", s->hud.refreshes, s->hud.rebuilds);
+	fprintf(fp, "frame_ms:\t\t%.2f\n", s->frame_ms);
 	if(format == FULL) {
 		/* dump positions et al, maybe to a file(?) */
 	}
 }
 
+/*
+Convert a list of particle type names into a subscription mask.
+
+@param	names	white space separated type names
+
+@returns mask of PTP_TYPE_BIT() values
+*/
+unsigned int particle_type_mask(const char *names) {
+	char buf[MAX_CFG_STRING];
+	char *name;
+	char *save = NULL;
+	unsigned int mask = 0;
+	int i;
+
+	snprintf(buf, sizeof(buf), "%s", names);
+	for(name = strtok_r(buf, " \t,", &save); name != NULL;
+			name = strtok_r(NULL, " \t,", &save)) {
+		for(i = 0; g_particle_types[i].name != NULL; i++) {
+			if(!strcmp(name, g_particle_types[i].name)) {
+				mask |= PTP_TYPE_BIT(g_particle_types[i].particle_type);
+				break;
+			}
+		}
+		if(g_particle_types[i].name == NULL) {
+			fprintf(stderr, "Unknown particle type '%s'\n", name);
+		}
+	}
+	return(mask);
+}
+
+/*
+@returns configuration name of a store type code
+*/
+const char *particle_type_name(int code) {
+	/* g_particle_types is in type code order */
+	if(code >= 0 && code < STORE_TYPE_OTHER) {
+		return(g_particle_types[code].name);
+	}
+	return("other");
+}
+
+/*
+Build the per-type vertex palette from the configured colors.
+
+@param	palette	filled in, RGBA8 by store type code
+*/
+void palette_from_config(store_palette_t *palette) {
+	static const struct {
+		char *name;
+		int code;
+	} colors[] = {
+			{ CFG_FLUID_COLOR,     STORE_TYPE_FLUID },
+			{ CFG_BOUNDARY_COLOR,  STORE_TYPE_BOUNDARY },
+			{ CFG_PISTON_COLOR,    STORE_TYPE_PISTON },
+			{ CFG_PADDLE_COLOR,    STORE_TYPE_PADDLE },
+			{ CFG_GATE_COLOR,      STORE_TYPE_GATE },
+			{ CFG_OBJECT_COLOR,    STORE_TYPE_OBJECT },
+			{ CFG_TESTPOINT_COLOR, STORE_TYPE_TESTPOINT },
+			{ CFG_SURFACE_COLOR,   STORE_TYPE_SURFACE },
+			{ NULL,                STORE_TYPE_OTHER }
+	};
+	float rgb[3];
+	int i;
+	int j;
+
+	for(i = 0; ; i++) {
+		/* unknown types are gray */
+		rgb[0] = rgb[1] = rgb[2] = 0.5;
+		if(colors[i].name != NULL) {
+			get_float3(colors[i].name, rgb);
+		}
+		for(j = 0; j < 3; j++) {
+			float c = rgb[j] < 0.0 ? 0.0 : (rgb[j] > 1.0 ? 1.0 : rgb[j]);
+			palette->rgba[colors[i].code][j] = (uint8_t)(c * 255.0 + 0.5);
+		}
+		palette->rgba[colors[i].code][3] = 255;
+		if(colors[i].name == NULL) {
+			break;
+		}
+	}
+}
+
 const char *byte_to_binary(int x) {
     static char b[9];
     b[0] = '\0';
@@ -247,8 +468,8 @@ void camera_reset(void) {
 void camera_dolly(int units) {
     float x, y, z;
     GLfloat dir_x, dir_y, dir_z;
-    float eye[3];
-    float target[3];
+    const float *eye = g_seewaves.settings.eye_pos;
+    const float *target = g_seewaves.settings.eye_target;
 
 	/* scale the requested units */
 	GLfloat scaled_units = units * CAMERA_TRANSLATE_SCALER;
@@ -257,8 +478,6 @@ void camera_dolly(int units) {
 	GLfloat magnitude;
 
 	/* find vector from eye to center */
-	get_float3(CFG_EYE_POS, eye);
-	get_float3(CFG_EYE_TARGET, target);
 	dir_x = target[0] - eye[0];
 	dir_y = target[1] - eye[1];
 	dir_z = target[2] - eye[2];
@@ -322,6 +541,44 @@ void set_float3(char *name, float x, float y, float z) {
 	}
 }
 
+/*
+Resolve an option to its value storage, exiting if the option is missing
+as that is a programming error.
+
+@param	name	option name
+@param	which	option type
+
+@returns value storage of the option
+*/
+void *setting_value(char *name, cfg_option_which_t which) {
+	int i;
+	/* the table itself, it has defaults even if no file was loaded */
+	for(i = 0; g_config_options[i].name != NULL; i++) {
+		if(!strcmp(g_config_options[i].name, name) &&
+				g_config_options[i].which == which) {
+			return(&g_config_options[i].u);
+		}
+	}
+	fprintf(stderr, "setting_value: no option %s of type %i\n", name, which);
+	exit(EXIT_FAILURE);
+}
+
+/*
+Resolve the hot-path options.  Their storage never moves, so once at
+startup is enough.
+
+@param	settings	handles to fill
+*/
+void settings_resolve(seewaves_settings_t *settings) {
+	settings->znear = (const float*)setting_value(CFG_ZNEAR, FLOAT);
+	settings->zfar = (const float*)setting_value(CFG_ZFAR, FLOAT);
+	settings->eye_pos = (float*)setting_value(CFG_EYE_POS, FLOAT3);
+	settings->eye_up = (float*)setting_value(CFG_EYE_UP, FLOAT3);
+	settings->eye_target = (float*)setting_value(CFG_EYE_TARGET, FLOAT3);
+	settings->win_width = (const int*)setting_value(CFG_WIN_WIDTH, INTEGER);
+	settings->win_height = (const int*)setting_value(CFG_WIN_HEIGHT, INTEGER);
+}
+
 int application_reconfigure(seewaves_t *s, const char *dirname,
     const char *filename, int create) {
 	char path[FILENAME_MAX];
@@ -437,9 +694,24 @@ int initialize_application(seewaves_t *s, int argc, char **argv) {
         {"in_host", required_argument, 0,  't' },
         {"in_port", required_argument, 0,  'l' },
         {"verbosity", required_argument, 0,  'v' },
+        {"script", required_argument, 0,  's' },
+        {"headless", no_argument, 0,  'o' },
+        {"history", required_argument, 0,  'H' },
         { 0, 0, 0, 0}
     };
 
+    /* replay history in MB, -1 to leave it to the configuration */
+    int history_megabytes = -1;
+
+    /* replay control script */
+    const char *script = NULL;
+
+    /* offscreen even if a window would open */
+    int headless = 0;
+
+    /* captured frame format */
+    int format;
+
     /* clear the structure */
     memset(&g_seewaves, 0, sizeof(seewaves_t));
 
@@ -472,7 +744,7 @@ int initialize_application(seewaves_t *s, int argc, char **argv) {
     //g_seewaves.view_options |= 1 << ROTATION_AXES;
 
     /* process command-line arguments */
-    while ((opt = getopt_long(argc, argv, "h:p:t:r:u:v:", long_options,
+    while ((opt = getopt_long(argc, argv, "h:p:t:r:u:v:s:oH:", long_options,
         &option_index)) != -1) {
         switch(opt) {
             case 'h':
@@ -493,6 +765,15 @@ int initialize_application(seewaves_t *s, int argc, char **argv) {
             case 'v':
                 s->verbosity = 9;
                 break;
+            case 's':
+                script = optarg;
+                break;
+            case 'o':
+                headless = 1;
+                break;
+            case 'H':
+                history_megabytes = atoi(optarg);
+                break;
             default: {
                	char b[64];
                	util_get_current_time_string(b, sizeof(b));
@@ -506,6 +787,9 @@ int initialize_application(seewaves_t *s, int argc, char **argv) {
                 printf("--udp_size -u <size>   UDP receive buffer size (%i)\n",
                 		util_get_udp_buffer_size(-1));
                 printf("--verbosity -v <level> Verbosity level 0-9 (0)\n");
+                printf("--script -s <file>     Replay control script\n");
+                printf("--headless -o          Draw offscreen, without a window\n");
+                printf("--history -H <MB>      Keep a replay history of this size (0, off)\n");
                 return(-5);
                 break;
             }
@@ -522,6 +806,69 @@ int initialize_application(seewaves_t *s, int argc, char **argv) {
     /* optionally override configuration with locally-defined */
     sprintf(dirname, ".");
     (void)application_reconfigure(s, dirname, filename, 0);
+    settings_resolve(&s->settings);
+
+    /* page size and placement of particle arrays, before any are allocated */
+    (void)store_policy(get_string(CFG_STORE_PAGES), get_string(CFG_STORE_NUMA));
+
+    /* vertex colors, resolved by the publish thread at decode time */
+    palette_from_config(&s->palette);
+
+    /* timestep history and replay */
+    if(history_megabytes >= 0) {
+    	cfg_set_int(&s->config, CFG_HISTORY_MEGABYTES, history_megabytes);
+    }
+    history_init(&s->history, get_int(CFG_HISTORY_FRAMES),
+    		(size_t)get_int(CFG_HISTORY_MEGABYTES) * 1024 * 1024,
+    		get_int(CFG_HISTORY_KEYFRAME));
+    replay_init(&s->replay, &s->palette);
+
+    /* spatial index, rebuilt by the publish thread as timesteps are published */
+    if(parallel_init(&s->pool, get_int(CFG_THREADS))) {
+    	return(-1);
+    }
+    morton_init(&s->order, get_int(CFG_MORTON_ORDER));
+    grid_init(&s->grid, get_int(CFG_GRID_PARTICLES_PER_CELL));
+    cull_init(&s->cull, get_int(CFG_RENDER_CULL));
+    s->culling = s->cull.enabled;
+    lod_init(&s->lod, get_int(CFG_RENDER_LOD),
+    		(unsigned int)get_int(CFG_RENDER_LOD_BUDGET),
+    		(unsigned int)get_int(CFG_RENDER_LOD_LIMIT));
+    s->leveling = s->lod.enabled;
+    motion_init(&s->motion, get_int(CFG_COLOR_SPEED),
+    		get_float(CFG_COLOR_SPEED_MAX), get_int(CFG_HUD_SPEED));
+    s->picked = -1;
+    s->spheres = get_int(CFG_RENDER_SPHERES);
+    s->particle_radius = get_float(CFG_PARTICLE_RADIUS);
+    if((s->render_mode = render_mode_code(get_string(CFG_RENDER_MODE))) < 0) {
+    	fprintf(stderr, "Unknown %s '%s', using vbo\n", CFG_RENDER_MODE,
+    			get_string(CFG_RENDER_MODE));
+    	s->render_mode = RENDER_VBO;
+    }
+    if(script != NULL && replay_script_load(&s->replay, script)) {
+    	return(-4);
+    }
+    if(script != NULL && !s->history.max_frames && !s->history.max_bytes) {
+    	fprintf(stderr, "Replay script without history, see --history\n");
+    }
+
+    /* offscreen drawing, and frames written as they are drawn */
+    s->headless = headless || get_int(CFG_HEADLESS);
+    if((format = capture_format_code(get_string(CFG_CAPTURE_FORMAT))) < 0) {
+    	fprintf(stderr, "Unknown %s '%s', using png\n", CFG_CAPTURE_FORMAT,
+    			get_string(CFG_CAPTURE_FORMAT));
+    	format = CAPTURE_PNG;
+    }
+    if(capture_init(&s->capture, get_string(CFG_CAPTURE_PATH), format,
+    		get_float(CFG_CAPTURE_INTERVAL), get_int(CFG_CAPTURE_FPS),
+    		get_int(CFG_CAPTURE_THREADS), get_int(CFG_CAPTURE_QUEUE))) {
+    	return(-6);
+    }
+
+    /* dual-rate subscription sent with each heartbeat */
+    s->tracked_types = particle_type_mask(get_string(CFG_TRACKED_TYPES));
+    s->tracked_stride = s->tracked_types ? get_int(CFG_TRACKED_STRIDE) : 0;
+    s->full_stride = get_int(CFG_FULL_STRIDE);
 
     arcball_init(&s->arcball, get_int(CFG_WIN_WIDTH), get_int(CFG_WIN_HEIGHT));
     Quaternion_loadIdentity(&s->arcball_rotation);
@@ -529,13 +876,30 @@ int initialize_application(seewaves_t *s, int argc, char **argv) {
     Matrix_loadIdentity(&s->arcball_last_rotation);
     Matrix_loadIdentity(&s->arcball_this_rotation);
 
-    /* initialize our mutex lock used to safely update data */
-    if ((err = pthread_mutex_init(&s->lock, NULL))) {
+    /* initialize our mutex locks used to safely update data */
+    if ((err = pthread_mutex_init(&s->lock, NULL)) ||
+        (err = pthread_mutex_init(&s->publish_lock, NULL)) ||
+        (err = pthread_mutex_init(&s->store_lock, NULL))) {
         PT_ERR_MSG("pthread_mutex_init", err);
         return(-1);
     }
 
-    /* create data thread */
+    /* packets pass from the data thread to the publish thread */
+    if (packet_queue_init(&s->queue, (unsigned int)get_int(CFG_INGEST_QUEUE))) {
+        return(-1);
+    }
+
+    /* frames are drawn when the publish thread or input asks for one */
+    if (redraw_init(&s->redraw)) {
+        return(-1);
+    }
+
+    /* create publish thread, then the data thread feeding it */
+    if ((err = pthread_create(&s->publish_thread, NULL,
+                                data_thread_publish_main, (void*)s))) {
+        PT_ERR_MSG("publish pthread_create", err);
+        return(-2);
+    }
     if ((err = pthread_create(&s->data_thread, NULL, data_thread_main,
                                 (void*)s))) {
         PT_ERR_MSG("data pthread_create", err);
@@ -600,6 +964,15 @@ void initialize_gl(seewaves_t *s) {
     /* prepare for modeling and viewing transforms */
     glMatrixMode(GL_MODELVIEW);
     glLoadIdentity();
+
+	/* particle vertices live in a buffer object where available */
+	vbo_init(&s->vbo);
+	stream_init(&s->stream);
+	sprite_init(&s->sprite);
+	scene_init(&s->scene);
+	if(hud_init(&s->hud, get_int(CFG_HUD_SCALE), get_float(CFG_HUD_REFRESH))) {
+		exit(EXIT_FAILURE);
+	}
 }
 
 /*
@@ -612,30 +985,18 @@ Leaves matrix unchanged.
 @param	s	String to render
 */
 void render_string(GLfloat x, GLfloat y, GLfloat z, char *s) {
-	/* string length */
-	int len;
-
-	/* iterator */
-	int i;
-
 	/* sanity check */
 	assert((s) && (*s));
 
+	/* text is drawn over the scene, depth plays no part */
+	(void)z;
+
 	/* save matrix state */
 	glPushMatrix();
 	glLoadIdentity();
 
-	/* set starting position */
-	glRasterPos3f(x, y, z);
-
-	/* get string length */
-	len = (int) strlen(s);
-
-	/* loop through all characters */
-	for (i = 0; i < len; i++) {
-		/* render bitmap character */
-		glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, s[i]);
-	}
+	/* draw from the glyph atlas */
+	hud_string(&g_seewaves.hud, x, y, s);
 
 	/* restart matrix state */
 	glPopMatrix();
@@ -687,153 +1048,38 @@ void render_fading_text(GLfloat x, GLfloat y, GLfloat z, char *s, GLfloat t) {
 	g_seewaves.fade_duration = t;
 }
 
-void render_grid_sub(float extent, float space) {
-	float threshold = 0.000009;
-	float result;
-	float x;
-	float y;
-	int count = (int)(extent/space);
-	int i;
-	for(i = 0; i < count; i++) {
-		x = space * i;
-		errno = 0;
-		result = fmodf(x, space * 10.0);
-		if(errno) {
-			perror("fmodf");
-			continue;
-		}
-		if(result < threshold) {
-			continue;
-		}
-		glVertex3f(x, 0.0, 0.0);
-		glVertex3f(x, extent, 0.0);
-	}
-	for(i = 0; i < count; i++) {
-		y = space * i;
-		errno = 0;
-		result = fmodf(y, space * 10.0);
-		if(errno) {
-			perror("fmodf");
-			continue;
-		}
-		if(result < threshold) {
-			continue;
-		}
-		glVertex3f(0.0, y, 0.0);
-		glVertex3f(extent, y, 0.0);
-	}
-}
-
-void render_grid(GLfloat extent) {
-	GLfloat color = 0.9;
-	GLfloat grid_large_color = 0.7;
-	GLfloat grid_medium_color = 0.8;
-	GLfloat grid_small_color = 0.9;
-	glColor3f(color, color, color);
-	glBegin(GL_LINES);
-	/* Draw smaller grid cells */
-	glColor3f(grid_small_color, grid_small_color, grid_small_color);
-	render_grid_sub(extent, 0.1);
-	/* Draw medium grid cells */
-	glColor3f(grid_medium_color, grid_medium_color, grid_medium_color);
-	render_grid_sub(extent, 1.0);
-	/* Draw large grid cells */
-	glColor3f(grid_large_color, grid_large_color, grid_large_color);
-	render_grid_sub(extent, 10.0);
-	glEnd();
-}
-
 #define OBJECTPART (6 << 4)
 
-void render_axes(float x, float y, float z, float length) {
-	glTranslatef(x, y, z);
-	glBegin(GL_LINES);
-		/* x axis */
-		glColor3f(1.0, 0.0, 0.0);
-		glVertex3f(0.0, 0.0, 0.0);
-		glVertex3f(length, 0.0, 0.0);
-
-		/* y axis (rotated to match model) */
-		glColor3f(0.0, 0.0, 1.0);
-		glVertex3f(0.0, 0.0, 0.0);
-		glVertex3f(0.0, length, 0.0);
-
-		/* z axis (rotated to match model) */
-		glColor3f(0.0, 1.0, 0.0);
-		glVertex3f(0.0, 0.0, 0.0);
-		glVertex3f(0.0, 0.0, length);
-	glEnd();
-}
-
-void render_box(float origin[3], float size[3]) {
-	if((size[0] == 0.0) || (size[1] == 0.0) || (size[2] == 0.0)) {
-		return;
-	}
-
-	/* move to origin */
-	glTranslatef(origin[0], origin[1], origin[2]);
-
-	/* draw back side */
-	glColor4f(1.0, 0.0, 0.0, 0.04);
-	glRectf(0.0, 0.0, size[0], size[2]);
-
-	glTranslatef(size[0], 0.0, 0.0);
-	glRotatef(270.0, 0.0, 1.0, 0.0);
-	glRectf(0.0, 0.0, size[1], size[2]);
-
-	glTranslatef(size[1], 0.0, 0.0);
-	glRotatef(270.0, 0.0, 1.0, 0.0);
-	glRectf(0.0, 0.0, size[0], size[2]);
-
-	glTranslatef(size[0], 0.0, 0.0);
-	glRotatef(270.0, 0.0, 1.0, 0.0);
-	glRectf(0.0, 0.0, size[1], size[2]);
-
-	glTranslatef(size[1], 0.0, 0.0);
-	glRotatef(90.0, 1.0, 0.0, 0.0);
-	glRotatef(90.0, 0.0, 0.0, 1.0);
-	glRectf(0.0, 0.0, size[0], size[1]);
-}
-
 /*
 Called from main loop to render the scene.
 
 @returns 1 if redrawn, 0 if unchanged
 */
 int display(void) {
-	/* A more full-featured config will solve this hack */
-	float fluid_color[3];
-	float boundary_color[3];
-	float piston_color[3];
-	float paddle_color[3];
-	float gate_color[3];
-	float object_color[3];
-	float testpoint_color[3];
-	float surface_color[3];
-
-	get_float3(CFG_FLUID_COLOR, fluid_color);
-	get_float3(CFG_BOUNDARY_COLOR, boundary_color);
-	get_float3(CFG_PISTON_COLOR, piston_color);
-	get_float3(CFG_PADDLE_COLOR, paddle_color);
-	get_float3(CFG_GATE_COLOR, gate_color);
-	get_float3(CFG_OBJECT_COLOR, object_color);
-	get_float3(CFG_SURFACE_COLOR, surface_color);
-
-	unsigned int particles_in_current_timestep = 0;
+	unsigned int particles_in_current_timestep;
 
     /* return value */
     int err;
 
     /* loop iterator */
-    unsigned int i;
+    int i;
+
+    /* live or replayed frame */
+    store_t *view = g_seewaves.view ? g_seewaves.view : &g_seewaves.store;
+
+    /* sphere program if drawing spheres, and their radius */
+    sprite_t *sprite;
+    float radius;
+    cull_t *cull;
+    lod_t *lod;
 
     /* world extent */
 	GLfloat extent = 100;
 
-    /* cache eye for speed */
-    GLfloat eye[3];
-    GLfloat up[3];
-    GLfloat target[3];
+    /* camera, straight from the configuration */
+    const GLfloat *eye = g_seewaves.settings.eye_pos;
+    const GLfloat *up = g_seewaves.settings.eye_up;
+    const GLfloat *target = g_seewaves.settings.eye_target;
 
 	/* setup viewport for this rendering */
 	glViewport(g_seewaves.viewport_main[0], g_seewaves.viewport_main[1],
@@ -843,7 +1089,7 @@ int display(void) {
 	glMatrixMode(GL_PROJECTION);
     glLoadIdentity();
     gluPerspective(82.5, g_seewaves.viewport_main[2] / g_seewaves.viewport_main[3],
-    		get_float(CFG_ZNEAR), get_float(CFG_ZFAR));
+    		*g_seewaves.settings.znear, *g_seewaves.settings.zfar);
 
     /* prepare for modeling and viewing transforms */
     glMatrixMode(GL_MODELVIEW);
@@ -862,25 +1108,17 @@ int display(void) {
 	*/
 
 
-    /* try to lock shared data */
-#ifdef LOCK
-    if ((err = pthread_mutex_trylock(&g_seewaves.lock))) {
-    	/* already locked */
-        if(err != EBUSY) {
-            perror("Error locking mutex during display");
-        }
+    /* the publish thread changes the store only briefly, wait for it */
+    if ((err = pthread_mutex_lock(&g_seewaves.store_lock))) {
+        fprintf(stderr, "Error locking mutex: %i\n", err);
         return(0);
     }
-#endif
 
 	glPushMatrix();
 	glMultMatrixf(g_seewaves.arcball_transform.m);
 
 
     /* aim the camera */
-    get_float3(CFG_EYE_POS, eye);
-    get_float3(CFG_EYE_UP, up);
-    get_float3(CFG_EYE_TARGET, target);
     gluLookAt(
         eye[0],
         eye[1],
@@ -900,70 +1138,100 @@ int display(void) {
     glTranslatef(-g_seewaves.rotation_center[0],-g_seewaves.rotation_center[2],
     		-g_seewaves.rotation_center[1]);
 
+    /* keep the scene transforms for picking */
+    glGetDoublev(GL_MODELVIEW_MATRIX, g_seewaves.pick_modelview);
+    glGetDoublev(GL_PROJECTION_MATRIX, g_seewaves.pick_projection);
+    glGetIntegerv(GL_VIEWPORT, g_seewaves.pick_viewport);
+
     glPointSize(g_seewaves.point_size_range[0]);
 	glLineWidth(g_seewaves.line_width_range[0]);
 
+    /* grids, axes and world box are rebuilt only when the world changes */
+    (void)scene_update(&g_seewaves.scene, g_seewaves.world_origin,
+    		g_seewaves.world_size, extent);
+
     /* does user want grid displayed? */
     if (g_seewaves.view_options & (1 << GRID)) {
-    	glPushMatrix();
-    	render_grid(extent);
-    	glRotatef(90.0, 1.0, 0.0, 0.0);
-    	render_grid(extent);
-    	glRotatef(90.0, 0.0, 1.0, 0.0);
-    	render_grid(extent);
-    	glPopMatrix();
+    	scene_draw(&g_seewaves.scene, SCENE_GRID);
     }
 
     /* does user want axes displayed? */
     if (g_seewaves.view_options & (1 << AXES)) {
-    	glPushMatrix();
-    	render_axes(0.0, 0.0, 0.0, extent);
-    	glPopMatrix();
+    	scene_draw(&g_seewaves.scene, SCENE_AXES);
     }
 
     /* does user want rotation center axes displayed? */
     if (g_seewaves.view_options & (1 << ROTATION_AXES)) {
     	glPushMatrix();
-    	render_axes(g_seewaves.rotation_center[0], g_seewaves.rotation_center[1],
-    			g_seewaves.rotation_center[2], 100.0);
+    	glTranslatef(g_seewaves.rotation_center[0], g_seewaves.rotation_center[1],
+    			g_seewaves.rotation_center[2]);
+    	scene_draw(&g_seewaves.scene, SCENE_AXES);
     	glPopMatrix();
     }
 
     /* draw particles */
-    glBegin(GL_POINTS);
-    for(i = 0; i < g_seewaves.total_particle_count; i++) {
-    	short ptype = g_seewaves.particle_type[i];
-    	if(g_seewaves.t[i] == g_seewaves.most_recent_timestamp) {
-    		particles_in_current_timestep++;
+    /* the publish thread keeps vertices render-ready, draw them as they are */
+    particles_in_current_timestep = view->current_count;
+    if(view->count > 0) {
+    	/* streaming moves the live store's vertices in and out of the ring,
+    	 * between passes of the publish thread, trying again next frame */
+    	if(view == &g_seewaves.store && (g_seewaves.render_mode ==
+    			RENDER_STREAM) != (g_seewaves.stream.store != NULL) &&
+    			pthread_mutex_trylock(&g_seewaves.publish_lock) == 0) {
+    		if(g_seewaves.render_mode != RENDER_STREAM) {
+    			stream_detach(&g_seewaves.stream, view);
+    		} else if(stream_attach(&g_seewaves.stream, view)) {
+    			g_seewaves.render_mode = RENDER_VBO;
+    		}
+    		pthread_mutex_unlock(&g_seewaves.publish_lock);
     	}
-        if(ptype == 0) {
-    		glColor3f(fluid_color[0], fluid_color[1], fluid_color[2]);
-        } else if(ptype == 16) {
-    		glColor3f(boundary_color[0], boundary_color[1], boundary_color[2]);
-        } else if(ptype == 32) {
-    		glColor3f(piston_color[0], piston_color[1], piston_color[2]);
-        } else if(ptype == 48) {
-    		glColor3f(paddle_color[0], paddle_color[1], paddle_color[2]);
-        } else if(ptype == 64) {
-    		glColor3f(gate_color[0], gate_color[1], gate_color[2]);
-        } else if(ptype == 80) {
-    		glColor3f(object_color[0], object_color[1], object_color[2]);
-        } else if(ptype == 96) {
-    		glColor3f(testpoint_color[0], testpoint_color[1], testpoint_color[2]);
-        } else if(ptype == 256) {
-    		glColor3f(surface_color[0], surface_color[1], surface_color[2]);
-    	} else {
-        	glColor3f(0.5, 0.5, 0.5);
+    	/* spheres of the configured radius, or half the spacing of evenly
+    	 * spread particles; type colors come from the lookup texture */
+    	sprite = NULL;
+    	radius = g_seewaves.particle_radius > 0.0f ? g_seewaves.particle_radius :
+    			0.5f * cbrtf(g_seewaves.world_size[0] * g_seewaves.world_size[1] *
+    			g_seewaves.world_size[2] / view->count);
+    	if(g_seewaves.spheres && radius > 0.0f) {
+    		sprite_palette(&g_seewaves.sprite, &view->palette);
+    		if(sprite_begin(&g_seewaves.sprite, radius,
+    				g_seewaves.pick_viewport[3]) == 0) {
+    			sprite = &g_seewaves.sprite;
+    		}
+    	}
+    	/* octree nodes up to the point budget, or else chunks in view;
+    	 * spheres reach a radius past their centers */
+    	lod = NULL;
+    	cull = NULL;
+    	if(g_seewaves.leveling && lod_select(&g_seewaves.lod, view,
+    			g_seewaves.pick_modelview, g_seewaves.pick_projection,
+    			g_seewaves.pick_viewport[3], sprite != NULL ? radius : 0.0f,
+    			g_seewaves.hidden_types) == 0) {
+    		lod = &g_seewaves.lod;
+    	} else if(g_seewaves.culling && cull_frustum(&g_seewaves.cull, view,
+    			&g_seewaves.pool, g_seewaves.pick_modelview,
+    			g_seewaves.pick_projection, sprite != NULL ? radius : 0.0f) == 0) {
+    		cull = &g_seewaves.cull;
+    	}
+    	g_seewaves.leveled = lod != NULL;
+    	g_seewaves.culled = cull != NULL;
+    	/* buffer object uploads changed chunks only */
+    	g_seewaves.render_used = render_particles(&g_seewaves.vbo,
+    			&g_seewaves.stream, sprite, cull, lod, view,
+    			g_seewaves.render_mode, g_seewaves.hidden_types);
+    	if(sprite != NULL) {
+    		sprite_end(sprite);
+    	}
+    	if(g_seewaves.render_used == RENDER_VBO) {
+    		g_seewaves.upload_bytes = g_seewaves.upload_bytes * 0.9 +
+    				g_seewaves.vbo.last_bytes * 0.1;
+    		g_seewaves.upload_share = g_seewaves.upload_share * 0.9 +
+    				(double)g_seewaves.vbo.last_bytes /
+    				g_seewaves.vbo.full_bytes * 0.1;
     	}
-		glVertex3f(g_seewaves.x[i], g_seewaves.z[i], g_seewaves.y[i]);
     }
-    glEnd();
 
     /* render world box (render last for opacity to work */
-    glColor4f(0.0, 0.0, 0.0, 0.5);
-    glPushMatrix();
-    render_box(g_seewaves.world_origin, g_seewaves.world_size);
-    glPopMatrix();
+    scene_draw(&g_seewaves.scene, SCENE_BOX);
 
     /* is heads up display enabled? */
     if (g_seewaves.view_options & (1 << HEADS_UP)) {
@@ -989,51 +1257,221 @@ int display(void) {
     	/* switch to ortho mode */
     	push_ortho();
 
-    	/* render network status */
-    	if(g_seewaves.total_particle_count == 0) {
-    		loss = 0.0;
-    	} else {
-    		loss = particles_in_current_timestep /
-    				g_seewaves.total_particle_count * 100.0;
+    	/* regenerate the lines at the refresh rate, the atlas draws them */
+    	if(hud_begin(&g_seewaves.hud, frame_time())) {
+    		/* render network status */
+    		if(g_seewaves.total_particle_count == 0) {
+    			loss = 0.0;
+    		} else {
+    			loss = particles_in_current_timestep /
+    					g_seewaves.total_particle_count * 100.0;
+    		}
+    		sprintf(status_msg, "network: outgoing(%s:%i:%i) incoming(%s:%i:%i)",
+    				g_seewaves.gpusph_host, g_seewaves.gpusph_port,
+    				g_seewaves.heartbeats_sent,
+    				g_seewaves.data_host, g_seewaves.data_port,
+    				g_seewaves.packets_received);
+    		hud_line(&g_seewaves.hud, x, y, status_msg);
+    		y += y_inc;
+
+    		/* render model status */
+    		sprintf(status_msg, "model: particles(%i, %i, %.2f%%) time(%.3fs) steps(%i) id(%u)",
+    				g_seewaves.total_particle_count,
+    				particles_in_current_timestep, loss,
+    				g_seewaves.most_recent_timestamp,
+    				g_seewaves.total_timesteps,
+    				g_seewaves.model_id);
+    		hud_line(&g_seewaves.hud, x, y, status_msg);
+    		y += y_inc;
+
+    		/* render frame completeness status */
+    		sprintf(status_msg, "frames: complete(%i/%i) keyframes(%i/%i) nacks(%i) retransmits(%i)",
+    				g_seewaves.completeness.frames_complete,
+    				g_seewaves.completeness.frames_seen,
+    				g_seewaves.completeness.keyframes_complete,
+    				g_seewaves.completeness.keyframes_seen,
+    				g_seewaves.completeness.nacks_sent,
+    				g_seewaves.completeness.retransmits_received);
+    		hud_line(&g_seewaves.hud, x, y, status_msg);
+    		y += y_inc;
+
+    		/* render particle counts by type, hidden types in brackets */
+    		status_msg[0] = '\0';
+    		for(i = 0; i < STORE_TYPE_COUNT; i++) {
+    			char type_msg[64];
+    			unsigned int count = store_type_count(view, i);
+    			if(count == 0) {
+    				continue;
+    			}
+    			sprintf(type_msg, g_seewaves.hidden_types & (1 << i) ? "[%i:%s(%u)] " :
+    					"%i:%s(%u) ", i + 1, particle_type_name(i), count);
+    			strcat(status_msg, type_msg);
+    		}
+    		if(status_msg[0] != '\0') {
+    			hud_line(&g_seewaves.hud, x, y, status_msg);
+    			y += y_inc;
+    		}
+
+    		/* render frame time and store footprint */
+    		sprintf(status_msg, "render: frame(%.2fms %.0ffps %s %s) store(%.1fMB %s)",
+    				g_seewaves.frame_ms, g_seewaves.fps,
+    				render_mode_name(g_seewaves.render_used),
+    				g_seewaves.spheres && g_seewaves.sprite.program ? "spheres" :
+    				"points",
+    				store_bytes(&g_seewaves.store) / (1024.0 * 1024.0),
+    				store_policy_name());
+    		hud_line(&g_seewaves.hud, x, y, status_msg);
+    		y += y_inc;
+
+    		/* render particles submitted after frustum culling */
+    		if(g_seewaves.culled) {
+    			cull_t *c = &g_seewaves.cull;
+    			sprintf(status_msg, "cull: chunks(%u/%u) submitted(%u %.1f%%) test(%.3fms) bounds(%.2fms)",
+    					c->last_visible, c->visible_chunks, c->last_submitted,
+    					view->count ? 100.0 * c->last_submitted / view->count : 0.0,
+    					c->last_cull_seconds * 1000.0,
+    					c->last_bound_seconds * 1000.0);
+    			hud_line(&g_seewaves.hud, x, y, status_msg);
+    			y += y_inc;
+    		}
+
+    		/* render octree nodes and particles drawn against the budget */
+    		if(g_seewaves.leveled) {
+    			lod_t *l = &g_seewaves.lod;
+    			sprintf(status_msg, "lod: nodes(%u/%u) drawn(%u %.1f%%) budget(%llu%s) select(%.3fms) build(%.2fms)",
+    					l->last_nodes, l->node_count, l->last_points,
+    					view->count ? 100.0 * l->last_points / view->count : 0.0,
+    					l->last_budget, l->refining ? " refining" : "",
+    					l->last_select_seconds * 1000.0,
+    					l->last_build_seconds * 1000.0);
+    			hud_line(&g_seewaves.hud, x, y, status_msg);
+    			y += y_inc;
+    		}
+
+    		/* render frames written and waiting to be encoded */
+    		if(g_seewaves.capture.enabled) {
+    			capture_t *c = &g_seewaves.capture;
+    			sprintf(status_msg, "capture: %s frames(%llu) pending(%u) dropped(%llu) errors(%llu) encode(%.2fms) read(%.2fms)",
+    					capture_format_name(c->format), c->captured,
+    					capture_pending(c), c->dropped, c->errors,
+    					c->encoded ? c->encode_seconds * 1000.0 / c->encoded : 0.0,
+    					c->last_read_seconds * 1000.0);
+    			hud_line(&g_seewaves.hud, x, y, status_msg);
+    			y += y_inc;
+    		}
+
+    		/* render vertex upload traffic against uploading everything */
+    		if(g_seewaves.vbo.updates > 0) {
+    			sprintf(status_msg, "upload: frame(%.2fMB %.1f%% of full) total(%.1fMB saved %.1f%%)",
+    					g_seewaves.upload_bytes / (1024.0 * 1024.0),
+    					g_seewaves.upload_share * 100.0,
+    					g_seewaves.vbo.bytes / (1024.0 * 1024.0),
+    					100.0 - 100.0 * g_seewaves.vbo.bytes /
+    					g_seewaves.vbo.bytes_if_full);
+    			hud_line(&g_seewaves.hud, x, y, status_msg);
+    			y += y_inc;
+    		}
+
+    		/* render streaming ring traffic, copies made to catch buffers up */
+    		if(g_seewaves.stream.store != NULL) {
+    			sprintf(status_msg, "stream: published(%llu) stalls(%llu) catchup(%.2fMB)",
+    					g_seewaves.stream.published, g_seewaves.stream.stalls,
+    					g_seewaves.stream.last_catchup_bytes / (1024.0 * 1024.0));
+    			hud_line(&g_seewaves.hud, x, y, status_msg);
+    			y += y_inc;
+    		}
+
+    		/* render spatial index status */
+    		if(g_seewaves.grid.builds > 0) {
+    			sprintf(status_msg, "grid: cells(%u) build(%.2fms) order(%.2fms %u) threads(%i)",
+    					g_seewaves.grid.cells,
+    					g_seewaves.grid.last_build_seconds * 1000.0,
+    					g_seewaves.order.last_sort_seconds * 1000.0,
+    					g_seewaves.order.last_descents,
+    					g_seewaves.pool.threads);
+    			hud_line(&g_seewaves.hud, x, y, status_msg);
+    			y += y_inc;
+    		}
+
+    		/* render particle ids outside the dense range, if any */
+    		if(g_seewaves.ids.hashed > 0 || g_seewaves.ids.dropped > 0) {
+    			sprintf(status_msg, "ids: free(%u/%u) hashed(%u %.2f probes/lookup) dropped(%llu) mem(%.1fMB)",
+    					g_seewaves.ids.free_count - g_seewaves.ids.free_next,
+    					g_seewaves.ids.capacity, g_seewaves.ids.hashed, g_seewaves.ids.lookups ?
+    					(double)g_seewaves.ids.probes / g_seewaves.ids.lookups : 0.0,
+    					g_seewaves.ids.dropped,
+    					idmap_bytes(&g_seewaves.ids) / (1024.0 * 1024.0));
+    			hud_line(&g_seewaves.hud, x, y, status_msg);
+    			y += y_inc;
+    		}
+
+    		/* render derived speed */
+    		if(motion_enabled(&g_seewaves.motion) &&
+    				g_seewaves.motion.derives > 0) {
+    			motion_stats_t *st = &g_seewaves.motion.stats;
+    			sprintf(status_msg, "speed: min(%.3f) max(%.3f) mean(%.3f) sampled(%u) stale(%u) derive(%.2fms)%s",
+    					st->min_speed, st->max_speed,
+    					st->sampled ? st->sum_speed / st->sampled : 0.0,
+    					st->sampled, st->stale,
+    					g_seewaves.motion.last_derive_seconds * 1000.0,
+    					g_seewaves.motion.color ? " colored" : "");
+    			hud_line(&g_seewaves.hud, x, y, status_msg);
+    			y += y_inc;
+    		}
+
+    		/* render picked particle */
+    		if(g_seewaves.picked >= 0) {
+    			sprintf(status_msg, "pick: id(%i) position(%.3f, %.3f, %.3f)",
+    					g_seewaves.picked, g_seewaves.picked_position[0],
+    					g_seewaves.picked_position[1], g_seewaves.picked_position[2]);
+    			hud_line(&g_seewaves.hud, x, y, status_msg);
+    			y += y_inc;
+    		}
+
+    		/* render history and replay status */
+    		if(g_seewaves.history.frames_added > 0) {
+    			history_t *h = &g_seewaves.history;
+    			replay_t *r = &g_seewaves.replay;
+    			char mode_msg[64];
+    			if(r->mode == REPLAY_PLAYING) {
+    				sprintf(mode_msg, "playing(x%.2f t=%.3fs)", r->rate, r->decoded_t);
+    			} else if(r->mode == REPLAY_PAUSED) {
+    				sprintf(mode_msg, "paused(t=%.3fs)", r->decoded_t);
+    			} else {
+    				sprintf(mode_msg, "live");
+    			}
+    			sprintf(status_msg,
+    					"history: frames(%u) mem(%.1fMB %.1fKB/frame) decode(%.1fM/s) %s",
+    					h->length, h->bytes / (1024.0 * 1024.0),
+    					h->length ? h->bytes / 1024.0 / h->length : 0.0,
+    					h->decode_seconds > 0.0 ?
+    					h->decoded_particles / h->decode_seconds / 1e6 : 0.0,
+    					mode_msg);
+    			hud_line(&g_seewaves.hud, x, y, status_msg);
+    			y += y_inc;
+    		}
+
+    		/* render camera status (rotated to match model) */
+    		sprintf(status_msg,
+    				"camera: eye(%.2f, %.2f, %.2f) eye_ctr(%.2f, %.2f, %.2f) rot_ctr(%.2f, %.2f, %.2f) rot(%.2f, %.2f)",
+    				eye[0], eye[2], eye[1],
+    				target[0], target[2], target[1],
+    				rotation_center[0], rotation_center[2], rotation_center[1],
+    				g_seewaves.model_rotation[0], g_seewaves.model_rotation[1]);
+    		hud_line(&g_seewaves.hud, x, y, status_msg);
+    		hud_end(&g_seewaves.hud);
     	}
-    	sprintf(status_msg, "network: outgoing(%s:%i:%i) incoming(%s:%i:%i)",
-    			g_seewaves.gpusph_host, g_seewaves.gpusph_port,
-    			g_seewaves.heartbeats_sent,
-    			g_seewaves.data_host, g_seewaves.data_port,
-    			g_seewaves.packets_received);
-    	render_string(x, y, 0.5f, status_msg);
-    	y += y_inc;
-
-    	/* render model status */
-    	sprintf(status_msg, "model: particles(%i, %i, %.2f%%) time(%.3fs) steps(%i) id(%u)",
-    			g_seewaves.total_particle_count,
-    			particles_in_current_timestep, loss,
-    			g_seewaves.most_recent_timestamp,
-    			g_seewaves.total_timesteps,
-    			g_seewaves.model_id);
-    	render_string(x, y, 0.5f, status_msg);
-    	y += y_inc;
-
-    	/* render camera status (rotated to match model) */
-    	sprintf(status_msg,
-    			"camera: eye(%.2f, %.2f, %.2f) eye_ctr(%.2f, %.2f, %.2f) rot_ctr(%.2f, %.2f, %.2f) rot(%.2f, %.2f)",
-    			eye[0], eye[2], eye[1],
-    			target[0], target[2], target[1],
-    			rotation_center[0], rotation_center[2], rotation_center[1],
-    			g_seewaves.model_rotation[0], g_seewaves.model_rotation[1]);
-    	render_string(x, y, 0.5f, status_msg);
+    	hud_draw(&g_seewaves.hud);
 
     	/* switch back */
     	pop_ortho();
     	glPopMatrix();
     }
 
-#ifdef LOCK
     /* unlock data */
-    if ((err = pthread_mutex_unlock(&g_seewaves.lock))) {
+    if ((err = pthread_mutex_unlock(&g_seewaves.store_lock))) {
         fprintf(stderr, "Error unlocking mutex: %i\n", err);
     }
-#endif
 
     /* handle fading text */
     if(g_seewaves.fade_start != 0) {
@@ -1090,7 +1528,67 @@ GLdouble *z) {
     gluUnProject( winX, winY, winZ, modelview, projection, viewport, x, y, z);
 }
 
+/*
+Pick the particle under the mouse by casting a ray through the spatial index.
+Uses the transforms saved by the last display().
+
+@param	mx	mouse x, window coordinates
+@param	my	mouse y, window coordinates
+*/
+void pick_particle(int mx, int my) {
+	GLdouble near[3];
+	GLdouble far[3];
+	GLdouble win_y = *g_seewaves.settings.win_height - my;
+	float origin[3];
+	float dir[3];
+	int id;
+	uint32_t wire_id = IDMAP_NONE;
+
+	g_seewaves.picked = -1;
+
+	/* the index follows the live store, not a replayed frame */
+	if(g_seewaves.view != NULL) {
+		return;
+	}
+	if(!gluUnProject(mx, win_y, 0.0, g_seewaves.pick_modelview,
+			g_seewaves.pick_projection, g_seewaves.pick_viewport,
+			&near[0], &near[1], &near[2]) ||
+			!gluUnProject(mx, win_y, 1.0, g_seewaves.pick_modelview,
+			g_seewaves.pick_projection, g_seewaves.pick_viewport,
+			&far[0], &far[1], &far[2])) {
+		return;
+	}
+
+	/* GL order is x, z, y */
+	origin[0] = near[0];
+	origin[1] = near[2];
+	origin[2] = near[1];
+	dir[0] = far[0] - near[0];
+	dir[1] = far[2] - near[2];
+	dir[2] = far[1] - near[1];
+
+	pthread_mutex_lock(&g_seewaves.publish_lock);
+	id = grid_ray(&g_seewaves.grid, origin, dir, g_seewaves.grid.cell * 0.5f,
+			NULL);
+	if(id >= 0) {
+		pthread_mutex_lock(&g_seewaves.lock);
+		wire_id = idmap_id(&g_seewaves.ids, id);
+		pthread_mutex_unlock(&g_seewaves.lock);
+	}
+	if(id >= 0 && wire_id != IDMAP_NONE) {
+		/* vertices hold positions in GL order, x, z, y */
+		const float *p = g_seewaves.store.vertex[store_slot(&g_seewaves.store,
+				id)].pos;
+		g_seewaves.picked = (int)wire_id;
+		g_seewaves.picked_position[0] = p[0];
+		g_seewaves.picked_position[1] = p[2];
+		g_seewaves.picked_position[2] = p[1];
+	}
+	pthread_mutex_unlock(&g_seewaves.publish_lock);
+}
+
 void GLFWCALL on_mouse_button(int button, int action) {
+	redraw_post(&g_seewaves.redraw, REDRAW_INPUT);
 	g_seewaves.mouse_button = button;
 	g_seewaves.mouse_button_action = action;
 	if((g_seewaves.mouse_button == GLFW_MOUSE_BUTTON_LEFT) &&
@@ -1098,6 +1596,9 @@ void GLFWCALL on_mouse_button(int button, int action) {
 		g_seewaves.arcball_last_rotation = g_seewaves.arcball_this_rotation;
 		arcball_click(&g_seewaves.arcball, g_seewaves.mouse_x, g_seewaves.mouse_y);
 	}
+	if((button == GLFW_MOUSE_BUTTON_RIGHT) && (action == GLFW_PRESS)) {
+		pick_particle(g_seewaves.mouse_x, g_seewaves.mouse_y);
+	}
 }
 
 /*
@@ -1108,6 +1609,7 @@ void GLFWCALL on_mouse(int x, int y) {
 	g_seewaves.mouse_y = y;
 	if((g_seewaves.mouse_button == GLFW_MOUSE_BUTTON_LEFT) &&
 		(g_seewaves.mouse_button_action == GLFW_PRESS)) {
+		redraw_post(&g_seewaves.redraw, REDRAW_INPUT);
 		arcball_drag(&g_seewaves.arcball, x, y, &g_seewaves.arcball_rotation);
 		Matrix m = Quaternion_toMatrix(g_seewaves.arcball_rotation);
 		Matrix_withMatrix(&g_seewaves.arcball_this_rotation, &m);
@@ -1124,6 +1626,7 @@ void GLFWCALL on_mouse_wheel(int pos) {
 	int diff = pos - g_seewaves.mouse_wheel_pos;
 #endif
 	if(diff != 0) {
+		redraw_post(&g_seewaves.redraw, REDRAW_INPUT);
 		camera_dolly(diff);
 		g_seewaves.mouse_wheel_pos = pos;
 	}
@@ -1136,6 +1639,7 @@ Called when a key is pressed or released.
 @param	action	Either GLFW_RELEASE or GLFW_PRESS
 */
 void GLFWCALL on_key(int key, int action) {
+	redraw_post(&g_seewaves.redraw, REDRAW_INPUT);
     switch(key) {
         case GLFW_KEY_ESC:
             g_seewaves.flag_exit_main_loop = 1;
@@ -1165,6 +1669,7 @@ whereas glfwSetKeyCallback() behaves as expected.
 void GLFWCALL on_char(int key, int action) {
 	/* eliminate compiler warning since we don't use action */
 	(void)action;
+	redraw_post(&g_seewaves.redraw, REDRAW_INPUT);
 
 	/* which key was pressed? */
     switch(key) {
@@ -1247,6 +1752,84 @@ void GLFWCALL on_char(int key, int action) {
         	g_seewaves.view_options ^= 1 << GRID;
         	break;
         }
+        case 'v': {
+        	/* color fluid by speed or by type, the store is the publish thread's */
+        	pthread_mutex_lock(&g_seewaves.publish_lock);
+        	pthread_mutex_lock(&g_seewaves.store_lock);
+        	motion_set_color(&g_seewaves.motion, &g_seewaves.store,
+        			!g_seewaves.motion.color);
+        	pthread_mutex_unlock(&g_seewaves.store_lock);
+        	pthread_mutex_unlock(&g_seewaves.publish_lock);
+        	break;
+        }
+        case 'i': {
+        	/* spheres or points, takes effect on the next draw */
+        	g_seewaves.spheres = !g_seewaves.spheres;
+        	break;
+        }
+        case 'k': {
+        	/* skip chunks outside the view or draw everything */
+        	g_seewaves.culling = !g_seewaves.culling && g_seewaves.cull.enabled;
+        	break;
+        }
+        case 'l': {
+        	/* draw by level of detail or by chunk */
+        	g_seewaves.leveling = !g_seewaves.leveling && g_seewaves.lod.enabled;
+        	break;
+        }
+        case 'm': {
+        	/* next way of drawing particles, takes effect on the next draw */
+        	g_seewaves.render_mode = (g_seewaves.render_mode + 1) %
+        			RENDER_MODE_COUNT;
+        	break;
+        }
+        case 'p':
+        case ' ':
+        case ',':
+        case '.':
+        case '-':
+        case '=':
+        case 'b': {
+        	/* replay controls, the history is shared with the publish thread */
+        	replay_t *r = &g_seewaves.replay;
+        	if(!g_seewaves.history.max_frames && !g_seewaves.history.max_bytes) {
+        		fprintf(stderr, "No replay history, set %s or %s (--history)\n",
+        				CFG_HISTORY_FRAMES, CFG_HISTORY_MEGABYTES);
+        		break;
+        	}
+        	pthread_mutex_lock(&g_seewaves.publish_lock);
+        	if(key == 'p') {
+        		/* pause the live view or go back to it */
+        		if(r->mode == REPLAY_LIVE) {
+        			replay_pause(r, &g_seewaves.history);
+        		} else {
+        			replay_live(r);
+        		}
+        	} else if(key == ' ') {
+        		/* play or stop */
+        		if(r->mode == REPLAY_PLAYING) {
+        			replay_pause(r, &g_seewaves.history);
+        		} else {
+        			replay_play(r, &g_seewaves.history, r->rate);
+        		}
+        	} else if(key == ',' || key == '.') {
+        		replay_step(r, &g_seewaves.history, key == ',' ? -1 : 1);
+        	} else if(key == '-') {
+        		r->rate /= 2.0;
+        	} else if(key == '=') {
+        		r->rate *= 2.0;
+        	} else {
+        		r->rate = -r->rate;
+        	}
+        	pthread_mutex_unlock(&g_seewaves.publish_lock);
+        	break;
+        }
+        case '1': case '2': case '3': case '4': case '5':
+        case '6': case '7': case '8': case '9': {
+        	/* show/hide a particle type, takes effect on the next draw */
+        	g_seewaves.hidden_types ^= 1 << (key - '1');
+        	break;
+        }
         case '?': {
         	g_seewaves.show_help = 1;
         	break;
@@ -1269,6 +1852,8 @@ Recalculates all dependencies.
 @param	h	new height
 */
 void on_resize(int w, int h) {
+	redraw_post(&g_seewaves.redraw, REDRAW_RESIZE);
+
 	/* cache the new window size internally */
 	cfg_set_int(&g_seewaves.config, CFG_WIN_WIDTH, w);
 	cfg_set_int(&g_seewaves.config, CFG_WIN_HEIGHT, h);
@@ -1287,53 +1872,110 @@ void on_resize(int w, int h) {
     arcball_set_bounds(&g_seewaves.arcball, (float)w, (float)h);
 }
 
+/*
+Time for frame pacing and the heads-up display.  Without a window glfw is not
+initialized, so the monotonic clock stands in.
+
+@returns seconds
+*/
+double frame_time(void) {
+	struct timespec ts;
+
+	if(!g_seewaves.headless) {
+		return(glfwGetTime());
+	}
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return(ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+/*
+Called on SIGINT or SIGTERM, when there is no window to close.  Ends the main
+loop so captured frames are written out before exiting.
+
+@param	sig	signal number
+*/
+void on_signal(int sig) {
+	(void)sig;
+	g_seewaves.flag_exit_main_loop = 1;
+}
+
 int main(int argc, char **argv) {
     /* return value */
     int err;
 
+    /* signal handler ending the main loop */
+    struct sigaction action;
+
     /* initialize the application */
     if ((err = initialize_application(&g_seewaves, argc, argv))) {
         exit(EXIT_FAILURE);
     }
 
-    /* we use glut just fonts right now */
+#ifdef SEEWAVES_GLUT
+    /* glut draws the heads-up display's text, see hud.h */
     glutInit(&argc, argv);
+#endif
 
-    /* initialize glfw */
-    if (!glfwInit()) {
-        exit(EXIT_FAILURE);
+    /* open the GL window, unless asked to draw offscreen */
+    if (!g_seewaves.headless) {
+        /* initialize glfw, without a window system draw offscreen instead */
+        if (!glfwInit()) {
+            fprintf(stderr, "No window system, drawing offscreen\n");
+            g_seewaves.headless = 1;
+        } else if (!glfwOpenWindow(get_int(CFG_WIN_WIDTH),
+        	get_int(CFG_WIN_HEIGHT),
+            g_seewaves.red_bits,
+            g_seewaves.green_bits,
+            g_seewaves.blue_bits,
+            g_seewaves.alpha_bits,
+            g_seewaves.depth_bits,
+            g_seewaves.stencil_bits,
+            g_seewaves.display_mode)) {
+            /* no display, so draw offscreen instead */
+            glfwTerminate();
+            fprintf(stderr, "No window opened, drawing offscreen\n");
+            g_seewaves.headless = 1;
+        }
     }
 
-    /* open the GL window */
-    if (!glfwOpenWindow(get_int(CFG_WIN_WIDTH),
-    	get_int(CFG_WIN_HEIGHT),
-        g_seewaves.red_bits,
-        g_seewaves.green_bits,
-        g_seewaves.blue_bits,
-        g_seewaves.alpha_bits,
-        g_seewaves.depth_bits,
-        g_seewaves.stencil_bits,
-        g_seewaves.display_mode)) {
-        return(-1);
-    }
+    if (g_seewaves.headless) {
+        /* nothing shown, so frames are captured at the drawing's expense */
+        g_seewaves.capture.wait = 1;
 
-    glfwSetWindowTitle(get_string(CFG_WIN_TITLE));
+        /* a window-sized offscreen surface, never resized */
+        if (offscreen_open(&g_seewaves.offscreen, get_int(CFG_WIN_WIDTH),
+        		get_int(CFG_WIN_HEIGHT), g_seewaves.depth_bits)) {
+            return(-1);
+        }
+        on_resize(get_int(CFG_WIN_WIDTH), get_int(CFG_WIN_HEIGHT));
+    } else {
+        glfwSetWindowTitle(get_string(CFG_WIN_TITLE));
+
+        /* set a keyboard callback function */
+        glfwSetCharCallback(on_char);
+        glfwSetKeyCallback(on_key);
 
-    /* set a keyboard callback function */
-    glfwSetCharCallback(on_char);
-    glfwSetKeyCallback(on_key);
+        /* set a mouse callback */
+        glfwSetMousePosCallback(on_mouse);
 
-    /* set a mouse callback */
-    glfwSetMousePosCallback(on_mouse);
+        /* set a mouse button callback */
+        glfwSetMouseButtonCallback(on_mouse_button);
 
-    /* set a mouse button callback */
-    glfwSetMouseButtonCallback(on_mouse_button);
+        /* set a mouse wheel callback */
+        glfwSetMouseWheelCallback(on_mouse_wheel);
 
-    /* set a mouse wheel callback */
-    glfwSetMouseWheelCallback(on_mouse_wheel);
+        /* set a window resize callback function */
+        glfwSetWindowSizeCallback(on_resize);
+    }
 
-    /* set a window resize callback function */
-    glfwSetWindowSizeCallback(on_resize);
+    /* without a window, interrupting ends the loop as closing it would */
+    if (g_seewaves.headless || g_seewaves.capture.enabled) {
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = on_signal;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGINT, &action, NULL);
+        sigaction(SIGTERM, &action, NULL);
+    }
 
     /* perform any gl-related initialization */
     initialize_gl(&g_seewaves);
@@ -1343,45 +1985,150 @@ int main(int argc, char **argv) {
     	util_print_seewaves(&g_seewaves, FULL, 0);
     }
 
-    /* loop until the user closes the window or exits */
+    /* swap on vertical retrace, or as soon as drawn */
+    if (!g_seewaves.headless) {
+        glfwSwapInterval(get_int(CFG_RENDER_VSYNC));
+    }
+
+
+    /* draw only when asked to, no sooner than the frame rate cap allows */
     struct timeval t_start, t_end;
+    double frame_start;
+    double frame_last = 0.0;
+    double frame_next = 0.0;
+    double frame_interval = get_int(CFG_RENDER_FPS_MAX) > 0 ?
+    		1.0 / get_int(CFG_RENDER_FPS_MAX) : 0.0;
+    double input_poll = get_int(CFG_RENDER_INPUT_POLL) / 1000.0;
     gettimeofday(&t_start, NULL);
     while (g_seewaves.flag_exit_main_loop != 1) {
-        /* did user close window? */
-        if (!glfwGetWindowParam(GLFW_OPENED)) {
-            /* yes, gracefully exit */
-            g_seewaves.flag_exit_main_loop = 1;
+        if (!g_seewaves.headless) {
+            /* input callbacks post their redraws */
+            glfwPollEvents();
+
+            /* did user close window? */
+            if (!glfwGetWindowParam(GLFW_OPENED)) {
+                /* yes, gracefully exit */
+                g_seewaves.flag_exit_main_loop = 1;
+                break;
+            }
         }
 
+        /* replay, scripts and fading text move without new data */
+        if(g_seewaves.replay.mode == REPLAY_PLAYING ||
+        		g_seewaves.replay.script_next < g_seewaves.replay.script_length ||
+        		g_seewaves.fade_start != 0) {
+        	redraw_post(&g_seewaves.redraw, REDRAW_ANIMATION);
+        }
+
+        /* a still camera draws more of the octree each frame until done */
+        if(g_seewaves.leveled && g_seewaves.lod.refining) {
+        	redraw_post(&g_seewaves.redraw, REDRAW_ANIMATION);
+        }
+
+        /* a heads-up display refresh put off by the rate shows its values */
+        if((g_seewaves.view_options & (1 << HEADS_UP)) &&
+        		g_seewaves.hud.stale && frame_time() >= g_seewaves.hud.next) {
+        	redraw_post(&g_seewaves.redraw, REDRAW_ANIMATION);
+        }
+
+        /* sleep until there is a reason to draw, waking to check input */
+        if (redraw_wait(&g_seewaves.redraw, input_poll) == 0) {
+            continue;
+        }
+        frame_start = frame_time();
+        if (frame_start < frame_next) {
+            /* reasons posted meanwhile are drawn by the next frame */
+            usleep((useconds_t)((frame_next - frame_start) * 1000000.0));
+            frame_start = frame_time();
+        }
+        if (frame_start > frame_last) {
+            g_seewaves.fps = g_seewaves.fps * 0.9 +
+            		0.1 / (frame_start - frame_last);
+        }
+        frame_last = frame_start;
+        frame_next = frame_start + frame_interval;
+
         /* render display */
         gettimeofday(&t_end, NULL);
         long usec_diff = (t_end.tv_sec - t_start.tv_sec) * 1000000 + (t_end.tv_usec - t_start.tv_usec);
         physics_update(usec_diff);
+
+        /* pick the live or a replayed frame */
+        if(g_seewaves.replay.mode != REPLAY_LIVE ||
+        		g_seewaves.replay.script_next < g_seewaves.replay.script_length) {
+        	double now = frame_time();
+        	pthread_mutex_lock(&g_seewaves.publish_lock);
+        	if(replay_script_run(&g_seewaves.replay, &g_seewaves.history, now)) {
+        		g_seewaves.flag_exit_main_loop = 1;
+        	}
+        	g_seewaves.view = replay_update(&g_seewaves.replay, &g_seewaves.history,
+        			now);
+        	pthread_mutex_unlock(&g_seewaves.publish_lock);
+        } else {
+        	g_seewaves.view = NULL;
+        }
+
         if(display()) {
+            /* exponentially smoothed, for the heads-up display */
+            double ms = (frame_time() - frame_start) * 1000.0;
+            g_seewaves.frame_ms = g_seewaves.frame_ms * 0.9 + ms * 0.1;
+
+            /* read the frame back at the capture cadence of its timestep */
+            if (g_seewaves.capture.enabled) {
+                store_t *view = g_seewaves.view ? g_seewaves.view :
+                		&g_seewaves.store;
+                pthread_mutex_lock(&g_seewaves.store_lock);
+                double t = view->current_t;
+                unsigned int count = view->count;
+                pthread_mutex_unlock(&g_seewaves.store_lock);
+                if (count > 0) {
+                    capture_frame(&g_seewaves.capture, t,
+                    		*g_seewaves.settings.win_width,
+                    		*g_seewaves.settings.win_height);
+                }
+            }
+
             /* swap the display buffer */
-            glfwSwapBuffers();
+            if (!g_seewaves.headless) {
+                glfwSwapBuffers();
+            }
         }
-
-        /* give the CPU a break */
-        usleep(20);
     }
 
-    /* close the underlying sockets, results in threads exiting gracefully */
-    close(g_seewaves.data_socket_fd);
-    close(g_seewaves.heartbeat_socket_fd);
-    shutdown(g_seewaves.data_socket_fd, SHUT_RDWR);
-    shutdown(g_seewaves.heartbeat_socket_fd, SHUT_RDWR);
+    /* wake the threads blocked on their sockets, they close them on the way
+     * out; where shutdown() wakes no one they see the exit flag at the next
+     * poll timeout */
+    shutdown(g_seewaves.data_socket_fd, SHUT_RD);
+    shutdown(g_seewaves.heartbeat_socket_fd, SHUT_RD);
 
-    /* wait for threads to finish */
+    /* wait for threads to finish, the publish thread drops what is queued */
+    packet_queue_close(&g_seewaves.queue);
     if ((err = pthread_join(g_seewaves.data_thread, NULL))) {
         PT_ERR_MSG("pthread_join(data_thread)", err);
     }
+    if ((err = pthread_join(g_seewaves.publish_thread, NULL))) {
+        PT_ERR_MSG("pthread_join(publish_thread)", err);
+    }
+    packet_queue_free(&g_seewaves.queue);
     if ((err = pthread_join(g_seewaves.heartbeat_thread, NULL))) {
         PT_ERR_MSG("pthread_join(heartbeat_thread)", err);
     }
 
-    /* terminate glfw */
-    glfwTerminate();
+    /* release GL objects while the context exists, then terminate glfw */
+    stream_detach(&g_seewaves.stream, &g_seewaves.store);
+    stream_free(&g_seewaves.stream);
+    sprite_free(&g_seewaves.sprite);
+    hud_free(&g_seewaves.hud);
+    scene_free(&g_seewaves.scene);
+    vbo_free(&g_seewaves.vbo);
+    if (g_seewaves.headless) {
+        offscreen_close(&g_seewaves.offscreen);
+    } else {
+        glfwTerminate();
+    }
+
+    /* write out frames still queued */
+    capture_free(&g_seewaves.capture);
 
     if(g_seewaves.verbosity) {
         fprintf(stdout, "Seewaves exiting\n");
@@ -2,14 +2,35 @@
 #define SEEWAVES_H
 
 #ifdef __APPLE__
+#ifdef SEEWAVES_GLUT
 #include <GLUT/glut.h>
+#endif
 #else
 #include <unistd.h>
+#ifdef SEEWAVES_GLUT
 #include <GL/glut.h>
 #endif
+#endif
 #include "ArcBall.h"
 #include "cfg.h"
 #include "Matrix.h"
+#include "completeness.h"
+#include "store.h"
+#include "history.h"
+#include "replay.h"
+#include "parallel.h"
+#include "grid.h"
+#include "morton.h"
+#include "vbo.h"
+#include "render.h"
+#include "redraw.h"
+#include "hud.h"
+#include "scene.h"
+#include "offscreen.h"
+#include "capture.h"
+#include "motion.h"
+#include "idmap.h"
+#include "packet_queue.h"
 
 /* Versioning */
 #define VERSION_HIGH 0
@@ -50,12 +71,63 @@ typedef enum { SHIFT } seewaves_key_option_t;
 #define CFG_OBJECT_COLOR	"particle.type.object.color"
 #define CFG_TESTPOINT_COLOR	"particle.type.testpoint.color"
 #define CFG_SURFACE_COLOR	"particle.type.surface.color"
+#define CFG_TRACKED_TYPES	"subscription.tracked.types"
+#define CFG_TRACKED_STRIDE	"subscription.tracked.stride"
+#define CFG_FULL_STRIDE		"subscription.full.stride"
+#define CFG_HISTORY_FRAMES	"history.frames"
+#define CFG_HISTORY_MEGABYTES	"history.megabytes"
+#define CFG_HISTORY_KEYFRAME	"history.keyframe.interval"
+#define CFG_THREADS		"threads"
+#define CFG_GRID_PARTICLES_PER_CELL	"grid.particles.per.cell"
+#define CFG_MORTON_ORDER	"store.morton.order"
+#define CFG_STORE_PAGES	"store.pages"
+#define CFG_STORE_NUMA	"store.numa"
+#define CFG_COLOR_SPEED	"color.speed"
+#define CFG_COLOR_SPEED_MAX	"color.speed.max"
+#define CFG_RENDER_MODE	"render.mode"
+#define CFG_RENDER_SPHERES	"render.spheres"
+#define CFG_PARTICLE_RADIUS	"particle.radius"
+#define CFG_RENDER_CULL	"render.cull"
+#define CFG_RENDER_LOD	"render.lod"
+#define CFG_RENDER_LOD_BUDGET	"render.lod.budget"
+#define CFG_RENDER_LOD_LIMIT	"render.lod.limit"
+#define CFG_RENDER_FPS_MAX	"render.fps.max"
+#define CFG_RENDER_VSYNC	"render.vsync"
+#define CFG_RENDER_INPUT_POLL	"render.input.poll.ms"
+#define CFG_HUD_REFRESH	"hud.refresh.hz"
+#define CFG_HUD_SCALE	"hud.scale"
+#define CFG_HUD_SPEED	"hud.speed"
+#define CFG_HEADLESS	"headless"
+#define CFG_CAPTURE_PATH	"capture.path"
+#define CFG_CAPTURE_FORMAT	"capture.format"
+#define CFG_CAPTURE_INTERVAL	"capture.interval"
+#define CFG_CAPTURE_FPS	"capture.fps"
+#define CFG_CAPTURE_THREADS	"capture.threads"
+#define CFG_CAPTURE_QUEUE	"capture.queue"
+#define CFG_INGEST_QUEUE	"ingest.queue"
 
+/*
+Options read while drawing or handling input, resolved once to their value
+storage by settings_resolve().  Reloading and set_float3() write the same
+storage, so reads through these never go stale and cost no lookup.
+*/
+typedef struct {
+	const float *znear;
+	const float *zfar;
+	/* three floats each */
+	float *eye_pos;
+	float *eye_up;
+	float *eye_target;
+	const int *win_width;
+	const int *win_height;
+} seewaves_settings_t;
 
 /* Global application data structure */
 typedef struct {
 	/* configuration */
 	cfg_t config;
+	/* hot-path options */
+	seewaves_settings_t settings;
 	/* verbosity */
 	int verbosity;
     /* heartbeat thread, sends packets to server */
@@ -68,24 +140,27 @@ typedef struct {
     pthread_t data_thread;
     /* data thread socket descriptor, incoming data packets */
     int data_socket_fd;
-    /* mutex lock for sharing data safely */
+    /* mutex lock for sharing reception state safely */
     pthread_mutex_t lock;
+    /* packets received, waiting for the publish thread */
+    packet_queue_t queue;
+    /* publish thread, applies packets and runs the per-timestep passes */
+    pthread_t publish_thread;
+    /* held by the publish thread while it changes the store or anything
+    derived from it, taken by others to read those or attach the stream */
+    pthread_mutex_t publish_lock;
+    /* held while the store's vertices, columns or model change, briefly,
+    and by the render thread while it draws */
+    pthread_mutex_t store_lock;
     /* total number of particles in current simulation */
     unsigned int total_particle_count;
-    /* array of x position of all particles, total_particle_cnt long */
-    double *x;
-    /* array of y position of all particles, total_particle_cnt long */
-    double *y;
-    /* array of z position of all particles, total_particle_cnt long */
-    double *z;
-    /* array of w (mass) of all particles, total_particle_cnt long */
-    double *w;
-    /* array of particle_type of all particles, total_particle_cnt long */
-    short *particle_type;
-    /* array of t (timestamp) of all particles, total_particle_cnt long */
-    float *t;
-    /* particle flag */
-    unsigned int *flag;
+    /* particle positions, types and timestamps, indexed by id, written by
+    the publish thread */
+    store_t store;
+    /* vertex colors by particle type, from configuration */
+    store_palette_t palette;
+    /* bit per store type code, set if the type is not drawn */
+    unsigned int hidden_types;
     /* total number of packets received from server */
     int packets_received;
     /* main application loop exit flag */
@@ -177,6 +252,81 @@ typedef struct {
 	short show_help;
 	/* current model id (as defined by server) */
 	pid_t model_id;
+	/* subscription: PTP_TYPE_BIT mask of particle types streamed every
+	tracked_stride steps */
+	unsigned int tracked_types;
+	unsigned short tracked_stride;
+	/* subscription: steps between full-field refreshes */
+	unsigned short full_stride;
+	/* per-timestep reception tracking, guarded by lock */
+	completeness_t completeness;
+	/* published timesteps, guarded by publish_lock */
+	history_t history;
+	/* pause/scrub/playback state, render thread only */
+	replay_t replay;
+	/* store being drawn, NULL for the live store */
+	store_t *view;
+	/* smoothed time spent in display(), milliseconds */
+	double frame_ms;
+	/* worker threads for per-timestep passes, shared, calls take turns */
+	parallel_t pool;
+	/* spatial slot order of the store, publish thread only */
+	morton_t order;
+	/* spatial index of the last published timestep, guarded by
+	publish_lock */
+	grid_t grid;
+	/* wire particle id to store index, assigned as packets arrive, guarded
+	by lock */
+	idmap_t ids;
+	/* ids.removed already cleared from the store, publish thread only */
+	unsigned long long ids_cleared;
+	/* velocity derived at each published timestep, guarded by
+	publish_lock */
+	motion_t motion;
+	/* transforms of the last frame drawn, for picking */
+	GLdouble pick_modelview[16];
+	GLdouble pick_projection[16];
+	GLint pick_viewport[4];
+	/* wire id of the particle under the last right click, -1 for none */
+	int picked;
+	float picked_position[3];
+	/* vertex buffer object, render thread only */
+	vbo_t vbo;
+	/* smoothed bytes uploaded per frame, and a full upload's share of it */
+	double upload_bytes;
+	double upload_share;
+	/* ring the publish thread streams vertices into, see stream.h */
+	stream_t stream;
+	/* reasons to draw the next frame, posted by any thread */
+	redraw_t redraw;
+	/* smoothed frames per second drawn */
+	double fps;
+	/* heads-up display text, render thread only */
+	hud_t hud;
+	/* grids, axes and world box, render thread only */
+	scene_t scene;
+	/* particles as spheres of a radius, 0 for the world's spacing */
+	sprite_t sprite;
+	int spheres;
+	float particle_radius;
+	/* chunk boxes, see cull.h; culling wanted and whether the last frame
+	culled */
+	cull_t cull;
+	int culling;
+	int culled;
+	/* octree levels of detail, see lod.h; wanted and whether the last frame
+	drew by them */
+	lod_t lod;
+	int leveling;
+	int leveled;
+	/* non-zero if drawing offscreen without a window, and its context */
+	int headless;
+	offscreen_t offscreen;
+	/* image sequence of the frames drawn, see capture.h */
+	capture_t capture;
+	/* render_mode_t wanted, and the one the last frame got */
+	int render_mode;
+	int render_used;
 } seewaves_t;
 
 /* formatting flag */
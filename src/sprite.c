@@ -0,0 +1,231 @@
+/*
+ * sprite.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/* GL 2.0 shader entry points */
+#define GL_GLEXT_PROTOTYPES 1
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sprite.h"
+
+/* eye-space center per point, sized so the sprite covers the sphere */
+static const char *g_sprite_vertex =
+	"#version 120\n"
+	"uniform float radius;\n"
+	"uniform float height;\n"
+	"varying vec3 center;\n"
+	"void main() {\n"
+	"	vec4 eye = gl_ModelViewMatrix * gl_Vertex;\n"
+	"	gl_Position = gl_ProjectionMatrix * eye;\n"
+	"	center = eye.xyz;\n"
+	"	gl_FrontColor = gl_Color;\n"
+	"	gl_PointSize = radius * gl_ProjectionMatrix[1][1] * height /\n"
+	"		gl_Position.w;\n"
+	"}\n";
+
+/* sphere normal from the sprite coordinate, depth of the sphere's surface */
+static const char *g_sprite_fragment =
+	"#version 120\n"
+	"uniform float radius;\n"
+	"uniform sampler1D lut;\n"
+	"uniform float row;\n"
+	"varying vec3 center;\n"
+	"void main() {\n"
+	"	vec2 p = vec2(gl_PointCoord.x, 1.0 - gl_PointCoord.y) * 2.0 - 1.0;\n"
+	"	float r2 = dot(p, p);\n"
+	"	if(r2 > 1.0) {\n"
+	"		discard;\n"
+	"	}\n"
+	"	vec3 n = vec3(p, sqrt(1.0 - r2));\n"
+	"	vec4 color = row < 0.0 ? gl_Color : texture1D(lut, row);\n"
+	"	vec4 clip = gl_ProjectionMatrix * vec4(center + n * radius, 1.0);\n"
+	"	float diffuse = max(dot(n, normalize(vec3(0.4, 0.6, 1.0))), 0.0);\n"
+	"	gl_FragColor = vec4(color.rgb * (0.3 + 0.7 * diffuse), color.a);\n"
+	"	gl_FragDepth = 0.5 * (gl_DepthRange.diff * clip.z / clip.w +\n"
+	"		gl_DepthRange.near + gl_DepthRange.far);\n"
+	"}\n";
+
+/* locals */
+static int sprite_supported(void);
+static GLuint sprite_shader(GLenum type, const char *source);
+static GLuint sprite_program(void);
+
+/*
+@returns non-zero if the context has GLSL 1.20
+*/
+static int sprite_supported(void) {
+	const char *version = (const char*)glGetString(GL_SHADING_LANGUAGE_VERSION);
+	int major = 0;
+	int minor = 0;
+	return(version != NULL && sscanf(version, "%d.%d", &major, &minor) == 2 &&
+		(major > 1 || (major == 1 && minor >= 20)));
+}
+
+/*
+Compile one shader.
+
+@returns shader name, 0 on error
+*/
+static GLuint sprite_shader(GLenum type, const char *source) {
+	GLuint shader = glCreateShader(type);
+	GLint status = 0;
+	char log[1024];
+
+	glShaderSource(shader, 1, &source, NULL);
+	glCompileShader(shader);
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	if(!status) {
+		glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+		fprintf(stderr, "sprite_shader: %s\n", log);
+		glDeleteShader(shader);
+		return(0);
+	}
+	return(shader);
+}
+
+/*
+Compile and link the sphere program.
+
+@returns program name, 0 on error
+*/
+static GLuint sprite_program(void) {
+	GLuint vertex = sprite_shader(GL_VERTEX_SHADER, g_sprite_vertex);
+	GLuint fragment = sprite_shader(GL_FRAGMENT_SHADER, g_sprite_fragment);
+	GLuint program = 0;
+	GLint status = 0;
+	char log[1024];
+
+	if(vertex != 0 && fragment != 0) {
+		program = glCreateProgram();
+		glAttachShader(program, vertex);
+		glAttachShader(program, fragment);
+		glLinkProgram(program);
+		glGetProgramiv(program, GL_LINK_STATUS, &status);
+		if(!status) {
+			glGetProgramInfoLog(program, sizeof(log), NULL, log);
+			fprintf(stderr, "sprite_program: %s\n", log);
+			glDeleteProgram(program);
+			program = 0;
+		}
+	}
+	/* flagged for deletion, they go with the program */
+	if(vertex != 0) {
+		glDeleteShader(vertex);
+	}
+	if(fragment != 0) {
+		glDeleteShader(fragment);
+	}
+	return(program);
+}
+
+/*
+Build the program and lookup texture, if the context has GLSL.  Needs a
+current GL context.
+
+@param	sp	sprites, program is 0 if particles must be drawn as points
+*/
+void sprite_init(sprite_t *sp) {
+	memset(sp, 0, sizeof(sprite_t));
+	if(!sprite_supported() || (sp->program = sprite_program()) == 0) {
+		fprintf(stderr, "GLSL unavailable, drawing particles as points\n");
+		return;
+	}
+	sp->u_radius = glGetUniformLocation(sp->program, "radius");
+	sp->u_height = glGetUniformLocation(sp->program, "height");
+	sp->u_lut = glGetUniformLocation(sp->program, "lut");
+	sp->u_row = glGetUniformLocation(sp->program, "row");
+	glGenTextures(1, &sp->lut);
+	glBindTexture(GL_TEXTURE_1D, sp->lut);
+	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA8, SPRITE_LUT_SIZE, 0, GL_RGBA,
+		GL_UNSIGNED_BYTE, NULL);
+	glBindTexture(GL_TEXTURE_1D, 0);
+}
+
+/*
+Delete the program and texture.
+*/
+void sprite_free(sprite_t *sp) {
+	if(sp->program != 0) {
+		glDeleteProgram(sp->program);
+		glDeleteTextures(1, &sp->lut);
+	}
+	memset(sp, 0, sizeof(sprite_t));
+}
+
+/*
+Load type colors into the lookup texture, if they changed.
+
+@param	sp	sprites
+@param	palette	colors by type code
+*/
+void sprite_palette(sprite_t *sp, const store_palette_t *palette) {
+	uint8_t texels[SPRITE_LUT_SIZE][4];
+
+	if(sp->program == 0 || (sp->lut_updates > 0 &&
+			!memcmp(&sp->palette, palette, sizeof(store_palette_t)))) {
+		return;
+	}
+	memset(texels, 0, sizeof(texels));
+	memcpy(texels, palette->rgba, sizeof(palette->rgba));
+	glBindTexture(GL_TEXTURE_1D, sp->lut);
+	glTexSubImage1D(GL_TEXTURE_1D, 0, 0, SPRITE_LUT_SIZE, GL_RGBA,
+		GL_UNSIGNED_BYTE, texels);
+	glBindTexture(GL_TEXTURE_1D, 0);
+	sp->palette = *palette;
+	sp->lut_updates++;
+}
+
+/*
+Start drawing points as spheres.  Call sprite_type() before each type's
+draws and sprite_end() after them.
+
+@param	sp	sprites
+@param	radius	sphere radius in world units
+@param	height	viewport height in pixels
+
+@returns 0 on success, -1 if particles must be drawn as points
+*/
+int sprite_begin(sprite_t *sp, float radius, int height) {
+	if(sp->program == 0) {
+		return(-1);
+	}
+	glPushAttrib(GL_ENABLE_BIT | GL_TEXTURE_BIT);
+	glDisable(GL_POINT_SMOOTH);
+	glEnable(GL_POINT_SPRITE);
+	glEnable(GL_VERTEX_PROGRAM_POINT_SIZE);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_1D, sp->lut);
+	glUseProgram(sp->program);
+	glUniform1f(sp->u_radius, radius);
+	glUniform1f(sp->u_height, (GLfloat)height);
+	glUniform1i(sp->u_lut, 0);
+	return(0);
+}
+
+/*
+Color the following draws by type.
+
+@param	sp	sprites
+@param	code	store_type_t
+@param	vertex_colors	non-zero to keep the vertices' own colors
+*/
+void sprite_type(const sprite_t *sp, int code, int vertex_colors) {
+	glUniform1f(sp->u_row, vertex_colors ? -1.0f :
+		(code + 0.5f) / SPRITE_LUT_SIZE);
+}
+
+/*
+Back to fixed-function drawing.
+*/
+void sprite_end(const sprite_t *sp) {
+	(void)sp;
+	glUseProgram(0);
+	glPopAttrib();
+}
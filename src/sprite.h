@@ -0,0 +1,49 @@
+/*
+ * sprite.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Particles as shaded spheres.  A GLSL program draws each point as a
+ * screen-aligned sprite sized from a radius in world units, shades it as a
+ * sphere and writes the sphere's depth, so particles intersect correctly.
+ * Colors come from a 1D lookup texture with an entry per store_type_t,
+ * selected per draw, so a palette change is a texture update rather than a
+ * pass over the vertices.  Types whose vertex colors carry a scalar (see
+ * motion.h) keep them.  Without GLSL the fixed-function points remain.
+ */
+
+#ifndef SPRITE_H_
+#define SPRITE_H_
+
+#include "GL/glfw.h"
+#include "store.h"
+
+/* lookup texture width, a power of two holding every type */
+#define SPRITE_LUT_SIZE 16
+
+/*
+Program, lookup texture and their state.
+*/
+typedef struct {
+	/* linked program, 0 if GLSL is unavailable */
+	GLuint program;
+	/* color lookup texture */
+	GLuint lut;
+	/* uniform locations */
+	GLint u_radius;
+	GLint u_height;
+	GLint u_lut;
+	GLint u_row;
+	/* palette the texture holds */
+	store_palette_t palette;
+	unsigned long long lut_updates;
+} sprite_t;
+
+void sprite_init(sprite_t *sp);
+void sprite_free(sprite_t *sp);
+void sprite_palette(sprite_t *sp, const store_palette_t *palette);
+int sprite_begin(sprite_t *sp, float radius, int height);
+void sprite_type(const sprite_t *sp, int code, int vertex_colors);
+void sprite_end(const sprite_t *sp);
+
+#endif /* SPRITE_H_ */
@@ -0,0 +1,658 @@
+/*
+ * store.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#endif
+#include "store.h"
+#include "ptp.h"
+
+/* vertex x of a particle not yet received */
+#define STORE_UNDEFINED -1.0
+
+/* column allocation policy, set once at startup */
+static struct {
+	store_pages_t pages;
+	int numa;
+	/* huge page mappings that fell back to transparent huge pages */
+	unsigned int huge_fallbacks;
+	/* a placement failure was reported */
+	int numa_warned;
+} g_store_policy = { STORE_PAGES_DEFAULT, STORE_NUMA_FIRST_TOUCH, 0, 0 };
+
+/* policy names, in store_pages_t order */
+static const char *g_store_pages_names[] = {
+	"default", "small", "transparent", "huge", NULL
+};
+
+/* locals */
+static void store_swap(store_t *s, unsigned int a, unsigned int b);
+static unsigned int store_move(store_t *s, unsigned int id, uint8_t to);
+#ifdef __linux__
+static size_t store_mapped_bytes(unsigned int capacity, size_t size);
+static int store_online_nodes(unsigned long *mask, int bits);
+static void store_place(void *column, size_t bytes);
+static void *store_map(size_t bytes);
+#endif
+
+#ifdef __linux__
+/*
+@returns mapping length of a column, 0 if it should come from the heap
+*/
+static size_t store_mapped_bytes(unsigned int capacity, size_t size) {
+	size_t bytes = (size_t)capacity * size;
+	/* small columns are not worth a huge page of their own */
+	if(g_store_policy.pages == STORE_PAGES_DEFAULT || bytes < STORE_HUGE_PAGE) {
+		return(0);
+	}
+	return((bytes + STORE_HUGE_PAGE - 1) / STORE_HUGE_PAGE * STORE_HUGE_PAGE);
+}
+
+/*
+Read the online NUMA nodes into a bit mask.
+
+@returns number of bits used, 0 if the system does not report nodes
+*/
+static int store_online_nodes(unsigned long *mask, int bits) {
+	FILE *fp = fopen("/sys/devices/system/node/online", "r");
+	int used = 0;
+	int first, last;
+	char sep;
+
+	memset(mask, 0, bits / 8);
+	if(fp == NULL) {
+		return(0);
+	}
+	/* list of ranges: 0-1,3 */
+	while(fscanf(fp, "%d", &first) == 1) {
+		last = first;
+		sep = (char)fgetc(fp);
+		if(sep == '-') {
+			if(fscanf(fp, "%d", &last) != 1) {
+				break;
+			}
+			sep = (char)fgetc(fp);
+		}
+		for(; first <= last && first < bits; first++) {
+			mask[first / (8 * sizeof(unsigned long))] |=
+				1UL << (first % (8 * sizeof(unsigned long)));
+			used = first + 1;
+		}
+		if(sep != ',') {
+			break;
+		}
+	}
+	fclose(fp);
+	return(used);
+}
+
+/*
+Apply the NUMA policy to a fresh mapping, before it is touched.
+*/
+static void store_place(void *column, size_t bytes) {
+	unsigned long mask[STORE_NUMA_MAX_NODES / (8 * sizeof(unsigned long))];
+	int bits = STORE_NUMA_MAX_NODES;
+	int mode = MPOL_BIND;
+	unsigned int cpu, node;
+
+	if(g_store_policy.numa == STORE_NUMA_FIRST_TOUCH) {
+		return;
+	}
+	if(store_online_nodes(mask, bits) == 0) {
+		return;
+	}
+	if(g_store_policy.numa == STORE_NUMA_INTERLEAVE) {
+		mode = MPOL_INTERLEAVE;
+	} else {
+		if(g_store_policy.numa == STORE_NUMA_LOCAL) {
+			/* node of the thread allocating, which is the one that fills it */
+			if(syscall(SYS_getcpu, &cpu, &node, NULL)) {
+				return;
+			}
+		} else {
+			node = (unsigned int)g_store_policy.numa;
+		}
+		if(node >= STORE_NUMA_MAX_NODES) {
+			return;
+		}
+		memset(mask, 0, sizeof(mask));
+		mask[node / (8 * sizeof(unsigned long))] =
+			1UL << (node % (8 * sizeof(unsigned long)));
+	}
+	if(syscall(SYS_mbind, column, bytes, mode, mask, bits + 1, 0) &&
+			!g_store_policy.numa_warned) {
+		perror("store: mbind");
+		g_store_policy.numa_warned = 1;
+	}
+}
+
+/*
+Map a column with the configured page size and placement.
+
+@returns zeroed mapping or NULL
+*/
+static void *store_map(size_t bytes) {
+	void *column = MAP_FAILED;
+
+	if(g_store_policy.pages == STORE_PAGES_HUGE) {
+		column = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if(column == MAP_FAILED && g_store_policy.huge_fallbacks++ == 0) {
+			fprintf(stderr, "store: no huge pages reserved (vm.nr_hugepages), "
+				"using transparent huge pages\n");
+		}
+	}
+	if(column == MAP_FAILED) {
+		column = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if(column == MAP_FAILED) {
+			return(NULL);
+		}
+		(void)madvise(column, bytes, g_store_policy.pages == STORE_PAGES_SMALL ?
+			MADV_NOHUGEPAGE : MADV_HUGEPAGE);
+	}
+	store_place(column, bytes);
+	return(column);
+}
+#endif
+
+/*
+Choose how columns are allocated.  Call before any store is initialized.
+
+@param	pages	"default" (heap), "small" (4 KB pages), "transparent"
+(transparent huge pages) or "huge" (hugetlbfs pool, transparent if empty)
+@param	numa	"first-touch", "interleave", "local" (node of the allocating
+thread) or a node number
+
+@returns 0 on success, -1 if a name is not recognized (that setting is left
+unchanged)
+*/
+int store_policy(const char *pages, const char *numa) {
+	int err = 0;
+	char *end;
+	int i;
+
+	for(i = 0; g_store_pages_names[i] != NULL; i++) {
+		if(!strcmp(pages, g_store_pages_names[i])) {
+			g_store_policy.pages = (store_pages_t)i;
+			break;
+		}
+	}
+	if(g_store_pages_names[i] == NULL) {
+		fprintf(stderr, "Unknown page size '%s'\n", pages);
+		err = -1;
+	}
+	if(!strcmp(numa, "first-touch")) {
+		g_store_policy.numa = STORE_NUMA_FIRST_TOUCH;
+	} else if(!strcmp(numa, "interleave")) {
+		g_store_policy.numa = STORE_NUMA_INTERLEAVE;
+	} else if(!strcmp(numa, "local")) {
+		g_store_policy.numa = STORE_NUMA_LOCAL;
+	} else if((i = (int)strtol(numa, &end, 10)) >= 0 && *numa && !*end) {
+		g_store_policy.numa = i;
+	} else {
+		fprintf(stderr, "Unknown NUMA placement '%s'\n", numa);
+		err = -1;
+	}
+#ifndef __linux__
+	if(g_store_policy.pages != STORE_PAGES_DEFAULT ||
+			g_store_policy.numa != STORE_NUMA_FIRST_TOUCH) {
+		fprintf(stderr, "Page size and NUMA placement need Linux, ignored\n");
+		g_store_policy.pages = STORE_PAGES_DEFAULT;
+		g_store_policy.numa = STORE_NUMA_FIRST_TOUCH;
+	}
+#endif
+	return(err);
+}
+
+/*
+@returns short description of the allocation policy, e.g. "huge/interleave"
+*/
+const char *store_policy_name(void) {
+	static char name[64];
+	const char *numa = "first-touch";
+	char node[16];
+
+	if(g_store_policy.numa == STORE_NUMA_INTERLEAVE) {
+		numa = "interleave";
+	} else if(g_store_policy.numa == STORE_NUMA_LOCAL) {
+		numa = "local";
+	} else if(g_store_policy.numa >= 0) {
+		sprintf(node, "node%i", g_store_policy.numa);
+		numa = node;
+	}
+	snprintf(name, sizeof(name), "%s/%s",
+		g_store_pages_names[g_store_policy.pages], numa);
+	return(name);
+}
+
+/*
+Allocate a column.  Also used for scratch copies that may be swapped with
+the store's own columns.  Large columns are mapped according to
+store_policy(), others come from the heap.
+
+@param	capacity	number of elements
+@param	size	element size
+
+@returns zeroed, STORE_ALIGN aligned column or NULL, release with
+store_column_free()
+*/
+void *store_column(unsigned int capacity, size_t size) {
+	void *column;
+#ifdef __linux__
+	size_t bytes = store_mapped_bytes(capacity, size);
+	if(bytes > 0) {
+		return(store_map(bytes));
+	}
+#endif
+	if(posix_memalign(&column, STORE_ALIGN, capacity * size)) {
+		return(NULL);
+	}
+	memset(column, 0, capacity * size);
+	return(column);
+}
+
+/*
+Release a column from store_column().
+
+@param	column	column, may be NULL
+@param	capacity, size	as allocated
+*/
+void store_column_free(void *column, unsigned int capacity, size_t size) {
+#ifdef __linux__
+	size_t bytes = store_mapped_bytes(capacity, size);
+	if(column != NULL && bytes > 0) {
+		munmap(column, bytes);
+		return;
+	}
+#endif
+	(void)capacity;
+	(void)size;
+	free(column);
+}
+
+/*
+Exchange the particles in two slots.
+*/
+static void store_swap(store_t *s, unsigned int a, unsigned int b) {
+	store_vertex_t v;
+	unsigned int id_a = s->id_of[a];
+	unsigned int id_b = s->id_of[b];
+
+	if(a == b) {
+		return;
+	}
+	v = s->vertex[a];
+	s->vertex[a] = s->vertex[b];
+	s->vertex[b] = v;
+	store_dirty_chunk(s, a / STORE_CHUNK);
+	store_dirty_chunk(s, b / STORE_CHUNK);
+	s->id_of[a] = id_b;
+	s->id_of[b] = id_a;
+	s->slot_of[id_a] = b;
+	s->slot_of[id_b] = a;
+}
+
+/*
+Move a particle into the range of another type.  The particle hops one
+range boundary at a time, swapping with the particle at the edge of each
+range it crosses, so the cost is the number of types between the two.
+Without slot maps, if they cannot be allocated, the particle stays put
+and keeps its old type until its next update.
+
+@param	s	store
+@param	id	particle id
+@param	to	new type code
+
+@returns new slot of the particle
+*/
+static unsigned int store_move(store_t *s, unsigned int id, uint8_t to) {
+	int code = s->type[id];
+	unsigned int slot;
+
+	if(store_order(s)) {
+		return(store_slot(s, id));
+	}
+	slot = s->slot_of[id];
+
+	while(code < to) {
+		/* last slot of this range becomes first slot of the next */
+		unsigned int edge = s->type_start[code + 1] - 1;
+		store_swap(s, slot, edge);
+		slot = edge;
+		s->type_start[++code]--;
+	}
+	while(code > to) {
+		/* first slot of this range becomes last slot of the previous */
+		unsigned int edge = s->type_start[code];
+		store_swap(s, slot, edge);
+		slot = edge;
+		s->type_start[code--]++;
+	}
+	s->type[id] = to;
+	s->type_moves++;
+	return(slot);
+}
+
+/*
+Allocate columns for a model.
+
+@param	s	store
+@param	count	number of particles in the model
+@param	palette	vertex colors by type code
+
+@returns 0 on success, -1 on allocation failure
+*/
+int store_init(store_t *s, unsigned int count, const store_palette_t *palette) {
+	unsigned int i;
+
+	memset(s, 0, sizeof(store_t));
+	s->count = count;
+	s->capacity = (count + STORE_PAD - 1) / STORE_PAD * STORE_PAD;
+	if(s->capacity == 0) {
+		s->capacity = STORE_PAD;
+	}
+	s->t = (float*)store_column(s->capacity, sizeof(float));
+	s->type = (uint8_t*)store_column(s->capacity, sizeof(uint8_t));
+	s->vertex = (store_vertex_t*)store_column(s->capacity, sizeof(store_vertex_t));
+	s->chunks = (s->capacity + STORE_CHUNK - 1) / STORE_CHUNK;
+	s->dirty = (uint32_t*)calloc((s->chunks + 31) / 32, sizeof(uint32_t));
+	if(!s->t || !s->type || !s->vertex || !s->dirty) {
+		perror("store_init");
+		store_free(s);
+		return(-1);
+	}
+	s->palette = *palette;
+	/* everything starts out as fluid, in id order */
+	for(i = 0; i < count; i++) {
+		s->t[i] = STORE_T_NONE;
+		s->vertex[i].pos[0] = STORE_UNDEFINED;
+		memcpy(s->vertex[i].rgba, s->palette.rgba[STORE_TYPE_FLUID], 4);
+	}
+	/* padding is never drawn */
+	memset(s->type + count, STORE_TYPE_OTHER, s->capacity - count);
+	for(i = STORE_TYPE_FLUID + 1; i <= STORE_TYPE_COUNT; i++) {
+		s->type_start[i] = count;
+	}
+	store_dirty_all(s);
+	return(0);
+}
+
+/*
+Release the columns.
+*/
+void store_free(store_t *s) {
+	store_column_free(s->t, s->capacity, sizeof(float));
+	store_column_free(s->type, s->capacity, sizeof(uint8_t));
+	store_column_free(s->vertex, s->capacity, sizeof(store_vertex_t));
+	store_column_free(s->slot_of, s->capacity, sizeof(unsigned int));
+	store_column_free(s->id_of, s->capacity, sizeof(unsigned int));
+	free(s->dirty);
+	memset(s, 0, sizeof(store_t));
+}
+
+/*
+Make room for a model that grew, keeping every particle.  The new particles
+are typed other, at the end of the last range, so slots stay where they are;
+each moves to its own range on its first update.  Detach it from a stream
+ring first, see stream.h.
+
+@param	s	store
+@param	count	number of particles in the model, a no-op unless larger
+
+@returns 0 on success, -1 on allocation failure, the store is unchanged
+*/
+int store_resize(store_t *s, unsigned int count) {
+	store_t grown;
+	unsigned int i;
+
+	if(count <= s->count) {
+		return(0);
+	}
+	memset(&grown, 0, sizeof(store_t));
+	grown.capacity = (count + STORE_PAD - 1) / STORE_PAD * STORE_PAD;
+	grown.t = (float*)store_column(grown.capacity, sizeof(float));
+	grown.type = (uint8_t*)store_column(grown.capacity, sizeof(uint8_t));
+	grown.vertex = (store_vertex_t*)store_column(grown.capacity,
+		sizeof(store_vertex_t));
+	grown.chunks = (grown.capacity + STORE_CHUNK - 1) / STORE_CHUNK;
+	grown.dirty = (uint32_t*)calloc((grown.chunks + 31) / 32, sizeof(uint32_t));
+	if(s->slot_of != NULL) {
+		grown.slot_of = (unsigned int*)store_column(grown.capacity,
+			sizeof(unsigned int));
+		grown.id_of = (unsigned int*)store_column(grown.capacity,
+			sizeof(unsigned int));
+	}
+	if(!grown.t || !grown.type || !grown.vertex || !grown.dirty ||
+			(s->slot_of != NULL && (!grown.slot_of || !grown.id_of))) {
+		perror("store_resize");
+		store_free(&grown);
+		return(-1);
+	}
+	memcpy(grown.t, s->t, s->count * sizeof(float));
+	memcpy(grown.type, s->type, s->count * sizeof(uint8_t));
+	memcpy(grown.vertex, s->vertex, s->count * sizeof(store_vertex_t));
+	for(i = s->count; i < count; i++) {
+		grown.t[i] = STORE_T_NONE;
+		grown.vertex[i].pos[0] = STORE_UNDEFINED;
+		memcpy(grown.vertex[i].rgba, s->palette.rgba[STORE_TYPE_OTHER], 4);
+	}
+	memset(grown.type + s->count, STORE_TYPE_OTHER, grown.capacity - s->count);
+	if(s->slot_of != NULL) {
+		memcpy(grown.slot_of, s->slot_of, s->count * sizeof(unsigned int));
+		memcpy(grown.id_of, s->id_of, s->count * sizeof(unsigned int));
+		for(i = s->count; i < grown.capacity; i++) {
+			grown.slot_of[i] = i;
+			grown.id_of[i] = i;
+		}
+	}
+
+	store_column_free(s->t, s->capacity, sizeof(float));
+	store_column_free(s->type, s->capacity, sizeof(uint8_t));
+	store_column_free(s->vertex, s->capacity, sizeof(store_vertex_t));
+	store_column_free(s->slot_of, s->capacity, sizeof(unsigned int));
+	store_column_free(s->id_of, s->capacity, sizeof(unsigned int));
+	free(s->dirty);
+	s->t = grown.t;
+	s->type = grown.type;
+	s->vertex = grown.vertex;
+	s->slot_of = grown.slot_of;
+	s->id_of = grown.id_of;
+	s->dirty = grown.dirty;
+	s->chunks = grown.chunks;
+	s->capacity = grown.capacity;
+	s->count = count;
+	s->type_start[STORE_TYPE_COUNT] = count;
+	store_dirty_all(s);
+	return(0);
+}
+
+/*
+Allocate the slot maps, as the identity, before the first particle changes
+place.  A no-op once they exist.
+
+@returns 0 on success, -1 on allocation failure
+*/
+int store_order(store_t *s) {
+	unsigned int i;
+
+	if(s->slot_of != NULL) {
+		return(0);
+	}
+	s->slot_of = (unsigned int*)store_column(s->capacity, sizeof(unsigned int));
+	s->id_of = (unsigned int*)store_column(s->capacity, sizeof(unsigned int));
+	if(!s->slot_of || !s->id_of) {
+		perror("store_order");
+		store_column_free(s->slot_of, s->capacity, sizeof(unsigned int));
+		store_column_free(s->id_of, s->capacity, sizeof(unsigned int));
+		s->slot_of = NULL;
+		s->id_of = NULL;
+		return(-1);
+	}
+	for(i = 0; i < s->capacity; i++) {
+		s->slot_of[i] = i;
+		s->id_of[i] = i;
+	}
+	return(0);
+}
+
+/*
+Map a GPUSPH particle type to its store code, bucketed as PTP_TYPE_BUCKET()
+is: flags are masked off the primary type, surface-flagged fluid is
+STORE_TYPE_SURFACE.
+
+@param	particle_type	type as sent on the wire
+
+@returns store_type_t code
+*/
+uint8_t store_type_code(short particle_type) {
+	unsigned int bucket = PTP_TYPE_BUCKET(particle_type);
+
+	if(particle_type < 0 || (particle_type & 15)) {
+		return(STORE_TYPE_OTHER);
+	}
+	if(bucket == PTP_TYPE_SURFACE_BUCKET) {
+		return(STORE_TYPE_SURFACE);
+	}
+	if(bucket < STORE_TYPE_SURFACE) {
+		return((uint8_t)bucket);
+	}
+	return(STORE_TYPE_OTHER);
+}
+
+/*
+Store one decoded particle.
+
+@param	s	store
+@param	id	particle id, must be below s->count
+@param	t	timestamp of the packet
+@param	x, y, z	wire position
+@param	code	store_type_t code, see store_type_code()
+*/
+void store_set(store_t *s, unsigned int id, float t, double x, double y,
+		double z, uint8_t code) {
+	unsigned int slot = store_slot(s, id);
+	store_vertex_t *v;
+
+	if(t > s->current_t) {
+		s->current_t = t;
+		s->current_count = 0;
+	}
+	if(t == s->current_t && s->t[id] != t) {
+		s->current_count++;
+	}
+	s->t[id] = t;
+	if(code != s->type[id]) {
+		slot = store_move(s, id, code);
+	}
+	v = &s->vertex[slot];
+	v->pos[0] = (float)x;
+	v->pos[1] = (float)z;
+	v->pos[2] = (float)y;
+	if(!(s->colored_types & (1U << code))) {
+		memcpy(v->rgba, s->palette.rgba[code], 4);
+	}
+	store_dirty_chunk(s, slot / STORE_CHUNK);
+}
+
+/*
+Forget a particle that left the model: it is not drawn until its id is
+stored again.
+
+@param	s	store
+@param	id	particle id, must be below s->count
+*/
+void store_clear(store_t *s, unsigned int id) {
+	unsigned int slot = store_slot(s, id);
+
+	if(s->t[id] == STORE_T_NONE) {
+		return;
+	}
+	if(s->t[id] == s->current_t) {
+		s->current_count--;
+	}
+	s->t[id] = STORE_T_NONE;
+	s->vertex[slot].pos[0] = STORE_UNDEFINED;
+	store_dirty_chunk(s, slot / STORE_CHUNK);
+}
+
+/*
+Change the palette and recolor every vertex.
+
+@param	s	store
+@param	palette	vertex colors by type code
+*/
+void store_set_palette(store_t *s, const store_palette_t *palette) {
+	unsigned int i;
+	s->palette = *palette;
+	for(i = 0; i < s->count; i++) {
+		memcpy(s->vertex[i].rgba, s->palette.rgba[s->type[store_id(s, i)]], 4);
+	}
+	store_dirty_all(s);
+}
+
+/*
+Flag a chunk of vertices as changed since the renderer last took it.  Safe
+to call from any thread.
+
+@param	s	store
+@param	chunk	slot / STORE_CHUNK
+*/
+void store_dirty_chunk(store_t *s, unsigned int chunk) {
+	uint32_t bit = 1U << (chunk % 32);
+	/* usually already set, only the first change of a chunk pays the atomic */
+	if(!(s->dirty[chunk / 32] & bit)) {
+		__sync_fetch_and_or(&s->dirty[chunk / 32], bit);
+	}
+}
+
+/*
+Flag every vertex as changed.
+*/
+void store_dirty_all(store_t *s) {
+	unsigned int i;
+	for(i = 0; i < s->chunks; i++) {
+		store_dirty_chunk(s, i);
+	}
+}
+
+/*
+Take and clear 32 dirty flags.  Take the flags before reading the vertices
+they cover, so a change made meanwhile is flagged again.
+
+@param	s	store
+@param	word	chunks 32 * word to 32 * word + 31
+
+@returns flags, bit n for chunk 32 * word + n
+*/
+uint32_t store_dirty_take(store_t *s, unsigned int word) {
+	if(s->dirty[word] == 0) {
+		return(0);
+	}
+	return(__sync_fetch_and_and(&s->dirty[word], 0));
+}
+
+/*
+@returns number of particles of a type
+*/
+unsigned int store_type_count(const store_t *s, int code) {
+	return(s->type_start[code + 1] - s->type_start[code]);
+}
+
+/*
+@returns bytes held by the columns
+*/
+size_t store_bytes(const store_t *s) {
+	return((size_t)s->capacity * (sizeof(float) + sizeof(uint8_t) +
+		sizeof(store_vertex_t) +
+		(s->slot_of != NULL ? 2 * sizeof(unsigned int) : 0)));
+}
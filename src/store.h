@@ -0,0 +1,162 @@
+/*
+ * store.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Columnar particle store, indexed by the compact particle ids of idmap.h
+ * (wire ids are mapped on decode).  Timestamps and 8-bit type codes are
+ * kept in separate aligned columns, padded so vector loops may run over
+ * whole STORE_PAD blocks.  Large columns are mapped rather than taken from
+ * the heap, so their page size and NUMA placement can be chosen
+ * (store_policy()).
+ *
+ * Positions are converted from the wire doubles once, at decode time, into
+ * an interleaved float vertex buffer, in GL's axis order and colored from a
+ * per-type palette, so the renderer can hand it to GL as is.  It is the
+ * only copy of the positions: passes wanting them by id read the vertex in
+ * the particle's slot.  Vertices are kept partitioned by type: each type
+ * owns the contiguous slot range [type_start[code], type_start[code + 1]),
+ * so a class can be drawn or skipped with one call.  Order within a range
+ * is otherwise free, see morton.h.  Slots are the ids until a particle
+ * first changes place; only then are the slot_of/id_of maps allocated.
+ * Every change to a vertex flags its STORE_CHUNK of slots dirty, so the
+ * renderer can upload just those.
+ *
+ * Per particle the store holds 21 bytes: 4 of t, 1 of type and 16 of
+ * vertex, plus 8 of slot_of/id_of once slots are reordered.  The three
+ * double arrays, short type and float t it replaced came to 30.
+ * store_bytes() counts the store's columns only; Morton order and motion
+ * keep columns of their own, and only while enabled.
+ */
+
+#ifndef STORE_H_
+#define STORE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* column alignment in bytes, one cache line */
+#define STORE_ALIGN 64
+/* columns are padded to a multiple of this many particles */
+#define STORE_PAD 16
+
+/* columns at least this large are mapped, in units of this size */
+#define STORE_HUGE_PAGE (2 * 1024 * 1024)
+/* vertices per dirty flag, 64 KB of vertex buffer */
+#define STORE_CHUNK 4096
+/* timestamp of a particle never updated */
+#define STORE_T_NONE -1.0f
+/* highest NUMA node count handled */
+#define STORE_NUMA_MAX_NODES 64
+
+/* page size for mapped columns, see store_policy() */
+typedef enum {
+	STORE_PAGES_DEFAULT,
+	STORE_PAGES_SMALL,
+	STORE_PAGES_TRANSPARENT,
+	STORE_PAGES_HUGE
+} store_pages_t;
+
+/* NUMA placement, or a node number >= 0 */
+#define STORE_NUMA_FIRST_TOUCH -1
+#define STORE_NUMA_INTERLEAVE -2
+#define STORE_NUMA_LOCAL -3
+
+/* particle type codes */
+typedef enum {
+	STORE_TYPE_FLUID,
+	STORE_TYPE_BOUNDARY,
+	STORE_TYPE_PISTON,
+	STORE_TYPE_PADDLE,
+	STORE_TYPE_GATE,
+	STORE_TYPE_OBJECT,
+	STORE_TYPE_TESTPOINT,
+	STORE_TYPE_SURFACE,
+	STORE_TYPE_OTHER,
+	STORE_TYPE_COUNT
+} store_type_t;
+
+/* RGBA8 color for each store_type_t */
+typedef struct {
+	uint8_t rgba[STORE_TYPE_COUNT][4];
+} store_palette_t;
+
+/*
+Render-ready vertex, laid out for glInterleavedArrays(GL_C4UB_V3F).
+Positions are swizzled to GL order: x, z, y.
+*/
+typedef struct {
+	uint8_t rgba[4];
+	float pos[3];
+} store_vertex_t;
+
+/*
+Particle columns, indexed by particle id (store index, see idmap.h).
+*/
+typedef struct {
+	/* number of particles */
+	unsigned int count;
+	/* allocated length of each column, count rounded up to STORE_PAD */
+	unsigned int capacity;
+	/* timestamp of the last update, STORE_T_NONE before the first */
+	float *t;
+	/* store_type_t codes */
+	uint8_t *type;
+	/* interleaved vertices by slot, capacity long */
+	store_vertex_t *vertex;
+	/* slot of each particle id and particle id in each slot, NULL while
+	every particle is in its own slot, see store_order() */
+	unsigned int *slot_of;
+	unsigned int *id_of;
+	/* first slot of each type, type_start[STORE_TYPE_COUNT] == count */
+	unsigned int type_start[STORE_TYPE_COUNT + 1];
+	/* particles moved between type ranges */
+	unsigned long long type_moves;
+	/* colors used for vertex */
+	store_palette_t palette;
+	/* types whose vertex colors are set by another pass, see motion.h,
+	store_set() leaves them alone */
+	uint32_t colored_types;
+	/* one flag per STORE_CHUNK slots whose vertices changed since the
+	renderer last took them, chunks flags in all */
+	uint32_t *dirty;
+	unsigned int chunks;
+	/* newest timestamp seen and how many particles carry it */
+	float current_t;
+	unsigned int current_count;
+} store_t;
+
+int store_policy(const char *pages, const char *numa);
+const char *store_policy_name(void);
+void *store_column(unsigned int capacity, size_t size);
+void store_column_free(void *column, unsigned int capacity, size_t size);
+int store_init(store_t *s, unsigned int count, const store_palette_t *palette);
+void store_free(store_t *s);
+int store_resize(store_t *s, unsigned int count);
+int store_order(store_t *s);
+uint8_t store_type_code(short particle_type);
+void store_set(store_t *s, unsigned int id, float t, double x, double y,
+		double z, uint8_t code);
+void store_clear(store_t *s, unsigned int id);
+void store_set_palette(store_t *s, const store_palette_t *palette);
+void store_dirty_chunk(store_t *s, unsigned int chunk);
+void store_dirty_all(store_t *s);
+uint32_t store_dirty_take(store_t *s, unsigned int word);
+unsigned int store_type_count(const store_t *s, int code);
+size_t store_bytes(const store_t *s);
+
+/*
+@returns slot of a particle id
+*/
+static inline unsigned int store_slot(const store_t *s, unsigned int id) {
+	return(s->slot_of != NULL ? s->slot_of[id] : id);
+}
+
+/*
+@returns particle id in a slot
+*/
+static inline unsigned int store_id(const store_t *s, unsigned int slot) {
+	return(s->id_of != NULL ? s->id_of[slot] : slot);
+}
+
+#endif /* STORE_H_ */
@@ -0,0 +1,232 @@
+/*
+ * store_bench.c
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Store allocation benchmark.  For each page size it allocates a store,
+ * puts it in Morton order as the client does, then times ingest (decoding
+ * every particle by id, as the data thread does) and the per-frame passes
+ * (a sequential read of the vertex buffer, as GL does when drawing, and a
+ * grid build).  Huge page usage is read back from /proc/self/smaps_rollup.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include "store.h"
+#include "parallel.h"
+#include "grid.h"
+#include "morton.h"
+
+/* keeps the read pass from being optimized away */
+static volatile double g_bench_sink;
+
+/* Local prototypes */
+static void bench_usage(void);
+static double bench_now(void);
+static double bench_random(unsigned long long *rng);
+static void bench_huge_kb(unsigned long *anon, unsigned long *hugetlb);
+static int bench_policy(const char *pages, const char *numa,
+		unsigned int particles, int iterations, parallel_t *pool);
+
+static void bench_usage(void) {
+	printf("usage: store_bench [ options ]\n\n");
+	printf("Options:\n\n");
+	printf("--particles -n <count>   Particle count (10000000)\n");
+	printf("--pages -p <name>        default, small, transparent or huge (all)\n");
+	printf("--numa -N <placement>    first-touch, interleave, local or a node (first-touch)\n");
+	printf("--threads -j <count>     Threads, 0 for one per CPU (0)\n");
+	printf("--iterations -i <count>  Passes to time (5)\n");
+}
+
+/*
+@returns monotonic time in seconds
+*/
+static double bench_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return(ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+/*
+@returns uniform random number in [0, 1), xorshift64*
+*/
+static double bench_random(unsigned long long *rng) {
+	*rng ^= *rng >> 12;
+	*rng ^= *rng << 25;
+	*rng ^= *rng >> 27;
+	return((double)((*rng * 2685821657736338717ULL) >> 11) / 9007199254740992.0);
+}
+
+/*
+Read this process' huge page usage in KB, 0 where not reported.
+*/
+static void bench_huge_kb(unsigned long *anon, unsigned long *hugetlb) {
+	FILE *fp = fopen("/proc/self/smaps_rollup", "r");
+	char line[256];
+
+	*anon = 0;
+	*hugetlb = 0;
+	if(fp == NULL) {
+		return;
+	}
+	while(fgets(line, sizeof(line), fp) != NULL) {
+		(void)sscanf(line, "AnonHugePages: %lu", anon);
+		(void)sscanf(line, "Private_Hugetlb: %lu", hugetlb);
+	}
+	fclose(fp);
+}
+
+/*
+Benchmark one allocation policy.
+
+@returns 0 on success, -1 on error
+*/
+static int bench_policy(const char *pages, const char *numa,
+		unsigned int particles, int iterations, parallel_t *pool) {
+	float origin[3] = { 0.0f, 0.0f, 0.0f };
+	float size[3] = { 100.0f, 50.0f, 20.0f };
+	unsigned long long rng = 1;
+	store_palette_t palette;
+	store_t store;
+	morton_t order;
+	grid_t grid;
+	unsigned long anon_kb, hugetlb_kb;
+	double start, alloc_ms, ingest_s, read_ms;
+	double sum = 0.0;
+	unsigned int id;
+	int i;
+
+	if(store_policy(pages, numa)) {
+		return(-1);
+	}
+	memset(&palette, 0, sizeof(palette));
+	start = bench_now();
+	if(store_init(&store, particles, &palette)) {
+		return(-1);
+	}
+	alloc_ms = (bench_now() - start) * 1000.0;
+	morton_init(&order, 1);
+	grid_init(&grid, GRID_PARTICLES_PER_CELL);
+
+	/* first timestep, then spatial order as in the client */
+	for(id = 0; id < particles; id++) {
+		double x = origin[0] + bench_random(&rng) * size[0];
+		double y = origin[1] + bench_random(&rng) * size[1];
+		double z = origin[2] + bench_random(&rng) * size[2];
+		store_set(&store, id, 0.0f, x, y, z, STORE_TYPE_FLUID);
+	}
+	if(morton_order(&order, &store, pool, origin, size, NULL)) {
+		return(-1);
+	}
+
+	/* ingest: every particle by id, scattering to Morton-ordered slots */
+	start = bench_now();
+	for(i = 1; i <= iterations; i++) {
+		for(id = 0; id < particles; id++) {
+			const float *p = store.vertex[store_slot(&store, id)].pos;
+			store_set(&store, id, (float)i, p[0] + 0.0001, p[2], p[1],
+				STORE_TYPE_FLUID);
+		}
+	}
+	ingest_s = (bench_now() - start) / iterations;
+
+	/* frame: stream the vertex buffer as a draw would */
+	start = bench_now();
+	for(i = 0; i < iterations; i++) {
+		for(id = 0; id < particles; id++) {
+			sum += store.vertex[id].pos[0];
+		}
+	}
+	read_ms = (bench_now() - start) * 1000.0 / iterations;
+	g_bench_sink = sum;
+
+	/* frame: spatial index */
+	for(i = 0; i < iterations; i++) {
+		if(grid_build(&grid, &store, pool, origin, size)) {
+			return(-1);
+		}
+	}
+
+	bench_huge_kb(&anon_kb, &hugetlb_kb);
+	printf("%-20s alloc(%7.2fms) ingest(%6.1fM/s) read(%7.2fms %5.2fGB/s) "
+		"grid(%7.2fms) thp(%luMB) hugetlb(%luMB)\n", store_policy_name(),
+		alloc_ms, particles / ingest_s / 1e6, read_ms,
+		particles * sizeof(store_vertex_t) / (read_ms / 1000.0) / 1e9,
+		grid.build_seconds * 1000.0 / grid.builds, anon_kb / 1024,
+		hugetlb_kb / 1024);
+
+	/* release before the policy changes, columns are freed by policy */
+	grid_free(&grid);
+	morton_free(&order);
+	store_free(&store);
+	return(0);
+}
+
+int main(int argc, char *argv[]) {
+	static struct option long_options[] = {
+		{ "particles", required_argument, 0, 'n' },
+		{ "pages", required_argument, 0, 'p' },
+		{ "numa", required_argument, 0, 'N' },
+		{ "threads", required_argument, 0, 'j' },
+		{ "iterations", required_argument, 0, 'i' },
+		{ "help", no_argument, 0, '?' },
+		{ 0, 0, 0, 0 }
+	};
+	static const char *all_pages[] = {
+		"default", "small", "transparent", "huge", NULL
+	};
+	const char *pages = NULL;
+	const char *numa = "first-touch";
+	unsigned int particles = 10000000;
+	int threads = 0;
+	int iterations = 5;
+	parallel_t pool;
+	int c;
+
+	while((c = getopt_long(argc, argv, "n:p:N:j:i:?", long_options,
+			NULL)) != -1) {
+		switch(c) {
+		case 'n':
+			particles = (unsigned int)strtoul(optarg, NULL, 10);
+			break;
+		case 'p':
+			pages = optarg;
+			break;
+		case 'N':
+			numa = optarg;
+			break;
+		case 'j':
+			threads = atoi(optarg);
+			break;
+		case 'i':
+			iterations = atoi(optarg);
+			break;
+		default:
+			bench_usage();
+			return(EXIT_FAILURE);
+		}
+	}
+	if(particles == 0 || iterations <= 0) {
+		bench_usage();
+		return(EXIT_FAILURE);
+	}
+	if(parallel_init(&pool, threads)) {
+		return(EXIT_FAILURE);
+	}
+	printf("particles(%u) threads(%i)\n", particles, pool.threads);
+	if(pages != NULL) {
+		c = bench_policy(pages, numa, particles, iterations, &pool);
+	} else {
+		for(c = 0; all_pages[c] != NULL; c++) {
+			if(bench_policy(all_pages[c], numa, particles, iterations, &pool)) {
+				break;
+			}
+		}
+		c = all_pages[c] != NULL ? -1 : 0;
+	}
+	parallel_free(&pool);
+	return(c ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -0,0 +1,344 @@
+/*
+ * stream.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/* buffer storage and sync entry points */
+#define GL_GLEXT_PROTOTYPES 1
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stream.h"
+
+/* headers too old for persistent mappings build a ring that never attaches */
+#if defined(GL_ARB_buffer_storage) && defined(GL_ARB_sync)
+#define STREAM_GL 1
+#endif
+
+/* mapping and storage flags of each buffer, write only: the mapping may be
+uncached, write-combined memory, and is only ever copied into */
+#define STREAM_MAP_FLAGS (GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | \
+		GL_MAP_COHERENT_BIT)
+
+/* locals */
+static int stream_supported(void);
+static void stream_wait(stream_t *st, int buffer);
+static void stream_poll(stream_t *st);
+static void stream_unmap(stream_t *st);
+static int stream_map(stream_t *st, unsigned int capacity, unsigned int chunks);
+
+/*
+@returns non-zero if the context has persistent mappings and fences
+*/
+static int stream_supported(void) {
+#ifdef STREAM_GL
+	const char *version = (const char*)glGetString(GL_VERSION);
+	const char *extensions = (const char*)glGetString(GL_EXTENSIONS);
+	int major = 0;
+	int minor = 0;
+
+	if(version != NULL && sscanf(version, "%d.%d", &major, &minor) == 2 &&
+			(major > 4 || (major == 4 && minor >= 4))) {
+		return(1);
+	}
+	return(extensions != NULL &&
+		strstr(extensions, "GL_ARB_buffer_storage") != NULL &&
+		(major > 3 || (major == 3 && minor >= 2) ||
+		strstr(extensions, "GL_ARB_sync") != NULL));
+#else
+	return(0);
+#endif
+}
+
+/*
+Wait for the GPU to finish with a buffer.
+*/
+static void stream_wait(stream_t *st, int buffer) {
+#ifdef STREAM_GL
+	if(st->fence[buffer] != NULL) {
+		(void)glClientWaitSync((GLsync)st->fence[buffer],
+			GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ULL);
+		glDeleteSync((GLsync)st->fence[buffer]);
+		st->fence[buffer] = NULL;
+	}
+#endif
+	pthread_mutex_lock(&st->lock);
+	st->busy &= ~(1U << buffer);
+	pthread_mutex_unlock(&st->lock);
+}
+
+/*
+Hand buffers whose fences have passed back to the publish thread.
+*/
+static void stream_poll(stream_t *st) {
+#ifdef STREAM_GL
+	int b;
+	for(b = 0; b < STREAM_BUFFERS; b++) {
+		GLenum status;
+		if(st->fence[b] == NULL) {
+			continue;
+		}
+		status = glClientWaitSync((GLsync)st->fence[b], 0, 0);
+		if(status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+			stream_wait(st, b);
+		}
+	}
+#else
+	(void)st;
+#endif
+}
+
+/*
+Unmap and delete the buffers, once the GPU is done with them.
+*/
+static void stream_unmap(stream_t *st) {
+	int b;
+	for(b = 0; b < STREAM_BUFFERS; b++) {
+		stream_wait(st, b);
+		if(st->id[b] != 0) {
+			glBindBuffer(GL_ARRAY_BUFFER, st->id[b]);
+			if(st->map[b] != NULL) {
+				(void)glUnmapBuffer(GL_ARRAY_BUFFER);
+			}
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+			glDeleteBuffers(1, &st->id[b]);
+		}
+		free(st->stale[b]);
+		st->id[b] = 0;
+		st->map[b] = NULL;
+		st->stale[b] = NULL;
+	}
+	st->capacity = 0;
+	st->words = 0;
+}
+
+/*
+Create and map the buffers.
+
+@returns 0 on success, -1 on error
+*/
+static int stream_map(stream_t *st, unsigned int capacity, unsigned int chunks) {
+#ifdef STREAM_GL
+	GLsizeiptr bytes = (GLsizeiptr)capacity * sizeof(store_vertex_t);
+	int b;
+
+	st->capacity = capacity;
+	st->words = (chunks + 31) / 32;
+	for(b = 0; b < STREAM_BUFFERS; b++) {
+		glGenBuffers(1, &st->id[b]);
+		glBindBuffer(GL_ARRAY_BUFFER, st->id[b]);
+		glBufferStorage(GL_ARRAY_BUFFER, bytes, NULL, STREAM_MAP_FLAGS);
+		st->map[b] = (store_vertex_t*)glMapBufferRange(GL_ARRAY_BUFFER, 0,
+			bytes, STREAM_MAP_FLAGS);
+		st->stale[b] = (uint32_t*)calloc(st->words, sizeof(uint32_t));
+		if(st->map[b] == NULL || st->stale[b] == NULL) {
+			fprintf(stderr, "stream_map: no mapping for %lu bytes (0x%x)\n",
+				(unsigned long)bytes, glGetError());
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+			stream_unmap(st);
+			return(-1);
+		}
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	return(0);
+#else
+	(void)st;
+	(void)capacity;
+	(void)chunks;
+	return(-1);
+#endif
+}
+
+/*
+Initialize, buffers are created by the first stream_attach().  Needs a
+current GL context.
+
+@param	st	ring, supported is 0 if the context cannot stream
+*/
+void stream_init(stream_t *st) {
+	memset(st, 0, sizeof(stream_t));
+	pthread_mutex_init(&st->lock, NULL);
+	st->ready = -1;
+	st->supported = stream_supported();
+	if(!st->supported) {
+		fprintf(stderr, "persistent buffer mappings unavailable, no streaming\n");
+	}
+}
+
+/*
+Delete the buffers.  Detach the store first.
+*/
+void stream_free(stream_t *st) {
+	stream_unmap(st);
+	pthread_mutex_destroy(&st->lock);
+}
+
+/*
+Stream a store's vertices through the ring.  Render thread, with the store's
+writer excluded.
+
+@param	st	ring
+@param	s	store, its vertex column is copied into the ring as published
+
+@returns 0 on success, -1 if the store cannot be streamed
+*/
+int stream_attach(stream_t *st, store_t *s) {
+	size_t bytes = s->capacity * sizeof(store_vertex_t);
+	int b;
+
+	if(st->store == s) {
+		return(0);
+	}
+	if(!st->supported || st->store != NULL) {
+		return(-1);
+	}
+	if(s->capacity != st->capacity) {
+		stream_unmap(st);
+		if(stream_map(st, s->capacity, s->chunks)) {
+			return(-1);
+		}
+	}
+	/* every buffer starts as a full copy */
+	for(b = 0; b < STREAM_BUFFERS; b++) {
+		stream_wait(st, b);
+		memcpy(st->map[b], s->vertex, bytes);
+		memset(st->stale[b], 0, st->words * sizeof(uint32_t));
+		memcpy(st->type_start[b], s->type_start, sizeof(s->type_start));
+	}
+	st->store = s;
+	st->ready = 0;
+	return(0);
+}
+
+/*
+Stop streaming a store.  Either thread, with the store's writer excluded;
+the ring stays mapped for the next stream_attach().
+
+@param	st	ring
+@param	s	store
+*/
+void stream_detach(stream_t *st, store_t *s) {
+	if(st->store != s || s == NULL) {
+		return;
+	}
+	st->store = NULL;
+	/* changes taken by the ring were never seen by other renderers */
+	store_dirty_all(s);
+}
+
+/*
+Publish the store's vertices: bring a free buffer up to date from the
+store's column and hand it to the renderer.  A buffer is free if the GPU is
+done with it and it is not the one published last, which the renderer may
+claim at any time.  If there is none the publish is put off, and the changes
+wait for the next.  Publish thread, as each timestep is published.
+
+@param	st	ring
+@param	s	store
+*/
+void stream_publish(stream_t *st, store_t *s) {
+	int next = -1;
+	unsigned int word;
+	int b;
+
+	if(st->store != s) {
+		return;
+	}
+	/* every buffer lacks this timestep's changes */
+	for(word = 0; word < st->words; word++) {
+		uint32_t flags = store_dirty_take(s, word);
+		if(flags == 0) {
+			continue;
+		}
+		for(b = 0; b < STREAM_BUFFERS; b++) {
+			st->stale[b][word] |= flags;
+		}
+	}
+
+	pthread_mutex_lock(&st->lock);
+	for(b = 1; b < STREAM_BUFFERS && next < 0; b++) {
+		int candidate = (st->ready + b) % STREAM_BUFFERS;
+		if(!(st->busy & (1U << candidate))) {
+			next = candidate;
+		}
+	}
+	pthread_mutex_unlock(&st->lock);
+	if(next < 0) {
+		st->stalls++;
+		return;
+	}
+
+	/* copy what the buffer lacks, writes only */
+	st->last_catchup_bytes = 0;
+	for(word = 0; word < st->words; word++) {
+		uint32_t flags = st->stale[next][word];
+		int bit;
+		if(flags == 0) {
+			continue;
+		}
+		st->stale[next][word] = 0;
+		for(bit = 0; bit < 32; bit++) {
+			unsigned int begin = (word * 32 + bit) * STORE_CHUNK;
+			unsigned int end = begin + STORE_CHUNK;
+			if(!(flags & (1U << bit)) || begin >= st->capacity) {
+				continue;
+			}
+			if(end > st->capacity) {
+				end = st->capacity;
+			}
+			memcpy(&st->map[next][begin], &s->vertex[begin],
+				(end - begin) * sizeof(store_vertex_t));
+			st->last_catchup_bytes += (end - begin) * sizeof(store_vertex_t);
+		}
+	}
+	memcpy(st->type_start[next], s->type_start, sizeof(s->type_start));
+
+	pthread_mutex_lock(&st->lock);
+	st->ready = next;
+	pthread_mutex_unlock(&st->lock);
+	st->catchup_bytes += st->last_catchup_bytes;
+	st->published++;
+}
+
+/*
+Bind the newest published buffer for drawing.  Render thread, call
+stream_release() after the draws.
+
+@param	st	ring
+
+@returns buffer bound, -1 if nothing is published
+*/
+int stream_claim(stream_t *st) {
+	int buffer;
+
+	stream_poll(st);
+	pthread_mutex_lock(&st->lock);
+	buffer = st->store != NULL ? st->ready : -1;
+	if(buffer >= 0) {
+		st->busy |= 1U << buffer;
+	}
+	pthread_mutex_unlock(&st->lock);
+	if(buffer >= 0) {
+		glBindBuffer(GL_ARRAY_BUFFER, st->id[buffer]);
+	}
+	return(buffer);
+}
+
+/*
+Fence the draws from a claimed buffer and unbind it.  The buffer stays busy
+until the fence passes.
+
+@param	st	ring
+@param	buffer	as returned by stream_claim()
+*/
+void stream_release(stream_t *st, int buffer) {
+#ifdef STREAM_GL
+	if(st->fence[buffer] != NULL) {
+		glDeleteSync((GLsync)st->fence[buffer]);
+	}
+	st->fence[buffer] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+#endif
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
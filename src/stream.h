@@ -0,0 +1,65 @@
+/*
+ * stream.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * Streaming vertex buffers.  A ring of STREAM_BUFFERS GL buffers, each
+ * persistently and coherently mapped write-only (ARB_buffer_storage).  The
+ * publish thread decodes packets into the store's own vertex column and its
+ * passes read and permute it there, in cached memory.  Publishing a
+ * timestep copies into a free buffer the chunks changed since that buffer
+ * was last written, then hands it to the renderer.  The renderer only binds
+ * and draws, placing a fence after each draw; a buffer is written again only
+ * once its fence has passed.  Nothing ever reads the mappings.
+ */
+
+#ifndef STREAM_H_
+#define STREAM_H_
+
+#include <pthread.h>
+#include "GL/glfw.h"
+#include "store.h"
+
+/* buffers in the ring: one written, one drawn, one in flight */
+#define STREAM_BUFFERS 3
+
+/*
+Ring of mapped buffers and its handoff state.
+*/
+typedef struct {
+	/* non-zero if the context has persistent mappings and fences */
+	int supported;
+	/* buffer names and mappings, capacity vertices each */
+	GLuint id[STREAM_BUFFERS];
+	store_vertex_t *map[STREAM_BUFFERS];
+	unsigned int capacity;
+	/* GLsync after the last draw from each buffer, render thread only */
+	void *fence[STREAM_BUFFERS];
+	/* store whose vertices are copied into the ring */
+	store_t *store;
+	/* chunks each buffer lacks, STORE_CHUNK slots per flag */
+	uint32_t *stale[STREAM_BUFFERS];
+	unsigned int words;
+	/* type ranges of each buffer's vertices */
+	unsigned int type_start[STREAM_BUFFERS][STORE_TYPE_COUNT + 1];
+	/* handoff: buffer last published, buffers GPU may read */
+	pthread_mutex_t lock;
+	int ready;
+	unsigned int busy;
+	/* publishes, publishes put off for want of a free buffer, bytes copied
+	into buffers */
+	unsigned long long published;
+	unsigned long long stalls;
+	unsigned long long catchup_bytes;
+	size_t last_catchup_bytes;
+} stream_t;
+
+void stream_init(stream_t *st);
+void stream_free(stream_t *st);
+int stream_attach(stream_t *st, store_t *s);
+void stream_detach(stream_t *st, store_t *s);
+void stream_publish(stream_t *st, store_t *s);
+int stream_claim(stream_t *st);
+void stream_release(stream_t *st, int buffer);
+
+#endif /* STREAM_H_ */
@@ -0,0 +1,159 @@
+/*
+ * vbo.c
+ *
+ *  Created on: Oct 16, 2026
+ */
+
+/* GL 1.5 buffer entry points */
+#define GL_GLEXT_PROTOTYPES 1
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vbo.h"
+
+/* locals */
+static int vbo_supported(void);
+static void vbo_upload(vbo_t *v, const store_t *s, unsigned int first,
+		unsigned int last);
+
+/*
+@returns non-zero if the context has buffer objects
+*/
+static int vbo_supported(void) {
+	const char *version = (const char*)glGetString(GL_VERSION);
+	const char *extensions = (const char*)glGetString(GL_EXTENSIONS);
+	int major = 0;
+	int minor = 0;
+
+	if(version != NULL && sscanf(version, "%d.%d", &major, &minor) == 2 &&
+			(major > 1 || (major == 1 && minor >= 5))) {
+		return(1);
+	}
+	return(extensions != NULL &&
+		strstr(extensions, "GL_ARB_vertex_buffer_object") != NULL);
+}
+
+/*
+Upload chunks first to last, inclusive.
+*/
+static void vbo_upload(vbo_t *v, const store_t *s, unsigned int first,
+		unsigned int last) {
+	unsigned int begin = first * STORE_CHUNK;
+	unsigned int end = (last + 1) * STORE_CHUNK;
+	size_t bytes;
+
+	if(end > v->capacity) {
+		end = v->capacity;
+	}
+	bytes = (end - begin) * sizeof(store_vertex_t);
+	glBufferSubData(GL_ARRAY_BUFFER, begin * sizeof(store_vertex_t), bytes,
+		&s->vertex[begin]);
+	v->last_bytes += bytes;
+	v->last_ranges++;
+}
+
+/*
+Create the buffer object, if the context has them.  Needs a current GL
+context.
+
+@param	v	buffer, id is 0 if vertices must stay in client memory
+*/
+void vbo_init(vbo_t *v) {
+	memset(v, 0, sizeof(vbo_t));
+	if(!vbo_supported()) {
+		fprintf(stderr, "buffer objects unavailable, using client arrays\n");
+		return;
+	}
+	glGenBuffers(1, &v->id);
+}
+
+/*
+Delete the buffer object.
+*/
+void vbo_free(vbo_t *v) {
+	if(v->id != 0) {
+		glDeleteBuffers(1, &v->id);
+	}
+	memset(v, 0, sizeof(vbo_t));
+}
+
+/*
+Bring the buffer up to date with a store and leave it bound to
+GL_ARRAY_BUFFER.  Only chunks flagged dirty are sent, merged into runs, a
+new or resized store is sent whole.
+
+@param	v	buffer
+@param	s	store to mirror
+
+@returns 0 on success, -1 if there is no buffer object
+*/
+int vbo_update(vbo_t *v, store_t *s) {
+	unsigned int word;
+	unsigned int run = 0;
+	int in_run = 0;
+
+	if(v->id == 0) {
+		return(-1);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, v->id);
+	v->last_bytes = 0;
+	v->last_ranges = 0;
+	v->full_bytes = s->capacity * sizeof(store_vertex_t);
+	v->updates++;
+	v->bytes_if_full += v->full_bytes;
+
+	if(s != v->store || s->capacity != v->capacity) {
+		/* flags go first, changes made during the copy are flagged again */
+		for(word = 0; word < (s->chunks + 31) / 32; word++) {
+			(void)store_dirty_take(s, word);
+		}
+		glBufferData(GL_ARRAY_BUFFER, v->full_bytes, s->vertex,
+			GL_STREAM_DRAW);
+		v->store = s;
+		v->capacity = s->capacity;
+		v->last_bytes = v->full_bytes;
+		v->last_ranges = 1;
+		v->bytes += v->last_bytes;
+		return(0);
+	}
+
+	for(word = 0; word < (s->chunks + 31) / 32; word++) {
+		uint32_t flags = store_dirty_take(s, word);
+		int bit;
+		if(flags == 0) {
+			/* close a run ending at the previous word */
+			if(in_run) {
+				vbo_upload(v, s, run, word * 32 - 1);
+				in_run = 0;
+			}
+			continue;
+		}
+		for(bit = 0; bit < 32; bit++) {
+			unsigned int chunk = word * 32 + bit;
+			if(flags & (1U << bit)) {
+				if(!in_run) {
+					run = chunk;
+					in_run = 1;
+				}
+			} else if(in_run) {
+				vbo_upload(v, s, run, chunk - 1);
+				in_run = 0;
+			}
+		}
+	}
+	if(in_run) {
+		vbo_upload(v, s, run, s->chunks - 1);
+	}
+	v->bytes += v->last_bytes;
+	return(0);
+}
+
+/*
+Unbind the buffer so later client arrays are read from memory.
+*/
+void vbo_unbind(const vbo_t *v) {
+	if(v->id != 0) {
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+}
@@ -0,0 +1,43 @@
+/*
+ * vbo.h
+ *
+ *  Created on: Oct 16, 2026
+ *
+ * GL buffer object mirroring a store's vertex buffer.  Each frame only the
+ * chunks the store flags dirty are uploaded, with glBufferSubData, so
+ * static boundaries and idle water cost no bandwidth.  Switching to a
+ * different store, or a resized one, uploads everything once.
+ */
+
+#ifndef VBO_H_
+#define VBO_H_
+
+#include "GL/glfw.h"
+#include "store.h"
+
+/*
+Buffer object and upload statistics.
+*/
+typedef struct {
+	/* buffer name, 0 if buffer objects are unavailable */
+	GLuint id;
+	/* store mirrored and its capacity when the buffer was sized */
+	const store_t *store;
+	unsigned int capacity;
+	/* bytes uploaded by the last update and a full copy's size */
+	size_t last_bytes;
+	size_t full_bytes;
+	/* glBufferSubData calls made by the last update */
+	unsigned int last_ranges;
+	/* totals */
+	unsigned long long updates;
+	unsigned long long bytes;
+	unsigned long long bytes_if_full;
+} vbo_t;
+
+void vbo_init(vbo_t *v);
+void vbo_free(vbo_t *v);
+int vbo_update(vbo_t *v, store_t *s);
+void vbo_unbind(const vbo_t *v);
+
+#endif /* VBO_H_ */